@@ -34,6 +34,23 @@ public:
 
     /** How long we should wait before considering the server to be timed out. */
     static constexpr double SERVER_TIMEOUT_S = SharedConfig::NETWORK_TICK_TIMESTEP_S * 2;
+
+    /** Inputs are sent unreliably. When connected over UDP, each input change
+        is re-sent on this many following ticks, so it survives a few lost
+        datagrams. */
+    static constexpr unsigned int INPUT_REDUNDANCY_TICKS = 3;
+
+    //-------------------------------------------------------------------------
+    // Replication
+    //-------------------------------------------------------------------------
+    /** The server sends changes to distant NPCs less often, so we extrapolate
+        them in between. When an update shows that we drifted, the correction
+        is spread over this many ticks instead of snapping. */
+    static constexpr Uint8 NPC_CORRECTION_TICKS = 4;
+
+    /** If an NPC drifted farther than this (in world units), it's snapped to
+        the server's position instead of being smoothly corrected. */
+    static constexpr float NPC_SNAP_DISTANCE = 64;
 };
 
 } // End namespace Client
@@ -13,13 +13,13 @@ namespace AM
 {
 namespace Client
 {
-Application::Application(const std::string& runPath)
+Application::Application(const std::string& runPath, Transport transport)
 : sdl(SDL_INIT_VIDEO)
 , sdlWindow("Amalgam", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
             SharedConfig::SCREEN_WIDTH, SharedConfig::SCREEN_HEIGHT, SDL_WINDOW_SHOWN)
 , sdlRenderer(sdlWindow, -1, SDL_RENDERER_ACCELERATED)
 , resourceManager(runPath, sdlRenderer)
-, network()
+, network(transport)
 , networkCaller(std::bind_front(&Network::tick, &network), SharedConfig::NETWORK_TICK_TIMESTEP_S,
                 "Network", true)
 , sim(network, resourceManager)
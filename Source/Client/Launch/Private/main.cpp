@@ -1,26 +1,36 @@
 #include "Application.h"
-#include "Ignore.h"
 #include "Log.h"
 
 #include "SDL2pp/Exception.hh"
 #include <SDL_filesystem.h>
 
 #include <exception>
+#include <string>
 
 using namespace AM;
 using namespace AM::Client;
 
 int main(int argc, char** argv)
 try {
-    // SDL2 needs this signature for main, but we don't use the parameters.
-    ignore(argc);
-    ignore(argv);
+    // Connect over TCP, unless "--udp" is given.
+    Transport transport = Transport::Tcp;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--udp") {
+            transport = Transport::Udp;
+        }
+        else {
+            LOG_INFO("Unknown argument: %s\n"
+                     "Usage: Client [--udp]",
+                     argv[i]);
+            return 1;
+        }
+    }
 
     // The path that this executable was ran from, excluding the binary name.
     std::string runPath{SDL_GetBasePath()};
 
     // Start the application (assumes control of the thread).
-    Application app(runPath);
+    Application app(runPath, transport);
     app.start();
 
     return 0;
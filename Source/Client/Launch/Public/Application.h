@@ -28,8 +28,9 @@ public:
     /**
      * @param runPath  The path that this application was ran from. Should be
      *                 prepended to any resource paths.
+     * @param transport  The transport to connect to the server over.
      */
-    Application(const std::string& runpath);
+    Application(const std::string& runpath, Transport transport);
 
     ~Application(){};
 
@@ -46,8 +46,19 @@ void MessageHandler::handleEntityUpdate(BinaryBuffer& messageRecBuffer,
     const std::vector<EntityState>& entities = entityUpdate->entityStates;
 
     // Iterate through the entities, checking if there's player or npc data.
+    // Note: Compact states and exits are always npcs, since the player is
+    //       always sent in full and never leaves its own AoI.
     bool playerFound = false;
     bool npcFound = false;
+    if (!(entityUpdate->compactEntityStates.empty())
+        || !(entityUpdate->exitedEntities.empty())) {
+        if (!(npcUpdateQueue.enqueue({NpcUpdateType::Update, entityUpdate}))) {
+            LOG_ERROR("Ran out of room in queue and memory allocation "
+                      "failed.");
+        }
+        npcFound = true;
+    }
+
     entt::entity playerEntity = network.getPlayerEntity();
     for (auto entityIt = entities.begin(); entityIt != entities.end();
          ++entityIt) {
@@ -1,5 +1,6 @@
 #include "Network.h"
 #include "Peer.h"
+#include "MessageBufferPool.h"
 #include "MessageTools.h"
 #include "EntityUpdate.h"
 #include "ConnectionResponse.h"
@@ -7,13 +8,15 @@
 #include "Config.h"
 #include "NetworkStats.h"
 #include <SDL_net.h>
+#include <algorithm>
 
 namespace AM
 {
 namespace Client
 {
-Network::Network()
-: server(nullptr)
+Network::Network(Transport inTransport)
+: transport(inTransport)
+, server(nullptr)
 , messageHandler(*this)
 , playerEntity(entt::null)
 , tickAdjustment(0)
@@ -24,6 +27,7 @@ Network::Network()
 , receiveThreadObj()
 , exitRequested(false)
 , headerRecBuffer(SERVER_HEADER_SIZE)
+, frameRecBuffer()
 , messageRecBuffer(Peer::MAX_MESSAGE_SIZE)
 , netstatsLoggingEnabled(true)
 , ticksSinceNetstatsLog(0)
@@ -49,7 +53,7 @@ Network::~Network()
 bool Network::connect()
 {
     // Try to connect.
-    server = Peer::initiate(Config::SERVER_IP, Config::SERVER_PORT);
+    server = Peer::initiate(Config::SERVER_IP, Config::SERVER_PORT, transport);
 
     // Spin up the receive thread.
     if (server != nullptr) {
@@ -76,7 +80,7 @@ void Network::tick()
     }
 }
 
-void Network::send(const BinaryBufferSharedPtr& message)
+void Network::send(const BinaryBufferSharedPtr& message, Channel channel)
 {
     if ((server == nullptr) || !(server->isConnected())) {
         LOG_ERROR("Tried to send while server is disconnected.");
@@ -87,7 +91,9 @@ void Network::send(const BinaryBufferSharedPtr& message)
     message->at(ClientHeaderIndex::AdjustmentIteration) = adjustmentIteration;
 
     // Send the message.
-    NetworkResult result = server->send(message);
+    NetworkResult result = (channel == Channel::Reliable)
+                               ? server->send(message)
+                               : server->sendUnreliable(message);
     if (result == NetworkResult::Success) {
         messagesSentSinceTick++;
 
@@ -152,6 +158,21 @@ NpcReceiveResult Network::receiveNpcUpdate(Uint64 timeoutMs)
 int Network::pollForMessages()
 {
     while (!exitRequested) {
+        // Over UDP, each frame of a batch arrives as its own datagram.
+        if (transport == Transport::Udp) {
+            NetworkResult frameResult
+                = server->receiveUnreliable(frameRecBuffer,
+                                            FRAME_WAIT_TIMEOUT_MS);
+            if (frameResult == NetworkResult::Success) {
+                processFrame();
+            }
+            else if (frameResult == NetworkResult::Disconnected) {
+                LOG_ERROR("Found server to be disconnected while trying to "
+                          "receive frame.");
+            }
+            continue;
+        }
+
         // Wait for a server header.
         NetworkResult headerResult = server->receiveBytesWait(
             headerRecBuffer.data(), SERVER_HEADER_SIZE);
@@ -217,6 +238,11 @@ void Network::setNetstatsLoggingEnabled(bool inNetstatsLoggingEnabled)
     netstatsLoggingEnabled = inNetstatsLoggingEnabled;
 }
 
+Transport Network::getTransport() const
+{
+    return transport;
+}
+
 void Network::sendHeartbeatIfNecessary()
 {
     if (messagesSentSinceTick == 0) {
@@ -226,7 +252,7 @@ void Network::sendHeartbeatIfNecessary()
 
         // Serialize the heartbeat message.
         BinaryBufferSharedPtr messageBuffer
-            = std::make_shared<BinaryBuffer>(Peer::MAX_MESSAGE_SIZE);
+            = MessageBufferPool::acquire();
         unsigned int startIndex = CLIENT_HEADER_SIZE + MESSAGE_HEADER_SIZE;
         std::size_t messageSize
             = MessageTools::serialize(*messageBuffer, heartbeat, startIndex);
@@ -236,7 +262,9 @@ void Network::sendHeartbeatIfNecessary()
                                         messageBuffer, CLIENT_HEADER_SIZE);
 
         // Send the message.
-        send(messageBuffer);
+        // Note: Heartbeats are superseded by the next one, so they don't
+        //       need to be reliable.
+        send(messageBuffer, Channel::Unreliable);
     }
 
     messagesSentSinceTick = 0;
@@ -278,18 +306,76 @@ void Network::processBatch()
         }
     }
 
-    /* Process any confirmed ticks. */
-    Uint8 confirmedTickCount
-        = headerRecBuffer[ServerHeaderIndex::ConfirmedTickCount];
-    for (unsigned int i = 0; i < confirmedTickCount; ++i) {
-        if (!(messageHandler.npcUpdateQueue.enqueue(
-                {NpcUpdateType::ExplicitConfirmation}))) {
-            LOG_ERROR("Ran out of room in queue and memory allocation failed.");
+    // Process any confirmed ticks.
+    processConfirmedTick();
+
+    // Record the number of received bytes.
+    NetworkStats::recordBytesReceived(bytesReceived);
+}
+
+void Network::processFrame()
+{
+    if (frameRecBuffer.size() < SERVER_HEADER_SIZE) {
+        LOG_ERROR("Received a frame that's too small. Size: %u",
+                  frameRecBuffer.size());
+    }
+
+    // Check if we need to adjust the tick offset.
+    std::copy_n(frameRecBuffer.begin(), SERVER_HEADER_SIZE,
+                headerRecBuffer.begin());
+    adjustIfNeeded(headerRecBuffer[ServerHeaderIndex::TickAdjustment],
+                   headerRecBuffer[ServerHeaderIndex::AdjustmentIteration]);
+
+    /* Process messages, if we received any. */
+    std::size_t messageStart = SERVER_HEADER_SIZE;
+    Uint8 messageCount = headerRecBuffer[ServerHeaderIndex::MessageCount];
+    for (unsigned int i = 0; i < messageCount; ++i) {
+        // Parse the message header.
+        if ((messageStart + MESSAGE_HEADER_SIZE) > frameRecBuffer.size()) {
+            LOG_ERROR("Received a truncated frame. Size: %u",
+                      frameRecBuffer.size());
+        }
+        const Uint8* messageHeader = &(frameRecBuffer[messageStart]);
+        MessageType messageType = static_cast<MessageType>(
+            messageHeader[MessageHeaderIndex::MessageType]);
+        Uint16 messageSize
+            = _SDLNet_Read16(&(messageHeader[MessageHeaderIndex::Size]));
+        messageStart += MESSAGE_HEADER_SIZE;
+        if ((messageStart + messageSize) > frameRecBuffer.size()) {
+            LOG_ERROR("Received a truncated frame. Size: %u",
+                      frameRecBuffer.size());
         }
+
+        // Copy the message into messageRecBuffer and push it into the
+        // appropriate queue.
+        std::copy_n((frameRecBuffer.begin() + messageStart), messageSize,
+                    messageRecBuffer.begin());
+        processReceivedMessage(messageType, messageSize);
+        messageStart += messageSize;
     }
+    receiveTimer.updateSavedTime();
+
+    // Process any confirmed ticks.
+    processConfirmedTick();
 
     // Record the number of received bytes.
-    NetworkStats::recordBytesReceived(bytesReceived);
+    NetworkStats::recordBytesReceived(frameRecBuffer.size());
+}
+
+void Network::processConfirmedTick()
+{
+    // Note: The confirmation is repeated in every batch, so it may confirm
+    //       ticks that we've already received. The NpcMovementSystem
+    //       ignores those.
+    Uint32 confirmedTick = _SDLNet_Read32(
+        &(headerRecBuffer[ServerHeaderIndex::ConfirmedTick]));
+    if (confirmedTick != 0) {
+        if (!(messageHandler.npcUpdateQueue.enqueue(
+                {NpcUpdateType::ImplicitConfirmation, nullptr,
+                 confirmedTick}))) {
+            LOG_ERROR("Ran out of room in queue and memory allocation failed.");
+        }
+    }
 }
 
 void Network::processReceivedMessage(MessageType messageType,
@@ -21,21 +21,18 @@ namespace Client
 enum class NpcUpdateType {
     /** An update contains actual npc entity data. */
     Update,
-    /** An implicit confirmation confirms all ticks up to the given tick. */
-    ImplicitConfirmation,
-    /** An explicit confirmation confirms 1 tick, with no particular tick given.
-     */
-    ExplicitConfirmation
+    /** An implicit confirmation confirms all ticks up to the given tick.
+        Confirmations may repeat ticks that were already confirmed. */
+    ImplicitConfirmation
 };
 
 /**
  * Represents a received NPC update message and/or any information we could
- * infer. Could contain data, or an implicit or explicit confirmation that no
- * changes occurred.
+ * infer. Could contain data, or a confirmation that no changes occurred.
  */
 struct NpcUpdateMessage {
     /** The type of information contained in this update. */
-    NpcUpdateType updateType = NpcUpdateType::ExplicitConfirmation;
+    NpcUpdateType updateType = NpcUpdateType::ImplicitConfirmation;
     /** If informationType == Update, contains the update message. */
     std::shared_ptr<const EntityUpdate> message = nullptr;
     /** If informationType == ImplicitConfirmation, contains the confirmed tick.
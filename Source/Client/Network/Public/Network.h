@@ -26,7 +26,10 @@ namespace Client
 class Network
 {
 public:
-    Network();
+    /**
+     * @param inTransport  The transport to connect to the server over.
+     */
+    Network(Transport inTransport = Transport::Tcp);
 
     ~Network();
 
@@ -49,8 +52,14 @@ public:
     /**
      * Sends bytes over the network.
      * Errors if the server is disconnected.
+     *
+     * @param channel  The channel to send on. Unreliable messages may be
+     *                 lost or dropped in favor of newer ones, so only use it
+     *                 for messages that are superseded by the next one (e.g.
+     *                 heartbeats and inputs).
      */
-    void send(const BinaryBufferSharedPtr& message);
+    void send(const BinaryBufferSharedPtr& message,
+              Channel channel = Channel::Reliable);
 
     /**
      * Returns a message if there are any in the associated queue.
@@ -68,8 +77,10 @@ public:
 
     /**
      * Thread function, started from connect().
-     * Tries to retrieve a message from the server.
-     * If successful, calls processBatch().
+     * Tries to retrieve a batch from the server.
+     * Over TCP, the batch's frames arrive on the stream, and each is handled
+     * by processBatch(). Over UDP, each frame arrives as a datagram, and is
+     * handled by processFrame().
      */
     int pollForMessages();
 
@@ -90,7 +101,14 @@ public:
 
     void setNetstatsLoggingEnabled(bool inNetstatsLoggingEnabled);
 
+    /** Returns the transport that we connect to the server over. */
+    Transport getTransport() const;
+
 private:
+    /** How long the receive thread waits for each frame over UDP, before
+        checking if it should exit. */
+    static constexpr unsigned int FRAME_WAIT_TIMEOUT_MS = 10;
+
     /**
      * If we haven't sent any messages since the last network tick, sends a
      * heartbeat.
@@ -100,11 +118,23 @@ private:
     /**
      * Processes the received header and following batch.
      * If any messages are expected, receives the messages.
-     * If it confirmed any ticks that had no changes, updates the confirmed tick
-     * count.
+     * If it confirmed any ticks that had no changes, passes the confirmation
+     * on.
      */
     void processBatch();
 
+    /**
+     * Processes the frame in frameRecBuffer, the same way as processBatch().
+     * @pre A frame ({server header, messages}) is in frameRecBuffer.
+     */
+    void processFrame();
+
+    /**
+     * If the header in headerRecBuffer confirms a tick, passes the
+     * confirmation on to the NPC update queue.
+     */
+    void processConfirmedTick();
+
     /**
      * Pushes a message into the appropriate queue, based on its contents.
      * @pre A serialized message is in messageRecBuffer, starting at index 0.
@@ -128,6 +158,9 @@ private:
      */
     void logNetworkStatistics();
 
+    /** The transport that we connect to the server over. */
+    const Transport transport;
+
     std::shared_ptr<Peer> server;
 
     /** Handles messages that we receive from the server, queueing them for the
@@ -166,6 +199,8 @@ private:
 
     /** Used to hold headers while we process them. */
     BinaryBuffer headerRecBuffer;
+    /** Used to hold frames that arrive as datagrams, while we process them. */
+    BinaryBuffer frameRecBuffer;
     /** Used to hold messages while we deserialize them. */
     BinaryBuffer messageRecBuffer;
 
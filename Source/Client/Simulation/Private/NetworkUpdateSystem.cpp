@@ -8,6 +8,7 @@
 #include "PlayerState.h"
 #include "IsDirty.h"
 #include "Peer.h"
+#include "MessageBufferPool.h"
 #include "Config.h"
 #include "Log.h"
 #include "Ignore.h"
@@ -23,6 +24,8 @@ NetworkUpdateSystem::NetworkUpdateSystem(Simulation& inSim, World& inWorld,
 : sim(inSim)
 , world(inWorld)
 , network(inNetwork)
+, latestInputMessage(nullptr)
+, redundantSendsLeft(0)
 {
 }
 
@@ -43,7 +46,7 @@ void NetworkUpdateSystem::sendInputState()
 
         // Serialize the client inputs message.
         BinaryBufferSharedPtr messageBuffer
-            = std::make_shared<BinaryBuffer>(Peer::MAX_MESSAGE_SIZE);
+            = MessageBufferPool::acquire();
         unsigned int startIndex = CLIENT_HEADER_SIZE + MESSAGE_HEADER_SIZE;
         std::size_t messageSize
             = MessageTools::serialize(*messageBuffer, clientInput, startIndex);
@@ -53,10 +56,23 @@ void NetworkUpdateSystem::sendInputState()
                                         messageBuffer, CLIENT_HEADER_SIZE);
 
         // Send the message.
-        network.send(messageBuffer);
+        network.send(messageBuffer, Channel::Unreliable);
+
+        // Over UDP, the message may be lost, so keep re-sending it for a
+        // few ticks.
+        latestInputMessage = messageBuffer;
+        redundantSendsLeft = (network.getTransport() == Transport::Udp)
+                                 ? Config::INPUT_REDUNDANCY_TICKS
+                                 : 0;
 
         registry.remove<IsDirty>(world.playerEntity);
     }
+    else if (redundantSendsLeft > 0) {
+        // Re-send our latest inputs. The server ignores any copies after the
+        // first that it receives.
+        network.send(latestInputMessage, Channel::Unreliable);
+        redundantSendsLeft--;
+    }
 }
 
 } // namespace Client
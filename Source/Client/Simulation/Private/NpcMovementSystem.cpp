@@ -4,9 +4,11 @@
 #include "World.h"
 #include "Network.h"
 #include "EntityUpdate.h"
+#include "CompactEntityState.h"
 #include "Name.h"
 #include "Position.h"
 #include "PreviousPosition.h"
+#include "PositionCorrection.h"
 #include "Movement.h"
 #include "Input.h"
 #include "Sprite.h"
@@ -17,6 +19,7 @@
 #include "Log.h"
 #include "Ignore.h"
 #include "entt/entity/registry.hpp"
+#include <cmath>
 #include <memory>
 #include <string>
 
@@ -77,6 +80,9 @@ void NpcMovementSystem::updateNpcs()
             applyUpdateMessage(stateUpdate.entityUpdate);
         }
 
+        // Continue any in-progress corrections.
+        applyPositionCorrections();
+
         /* Prepare for the next iteration. */
         lastProcessedTick++;
         stateUpdateQueue.pop();
@@ -118,12 +124,6 @@ void NpcMovementSystem::receiveEntityUpdates()
 
         // Handle the message appropriately.
         switch (npcUpdateMessage.updateType) {
-            case NpcUpdateType::ExplicitConfirmation:
-                // If we've been initialized, process the confirmation.
-                if (lastReceivedTick != 0) {
-                    handleExplicitConfirmation();
-                }
-                break;
             case NpcUpdateType::ImplicitConfirmation:
                 // If we've been initialized, process the confirmation.
                 if (lastReceivedTick != 0) {
@@ -139,14 +139,14 @@ void NpcMovementSystem::receiveEntityUpdates()
     }
 }
 
-void NpcMovementSystem::handleExplicitConfirmation()
-{
-    lastReceivedTick++;
-    stateUpdateQueue.push({lastReceivedTick, false, nullptr});
-}
-
 void NpcMovementSystem::handleImplicitConfirmation(Uint32 confirmedTick)
 {
+    // The server repeats its confirmation until it's superseded, so we may
+    // have already received these ticks.
+    if (confirmedTick <= lastReceivedTick) {
+        return;
+    }
+
     // If there's a gap > 1 between the latest received tick and the confirmed
     // tick, we know that no changes happened on the in-between ticks and can
     // push confirmations for them.
@@ -203,16 +203,95 @@ void NpcMovementSystem::moveAllNpcs()
     }
 }
 
+void NpcMovementSystem::redoMovement(entt::entity entity)
+{
+    auto [input, position, previousPos, movement]
+        = world.registry.get<Input, Position, PreviousPosition, Movement>(
+            entity);
+
+    // Go back to where the entity was before this tick, then move it.
+    position.x = previousPos.x;
+    position.y = previousPos.y;
+    position.z = previousPos.z;
+    MovementHelpers::moveEntity(position, movement, input.inputStates,
+                                SharedConfig::SIM_TICK_TIMESTEP_S);
+}
+
+void NpcMovementSystem::correctPosition(entt::entity entity,
+                                        const Position& serverPosition)
+{
+    entt::registry& registry = world.registry;
+    const Position& position = registry.get<Position>(entity);
+    float errorX = (serverPosition.x - position.x);
+    float errorY = (serverPosition.y - position.y);
+    float errorZ = (serverPosition.z - position.z);
+
+    // If we drifted too far, snap to the server's position.
+    if (std::hypot(errorX, errorY, errorZ) > Config::NPC_SNAP_DISTANCE) {
+        registry.patch<Position>(entity, [&serverPosition](Position& position) {
+            position = serverPosition;
+        });
+        if (registry.has<PositionCorrection>(entity)) {
+            registry.remove<PositionCorrection>(entity);
+        }
+        return;
+    }
+
+    // Spread the correction over the next few ticks.
+    // Note: This replaces any correction that's in progress, since it was
+    //       relative to an older position.
+    registry.emplace_or_replace<PositionCorrection>(
+        entity, errorX, errorY, errorZ, Config::NPC_CORRECTION_TICKS);
+}
+
+void NpcMovementSystem::applyPositionCorrections()
+{
+    entt::registry& registry = world.registry;
+    auto view = registry.view<PositionCorrection, Position>();
+    for (entt::entity entity : view) {
+        auto [correction, position]
+            = view.get<PositionCorrection, Position>(entity);
+
+        // Apply an even share of what's left.
+        float shareX = (correction.x / correction.ticksLeft);
+        float shareY = (correction.y / correction.ticksLeft);
+        float shareZ = (correction.z / correction.ticksLeft);
+        position.x += shareX;
+        position.y += shareY;
+        position.z += shareZ;
+        correction.x -= shareX;
+        correction.y -= shareY;
+        correction.z -= shareZ;
+
+        // If the correction is done, remove it.
+        // Note: Removing the entity that we're on doesn't invalidate the
+        //       view's iterator.
+        correction.ticksLeft--;
+        if (correction.ticksLeft == 0) {
+            registry.remove<PositionCorrection>(entity);
+        }
+    }
+}
+
 void NpcMovementSystem::applyUpdateMessage(
     const std::shared_ptr<const EntityUpdate>& entityUpdate)
 {
-    // Use the data in the message to correct any NPCs that changed inputs.
+    // Remove any NPCs that left our AoI.
+    entt::registry& registry = world.registry;
+    for (entt::entity entity : entityUpdate->exitedEntities) {
+        if (registry.valid(entity)) {
+            LOG_INFO("Entity removed. ID: %u", entity);
+            registry.destroy(entity);
+        }
+    }
+
+    // Use the data in the message to correct any NPCs that changed inputs or
+    // entered our AoI.
     const std::vector<EntityState>& entities = entityUpdate->entityStates;
     for (auto entityIt = entities.begin(); entityIt != entities.end();
          ++entityIt) {
         // Skip the player (not an NPC).
         entt::entity entity = entityIt->entity;
-        entt::registry& registry = world.registry;
         if (entity == registry.entity(world.playerEntity)) {
             continue;
         }
@@ -253,16 +332,68 @@ void NpcMovementSystem::applyUpdateMessage(
         registry.patch<Input>(
             entity, [entityIt](Input& input) { input = entityIt->input; });
 
-        // Update their position.
+        // Update their position, dropping any correction that's in progress.
         registry.patch<Position>(entity, [entityIt](Position& position) {
             position = entityIt->position;
         });
+        if (registry.has<PositionCorrection>(entity)) {
+            registry.remove<PositionCorrection>(entity);
+        }
 
         // Update their movements.
         registry.patch<Movement>(entity, [entityIt](Movement& movement) {
             movement = entityIt->movement;
         });
     }
+
+    // Apply any changes to NPCs that were already in our AoI.
+    for (const CompactEntityState& state : entityUpdate->compactEntityStates) {
+        entt::entity entity = state.entity;
+        if (!(registry.valid(entity))) {
+            LOG_INFO("Received changes for an unknown entity. ID: %u", entity);
+            continue;
+        }
+
+        if (state.changeMask & CompactEntityState::InputChanged) {
+            registry.patch<Input>(entity, [&state](Input& input) {
+                input.inputStates = state.input.inputStates;
+            });
+
+            // The server moved the entity using its new inputs, but we moved
+            // it using its old ones. If the server didn't send the resulting
+            // position (e.g. in input-only replication), redo this tick's
+            // movement using the new inputs.
+            if (!(state.changeMask & CompactEntityState::PositionXYChanged)) {
+                redoMovement(entity);
+            }
+        }
+
+        if (state.changeMask & CompactEntityState::VelocityChanged) {
+            registry.patch<Movement>(entity, [&state](Movement& movement) {
+                CompactEntityState::decodeVelocity(state.velocityCode,
+                                                   movement);
+            });
+        }
+
+        // If the server sent the entity's position, correct ours towards it.
+        // Note: We extrapolate between updates, so we'll usually be close.
+        if (state.changeMask
+            & (CompactEntityState::PositionXYChanged
+               | CompactEntityState::PositionZChanged)) {
+            Position serverPosition = registry.get<Position>(entity);
+            if (state.changeMask & CompactEntityState::PositionXYChanged) {
+                // Positions are relative to our AoI origin.
+                serverPosition.x
+                    = (entityUpdate->aoiOriginX + state.relativeX);
+                serverPosition.y
+                    = (entityUpdate->aoiOriginY + state.relativeY);
+            }
+            if (state.changeMask & CompactEntityState::PositionZChanged) {
+                serverPosition.z = state.z;
+            }
+            correctPosition(entity, serverPosition);
+        }
+    }
 }
 
 } // namespace Client
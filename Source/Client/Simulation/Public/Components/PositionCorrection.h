@@ -0,0 +1,31 @@
+#pragma once
+
+#include "SDL_stdinc.h"
+
+namespace AM
+{
+namespace Client
+{
+/**
+ * The remaining difference between an NPC's extrapolated position and the
+ * position that the server sent for it.
+ *
+ * Rather than snapping the NPC to the server's position, the difference is
+ * applied a piece at a time over the next few ticks.
+ */
+struct PositionCorrection {
+public:
+    //--------------------------------------------------------------------------
+    // Non-replicated data
+    //--------------------------------------------------------------------------
+    /** The difference that's left to apply. */
+    float x{0};
+    float y{0};
+    float z{0};
+
+    /** The number of ticks left to apply it over. */
+    Uint8 ticksLeft{0};
+};
+
+} // namespace Client
+} // namespace AM
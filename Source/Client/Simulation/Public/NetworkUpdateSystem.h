@@ -1,5 +1,6 @@
 #pragma once
 
+#include "NetworkDefs.h"
 #include <array>
 
 namespace AM
@@ -21,7 +22,10 @@ public:
 
     /**
      * If the player inputs have changed, sends them to the server.
-     * Else, sends an empty message as a heartbeat.
+     *
+     * Inputs are sent on the Unreliable channel, so they aren't held up
+     * behind a lost datagram. Over UDP, each change is re-sent for
+     * Config::INPUT_REDUNDANCY_TICKS more ticks, in case it was lost.
      */
     void sendInputState();
 
@@ -29,6 +33,12 @@ private:
     Simulation& sim;
     World& world;
     Network& network;
+
+    /** The latest inputs message that we sent. */
+    BinaryBufferSharedPtr latestInputMessage;
+
+    /** How many more ticks we'll re-send latestInputMessage for. */
+    unsigned int redundantSendsLeft;
 };
 
 } // namespace Client
@@ -1,11 +1,13 @@
 #pragma once
 
 #include "NetworkDefs.h"
+#include "entt/entity/registry.hpp"
 #include <queue>
 
 namespace AM
 {
 class EntityUpdate;
+class Position;
 
 namespace Client
 {
@@ -16,6 +18,12 @@ class Network;
 /**
  * Processes NPC (networked player and AI) entity update messages and moves
  * their entities appropriately.
+ *
+ * Between updates, NPCs are extrapolated using their latest inputs. The
+ * server sends changes to distant NPCs less often, so when an update shows
+ * that an NPC drifted from the server's position, the correction is spread
+ * over Config::NPC_CORRECTION_TICKS instead of snapping (unless it drifted
+ * farther than Config::NPC_SNAP_DISTANCE).
  */
 class NpcMovementSystem
 {
@@ -50,22 +58,39 @@ private:
      */
     void moveAllNpcs();
 
+    /**
+     * Moves the given NPC back to its previous position and re-runs this
+     * tick's movement, using its current inputs.
+     */
+    void redoMovement(entt::entity entity);
+
     /**
      * Receives NPC entity update messages from the network and pushes them into
      * the stateUpdateQueue.
      */
     void receiveEntityUpdates();
 
-    /** Pushes a message confirming that a tick was processed with no update. */
-    void handleExplicitConfirmation();
-    /** Pushes messages confirming ticks up to confirmedTick. */
+    /** Pushes messages confirming ticks up to confirmedTick. Ticks that
+        we've already received are ignored. */
     void handleImplicitConfirmation(const Uint32 confirmedTick);
     /** Handles an update message, including implicit confirmations based on it.
      */
     void handleUpdate(const std::shared_ptr<const EntityUpdate>& entityUpdate);
 
     /**
-     * Applies the given update message to the entity world state.
+     * Starts correcting the given NPC's position towards the given server
+     * position, or snaps to it if the NPC drifted too far.
+     */
+    void correctPosition(entt::entity entity, const Position& serverPosition);
+
+    /**
+     * Applies a tick's share of each in-progress position correction.
+     */
+    void applyPositionCorrections();
+
+    /**
+     * Applies the given update message to the entity world state, creating
+     * entities that entered our AoI and destroying ones that left it.
      */
     void applyUpdateMessage(
         const std::shared_ptr<const EntityUpdate>& entityUpdate);
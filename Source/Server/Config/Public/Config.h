@@ -4,6 +4,7 @@
 #include <SDL_stdinc.h>
 #include <string>
 #include <cmath>
+#include <array>
 
 namespace AM
 {
@@ -58,6 +59,108 @@ public:
     /** The minimum number of fresh diffs we'll use to calculate an adjustment.
         Aims to prevent thrashing. */
     static constexpr unsigned int MIN_FRESH_DIFFS = 3;
+
+    /** The most messages that a client's send queue will hold. Messages are
+        drained every network tick, so this is only reached if a client's
+        send thread stalls. If it's reached, the client is disconnected. */
+    static constexpr unsigned int MAX_SEND_QUEUE_SIZE = 64;
+
+    /** If more than this many bytes of a client's output are waiting to be
+        sent, the client isn't keeping up. Its EntityUpdates are then held
+        until it catches up, and their obsolete changes are dropped, so that
+        it doesn't receive a burst of stale ones. */
+    static constexpr unsigned int SEND_BACKPRESSURE_BYTES = 16 * 1024;
+
+    /** How long a client can go without keeping up before we disconnect it.
+     */
+    static constexpr double SEND_BACKPRESSURE_TIMEOUT_S = 3.0;
+
+    /** The number of threads that we'll use to send client updates.
+        Clients are sharded across the threads by NetworkID index. */
+    static constexpr unsigned int SEND_THREAD_COUNT = 4;
+
+    /** If true, client sockets are serviced through io_uring (received
+        through provided buffers, sent through per-thread send rings).
+        Experimental: off until it's been measured against epoll with
+        SocketBackendTest. Falls back to epoll if io_uring is unavailable. */
+    static constexpr bool USE_IO_URING = false;
+
+    /** The number of worker threads in the sim's job system. The sim thread
+        also runs jobs while it waits, so parallel work is spread across this
+        many threads + 1. */
+    static constexpr unsigned int JOB_THREAD_COUNT = 3;
+
+    /** Where our network statistics are periodically written, as JSON.
+        Overwritten each time. */
+    static constexpr const char* NETWORK_STATS_FILE_PATH
+        = "NetworkStats.json";
+
+    //-------------------------------------------------------------------------
+    // Replication
+    //-------------------------------------------------------------------------
+    /** The ways that we can replicate NPC changes to clients. */
+    enum class ReplicationMode {
+        /** Any changes to an NPC's inputs, velocity, or position are sent. */
+        FullState,
+        /** Only changes to an NPC's inputs are sent. Clients move NPCs using
+            the same deterministic MovementHelpers that we do, and we
+            periodically send a keyframe to correct any drift. */
+        InputOnly
+    };
+
+    /** How we replicate NPC changes to clients. */
+    static constexpr ReplicationMode REPLICATION_MODE
+        = ReplicationMode::FullState;
+
+    /** In InputOnly mode, how often (in ticks) each visible NPC's velocity
+        and position are sent. Entities are staggered across the interval so
+        that keyframes don't all land on the same tick. */
+    static constexpr unsigned int KEYFRAME_INTERVAL_TICKS = 30;
+
+    /** A region around a client's entity, and how often the changes of
+        entities within it are sent to the client. */
+    struct ReplicationTier {
+        /** The region's half-size, centered on the client's entity. */
+        float halfWidth;
+        float halfHeight;
+
+        /** How often (in ticks) changes are sent. 1 is every tick. Must be
+            less than 256. */
+        unsigned int updateInterval;
+    };
+
+    /** The replication tiers, nearest first. Each entity uses the first tier
+        that contains it, or the last if none do.
+        Entities entering and leaving the AoI aren't affected by tiers. */
+    static constexpr std::array<ReplicationTier, 2> REPLICATION_TIERS{{
+        // On screen.
+        {(SharedConfig::SCREEN_WIDTH / 2.0f),
+         (SharedConfig::SCREEN_HEIGHT / 2.0f), 1},
+        // The AoI's off-screen buffer zone.
+        {(SharedConfig::AOI_WIDTH / 2.0f), (SharedConfig::AOI_HEIGHT / 2.0f),
+         3},
+    }};
+
+    //-------------------------------------------------------------------------
+    // Update Prioritization
+    //-------------------------------------------------------------------------
+    /** The most bytes of EntityUpdates that we'll send each client per network
+        tick. Allowance that goes unused in one sim tick carries over to the
+        next, up to this amount. */
+    static constexpr unsigned int CLIENT_UPDATE_BYTES_PER_NETWORK_TICK = 2048;
+
+    /** How much faster an entity at the center of a client's AoI accumulates
+        update priority than one at the edge, minus 1. */
+    static constexpr float PROXIMITY_PRIORITY_SCALE = 4;
+
+    /** The distance (in world units) that an entity must move from the
+        state that a client last received to add 1 to its change priority.
+        Input and velocity changes each add 1 as well. */
+    static constexpr float CHANGE_PRIORITY_DISTANCE = 32;
+
+    /** The most that an entity's change can add to its update priority.
+        Entities entering a client's AoI get this amount. */
+    static constexpr float MAX_CHANGE_PRIORITY = 4;
 };
 
 } // End namespace Server
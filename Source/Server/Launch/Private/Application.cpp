@@ -11,20 +11,29 @@ namespace AM
 {
 namespace Server
 {
-Application::Application()
+Application::Application(Transport transport)
 : sdl(SDL_INIT_VIDEO)
 , sdlNetInit()
-, network()
+, network(transport)
 , networkCaller(std::bind_front(&Network::tick, &network), SharedConfig::NETWORK_TICK_TIMESTEP_S,
                 "Network", true)
 , sim(network)
 , simCaller(std::bind_front(&Simulation::tick, &sim), SharedConfig::SIM_TICK_TIMESTEP_S, "Sim",
             false)
+, scheduler()
 , exitRequested(false)
 {
     // Enable delay reporting.
     simCaller.reportDelays(Simulation::SIM_DELAYED_TIME_S);
 
+    // Enable timing statistics logging.
+    simCaller.reportStatistics(STATS_DUMP_INTERVAL_S);
+    networkCaller.reportStatistics(STATS_DUMP_INTERVAL_S);
+
+    // Let the sim process an iteration before sending a heartbeat.
+    scheduler.addCaller(simCaller);
+    scheduler.addCaller(networkCaller);
+
     // Spin up the thread to check for command line input.
     inputThreadObj = std::thread(&Application::receiveCliInput, this);
 }
@@ -39,31 +48,19 @@ void Application::start()
     // Set up file logging.
     Log::enableFileLogging("Server.log");
 
+    // Write logs from a background thread, so they don't stall our ticks.
+    Log::enableAsyncLogging();
+
     // Set up profiling.
     Profiler::init();
 
     LOG_INFO("Starting main loop.");
 
     // Prime the timers so they don't start at 0.
-    simCaller.initTimer();
-    networkCaller.initTimer();
+    scheduler.initTimers();
     while (!exitRequested) {
-        // Let the sim process an iteration if it needs to.
-        simCaller.update();
-
-        // Send a heartbeat if necessary.
-        networkCaller.update();
-
-        // See if we have enough time left to sleep.
-        double simTimeLeft = simCaller.getTimeTillNextCall();
-        double networkTimeLeft = networkCaller.getTimeTillNextCall();
-        if ((simTimeLeft > SLEEP_MINIMUM_TIME_S)
-            && (networkTimeLeft > SLEEP_MINIMUM_TIME_S)) {
-            // We have enough time to sleep for a few ms.
-            // Note: We try to delay for 1ms because the OS will generally end
-            //       up delaying us for 1-3ms.
-            SDL_Delay(1);
-        }
+        // Sleep until the sim or network is due, then run them.
+        scheduler.update();
     }
 }
 
@@ -1,21 +1,32 @@
 #include "Application.h"
-#include "Ignore.h"
+#include "Log.h"
 
 #include "SDL2pp/Exception.hh"
 
 #include <exception>
+#include <string>
 
 using namespace AM;
 using namespace AM::Server;
 
 int main(int argc, char** argv)
 try {
-    // SDL2 needs this signature for main, but we don't use the parameters.
-    ignore(argc);
-    ignore(argv);
+    // Clients connect over TCP, unless "--udp" is given.
+    Transport transport = Transport::Tcp;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--udp") {
+            transport = Transport::Udp;
+        }
+        else {
+            LOG_INFO("Unknown argument: %s\n"
+                     "Usage: Server [--udp]",
+                     argv[i]);
+            return 1;
+        }
+    }
 
     // Start the application (assumes control of the thread).
-    Application app;
+    Application app(transport);
     app.start();
 
     return 0;
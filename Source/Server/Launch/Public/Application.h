@@ -3,6 +3,7 @@
 #include "Network.h"
 #include "Simulation.h"
 #include "PeriodicCaller.h"
+#include "TickScheduler.h"
 #include "SDLNetInitializer.h"
 
 #include "SDL2pp/SDL.hh"
@@ -21,7 +22,10 @@ namespace Server
 class Application
 {
 public:
-    Application();
+    /**
+     * @param transport  The transport that clients will connect over.
+     */
+    Application(Transport transport);
 
     ~Application();
 
@@ -37,11 +41,8 @@ private:
      */
     void receiveCliInput();
 
-    /** We sleep for 1ms when possible to reduce our CPU usage. We can't trust
-        the scheduler to come back to us after exactly 1ms though, so we need
-        to give it some leeway. Picked .003 = 3ms as a reasonable number. Open
-        for tweaking. */
-    static constexpr double SLEEP_MINIMUM_TIME_S = .003;
+    /** How often our PeriodicCallers log their timing statistics. */
+    static constexpr double STATS_DUMP_INTERVAL_S = 5;
 
     SDL2pp::SDL sdl;
     SDLNetInitializer sdlNetInit;
@@ -52,6 +53,9 @@ private:
     Simulation sim;
     PeriodicCaller simCaller;
 
+    /** Sleeps until the next caller is due, then runs it. */
+    TickScheduler scheduler;
+
     /** Flags when to end the application. */
     std::atomic<bool> exitRequested;
 
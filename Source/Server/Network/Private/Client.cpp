@@ -3,8 +3,12 @@
 #include "Log.h"
 #include "MessageSorter.h"
 #include "NetworkStats.h"
+#include "MessageTools.h"
+#include "MessageBufferPool.h"
+#include <SDL2/SDL_net.h>
 #include <cmath>
 #include <array>
+#include <span>
 
 namespace AM
 {
@@ -13,7 +17,14 @@ namespace Server
 Client::Client(NetworkID inNetID, std::unique_ptr<Peer> inPeer)
 : netID(inNetID)
 , peer(std::move(inPeer))
-, batchBuffer{}
+, sendQueue(Config::MAX_SEND_QUEUE_SIZE)
+, dropRequested(false)
+, isBackpressured(false)
+, nextFrameToken(0)
+, unsettledReliableFrames(0)
+, lostUpdateTick(0)
+, settledUpdateTick(0)
+, latestInputTick(0)
 , latestSentSimTick(0)
 , tickDiffHistory(Config::TICKDIFF_TARGET)
 , numFreshDiffs(0)
@@ -26,96 +37,335 @@ Client::Client(NetworkID inNetID, std::unique_ptr<Peer> inPeer)
 void Client::queueMessage(const BinaryBufferSharedPtr& message,
                           Uint32 messageTick)
 {
-    if (!sendQueue.emplace(message, messageTick)) {
-        LOG_ERROR("Queue emplace failed.");
+    // Note: try_emplace() won't allocate, so the queue stays bounded.
+    if (!sendQueue.try_emplace(message, messageTick)) {
+        // Our send thread isn't draining the queue. Dropping the message
+        // would desync the client, so drop the client instead.
+        if (!dropRequested.exchange(true)) {
+            LOG_INFO("Send queue overflowed, dropping client. NetID: %u",
+                     netID);
+        }
     }
 }
 
 NetworkResult Client::sendWaitingMessages(Uint32 currentTick)
 {
-    if (peer == nullptr) {
+    if ((peer == nullptr) || dropRequested) {
         return NetworkResult::Disconnected;
     }
 
-    Uint8 messageCount = getWaitingMessageCount();
+    // Find out which of our earlier frames were delivered.
+    processDeliveryNotices();
+
+    /* If the client isn't keeping up, hold its messages until it does. */
+    std::size_t queueDepth = sendQueue.size_approx();
+    if (peer->getPendingOutputSize() > Config::SEND_BACKPRESSURE_BYTES) {
+        // If it's been too long, give up on the client.
+        if (!isBackpressured) {
+            isBackpressured = true;
+            backpressureTimer.updateSavedTime();
+        }
+        else if (backpressureTimer.getDeltaSeconds(false)
+                 > Config::SEND_BACKPRESSURE_TIMEOUT_S) {
+            LOG_INFO("Client isn't keeping up, dropping it. NetID: %u, "
+                     "pending bytes: %u",
+                     netID, peer->getPendingOutputSize());
+            dropRequested = true;
+            return NetworkResult::Disconnected;
+        }
+
+        holdWaitingMessages(queueDepth);
+        stats.recordBackpressure();
+        stats.recordSendQueueDepth(queueDepth);
+
+        // Keep trying to send what's pending.
+        return peer->flushPendingOutput();
+    }
+    isBackpressured = false;
+
+    /* If messages that must be delivered are in flight, hold the rest until
+       they're delivered, so the client doesn't receive them first. */
+    if (unsettledReliableFrames > 0) {
+        holdWaitingMessages(queueDepth);
+        return peer->flushPendingOutput();
+    }
+
+    /* Gather the messages to send. */
+    // Note: If we were holding messages, any that were queued since are
+    //       merged with them.
+    batchMessages.clear();
+    if (!(heldMessages.empty()) || !(heldUpdates.empty())) {
+        holdWaitingMessages(queueDepth);
+        releaseHeldMessages();
+    }
+    else {
+        for (std::size_t i = 0; i < queueDepth; ++i) {
+            if (!sendQueue.try_dequeue(batchMessages.emplace_back())) {
+                LOG_ERROR("Expected element but dequeue failed.");
+            }
+        }
+    }
+
+    std::size_t messageCount = batchMessages.size();
     if ((latestSentSimTick == 0) && (messageCount == 0)) {
-        // Nothing to send.
-        return NetworkResult::Success;
+        // Nothing new to send, but try to send anything that's still pending.
+        return peer->flushPendingOutput();
     }
 
-    /* Build the batch message. */
-    // Copy any waiting messages into the buffer.
-    unsigned int currentIndex = ServerHeaderIndex::MessageHeaderStart;
-    for (unsigned int i = 0; i < messageCount; ++i) {
-        /* Copy the message and message header into the buffer. */
-        std::pair<BinaryBufferSharedPtr, Uint32> messagePair;
-        if (!sendQueue.try_dequeue(messagePair)) {
-            LOG_ERROR("Expected element but dequeue failed.");
+    /* Build the batch. */
+    // Note: The messages aren't copied. We gather views of their shared
+    //       buffers and the peer sends straight from them.
+    // Note: If there are no waiting messages, we still send a batch header
+    //       to confirm that no changes occurred.
+    frameHeaders.clear();
+    frameHeaders.reserve(messageCount + 1);
+    sendBuffers.clear();
+    frameStarts.clear();
+    std::size_t firstFrameIndex = sentFrames.size();
+    beginFrame();
+
+    unsigned int frameSize = SERVER_HEADER_SIZE;
+    std::size_t totalBytes = SERVER_HEADER_SIZE;
+    for (QueuedMessage& messagePair : batchMessages) {
+        // If this message won't fit in the current frame, start a new one.
+        ServerHeader& currentHeader = frameHeaders.back();
+        std::size_t messageSize = messagePair.first->size();
+        if (((frameSize + messageSize) > Peer::MAX_MESSAGE_SIZE)
+            || (currentHeader[ServerHeaderIndex::MessageCount]
+                == SDL_MAX_UINT8)) {
+            beginFrame();
+            frameSize = SERVER_HEADER_SIZE;
+            totalBytes += SERVER_HEADER_SIZE;
         }
 
-        BinaryBufferSharedPtr& messageBuffer = messagePair.first;
-        std::copy(messageBuffer->begin(), messageBuffer->end(),
-                  &(batchBuffer[currentIndex]));
+        // Add the message to the frame.
+        sendBuffers.emplace_back(messagePair.first->data(), messageSize);
+        NetworkStats::recordMessageSent(
+            static_cast<MessageType>(messagePair.first->at(0)), messageSize);
+        frameHeaders.back()[ServerHeaderIndex::MessageCount]++;
+        frameSize += messageSize;
+        totalBytes += messageSize;
 
-        currentIndex += messageBuffer->size();
+        // Track what the frame holds, in case it's lost.
+        SentFrame& sentFrame = sentFrames.back();
+        Uint32 messageTick = messagePair.second;
+        if (static_cast<MessageType>(messagePair.first->at(0))
+            == MessageType::EntityUpdate) {
+            if (sentFrame.firstUpdateTick == 0) {
+                sentFrame.firstUpdateTick = messageTick;
+            }
+            sentFrame.lastUpdateTick = messageTick;
+        }
+        else {
+            if (sentFrame.reliableMessages.empty()) {
+                unsettledReliableFrames++;
+            }
+            sentFrame.reliableMessages.push_back(messagePair);
+        }
 
         // Track the latest tick we've sent.
-        Uint32 messageTick = messagePair.second;
         if (messageTick != 0) {
             latestSentSimTick = messageTick;
         }
     }
 
-    // Fill in the header.
-    fillHeader(messageCount, currentTick);
+    // Fill in the rest of the header data.
+    fillHeaders(currentTick);
 
     // Record the number of sent bytes.
-    NetworkStats::recordBytesSent(currentIndex);
+    NetworkStats::recordBytesSent(totalBytes);
+
+    // Send each frame as its own datagram.
+    // Note: This won't block. Over TCP, the frames are sent on the stream.
+    //       If the client's socket is full, the remainder is held by the
+    //       peer and sent first during our next call.
+    // Note: If the peer is using a send ring, it sends straight from our
+    //       buffers during the ring's submit(). Our references to the
+    //       messages are kept until our next call, so they outlive it.
+    NetworkResult result = NetworkResult::Success;
+    std::span<const std::span<const Uint8>> batchBuffers{sendBuffers};
+    for (std::size_t i = 0; i < frameStarts.size(); ++i) {
+        std::size_t frameEnd = ((i + 1) < frameStarts.size())
+                                   ? frameStarts[i + 1]
+                                   : sendBuffers.size();
+        result = peer->sendUnreliable(
+            batchBuffers.subspan(frameStarts[i], (frameEnd - frameStarts[i])),
+            sentFrames[firstFrameIndex + i].notifyToken);
+        if (result != NetworkResult::Success) {
+            break;
+        }
+    }
+
+    // Record this batch in our stats.
+    // Note: If the socket didn't accept all of it, the rest is pending.
+    stats.recordSend(messageCount, totalBytes, peer->getPendingOutputSize());
 
-    // Send the message.
-    // Note: If there were no waiting messages, we still send the batch header
-    // to confirm that no changes occurred.
-    return peer->send(&(batchBuffer[0]), currentIndex);
+    return result;
 }
 
-void Client::fillHeader(Uint8 messageCount, Uint32 currentTick)
+void Client::holdWaitingMessages(std::size_t messageCount)
 {
-    // Fill in the header adjustment info.
-    AdjustmentData tickAdjustment = getTickAdjustment();
-    batchBuffer[ServerHeaderIndex::TickAdjustment]
-        = static_cast<Uint8>(tickAdjustment.adjustment);
-    batchBuffer[ServerHeaderIndex::AdjustmentIteration]
-        = tickAdjustment.iteration;
+    for (std::size_t i = 0; i < messageCount; ++i) {
+        QueuedMessage messagePair;
+        if (!sendQueue.try_dequeue(messagePair)) {
+            LOG_ERROR("Expected element but dequeue failed.");
+        }
 
-    // Fill in the header message count.
-    batchBuffer[ServerHeaderIndex::MessageCount] = messageCount;
+        // If it's an EntityUpdate, add it to the merger.
+        BinaryBuffer& message = *(messagePair.first);
+        if (static_cast<MessageType>(message[MessageHeaderIndex::MessageType])
+            == MessageType::EntityUpdate) {
+            MessageTools::deserialize(message,
+                                      (message.size() - MESSAGE_HEADER_SIZE),
+                                      scratchUpdate, MESSAGE_HEADER_SIZE);
+            updateMerger.add(scratchUpdate);
+            heldUpdates.push_back(std::move(messagePair));
+        }
+        else {
+            heldMessages.push_back(std::move(messagePair));
+        }
+    }
+}
 
-    // If we haven't sent data or are caught up, don't try to confirm any ticks.
-    if ((latestSentSimTick == 0) || (latestSentSimTick == currentTick)) {
-        batchBuffer[ServerHeaderIndex::ConfirmedTickCount] = 0;
+void Client::releaseHeldMessages()
+{
+    // Send the other messages first, since they don't depend on the updates.
+    // Note: The only other message that we send is ConnectionResponse, which
+    //       always precedes the client's first update.
+    batchMessages.insert(batchMessages.end(), heldMessages.begin(),
+                         heldMessages.end());
+    heldMessages.clear();
+    if (heldUpdates.empty()) {
         return;
     }
-    else {
-        // Fill in the number of ticks we've processed since the last update.
-        // (the tick count increments at the end of a sim tick, so our latest
-        //  sent data is from currentTick - 1).
-        Uint8 confirmedTickCount = (currentTick - 1) - latestSentSimTick;
-        batchBuffer[ServerHeaderIndex::ConfirmedTickCount] = confirmedTickCount;
 
-        // Update our latestSent tracking to account for the confirmed ticks.
-        latestSentSimTick += confirmedTickCount;
+    // If there's only one update, send it as-is.
+    if (heldUpdates.size() == 1) {
+        updateMerger.take(mergedUpdates);
+        batchMessages.push_back(std::move(heldUpdates[0]));
+        heldUpdates.clear();
+        return;
     }
+
+    // Send the merged updates in place of the held updates.
+    // Note: Each merged update holds a subset of its held update's states,
+    //       so it always fits in a message.
+    updateMerger.take(mergedUpdates);
+    for (EntityUpdate& mergedUpdate : mergedUpdates) {
+        BinaryBufferSharedPtr messageBuffer = MessageBufferPool::acquire();
+        std::size_t messageSize = MessageTools::serialize(
+            *messageBuffer, mergedUpdate, MESSAGE_HEADER_SIZE);
+        MessageTools::fillMessageHeader(MessageType::EntityUpdate,
+                                        messageSize, messageBuffer, 0);
+        batchMessages.emplace_back(std::move(messageBuffer),
+                                   mergedUpdate.tickNum);
+    }
+    stats.recordSupersededUpdates(heldUpdates.size() - mergedUpdates.size());
+    heldUpdates.clear();
 }
 
-Uint8 Client::getWaitingMessageCount() const
+void Client::processDeliveryNotices()
 {
-    std::size_t size = sendQueue.size_approx();
-    if (size > SDL_MAX_UINT8) {
-        LOG_ERROR("Client's sendQueue contains too many messages to return as"
-                  "a Uint8.");
+    DeliveryNotice notice;
+    while (peer->popDeliveryNotice(notice)) {
+        // Notices come in send order, so this one is for our oldest frame.
+        if (sentFrames.empty()
+            || (sentFrames.front().notifyToken != notice.notifyToken)) {
+            LOG_ERROR("Received an out of order delivery notice. Token: %u",
+                      notice.notifyToken);
+        }
+        SentFrame& sentFrame = sentFrames.front();
+
+        if (!(notice.wasDelivered)) {
+            // Let the sim know that it needs to re-send this frame's updates.
+            if (sentFrame.firstUpdateTick != 0) {
+                recordLostUpdate(sentFrame.firstUpdateTick);
+            }
+
+            // Re-send the other messages ahead of anything we're holding.
+            heldMessages.insert(heldMessages.begin(),
+                                sentFrame.reliableMessages.begin(),
+                                sentFrame.reliableMessages.end());
+        }
+        if (!(sentFrame.reliableMessages.empty())) {
+            unsettledReliableFrames--;
+        }
+
+        // Every update up to this frame's has now been reported on.
+        // Note: This must come after recordLostUpdate(), see
+        //       takeUpdateDelivery().
+        if (sentFrame.lastUpdateTick != 0) {
+            settledUpdateTick = sentFrame.lastUpdateTick;
+        }
+
+        sentFrames.pop_front();
     }
+}
 
-    return size;
+void Client::recordLostUpdate(Uint32 tickNum)
+{
+    // Keep the earliest lost tick.
+    Uint32 lostTick = lostUpdateTick;
+    while (((lostTick == 0) || (tickNum < lostTick))
+           && !(lostUpdateTick.compare_exchange_weak(lostTick, tickNum))) {
+    }
+}
+
+void Client::beginFrame()
+{
+    frameHeaders.emplace_back();
+    frameHeaders.back().fill(0);
+    frameStarts.push_back(sendBuffers.size());
+    sendBuffers.emplace_back(frameHeaders.back().data(), SERVER_HEADER_SIZE);
+    sentFrames.emplace_back().notifyToken = nextFrameToken++;
+}
+
+void Client::fillHeaders(Uint32 currentTick)
+{
+    // Fill in the adjustment info.
+    // Note: Only the first frame carries the adjustment. The rest send 0,
+    //       which the client ignores.
+    AdjustmentData tickAdjustment = getTickAdjustment();
+    frameHeaders[0][ServerHeaderIndex::TickAdjustment]
+        = static_cast<Uint8>(tickAdjustment.adjustment);
+    if (tickAdjustment.adjustment != 0) {
+        stats.recordTickAdjustment();
+    }
+    for (ServerHeader& header : frameHeaders) {
+        header[ServerHeaderIndex::AdjustmentIteration]
+            = tickAdjustment.iteration;
+    }
+
+    // If we haven't sent data, don't try to confirm any ticks.
+    if (latestSentSimTick == 0) {
+        return;
+    }
+
+    // Account for the ticks we've processed since the last update.
+    // (the tick count increments at the end of a sim tick, so our latest
+    //  sent data is from currentTick - 1).
+    if ((currentTick - 1) > latestSentSimTick) {
+        latestSentSimTick = (currentTick - 1);
+    }
+
+    // Confirm them.
+    // Note: Only the last frame confirms ticks, since the confirmation
+    //       applies after all of the batch's messages.
+    // Note: The confirmation is absolute and repeated in every batch, so if
+    //       a frame is lost, the next one covers its confirmation.
+    _SDLNet_Write32(latestSentSimTick,
+                    &(frameHeaders.back()[ServerHeaderIndex::ConfirmedTick]));
+}
+
+UpdateDelivery Client::takeUpdateDelivery()
+{
+    // Note: The send thread records losses before it settles their ticks,
+    //       so we read the settled tick first. Any loss that it covers has
+    //       already been recorded.
+    UpdateDelivery delivery{};
+    delivery.settledTick = settledUpdateTick;
+    delivery.lostTick = lostUpdateTick.exchange(0);
+    return delivery;
 }
 
 Message Client::receiveMessage()
@@ -124,67 +374,70 @@ Message Client::receiveMessage()
         return {MessageType::NotSet, nullptr};
     }
 
-    // Receive the header.
+    // Try to receive a {client header, message} pair.
+    // Note: This doesn't block. If the full pair hasn't arrived yet, the
+    //       received bytes are held by the peer until the rest arrives.
     Uint8 headerBuf[CLIENT_HEADER_SIZE];
-    NetworkResult headerResult
-        = peer->receiveBytes(headerBuf, CLIENT_HEADER_SIZE, false);
-
-    // Receive the following message, or check for timeouts.
-    if (headerResult == NetworkResult::Success) {
-        // Process the adjustment iteration.
-        Uint8 receivedAdjIteration
-            = headerBuf[ClientHeaderIndex::AdjustmentIteration];
-        Uint8 expectedNextIteration = (latestAdjIteration + 1);
-
-        // If we received the next expected iteration, save it.
-        if (receivedAdjIteration == expectedNextIteration) {
-            latestAdjIteration = expectedNextIteration;
-            numFreshDiffs = 0;
-        }
-        else if (receivedAdjIteration > expectedNextIteration) {
-            LOG_ERROR("Skipped an adjustment iteration. Logic must be flawed.");
-        }
+    BinaryBufferPtr messageBuffer = nullptr;
+    MessageResult messageResult
+        = peer->receiveMessage(messageBuffer, headerBuf, CLIENT_HEADER_SIZE);
+    if (messageResult.networkResult != NetworkResult::Success) {
+        return {MessageType::NotSet, nullptr};
+    }
 
-        // Get the message.
-        // Note: This is a blocking read, but the data should immediately be
-        //       available since we send it all in 1 packet.
-        BinaryBufferPtr messageBuffer = nullptr;
-        MessageResult messageResult = peer->receiveMessageWait(messageBuffer);
-        if (messageResult.networkResult == NetworkResult::Success) {
-            // Got a message, update the receiveTimer.
-            receiveTimer.updateSavedTime();
-
-            // Record the number of received bytes.
-            NetworkStats::recordBytesReceived(CLIENT_HEADER_SIZE
-                                              + MESSAGE_HEADER_SIZE
-                                              + messageBuffer->size());
-
-            return {messageResult.messageType, std::move(messageBuffer)};
-        }
-        else {
-            LOG_ERROR("Data was not present when expected.");
-        }
+    // Process the adjustment iteration.
+    Uint8 receivedAdjIteration
+        = headerBuf[ClientHeaderIndex::AdjustmentIteration];
+    Uint8 expectedNextIteration = (latestAdjIteration + 1);
+
+    // If we received the next expected iteration, save it.
+    if (receivedAdjIteration == expectedNextIteration) {
+        latestAdjIteration = expectedNextIteration;
+        numFreshDiffs = 0;
     }
-    else if (headerResult == NetworkResult::NoWaitingData) {
-        // If we timed out, drop the connection.
-        double delta = receiveTimer.getDeltaSeconds(false);
-        if (delta > Config::CLIENT_TIMEOUT_S) {
-            peer = nullptr;
-            LOG_INFO("Dropped connection, peer timed out. Time since last "
-                     "message: %.6f seconds. Timeout: %.6f, NetID: %u",
-                     delta, Config::CLIENT_TIMEOUT_S, netID);
-            return {MessageType::NotSet, nullptr};
-        }
+    else if (receivedAdjIteration > expectedNextIteration) {
+        LOG_ERROR("Skipped an adjustment iteration. Logic must be flawed.");
     }
 
-    return {MessageType::NotSet, nullptr};
+    // Got a message, update the receiveTimer.
+    receiveTimer.updateSavedTime();
+
+    // Record the number of received bytes.
+    std::size_t receivedBytes
+        = (CLIENT_HEADER_SIZE + MESSAGE_HEADER_SIZE + messageBuffer->size());
+    NetworkStats::recordBytesReceived(receivedBytes);
+    NetworkStats::recordMessageReceived(messageResult.messageType,
+                                        receivedBytes);
+    stats.recordReceive(receivedBytes);
+
+    return {messageResult.messageType, std::move(messageBuffer)};
+}
+
+void Client::checkForTimeout()
+{
+    if (peer == nullptr) {
+        return;
+    }
+
+    // If we timed out, drop the connection.
+    double delta = receiveTimer.getDeltaSeconds(false);
+    if (delta > Config::CLIENT_TIMEOUT_S) {
+        peer = nullptr;
+        LOG_INFO("Dropped connection, peer timed out. Time since last "
+                 "message: %.6f seconds. Timeout: %.6f, NetID: %u",
+                 delta, Config::CLIENT_TIMEOUT_S, netID);
+    }
 }
 
 bool Client::isConnected()
 {
     // Peer might've been force-disconnected by dropping the reference.
     // It also could have internally detected a client-initiated disconnect.
-    return (peer == nullptr) ? false : peer->isConnected();
+    // If we couldn't keep up with our sends, we'll be dropped.
+    if ((peer == nullptr) || dropRequested) {
+        return false;
+    }
+    return peer->isConnected();
 }
 
 void Client::recordTickDiff(Sint64 tickDiff)
@@ -207,6 +460,16 @@ void Client::recordTickDiff(Sint64 tickDiff)
     }
 }
 
+bool Client::recordInputTick(Uint32 tickNum)
+{
+    if ((latestInputTick != 0) && (tickNum <= latestInputTick)) {
+        return false;
+    }
+
+    latestInputTick = tickNum;
+    return true;
+}
+
 Client::AdjustmentData Client::getTickAdjustment()
 {
     // Copy the history so we can work on it without staying locked.
@@ -227,6 +490,16 @@ NetworkID Client::getNetID()
     return netID;
 }
 
+const ClientStats& Client::getStats() const
+{
+    return stats;
+}
+
+ClientStats& Client::getStats()
+{
+    return stats;
+}
+
 Sint8 Client::calcAdjustment(
     CircularBuffer<Sint8, Config::TICKDIFF_HISTORY_LENGTH>& tickDiffHistoryCopy,
     unsigned int numFreshDiffsCopy)
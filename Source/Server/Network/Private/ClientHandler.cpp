@@ -1,7 +1,10 @@
 #include "ClientHandler.h"
 #include "Network.h"
 #include "SocketSet.h"
-#include <shared_mutex>
+#include "TcpSocket.h"
+#include "TcpPeer.h"
+#include "NetworkStats.h"
+#include "Config.h"
 #include <mutex>
 #include <memory>
 #include "Log.h"
@@ -10,18 +13,55 @@ namespace AM
 {
 namespace Server
 {
-ClientHandler::ClientHandler(Network& inNetwork)
+ClientHandler::ClientHandler(Network& inNetwork, Transport inTransport)
 : network(inNetwork)
+, transport(inTransport)
 , idPool(MAX_CLIENTS)
-, clientSet(std::make_shared<SocketSet>(MAX_CLIENTS))
-, acceptor(Network::SERVER_PORT, clientSet)
+, clientSet(nullptr)
+, acceptor(nullptr)
+, udpHost(nullptr)
 , receiveThreadObj()
 , exitRequested(false)
-, sendRequested(false)
+, sendIteration(0)
+, numFinishedSendThreads(0)
 {
+    // Open the listener for our transport.
+    if (transport == Transport::Udp) {
+        udpHost = std::make_shared<UdpHost>(Network::SERVER_PORT);
+        LOG_INFO("Accepting clients over UDP.");
+    }
+    else {
+        clientSet = std::make_shared<SocketSet>(
+            MAX_CLIENTS, (Config::USE_IO_URING ? SocketSet::Backend::IoUring
+                                               : SocketSet::Backend::Epoll));
+        acceptor = std::make_unique<Acceptor>(Network::SERVER_PORT, clientSet);
+        LOG_INFO("Accepting clients over TCP.");
+
+        // If io_uring is working, batch each send thread's sends too.
+        if (clientSet->getBackend() == SocketSet::Backend::IoUring) {
+            unsigned int maxClientsPerShard
+                = ((MAX_CLIENTS + Config::SEND_THREAD_COUNT - 1)
+                   / Config::SEND_THREAD_COUNT);
+            for (unsigned int i = 0; i < Config::SEND_THREAD_COUNT; ++i) {
+                sendRings.push_back(
+                    std::make_unique<TcpSendRing>(maxClientsPerShard));
+                if (!(sendRings.back()->isAvailable())) {
+                    LOG_INFO("Falling back to unbatched sends.");
+                    sendRings.clear();
+                    break;
+                }
+            }
+        }
+    }
+
+    timeoutCheckTimer.updateSavedTime();
+
     // Start the send and receive threads.
     receiveThreadObj = std::thread(&ClientHandler::serviceClients, this);
-    sendThreadObj = std::thread(&ClientHandler::sendClientUpdates, this);
+    for (unsigned int i = 0; i < Config::SEND_THREAD_COUNT; ++i) {
+        sendThreadObjs.emplace_back(&ClientHandler::sendClientUpdates, this,
+                                    i);
+    }
 }
 
 ClientHandler::~ClientHandler()
@@ -31,20 +71,24 @@ ClientHandler::~ClientHandler()
 
     {
         std::unique_lock<std::mutex> lock(sendMutex);
-        sendRequested = true;
+        sendIteration++;
+    }
+    sendCondVar.notify_all();
+    for (std::thread& sendThreadObj : sendThreadObjs) {
+        sendThreadObj.join();
     }
-    sendCondVar.notify_one();
-    sendThreadObj.join();
 }
 
 void ClientHandler::beginSendClientUpdates()
 {
-    // Wake the send thread.
+    // Wake the send threads.
     {
         std::unique_lock<std::mutex> lock(sendMutex);
-        sendRequested = true;
+        sendIteration++;
+        numFinishedSendThreads = 0;
+        sendTimer.updateSavedTime();
     }
-    sendCondVar.notify_one();
+    sendCondVar.notify_all();
 }
 
 void ClientHandler::serviceClients()
@@ -55,68 +99,102 @@ void ClientHandler::serviceClients()
         // Check if there are any new clients to connect.
         acceptNewClients(clientMap);
 
-        // Erase any clients who were detected to be disconnected.
+        // Erase any clients who were detected to be disconnected, and
+        // delete any erased clients that are no longer being read.
         eraseDisconnectedClients(clientMap);
+        clientMap.reclaimRetired();
 
-        // Check if there's any clients with activity, and receive all their
+        // Wait for any clients to have activity, and receive all their
         // messages.
-        // Note: Doesn't need a lock because we only mutate the map from this
-        //       thread.
-        int numReceived = 0;
-        if (clientMap.size() != 0) {
-            numReceived = receiveClientMessages(clientMap);
-        }
+        // Note: Doesn't need a ReadGuard because we only mutate the map from
+        //       this thread.
+        int numReceived = receiveClientMessages(clientMap);
 
         // If we received messages, deserialize and route them.
         if (numReceived != 0) {
             network.processReceivedMessages(receiveQueue);
         }
-        else {
-            // There wasn't any activity, delay so we don't waste CPU spinning.
-            SDL_Delay(INACTIVE_DELAY_TIME_MS);
+
+        // If it's time, check for any clients that have timed out.
+        if (timeoutCheckTimer.getDeltaSeconds(false)
+            > TIMEOUT_CHECK_INTERVAL_S) {
+            checkClientTimeouts(clientMap);
+            timeoutCheckTimer.updateSavedTime();
         }
     }
 }
 
-void ClientHandler::sendClientUpdates()
+void ClientHandler::sendClientUpdates(unsigned int shardIndex)
 {
-    std::shared_mutex& clientMapMutex = network.getClientMapMutex();
     ClientMap& clientMap = network.getClientMap();
 
+    Uint64 latestIteration = 0;
     while (!exitRequested) {
         // Wait until this thread is signaled by beginSendClientUpdates().
         std::unique_lock<std::mutex> lock(sendMutex);
-        sendCondVar.wait(lock, [this] { return sendRequested; });
+        sendCondVar.wait(lock, [this, latestIteration] {
+            return (sendIteration != latestIteration);
+        });
+        latestIteration = sendIteration;
+        lock.unlock();
+
+        if (exitRequested) {
+            break;
+        }
+
+        {
+            // Keep the clients alive while we run through them.
+            ClientMap::ReadGuard readGuard(clientMap);
 
-        // Acquire a read lock before running through the client map.
-        std::shared_lock readLock(clientMapMutex);
+            // Run through the clients in our shard, sending their waiting
+            // messages.
+            Uint32 currentTick = network.getCurrentTick();
+            clientMap.forEachInStride(
+                shardIndex, Config::SEND_THREAD_COUNT,
+                [currentTick](std::size_t, Client& client) {
+                    client.sendWaitingMessages(currentTick);
+                });
 
-        // Run through the clients, sending their waiting messages.
-        Uint32 currentTick = network.getCurrentTick();
-        for (auto& pair : clientMap) {
-            pair.second->sendWaitingMessages(currentTick);
+            // If we're batching, send everything that the clients queued.
+            // Note: This must happen before the ReadGuard is released, since
+            //       the ring holds references to the clients' peers.
+            if (!(sendRings.empty())) {
+                sendRings[shardIndex]->submit();
+            }
         }
 
-        sendRequested = false;
+        // If we're the last thread to finish this iteration, record how long
+        // the whole send took.
+        // Note: If a new iteration began while we were sending, we're late and
+        //       don't count towards it.
+        lock.lock();
+        if (latestIteration == sendIteration) {
+            numFinishedSendThreads++;
+            if (numFinishedSendThreads == Config::SEND_THREAD_COUNT) {
+                NetworkStats::recordSendTime(sendTimer.getDeltaSeconds(false));
+            }
+        }
     }
 }
 
 void ClientHandler::acceptNewClients(ClientMap& clientMap)
 {
-    // Creates the new peer, which adds itself to the socket set.
-    std::unique_ptr<Peer> newPeer = acceptor.accept();
+    // Creates the new peer. TCP peers add themselves to the socket set.
+    std::unique_ptr<Peer> newPeer = acceptPeer();
 
     while (newPeer != nullptr) {
         NetworkID newID = idPool.reserveID();
-        LOG_INFO("New client connected. Assigning netID: %u", newID);
-
-        // Add the peer to the Network's clientMap, constructing a Client
-        // in-place.
-        std::unique_lock writeLock(network.getClientMapMutex());
-        if (!(clientMap
-                  .try_emplace(newID, std::make_shared<Client>(
-                                          newID, std::move(newPeer)))
-                  .second)) {
+        LOG_INFO("New client connected. Assigning netID: %u (index: %u, "
+                 "generation: %u)",
+                 newID, IDPool::getIndex(newID), IDPool::getGeneration(newID));
+
+        // Track which client owns this peer.
+        trackPeer(*newPeer, newID);
+
+        // Add the peer to the Network's clientMap, wrapped in a new Client.
+        if (!(clientMap.insert(
+                IDPool::getIndex(newID),
+                std::make_unique<Client>(newID, std::move(newPeer))))) {
             idPool.freeID(newID);
             LOG_ERROR("Ran out of room in client map or key already existed.");
         }
@@ -126,67 +204,146 @@ void ClientHandler::acceptNewClients(ClientMap& clientMap)
             LOG_ERROR("Ran out of room in queue and memory allocation failed.");
         }
 
-        newPeer = acceptor.accept();
+        newPeer = acceptPeer();
+    }
+}
+
+std::unique_ptr<Peer> ClientHandler::acceptPeer()
+{
+    if (transport == Transport::Udp) {
+        return udpHost->accept();
+    }
+    else {
+        return acceptor->accept();
+    }
+}
+
+void ClientHandler::trackPeer(Peer& peer, NetworkID netID)
+{
+    // Note: A dropped client's socket or peer may have been freed and its
+    //       address reused, so we overwrite any existing entry.
+    if (transport == Transport::Udp) {
+        udpPeerIDMap.insert_or_assign(static_cast<const UdpPeer*>(&peer),
+                                      netID);
+    }
+    else {
+        TcpPeer& tcpPeer = static_cast<TcpPeer&>(peer);
+        socketIDMap.insert_or_assign(&(tcpPeer.getSocket()), netID);
+
+        // The client's sends happen on its shard's send thread, so they go
+        // through that thread's ring.
+        if (!(sendRings.empty())) {
+            unsigned int shardIndex
+                = (IDPool::getIndex(netID) % Config::SEND_THREAD_COUNT);
+            tcpPeer.setSendRing(sendRings[shardIndex].get());
+        }
     }
 }
 
 void ClientHandler::eraseDisconnectedClients(ClientMap& clientMap)
 {
     /* Erase any disconnected clients. */
-    // Only need a read lock to check for disconnects.
-    for (auto it = clientMap.begin(); it != clientMap.end();) {
-        std::shared_ptr<Client>& client = it->second;
-
-        if (!(client->isConnected())) {
-            // Need to modify the map, acquire a write lock.
-            std::unique_lock writeLock(network.getClientMapMutex());
+    // Note: Erasing doesn't invalidate forEach(), and any readers that are
+    //       still using the client will finish before it's deleted.
+    clientMap.forEach([&](std::size_t id, Client& client) {
+        if (!(client.isConnected())) {
+            NetworkID netID = client.getNetID();
 
             // Add an event to the Network's queue.
-            network.getDisconnectEventQueue().enqueue(it->first);
+            network.getDisconnectEventQueue().enqueue(netID);
+
+            // Stop checking the client's socket.
+            // Note: The client's peer isn't destroyed until any readers are
+            //       done with it, and the set would keep reporting its socket
+            //       until then (e.g. closed sockets stay ready).
+            auto ownsPeer = [netID](const auto& pair) {
+                return (pair.second == netID);
+            };
+            for (const auto& [socket, socketNetID] : socketIDMap) {
+                if (socketNetID == netID) {
+                    clientSet->remSocket(*socket);
+                }
+            }
 
             // Erase the disconnected client.
-            LOG_INFO("Erased disconnected client with netID: %u.", it->first);
-            idPool.freeID(it->first);
-            it = clientMap.erase(it);
-        }
-        else {
-            ++it;
+            LOG_INFO("Erased disconnected client with netID: %u.", netID);
+            std::erase_if(socketIDMap, ownsPeer);
+            std::erase_if(udpPeerIDMap, ownsPeer);
+            idPool.freeID(netID);
+            clientMap.erase(id);
         }
-    }
+    });
 }
 
 int ClientHandler::receiveClientMessages(ClientMap& clientMap)
 {
-    // Update each client's internal socket isReady().
-    // Note: We check all clients regardless of whether this returns > 0
-    //       because, even if there's no activity, we need to check for
-    //       timeouts.
-    clientSet->checkSockets(0);
-
-    /* Iterate through all clients. */
-    // Note: Doesn't need a lock because we only mutate the map from this
+    /* Wait for activity, and find the clients that had it. */
+    activeIDs.clear();
+    if (transport == Transport::Udp) {
+        // Receive all waiting datagrams and hand them to their peers.
+        for (UdpPeer* peer : udpHost->receive(SOCKET_WAIT_TIMEOUT_MS)) {
+            // Note: Peers that haven't been accepted yet are reported again
+            //       once they are.
+            auto peerIt = udpPeerIDMap.find(peer);
+            if (peerIt != udpPeerIDMap.end()) {
+                activeIDs.push_back(peerIt->second);
+            }
+        }
+    }
+    else {
+        // This updates each active client's internal socket isReady() and
+        // gives us the list of active sockets.
+        int numReady = clientSet->checkSockets(SOCKET_WAIT_TIMEOUT_MS);
+        if (numReady <= 0) {
+            return 0;
+        }
+
+        for (const TcpSocket* socket : clientSet->getReadySockets()) {
+            // Find the client that owns this socket.
+            // Note: Sockets are removed from the set when their client is
+            //       erased, so this shouldn't fail. If it does, the client is
+            //       gone and there's nothing to receive.
+            auto socketIt = socketIDMap.find(socket);
+            if (socketIt == socketIDMap.end()) {
+                continue;
+            }
+
+            activeIDs.push_back(socketIt->second);
+        }
+    }
+
+    /* Iterate through the clients with activity. */
+    // Note: Doesn't need a ReadGuard because we only mutate the map from this
     //       thread.
     int numReceived = 0;
-    for (auto& pair : clientMap) {
-        const std::shared_ptr<Client>& clientPtr = pair.second;
+    for (NetworkID netID : activeIDs) {
+        Client* client = clientMap.find(IDPool::getIndex(netID));
+        if (client == nullptr) {
+            continue;
+        }
 
-        /* If there's potentially data waiting, try to receive all messages
-           from the client. */
-        Message resultMessage = clientPtr->receiveMessage();
+        /* Try to receive all messages from the client. */
+        Message resultMessage = client->receiveMessage();
         while (resultMessage.messageType != MessageType::NotSet) {
             // Queue the message.
-            std::weak_ptr<Client> clientWeakPtr = clientPtr;
-            receiveQueue.emplace(clientPtr->getNetID(),
-                                 std::move(clientWeakPtr),
+            receiveQueue.emplace(client->getNetID(),
                                  std::move(resultMessage));
 
             numReceived++;
-            resultMessage = clientPtr->receiveMessage();
+            resultMessage = client->receiveMessage();
         }
     }
 
     return numReceived;
 }
 
+void ClientHandler::checkClientTimeouts(ClientMap& clientMap)
+{
+    // Note: Doesn't need a ReadGuard because we only mutate the map from
+    //       this thread.
+    clientMap.forEach(
+        [](std::size_t, Client& client) { client.checkForTimeout(); });
+}
+
 } // End namespace Server
 } // End namespace AM
@@ -0,0 +1,134 @@
+#include "EntityUpdateMerger.h"
+#include <algorithm>
+
+namespace AM
+{
+namespace Server
+{
+EntityUpdateMerger::EntityUpdateMerger()
+: addedUpdates()
+, updateCount(0)
+{
+}
+
+void EntityUpdateMerger::add(const EntityUpdate& entityUpdate)
+{
+    // Copy the update.
+    std::size_t updateIndex = updateCount;
+    if (addedUpdates.size() <= updateIndex) {
+        addedUpdates.emplace_back();
+    }
+    addedUpdates[updateIndex] = entityUpdate;
+    updateCount++;
+
+    // Track its changes in the same order that the client applies them:
+    // exits, then full states, then compact states.
+    for (std::size_t i = 0; i < entityUpdate.exitedEntities.size(); ++i) {
+        std::vector<HeldChange>& changes
+            = heldChanges[entityUpdate.exitedEntities[i]];
+        changes.clear();
+        changes.push_back({HeldChange::Type::Exited, updateIndex, i});
+    }
+
+    for (std::size_t i = 0; i < entityUpdate.entityStates.size(); ++i) {
+        std::vector<HeldChange>& changes
+            = heldChanges[entityUpdate.entityStates[i].entity];
+        changes.clear();
+        changes.push_back({HeldChange::Type::Full, updateIndex, i});
+    }
+
+    for (std::size_t i = 0; i < entityUpdate.compactEntityStates.size(); ++i) {
+        const CompactEntityState& state = entityUpdate.compactEntityStates[i];
+        std::vector<HeldChange>& changes = heldChanges[state.entity];
+        dropObsoleteCompactStates(changes, state.changeMask);
+        changes.push_back({HeldChange::Type::Compact, updateIndex, i});
+    }
+}
+
+unsigned int EntityUpdateMerger::getUpdateCount() const
+{
+    return updateCount;
+}
+
+void EntityUpdateMerger::take(std::vector<EntityUpdate>& outUpdates)
+{
+    // Start an update for each added update, with the same tick and origin.
+    outUpdates.resize(updateCount);
+    for (std::size_t i = 0; i < updateCount; ++i) {
+        EntityUpdate& outUpdate = outUpdates[i];
+        outUpdate.tickNum = addedUpdates[i].tickNum;
+        outUpdate.entityStates.clear();
+        outUpdate.compactEntityStates.clear();
+        outUpdate.exitedEntities.clear();
+        outUpdate.aoiOriginX = addedUpdates[i].aoiOriginX;
+        outUpdate.aoiOriginY = addedUpdates[i].aoiOriginY;
+    }
+
+    // Copy each change that wasn't dropped into its tick's update.
+    // Note: The map is sorted, so each list will be too.
+    for (auto& [entity, changes] : heldChanges) {
+        for (const HeldChange& change : changes) {
+            const EntityUpdate& addedUpdate = addedUpdates[change.updateIndex];
+            EntityUpdate& outUpdate = outUpdates[change.updateIndex];
+            switch (change.type) {
+                case HeldChange::Type::Full: {
+                    outUpdate.entityStates.push_back(
+                        addedUpdate.entityStates[change.stateIndex]);
+                    break;
+                }
+                case HeldChange::Type::Compact: {
+                    outUpdate.compactEntityStates.push_back(
+                        addedUpdate.compactEntityStates[change.stateIndex]);
+                    break;
+                }
+                case HeldChange::Type::Exited: {
+                    outUpdate.exitedEntities.push_back(entity);
+                    break;
+                }
+            }
+        }
+    }
+
+    // Leave out any ticks that have no changes left.
+    std::erase_if(outUpdates, [](const EntityUpdate& outUpdate) {
+        return (outUpdate.entityStates.empty()
+                && outUpdate.compactEntityStates.empty()
+                && outUpdate.exitedEntities.empty());
+    });
+
+    // Reset.
+    heldChanges.clear();
+    updateCount = 0;
+}
+
+void EntityUpdateMerger::dropObsoleteCompactStates(
+    std::vector<HeldChange>& changes, Uint8 changeMask)
+{
+    std::erase_if(changes, [&](const HeldChange& change) {
+        if (change.type != HeldChange::Type::Compact) {
+            return false;
+        }
+
+        // If the earlier state changed a field that this one doesn't, keep
+        // it.
+        const CompactEntityState& earlierState
+            = addedUpdates[change.updateIndex]
+                  .compactEntityStates[change.stateIndex];
+        if ((earlierState.changeMask & ~changeMask) != 0) {
+            return false;
+        }
+
+        // The client moves the entity using its inputs until the next
+        // position, so an input change is only obsolete once the position
+        // is set.
+        if ((earlierState.changeMask & CompactEntityState::InputChanged)
+            && !(changeMask & CompactEntityState::PositionXYChanged)) {
+            return false;
+        }
+
+        return true;
+    });
+}
+
+} // End namespace Server
+} // End namespace AM
@@ -7,46 +7,67 @@ namespace Server
 {
 IDPool::IDPool(unsigned int inPoolSize)
 : poolSize(inPoolSize)
-, containerSize(poolSize + SAFETY_BUFFER)
-, lastAddedIndex(0)
 , reservedIDCount(0)
-, IDs(poolSize)
+, generations(poolSize, 1)
+, reservedIndices(poolSize)
+, freeIndices(poolSize)
+, freeHead(0)
 {
+    if (poolSize > MAX_POOL_SIZE) {
+        LOG_ERROR("Pool size is too large. Size: %u, max: %u", poolSize,
+                  MAX_POOL_SIZE);
+    }
+
+    // All indices start free, in order.
+    for (unsigned int i = 0; i < poolSize; ++i) {
+        freeIndices[i] = i;
+    }
 }
 
-unsigned int IDPool::reserveID()
+NetworkID IDPool::reserveID()
 {
-    if (reservedIDCount > poolSize) {
+    if (reservedIDCount == poolSize) {
         LOG_ERROR("Tried to reserve ID when all were taken.");
         return 0;
     }
 
-    // Find the next empty index.
-    for (unsigned int i = 1; i < poolSize; ++i) {
-        // If this index is false (ID is unused).
-        unsigned int index = (lastAddedIndex + i) % containerSize;
-        if (!IDs[index]) {
-            IDs[index] = true;
-            lastAddedIndex = index;
-            reservedIDCount++;
-
-            return index;
-        }
-    }
+    // Pop the oldest free index.
+    Uint32 index = freeIndices[freeHead];
+    freeHead = ((freeHead + 1) % poolSize);
+    reservedIndices[index] = true;
+    reservedIDCount++;
 
-    LOG_ERROR("Couldn't find an empty index when one should exist.");
-    return 0;
+    return ((generations[index] << INDEX_BITS) | index);
 }
 
-void IDPool::freeID(unsigned int ID)
+void IDPool::freeID(NetworkID ID)
 {
-    if (IDs[ID]) {
-        IDs[ID] = false;
-        reservedIDCount--;
+    if (!isReserved(ID)) {
+        LOG_ERROR("Tried to free an unused ID.");
+        return;
+    }
+
+    // Invalidate any copies of the ID.
+    unsigned int index = getIndex(ID);
+    reservedIndices[index] = false;
+    if (generations[index] == MAX_GENERATION) {
+        generations[index] = 1;
     }
     else {
-        LOG_ERROR("Tried to free an unused ID.");
+        generations[index]++;
     }
+
+    // Push the index onto the back of the free ring.
+    unsigned int freeCount = (poolSize - reservedIDCount);
+    freeIndices[(freeHead + freeCount) % poolSize] = index;
+    reservedIDCount--;
+}
+
+bool IDPool::isReserved(NetworkID ID) const
+{
+    unsigned int index = getIndex(ID);
+    return ((index < poolSize) && reservedIndices[index]
+            && (generations[index] == getGeneration(ID)));
 }
 
 } // namespace Server
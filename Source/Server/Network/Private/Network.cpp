@@ -1,23 +1,45 @@
 #include "Network.h"
 #include "Acceptor.h"
 #include "Peer.h"
+#include "MessageBufferPool.h"
 #include "MessageTools.h"
 #include "Heartbeat.h"
 #include "Log.h"
 #include "NetworkStats.h"
+#include "Config.h"
+#include "nlohmann/json.hpp"
 #include <SDL2/SDL_net.h>
 #include <algorithm>
 #include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <utility>
 
 namespace AM
 {
 namespace Server
 {
-Network::Network()
-: clientHandler(*this)
+Network::Network(Transport transport)
+: clientMap(ClientHandler::MAX_CLIENTS)
+, clientHandler(*this, transport)
+, inputMessageSorter(ClientHandler::MAX_CLIENTS)
 , ticksSinceNetstatsLog(0)
 , currentTickPtr(nullptr)
+, pendingStatsSnapshot()
+, statsWriterExitRequested(false)
 {
+    statsWriterThreadObj = std::thread(&Network::statsWriterLoop, this);
+}
+
+Network::~Network()
+{
+    {
+        std::unique_lock<std::mutex> lock(statsWriterMutex);
+        statsWriterExitRequested = true;
+    }
+    statsWriterCondVar.notify_one();
+    statsWriterThreadObj.join();
 }
 
 void Network::tick()
@@ -30,6 +52,7 @@ void Network::tick()
     ticksSinceNetstatsLog++;
     if (ticksSinceNetstatsLog == TICKS_TILL_STATS_DUMP) {
         logNetworkStatistics();
+        queueStatsFileWrite();
         ticksSinceNetstatsLog = 0;
     }
 }
@@ -37,13 +60,12 @@ void Network::tick()
 void Network::send(NetworkID networkID, const BinaryBufferSharedPtr& message,
                    Uint32 messageTick)
 {
-    // Acquire a read lock before running through the client map.
-    std::shared_lock readLock(clientMapMutex);
+    // Keep any client that we find alive until we're done with it.
+    ClientMap::ReadGuard readGuard(clientMap);
 
     // Check that the client still exists, queue the message if so.
-    auto clientPair = clientMap.find(networkID);
-    if (clientPair != clientMap.end()) {
-        clientPair->second->queueMessage(message, messageTick);
+    if (Client* client = findClient(networkID)) {
+        client->queueMessage(message, messageTick);
     }
 }
 
@@ -54,13 +76,20 @@ void Network::processReceivedMessages(std::queue<ClientMessage>& receiveQueue)
         ClientMessage& clientMessage = receiveQueue.front();
         BinaryBufferPtr& messageBuffer = clientMessage.message.messageBuffer;
 
+        // If the client was erased, drop the message before doing any work.
+        Client* client = findClient(clientMessage.netID);
+        if (client == nullptr) {
+            receiveQueue.pop();
+            continue;
+        }
+
         // Used for recording how far ahead or behind the client's tick is.
-        Sint64 tickDiff = 0;
+        std::optional<Sint64> tickDiff{};
 
         // Process the message.
         switch (clientMessage.message.messageType) {
             case MessageType::ClientInputs: {
-                tickDiff = handleClientInputs(clientMessage, messageBuffer);
+                tickDiff = handleClientInputs(*client, messageBuffer);
                 break;
             }
             case MessageType::Heartbeat: {
@@ -73,12 +102,10 @@ void Network::processReceivedMessages(std::queue<ClientMessage>& receiveQueue)
             }
         }
 
-        // Record the diff.
-        if (std::shared_ptr<Client> clientPtr
-            = clientMessage.clientPtr.lock()) {
-            clientPtr->recordTickDiff(tickDiff);
+        // Record the diff, if the message had a fresh one.
+        if (tickDiff) {
+            client->recordTickDiff(*tickDiff);
         }
-        // Else, the client was destructed so we don't care.
 
         receiveQueue.pop();
     }
@@ -87,7 +114,28 @@ void Network::processReceivedMessages(std::queue<ClientMessage>& receiveQueue)
 std::queue<std::unique_ptr<ClientInput>>&
     Network::startReceiveInputMessages(Uint32 tickNum)
 {
-    return inputMessageSorter.startReceive(tickNum);
+    std::queue<std::unique_ptr<ClientInput>>& receiveQueue
+        = inputMessageSorter.startReceive(tickNum);
+
+    // Record any messages that were dropped for being stale, the same way
+    // that handleClientInputs() records rejected pushes.
+    // Note: The sim handles the drops through getStaleInputMessages(), since
+    //       only the receive thread may push drop events.
+    ClientMap::ReadGuard readGuard(clientMap);
+    for (const std::unique_ptr<ClientInput>& clientInput :
+         inputMessageSorter.getStaleMessages()) {
+        NetworkStats::recordMessageDropped(MessageType::ClientInputs);
+        if (Client* client = findClient(clientInput->netID)) {
+            client->getStats().recordDrop();
+        }
+    }
+
+    return receiveQueue;
+}
+
+std::vector<std::unique_ptr<ClientInput>>& Network::getStaleInputMessages()
+{
+    return inputMessageSorter.getStaleMessages();
 }
 
 void Network::endReceiveInputMessages()
@@ -100,9 +148,26 @@ ClientMap& Network::getClientMap()
     return clientMap;
 }
 
-std::shared_mutex& Network::getClientMapMutex()
+Client* Network::findClient(NetworkID netID)
 {
-    return clientMapMutex;
+    Client* client = clientMap.find(IDPool::getIndex(netID));
+    if ((client != nullptr) && (client->getNetID() == netID)) {
+        return client;
+    }
+    else {
+        return nullptr;
+    }
+}
+
+UpdateDelivery Network::takeUpdateDelivery(NetworkID networkID)
+{
+    // Keep any client that we find alive until we're done with it.
+    ClientMap::ReadGuard readGuard(clientMap);
+
+    if (Client* client = findClient(networkID)) {
+        return client->takeUpdateDelivery();
+    }
+    return {};
 }
 
 moodycamel::ReaderWriterQueue<NetworkID>& Network::getConnectEventQueue()
@@ -135,10 +200,10 @@ BinaryBufferSharedPtr Network::constructMessage(MessageType type,
                   Peer::MAX_MESSAGE_SIZE);
     }
 
-    // Allocate a buffer that can hold the Uint8 type, Uint16 size, and the
-    // payload.
-    BinaryBufferSharedPtr dynamicBuffer
-        = std::make_shared<std::vector<Uint8>>(MESSAGE_HEADER_SIZE + size);
+    // Get a buffer from the pool and fit it to the Uint8 type, Uint16 size,
+    // and the payload.
+    BinaryBufferSharedPtr dynamicBuffer = MessageBufferPool::acquire();
+    dynamicBuffer->resize(MESSAGE_HEADER_SIZE + size);
 
     // Copy the type into the buffer.
     dynamicBuffer->at(0) = static_cast<Uint8>(type);
@@ -158,6 +223,23 @@ Uint32 Network::getCurrentTick()
     return *currentTickPtr;
 }
 
+NetworkStatsSnapshot Network::getStatsSnapshot()
+{
+    NetworkStatsSnapshot snapshot{};
+    snapshot.tickNum = getCurrentTick();
+    snapshot.messageTypes = NetworkStats::getMessageTypeStats();
+
+    // Keep the clients alive while we run through them.
+    ClientMap::ReadGuard readGuard(clientMap);
+    snapshot.clients.reserve(clientMap.getSize());
+    clientMap.forEach([&](std::size_t, Client& client) {
+        snapshot.clients.push_back(
+            client.getStats().getSnapshot(client.getNetID()));
+    });
+
+    return snapshot;
+}
+
 void Network::logNetworkStatistics()
 {
     // Dump the stats from the tracker.
@@ -169,20 +251,130 @@ void Network::logNetworkStatistics()
         = netStats.bytesReceived / SECONDS_TILL_STATS_DUMP;
     LOG_INFO("Bytes sent per second: %.0f, Bytes received per second: %.0f",
              bytesSentPerSecond, bytesReceivedPerSecond);
+    LOG_INFO("Tick send time (ms): average: %.3f, max: %.3f",
+             (netStats.averageSendTime * 1000), (netStats.maxSendTime * 1000));
+    float syscallsPerSecond = netStats.socketSyscalls / SECONDS_TILL_STATS_DUMP;
+    LOG_INFO("Socket syscalls per second: %.0f", syscallsPerSecond);
+
+    BufferPoolStatsDump poolStats = MessageBufferPool::dumpStats();
+    LOG_INFO("Message buffer pool: hits: %u, misses: %u", poolStats.hits,
+             poolStats.misses);
 }
 
-Sint64 Network::handleClientInputs(ClientMessage& clientMessage,
-                                   BinaryBufferPtr& messageBuffer)
+void Network::queueStatsFileWrite()
+{
+    // Take the snapshot here, so it matches this tick. The writer thread
+    // handles the serialization and file I/O.
+    NetworkStatsSnapshot snapshot = getStatsSnapshot();
+    {
+        std::unique_lock<std::mutex> lock(statsWriterMutex);
+        pendingStatsSnapshot = std::move(snapshot);
+    }
+    statsWriterCondVar.notify_one();
+}
+
+void Network::statsWriterLoop()
+{
+    while (true) {
+        // Wait until there's a snapshot to write, or we're asked to exit.
+        NetworkStatsSnapshot snapshot{};
+        {
+            std::unique_lock<std::mutex> lock(statsWriterMutex);
+            statsWriterCondVar.wait(lock, [&]() {
+                return (statsWriterExitRequested
+                        || pendingStatsSnapshot.has_value());
+            });
+            if (statsWriterExitRequested) {
+                return;
+            }
+
+            snapshot = std::move(*pendingStatsSnapshot);
+            pendingStatsSnapshot.reset();
+        }
+
+        writeStatsFile(snapshot);
+    }
+}
+
+void Network::writeStatsFile(const NetworkStatsSnapshot& snapshot)
+{
+    static constexpr const char* MESSAGE_TYPE_NAMES[MESSAGE_TYPE_COUNT]
+        = {"NotSet", "ConnectionResponse", "EntityUpdate", "ClientInputs",
+           "Heartbeat"};
+
+    // Build the JSON.
+    nlohmann::json json;
+    json["tickNum"] = snapshot.tickNum;
+    json["messageTypes"] = nlohmann::json::object();
+    for (std::size_t i = 0; i < MESSAGE_TYPE_COUNT; ++i) {
+        const MessageTypeStats& stats = snapshot.messageTypes[i];
+        json["messageTypes"][MESSAGE_TYPE_NAMES[i]]
+            = {{"messagesSent", stats.messagesSent},
+               {"bytesSent", stats.bytesSent},
+               {"messagesReceived", stats.messagesReceived},
+               {"bytesReceived", stats.bytesReceived},
+               {"messagesDropped", stats.messagesDropped}};
+    }
+
+    json["clients"] = nlohmann::json::array();
+    for (const ClientStatsSnapshot& stats : snapshot.clients) {
+        json["clients"].push_back(
+            {{"netID", stats.netID},
+             {"messagesSent", stats.messagesSent},
+             {"bytesSent", stats.bytesSent},
+             {"messagesReceived", stats.messagesReceived},
+             {"bytesReceived", stats.bytesReceived},
+             {"messagesDropped", stats.messagesDropped},
+             {"tickAdjustments", stats.tickAdjustments},
+             {"sendStalls", stats.sendStalls},
+             {"sendQueueDepth", stats.sendQueueDepth},
+             {"maxSendQueueDepth", stats.maxSendQueueDepth},
+             {"backpressuredSends", stats.backpressuredSends},
+             {"updatesSuperseded", stats.updatesSuperseded},
+             {"pendingOutputBytes", stats.pendingOutputBytes}});
+    }
+
+    // Write to a temporary file, then move it into place so readers never
+    // see a partial file.
+    std::string tempPath
+        = std::string(Config::NETWORK_STATS_FILE_PATH) + ".tmp";
+    {
+        std::ofstream tempFile(tempPath, std::ios::trunc);
+        if (!tempFile) {
+            LOG_INFO("Failed to open network stats file for writing: %s",
+                     tempPath.c_str());
+            return;
+        }
+        // Note: Not indented, since only tools read it.
+        tempFile << json.dump();
+    }
+    if (std::rename(tempPath.c_str(), Config::NETWORK_STATS_FILE_PATH)
+        != 0) {
+        LOG_INFO("Failed to move network stats file into place: %s",
+                 Config::NETWORK_STATS_FILE_PATH);
+    }
+}
+
+std::optional<Sint64>
+    Network::handleClientInputs(Client& client, BinaryBufferPtr& messageBuffer)
 {
     // Deserialize the message.
     std::unique_ptr<ClientInput> clientInput = std::make_unique<ClientInput>();
     MessageTools::deserialize(*messageBuffer, messageBuffer->size(),
                               *clientInput);
 
+    // If it's a copy of inputs that we already received, skip it.
+    // Note: Its diff is skipped too, since the copy was sent on a later tick.
+    if (!(client.recordInputTick(clientInput->tickNum))) {
+        return std::nullopt;
+    }
+
     // Fill in the network ID that we assigned to this client.
-    clientInput->netID = clientMessage.netID;
+    // Note: This includes the generation, so the sim won't apply the input
+    //       to a different client that reuses the index.
+    clientInput->netID = client.getNetID();
 
-    // Push the message (blocks if the MessageSorter is locked).
+    // Push the message.
     // Save the tickNum locally since the move might be optimized
     // in front of the access (this does happen).
     Uint32 messageTickNum = clientInput->tickNum;
@@ -191,13 +383,17 @@ Sint64 Network::handleClientInputs(ClientMessage& clientMessage,
 
     // If the sorter dropped the message, push a message drop event.
     if (pushResult.result != MessageSorterBase::ValidityResult::Valid) {
-        if (!messageDropEventQueue.enqueue(clientMessage.netID)) {
+        if (!messageDropEventQueue.enqueue(client.getNetID())) {
             LOG_ERROR("Enqueue failed.");
         }
 
+        // Record the drop.
+        NetworkStats::recordMessageDropped(MessageType::ClientInputs);
+        client.getStats().recordDrop();
+
         LOG_INFO("Message was dropped. NetID: %u, diff: %d, result: %u, "
                  "tickNum: %u",
-                 clientMessage.netID, pushResult.diff, pushResult.result,
+                 client.getNetID(), pushResult.diff, pushResult.result,
                  messageTickNum);
     }
 
@@ -1,13 +1,20 @@
 #pragma once
 
 #include "NetworkDefs.h"
+#include "ServerNetworkDefs.h"
 #include "Config.h"
+#include "ClientStats.h"
+#include "EntityUpdateMerger.h"
+#include "EntityUpdate.h"
 #include "Peer.h"
 #include "CircularBuffer.h"
 #include "Timer.h"
 #include "readerwriterqueue.h"
 #include <memory>
 #include <array>
+#include <deque>
+#include <vector>
+#include <span>
 #include <mutex>
 #include <atomic>
 
@@ -28,6 +35,11 @@ public:
 
     /**
      * Queues a message to be sent the next time sendWaitingMessages is called.
+     *
+     * The queue holds up to Config::MAX_SEND_QUEUE_SIZE messages. If it's
+     * full, the message can't be dropped without desyncing the client, so the
+     * client is disconnected instead.
+     *
      * @param message  The message to queue.
      * @param messageTick  If non-0, used to update our latestSentSimTick.
      *                     Use 0 if sending messages that aren't associated
@@ -37,15 +49,40 @@ public:
 
     /**
      * Attempts to send all queued messages over the network.
+     * Doesn't block. Any data that the socket won't accept is held and sent
+     * first during the next call.
+     *
+     * Each frame of the batch is sent with Peer::sendUnreliable(), so that a
+     * lost frame doesn't hold up the ones behind it. If a frame is lost, its
+     * EntityUpdates are reported through takeUpdateDelivery() for the sim to
+     * re-send, and its other messages (which must be delivered in order) are
+     * re-sent. While other messages are in flight, the rest are held so that
+     * they aren't received first.
+     *
+     * If the client isn't keeping up (more than
+     * Config::SEND_BACKPRESSURE_BYTES are still waiting to be sent), its
+     * messages are held instead of sent. Obsolete changes are dropped from
+     * held EntityUpdates, so the client receives only what's still relevant
+     * once it catches up.
+     * If it doesn't catch up within Config::SEND_BACKPRESSURE_TIMEOUT_S, it's
+     * disconnected.
+     *
      * @param currentTick  The sim's current tick.
      * @return An appropriate NetworkResult.
      */
     NetworkResult sendWaitingMessages(Uint32 currentTick);
 
     /**
-     * Tries to receive a message from this client.
-     * If no message is received, checks if this client has timed out.
-     * Note: It's expected that you called SDLNet_CheckSockets() on the
+     * Returns what we've learned about the delivery of the EntityUpdates
+     * that we've sent this client, since the last call.
+     * Safe to call from the sim thread.
+     */
+    UpdateDelivery takeUpdateDelivery();
+
+    /**
+     * Tries to receive a message from this client, without blocking.
+     * Call repeatedly until NotSet is returned to drain all waiting messages.
+     * Note: It's expected that you called checkSockets() on the
      * outside-managed socket set before calling this.
      *
      * @return A received Message. If no data was waiting, return.messageType
@@ -54,6 +91,12 @@ public:
      */
     Message receiveMessage();
 
+    /**
+     * Checks if it's been longer than Config::CLIENT_TIMEOUT_S since we last
+     * received a message from this client. If so, drops the connection.
+     */
+    void checkForTimeout();
+
     /**
      * @return True if the client is connected, else false.
      *
@@ -76,24 +119,88 @@ public:
      */
     void recordTickDiff(Sint64 tickDiff);
 
+    /**
+     * Records that we received this client's inputs for the given tick.
+     * Clients re-send their inputs for a few ticks in case they're lost, so
+     * this lets us skip the copies.
+     *
+     * Note: Only called by the receive thread.
+     *
+     * @return false if we already received inputs for the given tick or a
+     *         later one, else true.
+     */
+    bool recordInputTick(Uint32 tickNum);
+
     NetworkID getNetID();
 
+    /** Returns our network statistics. Safe to call from any thread. */
+    const ClientStats& getStats() const;
+
+    /** Returns our network statistics, for recording receive-side events. */
+    ClientStats& getStats();
+
 private:
     //--------------------------------------------------------------------------
     // Helpers
     //--------------------------------------------------------------------------
+    /** A server header, sent at the start of each frame of a batch. */
+    typedef std::array<Uint8, SERVER_HEADER_SIZE> ServerHeader;
+
+    /** A queued message, and the tick that it's associated with. */
+    typedef std::pair<BinaryBufferSharedPtr, Uint32> QueuedMessage;
+
+    /** A frame that we've sent, waiting for its delivery notice. */
+    struct SentFrame {
+        /** The token that the frame was sent with. */
+        Uint32 notifyToken{0};
+        /** The tick of the frame's earliest EntityUpdate. 0 if it has
+            none. */
+        Uint32 firstUpdateTick{0};
+        /** The tick of the frame's latest EntityUpdate. 0 if it has none. */
+        Uint32 lastUpdateTick{0};
+        /** The frame's messages, other than EntityUpdates. They must be
+            delivered, so they're re-sent if the frame is lost. */
+        std::vector<QueuedMessage> reliableMessages;
+    };
+
+    /**
+     * Pops our peer's delivery notices and applies them to sentFrames.
+     */
+    void processDeliveryNotices();
+
+    /**
+     * Records that the EntityUpdate for the given tick was lost, for
+     * takeUpdateDelivery() to report.
+     */
+    void recordLostUpdate(Uint32 tickNum);
+
     /**
-     * Returns the number of messages waiting in the sendQueue.
-     * The return type is Uint8 because it needs to fit in 1 byte of a message.
+     * Moves the given number of messages out of the send queue and holds
+     * them. EntityUpdates are added to updateMerger.
      */
-    Uint8 getWaitingMessageCount() const;
+    void holdWaitingMessages(std::size_t messageCount);
 
     /**
-     * Fills in the header information for the batch currently being built.
-     * @param messageCount  The number of messages going into the current batch.
+     * Moves all of our held messages into batchMessages.
+     * Held EntityUpdates are replaced by updateMerger's updates, which hold
+     * only the changes that are still relevant.
+     */
+    void releaseHeldMessages();
+
+    /**
+     * Starts a new frame in the batch currently being built.
+     * Adds a zeroed header to frameHeaders, a view of it to sendBuffers, and
+     * an entry to sentFrames.
+     */
+    void beginFrame();
+
+    /**
+     * Fills in the adjustment and confirmation information for each frame in
+     * the batch currently being built.
+     * Message counts are filled in as the frames are built.
      * @param currentTick  The sim's current tick number.
      */
-    void fillHeader(Uint8 messageCount, Uint32 currentTick);
+    void fillHeaders(Uint32 currentTick);
 
     //--------------------------------------------------------------------------
     // Connection, Batching
@@ -104,17 +211,88 @@ private:
     /** Our connection and interface to the client. */
     std::unique_ptr<Peer> peer;
 
-    /** Holds messages to be sent with the next call to sendWaitingMessages. */
-    moodycamel::ReaderWriterQueue<std::pair<BinaryBufferSharedPtr, Uint32>>
-        sendQueue;
+    /** Holds messages to be sent with the next call to sendWaitingMessages.
+        Bounded to Config::MAX_SEND_QUEUE_SIZE. */
+    moodycamel::ReaderWriterQueue<QueuedMessage> sendQueue;
+
+    /** If true, we failed to keep up with this client's sends (our send
+        queue overflowed, or the client stopped keeping up) and it should be
+        disconnected. Checked by isConnected(). */
+    std::atomic<bool> dropRequested;
+
+    /** The messages that are being held while the client catches up,
+        excluding EntityUpdates. */
+    std::vector<QueuedMessage> heldMessages;
+
+    /** The EntityUpdates that are being held while the client catches up.
+        Only sent as-is if there's just one. */
+    std::vector<QueuedMessage> heldUpdates;
+
+    /** Merges heldUpdates. */
+    EntityUpdateMerger updateMerger;
+
+    /** Scratch update, used while holding updates. Kept around to avoid
+        re-allocating. */
+    EntityUpdate scratchUpdate;
 
-    /** Holds data while we're putting it together to be sent as a batch. */
-    std::array<Uint8, Peer::MAX_MESSAGE_SIZE> batchBuffer;
+    /** Scratch updates, filled by updateMerger. Kept around to avoid
+        re-allocating. */
+    std::vector<EntityUpdate> mergedUpdates;
+
+    /** If true, the client isn't keeping up and we're holding its
+        messages. */
+    bool isBackpressured;
+
+    /** Tracks how long the client has gone without keeping up. */
+    Timer backpressureTimer;
+
+    /** The messages in the most recent batch. Keeps them alive until the
+        next batch is built, so a send ring can send from them. */
+    std::vector<QueuedMessage> batchMessages;
+
+    /** The headers of each frame in the batch that's being built.
+        Batches that are larger than Peer::MAX_MESSAGE_SIZE are split into
+        multiple frames, each with its own header. */
+    std::vector<ServerHeader> frameHeaders;
+
+    /** Views of the frame headers and messages in the batch that's being
+        built, in send order. */
+    std::vector<std::span<const Uint8>> sendBuffers;
+
+    /** The index in sendBuffers that each frame of the batch that's being
+        built starts at. */
+    std::vector<std::size_t> frameStarts;
+
+    /** The frames that we've sent and haven't received a delivery notice
+        for, in send order. */
+    std::deque<SentFrame> sentFrames;
+
+    /** The notify token to send our next frame with. */
+    Uint32 nextFrameToken;
+
+    /** The number of frames in sentFrames that hold reliableMessages. */
+    std::size_t unsettledReliableFrames;
+
+    /** The earliest tick whose EntityUpdate was lost since the last
+        takeUpdateDelivery(). 0 if none were.
+        Note: Always written before settledUpdateTick. */
+    std::atomic<Uint32> lostUpdateTick;
+
+    /** Every EntityUpdate up to and including this tick has had its delivery
+        notice processed. */
+    std::atomic<Uint32> settledUpdateTick;
 
     /** Tracks how long it's been since we've received a message from this
         client. */
     Timer receiveTimer;
 
+    /** Our network statistics. */
+    ClientStats stats;
+
+    /** The latest tick that we've received inputs for. Only used by the
+        receive thread. */
+    Uint32 latestInputTick;
+
     //--------------------------------------------------------------------------
     // Synchronization Functions
     //--------------------------------------------------------------------------
@@ -4,8 +4,12 @@
 #include "ServerNetworkDefs.h"
 #include "Client.h"
 #include "Acceptor.h"
+#include "UdpHost.h"
+#include "TcpSendRing.h"
 #include "IDPool.h"
+#include "Timer.h"
 #include <thread>
+#include <vector>
 #include <queue>
 #include <unordered_map>
 #include <atomic>
@@ -24,6 +28,9 @@ class Network;
  * Accepts new client connections, erases clients that have been detected as
  * disconnected, and receives available messages.
  *
+ * Clients connect over TCP or UDP, depending on the transport that we were
+ * constructed with.
+ *
  * Acts directly on the Network's client map.
  */
 class ClientHandler
@@ -32,21 +39,30 @@ public:
     /** The maximum number of clients that we will accept connections from. */
     static constexpr unsigned int MAX_CLIENTS = 1000;
 
-    ClientHandler(Network& inNetwork);
+    ClientHandler(Network& inNetwork, Transport inTransport);
 
     ~ClientHandler();
 
     /**
-     * Flags the send thread to begin sending all waiting messages.
+     * Flags the send threads to begin sending all waiting messages.
      */
     void beginSendClientUpdates();
 
 private:
     /**
      * How long the accept/disconnect/receive loop in serviceClients should
-     * delay if no socket activity was reported on the clientSet.
+     * block waiting for socket activity on the clientSet.
+     * Incoming messages wake the thread immediately, so this mostly bounds
+     * how long a new connection may wait to be accepted.
+     */
+    static constexpr unsigned int SOCKET_WAIT_TIMEOUT_MS = 10;
+
+    /**
+     * How often we should check all clients for timeouts. Idle clients
+     * won't show up as active in the clientSet, so they need a separate
+     * sweep.
      */
-    static constexpr unsigned int INACTIVE_DELAY_TIME_MS = 1;
+    static constexpr double TIMEOUT_CHECK_INTERVAL_S = .1;
 
     /**
      * Thread function, started from constructor.
@@ -59,45 +75,100 @@ private:
     void serviceClients();
 
     /**
-     * Thread function, started from constructor.
+     * Thread function, one instance per send thread, started from
+     * constructor.
      * Waits for beginSendClientUpdates() to flag that a send should begin.
      *
-     * Tries to send any messages in each client's queue over the network.
-     * If a send fails, leaves the message at the front of the queue and moves
-     * on to the next client's queue.
+     * Sends the messages in the queue of each client in this thread's shard
+     * (clients whose netID index % SEND_THREAD_COUNT == shardIndex).
+     * Sends don't block. If a client's socket is full, the rest of its data
+     * is held and sent during the next call, so a slow client doesn't delay
+     * the others.
+     * If we have send rings, the shard's sends are all submitted at once
+     * after its clients have been run through.
      * If there's no messages to send, sends a heartbeat instead, with a value
      * that confirms that we've processed tick(s) with no changes to send.
+     *
+     * @param shardIndex  The shard of clients that this thread is in charge
+     *                    of.
      */
-    void sendClientUpdates();
+    void sendClientUpdates(unsigned int shardIndex);
 
     /**
      * Accepts any new clients, pushing them into the Network's client map.
      */
     void acceptNewClients(ClientMap& clientMap);
 
+    /**
+     * Returns a newly connected peer, if there are any.
+     */
+    std::unique_ptr<Peer> acceptPeer();
+
+    /**
+     * Tracks that the given peer belongs to the given client, so we can find
+     * the client when the peer has activity.
+     * If we have send rings, also has the peer send through its shard's ring.
+     */
+    void trackPeer(Peer& peer, NetworkID netID);
+
     /**
      * Erase any disconnected clients from the Network's clientMap.
      */
     void eraseDisconnectedClients(ClientMap& clientMap);
 
     /**
-     * Used by pollForMessages, checks for new messages and pushes them into
-     * their queues.
+     * Waits for socket activity, then receives all waiting messages from the
+     * active clients and pushes them into the receiveQueue.
+     * Only clients with activity are touched.
      * @return The number of messages that were received.
      */
     int receiveClientMessages(ClientMap& clientMap);
 
+    /**
+     * Checks every client for a timeout, dropping any that have timed out.
+     */
+    void checkClientTimeouts(ClientMap& clientMap);
+
     Network& network;
 
+    /** The transport that clients connect over. */
+    const Transport transport;
+
     /** Used for generating network IDs. */
     IDPool idPool;
 
-    /** The socket set used for all clients. Lets us do select()-like behavior,
-        allowing our receive thread to not be constantly spinning. */
+    /** TCP only. The socket set used for all clients. Lets us do
+        select()-like behavior, allowing our receive thread to not be
+        constantly spinning.
+        Uses io_uring or epoll where available, so only active clients are
+        reported. */
     std::shared_ptr<SocketSet> clientSet;
 
-    /** The listener that we use to accept new clients. */
-    Acceptor acceptor;
+    /** TCP only. Maps each client's socket to its netID, so we can find the
+        clients that the clientSet reports as active. */
+    std::unordered_map<const TcpSocket*, NetworkID> socketIDMap;
+
+    /** TCP only. The listener that we use to accept new clients. */
+    std::unique_ptr<Acceptor> acceptor;
+
+    /** TCP only. If the clientSet is using io_uring, holds a send ring for
+        each send thread, indexed by shard. Otherwise, empty and clients send
+        directly. */
+    std::vector<std::unique_ptr<TcpSendRing>> sendRings;
+
+    /** UDP only. Receives all client datagrams and accepts new clients. */
+    std::shared_ptr<UdpHost> udpHost;
+
+    /** UDP only. Maps each client's peer to its netID, so we can find the
+        clients that the udpHost reports as active. */
+    std::unordered_map<const UdpPeer*, NetworkID> udpPeerIDMap;
+
+    /** The netIDs of the clients that had activity during the current
+        receiveClientMessages(). */
+    std::vector<NetworkID> activeIDs;
+
+    /** Tracks how long it's been since we last checked for timeouts. */
+    Timer timeoutCheckTimer;
 
     /** A queue used for storing received messages until we can deserialize and
         route them. */
@@ -108,14 +179,19 @@ private:
     /** Turn false to signal that the send and receive threads should end. */
     std::atomic<bool> exitRequested;
 
-    /** Calls sendClientUpdates(). */
-    std::thread sendThreadObj;
-    /** Used for signaling the send thread. */
+    /** Each calls sendClientUpdates() for its shard of clients. */
+    std::vector<std::thread> sendThreadObjs;
+    /** Used for signaling the send threads. */
     std::mutex sendMutex;
-    /** Used for signaling the send thread. */
+    /** Used for signaling the send threads. */
     std::condition_variable sendCondVar;
-    /** Used for signaling the send thread. */
-    bool sendRequested;
+    /** Incremented by beginSendClientUpdates() to signal the send threads. */
+    Uint64 sendIteration;
+    /** The number of send threads that have finished the current
+        sendIteration. */
+    unsigned int numFinishedSendThreads;
+    /** Tracks how long the current sendIteration has been running. */
+    Timer sendTimer;
 };
 
 } // End namespace Server
@@ -0,0 +1,201 @@
+#pragma once
+
+#include "NetworkDefs.h"
+#include <atomic>
+#include <cstddef>
+
+namespace AM
+{
+namespace Server
+{
+/** A copy of a single client's network statistics. */
+struct ClientStatsSnapshot {
+    NetworkID netID = 0;
+
+    Uint64 messagesSent = 0;
+    /** Includes batch headers. */
+    Uint64 bytesSent = 0;
+    Uint64 messagesReceived = 0;
+    /** Includes client headers. */
+    Uint64 bytesReceived = 0;
+
+    /** The number of received messages that the MessageSorter dropped. */
+    Uint64 messagesDropped = 0;
+
+    /** The number of batches that carried a tick adjustment. */
+    Uint64 tickAdjustments = 0;
+
+    /** The number of batches that the socket couldn't accept in full. */
+    Uint64 sendStalls = 0;
+
+    /** The number of messages that were waiting in the send queue, as of the
+        latest send. */
+    Uint64 sendQueueDepth = 0;
+
+    /** The most messages that have been waiting in the send queue. */
+    Uint64 maxSendQueueDepth = 0;
+
+    /** The number of network ticks that we held this client's updates for,
+        because it wasn't keeping up. */
+    Uint64 backpressuredSends = 0;
+
+    /** The number of EntityUpdates that we avoided sending, because all of
+        their changes were made obsolete by later held updates. */
+    Uint64 updatesSuperseded = 0;
+
+    /** The number of bytes that were waiting to be sent after the socket
+        filled up, as of the latest send. */
+    Uint64 pendingOutputBytes = 0;
+};
+
+/**
+ * Tracks a single client's network statistics.
+ *
+ * Each counter is only written to by a single thread (either the client's
+ * send thread or the receive thread), except for messagesDropped. The
+ * counters are grouped by the thread that writes them, and each group is
+ * kept on its own cache line, so the threads don't contend. Counters can be
+ * read from any thread.
+ */
+class ClientStats
+{
+public:
+    //-------------------------------------------------------------------------
+    // Send thread
+    //-------------------------------------------------------------------------
+    /**
+     * Records a sent batch.
+     *
+     * @param messageCount  The number of messages in the batch.
+     * @param bytes  The size of the batch, including headers.
+     * @param pendingBytes  The number of bytes that the socket didn't accept.
+     */
+    void recordSend(std::size_t messageCount, std::size_t bytes,
+                    std::size_t pendingBytes)
+    {
+        add(sendCounters.messagesSent, messageCount);
+        add(sendCounters.bytesSent, bytes);
+        recordSendQueueDepth(messageCount);
+        sendCounters.pendingOutputBytes.store(pendingBytes,
+                                              std::memory_order_relaxed);
+        if (pendingBytes > 0) {
+            add(sendCounters.sendStalls, 1);
+        }
+    }
+
+    /**
+     * Records the number of messages that were waiting in the send queue.
+     * Called by recordSend(), or directly if nothing was sent.
+     */
+    void recordSendQueueDepth(std::size_t queueDepth)
+    {
+        sendCounters.sendQueueDepth.store(queueDepth,
+                                          std::memory_order_relaxed);
+        if (queueDepth > load(sendCounters.maxSendQueueDepth)) {
+            sendCounters.maxSendQueueDepth.store(queueDepth,
+                                                 std::memory_order_relaxed);
+        }
+    }
+
+    /** Records a network tick where we held the client's updates. */
+    void recordBackpressure() { add(sendCounters.backpressuredSends, 1); }
+
+    /** Records the number of EntityUpdates that were dropped as obsolete. */
+    void recordSupersededUpdates(std::size_t updateCount)
+    {
+        add(sendCounters.updatesSuperseded, updateCount);
+    }
+
+    /** Records a batch carrying a tick adjustment. */
+    void recordTickAdjustment() { add(sendCounters.tickAdjustments, 1); }
+
+    //-------------------------------------------------------------------------
+    // Receive thread
+    //-------------------------------------------------------------------------
+    /** Records a received message of the given size, including headers. */
+    void recordReceive(std::size_t bytes)
+    {
+        add(receiveCounters.messagesReceived, 1);
+        add(receiveCounters.bytesReceived, bytes);
+    }
+
+    //-------------------------------------------------------------------------
+    // Any thread
+    //-------------------------------------------------------------------------
+    /**
+     * Records a received message being dropped.
+     * Note: Drops are recorded by both the receive thread and the sim thread
+     *       (for stale messages), so this uses an atomic increment.
+     */
+    void recordDrop()
+    {
+        receiveCounters.messagesDropped.fetch_add(1,
+                                                  std::memory_order_relaxed);
+    }
+
+    /**
+     * Returns a copy of our current statistics.
+     */
+    ClientStatsSnapshot getSnapshot(NetworkID netID) const
+    {
+        ClientStatsSnapshot snapshot{};
+        snapshot.netID = netID;
+        snapshot.messagesSent = load(sendCounters.messagesSent);
+        snapshot.bytesSent = load(sendCounters.bytesSent);
+        snapshot.messagesReceived = load(receiveCounters.messagesReceived);
+        snapshot.bytesReceived = load(receiveCounters.bytesReceived);
+        snapshot.messagesDropped = load(receiveCounters.messagesDropped);
+        snapshot.tickAdjustments = load(sendCounters.tickAdjustments);
+        snapshot.sendStalls = load(sendCounters.sendStalls);
+        snapshot.sendQueueDepth = load(sendCounters.sendQueueDepth);
+        snapshot.maxSendQueueDepth = load(sendCounters.maxSendQueueDepth);
+        snapshot.backpressuredSends = load(sendCounters.backpressuredSends);
+        snapshot.updatesSuperseded = load(sendCounters.updatesSuperseded);
+        snapshot.pendingOutputBytes = load(sendCounters.pendingOutputBytes);
+        return snapshot;
+    }
+
+private:
+    /** The counters that are written to by the client's send thread. */
+    struct alignas(64) SendCounters {
+        std::atomic<Uint64> messagesSent{0};
+        std::atomic<Uint64> bytesSent{0};
+        std::atomic<Uint64> tickAdjustments{0};
+        std::atomic<Uint64> sendStalls{0};
+        std::atomic<Uint64> sendQueueDepth{0};
+        std::atomic<Uint64> maxSendQueueDepth{0};
+        std::atomic<Uint64> backpressuredSends{0};
+        std::atomic<Uint64> updatesSuperseded{0};
+        std::atomic<Uint64> pendingOutputBytes{0};
+    };
+
+    /** The counters that are written to by the receive thread.
+        messagesDropped is also written to by the sim thread. */
+    struct alignas(64) ReceiveCounters {
+        std::atomic<Uint64> messagesReceived{0};
+        std::atomic<Uint64> bytesReceived{0};
+        std::atomic<Uint64> messagesDropped{0};
+    };
+
+    /**
+     * Adds to the given counter.
+     * Note: Each counter only has 1 writer, so we don't need an atomic
+     *       read-modify-write.
+     */
+    static void add(std::atomic<Uint64>& counter, Uint64 value)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value,
+                      std::memory_order_relaxed);
+    }
+
+    static Uint64 load(const std::atomic<Uint64>& counter)
+    {
+        return counter.load(std::memory_order_relaxed);
+    }
+
+    SendCounters sendCounters;
+    ReceiveCounters receiveCounters;
+};
+
+} // End namespace Server
+} // End namespace AM
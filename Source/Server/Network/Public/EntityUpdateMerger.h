@@ -0,0 +1,92 @@
+#pragma once
+
+#include "EntityUpdate.h"
+#include "EntityState.h"
+#include "CompactEntityState.h"
+#include "entt/entity/registry.hpp"
+#include <map>
+#include <vector>
+
+namespace AM
+{
+namespace Server
+{
+/**
+ * Drops the obsolete changes from a run of EntityUpdates for a single
+ * client.
+ *
+ * Used when a client isn't keeping up, so that it receives only the changes
+ * that still matter instead of a burst of obsolete ones.
+ *
+ * Every change keeps the tick and AoI origin of the update that it came
+ * from, since the client applies each state at its own tick (e.g. to
+ * reconcile its own entity, or to replay an NPC's inputs). A change is
+ * dropped if a later one makes it obsolete:
+ *   - A full state or an exit drops every earlier change to its entity.
+ *   - A compact state drops an earlier compact state if it changes every
+ *     field that the earlier one changed. An earlier input change is only
+ *     dropped if the later state also sets the position, since the client
+ *     moves the entity using its inputs in between.
+ *
+ * The surviving changes are returned as one update per tick. Ticks that
+ * have no surviving changes are left out, and the client treats them as
+ * having no changes.
+ */
+class EntityUpdateMerger
+{
+public:
+    EntityUpdateMerger();
+
+    /**
+     * Adds the given update.
+     * Updates must be added in the order that they were built.
+     */
+    void add(const EntityUpdate& entityUpdate);
+
+    /**
+     * Returns the number of updates that were added since the last take().
+     */
+    unsigned int getUpdateCount() const;
+
+    /**
+     * Fills the given vector with one update for each added update that
+     * still has changes, in tick order, then resets.
+     * Each update holds a subset of its added update's states, so it's never
+     * larger. Each list is sorted by entity.
+     */
+    void take(std::vector<EntityUpdate>& outUpdates);
+
+private:
+    /** A change to an entity, held in one of our added updates. */
+    struct HeldChange {
+        enum class Type { Full, Compact, Exited };
+        Type type{Type::Exited};
+
+        /** The index in addedUpdates of the update that holds the change. */
+        std::size_t updateIndex{0};
+
+        /** The index of the change within its update's list. */
+        std::size_t stateIndex{0};
+    };
+
+    /**
+     * Drops any of the given entity's held compact states that the given
+     * change mask makes obsolete.
+     */
+    void dropObsoleteCompactStates(std::vector<HeldChange>& changes,
+                                   Uint8 changeMask);
+
+    /** Copies of the updates that were added since the last take().
+        Not shrunk on take(), so the copies can reuse their allocations. */
+    std::vector<EntityUpdate> addedUpdates;
+
+    /** The number of updates that were added since the last take(). */
+    unsigned int updateCount;
+
+    /** The changes to each entity that haven't been dropped, oldest first.
+        Sorted by entity. */
+    std::map<entt::entity, std::vector<HeldChange>> heldChanges;
+};
+
+} // End namespace Server
+} // End namespace AM
@@ -0,0 +1,303 @@
+#pragma once
+
+#include "Log.h"
+#include <SDL_stdinc.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace AM
+{
+namespace Server
+{
+/**
+ * A fixed-capacity array of owned objects, indexed by a small dense ID (e.g.
+ * a NetworkID from IDPool).
+ *
+ * A single writer thread inserts and erases objects. Any number of reader
+ * threads may look them up concurrently without locking, hashing, or
+ * refcounting: readers hold a ReadGuard, and erased objects are only deleted
+ * once every reader that might still see them has dropped its guard
+ * (epoch-based reclamation).
+ *
+ * Each slot has a generation counter that's incremented whenever its object
+ * is inserted or erased, so callers can detect that an ID has been reused.
+ *
+ * Usage:
+ *   Writer: insert(), erase(), then periodically reclaimRetired().
+ *           The writer may call find() and forEach() without a guard.
+ *   Readers: Construct a ReadGuard, then call find() or forEach(). Returned
+ *            pointers are valid until the guard is destroyed.
+ */
+template<typename T>
+class EpochSlotArray
+{
+public:
+    /** The maximum number of threads that may ever hold a ReadGuard.
+        Slots are never given back, so this must cover every thread that
+        reads over the lifetime of the program. */
+    static constexpr std::size_t MAX_READER_THREADS = 64;
+
+    /**
+     * Marks the calling thread as reading from the array until destructed.
+     * Guards may be nested on the same thread.
+     */
+    class ReadGuard
+    {
+    public:
+        explicit ReadGuard(const EpochSlotArray& inArray)
+        : readerEpoch(inArray.readerEpochs[getReaderIndex()].epoch)
+        , ownsEpoch(false)
+        {
+            // If we're nested inside another guard, it already protects us.
+            if (readerEpoch.load(std::memory_order_relaxed) != 0) {
+                return;
+            }
+
+            // Publish the current epoch before touching any slots.
+            // Note: seq_cst orders this store before our slot loads, and
+            //       against the writer's erase() and reclaimRetired().
+            readerEpoch.store(inArray.globalEpoch.load());
+            ownsEpoch = true;
+        }
+
+        ~ReadGuard()
+        {
+            if (ownsEpoch) {
+                readerEpoch.store(0, std::memory_order_release);
+            }
+        }
+
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+    private:
+        std::atomic<Uint64>& readerEpoch;
+
+        /** If false, we're nested and shouldn't clear readerEpoch. */
+        bool ownsEpoch;
+    };
+
+    explicit EpochSlotArray(std::size_t inCapacity)
+    : capacity(inCapacity)
+    , slots(std::make_unique<Slot[]>(inCapacity))
+    , globalEpoch(1)
+    , size(0)
+    {
+    }
+
+    ~EpochSlotArray()
+    {
+        for (std::size_t i = 0; i < capacity; ++i) {
+            delete slots[i].object.load(std::memory_order_relaxed);
+        }
+        for (RetiredObject& retired : retiredObjects) {
+            delete retired.object;
+        }
+    }
+
+    EpochSlotArray(const EpochSlotArray&) = delete;
+    EpochSlotArray& operator=(const EpochSlotArray&) = delete;
+
+    //-------------------------------------------------------------------------
+    // Writer thread
+    //-------------------------------------------------------------------------
+    /**
+     * Takes ownership of the given object and places it at the given ID.
+     *
+     * @return true if the object was inserted, false if the ID is out of range
+     *         or already occupied (in which case the object is destroyed).
+     */
+    bool insert(std::size_t id, std::unique_ptr<T> object)
+    {
+        if ((id >= capacity)
+            || (slots[id].object.load(std::memory_order_relaxed)
+                != nullptr)) {
+            return false;
+        }
+
+        Slot& slot = slots[id];
+        slot.generation.fetch_add(1, std::memory_order_relaxed);
+        slot.object.store(object.release(), std::memory_order_release);
+        size++;
+
+        return true;
+    }
+
+    /**
+     * Removes the object at the given ID, if there is one.
+     * The object will be deleted by a later reclaimRetired() call, once no
+     * readers can still be using it.
+     */
+    void erase(std::size_t id)
+    {
+        if (id >= capacity) {
+            return;
+        }
+
+        Slot& slot = slots[id];
+        T* object = slot.object.exchange(nullptr);
+        if (object == nullptr) {
+            return;
+        }
+        slot.generation.fetch_add(1, std::memory_order_relaxed);
+        size--;
+
+        // Any reader that saw the object entered at or before this epoch.
+        Uint64 retireEpoch = globalEpoch.fetch_add(1);
+        retiredObjects.push_back({retireEpoch, object});
+    }
+
+    /**
+     * Deletes any erased objects that no reader can still be using.
+     * Cheap if nothing is waiting to be deleted.
+     */
+    void reclaimRetired()
+    {
+        if (retiredObjects.empty()) {
+            return;
+        }
+
+        // Find the oldest epoch that any active reader entered in.
+        Uint64 oldestActiveEpoch = std::numeric_limits<Uint64>::max();
+        for (const ReaderEpoch& readerEpoch : readerEpochs) {
+            Uint64 epoch = readerEpoch.epoch.load();
+            if (epoch != 0) {
+                oldestActiveEpoch = std::min(oldestActiveEpoch, epoch);
+            }
+        }
+
+        // Delete everything that was retired before that epoch.
+        std::erase_if(retiredObjects, [&](const RetiredObject& retired) {
+            if (retired.epoch < oldestActiveEpoch) {
+                delete retired.object;
+                return true;
+            }
+            return false;
+        });
+    }
+
+    /** Returns the number of erased objects that are waiting to be deleted.
+     */
+    std::size_t getRetiredCount() const { return retiredObjects.size(); }
+
+    //-------------------------------------------------------------------------
+    // Readers (with a ReadGuard) or the writer thread
+    //-------------------------------------------------------------------------
+    /**
+     * Returns the object at the given ID, or nullptr if there isn't one.
+     */
+    T* find(std::size_t id) const
+    {
+        if (id >= capacity) {
+            return nullptr;
+        }
+
+        return slots[id].object.load();
+    }
+
+    /**
+     * Calls func(id, object) for each object, in ID order.
+     */
+    template<typename Func>
+    void forEach(Func&& func) const
+    {
+        forEachInStride(0, 1, func);
+    }
+
+    /**
+     * Calls func(id, object) for each object whose ID is
+     * (first + (n * stride)), for n = 0, 1, 2...
+     * Used to split the objects into disjoint shards.
+     */
+    template<typename Func>
+    void forEachInStride(std::size_t first, std::size_t stride,
+                         Func&& func) const
+    {
+        for (std::size_t id = first; id < capacity; id += stride) {
+            if (T* object = slots[id].object.load()) {
+                func(id, *object);
+            }
+        }
+    }
+
+    /**
+     * Returns the given slot's generation. Changes whenever the slot's object
+     * is inserted or erased. Odd while the slot is occupied.
+     */
+    Uint32 getGeneration(std::size_t id) const
+    {
+        if (id >= capacity) {
+            return 0;
+        }
+
+        return slots[id].generation.load(std::memory_order_relaxed);
+    }
+
+    //-------------------------------------------------------------------------
+    // Any thread
+    //-------------------------------------------------------------------------
+    std::size_t getCapacity() const { return capacity; }
+
+    /** Returns the number of objects currently in the array. */
+    std::size_t getSize() const { return size.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        std::atomic<T*> object{nullptr};
+        std::atomic<Uint32> generation{0};
+    };
+
+    /** A reader thread's published epoch. 0 if the thread isn't reading.
+        Each is kept on its own cache line so readers don't contend. */
+    struct alignas(64) ReaderEpoch {
+        std::atomic<Uint64> epoch{0};
+    };
+
+    /** An erased object, waiting for readers to move past its epoch. */
+    struct RetiredObject {
+        Uint64 epoch;
+        T* object;
+    };
+
+    /**
+     * Returns the calling thread's index into readerEpochs.
+     * Indices are shared by all arrays of this type.
+     */
+    static std::size_t getReaderIndex()
+    {
+        static std::atomic<std::size_t> nextReaderIndex{0};
+        thread_local std::size_t readerIndex
+            = nextReaderIndex.fetch_add(1, std::memory_order_relaxed);
+        if (readerIndex >= MAX_READER_THREADS) {
+            LOG_ERROR("Too many reader threads. Max: %u", MAX_READER_THREADS);
+        }
+
+        return readerIndex;
+    }
+
+    /** The number of slots. IDs must be less than this. */
+    const std::size_t capacity;
+
+    std::unique_ptr<Slot[]> slots;
+
+    /** Each reader thread's published epoch. */
+    mutable std::array<ReaderEpoch, MAX_READER_THREADS> readerEpochs;
+
+    /** Incremented each time an object is erased. Starts at 1, since 0 means
+        "not reading". */
+    std::atomic<Uint64> globalEpoch;
+
+    /** Erased objects that may still be in use by a reader. Writer only. */
+    std::vector<RetiredObject> retiredObjects;
+
+    /** The number of occupied slots. Only written by the writer. */
+    std::atomic<std::size_t> size;
+};
+
+} // End namespace Server
+} // End namespace AM
@@ -1,52 +1,89 @@
 #pragma once
 
+#include "NetworkDefs.h"
 #include <vector>
 
 namespace AM
 {
 namespace Server
 {
+/**
+ * Hands out generation-tagged IDs.
+ *
+ * Each ID is made of an index (the low INDEX_BITS), which is dense and less
+ * than the pool size so it can be used to index arrays, and a generation
+ * (the remaining high bits), which is incremented every time the index is
+ * freed. Data that outlives its ID (e.g. a late message from a disconnected
+ * client) can be detected by comparing the full ID, even if the index has
+ * since been reused.
+ *
+ * Generations start at 1, so a reserved ID is never 0.
+ */
 class IDPool
 {
 public:
+    /** The number of low bits in an ID that hold its index. */
+    static constexpr unsigned int INDEX_BITS = 16;
+
+    /** The largest pool that we support. */
+    static constexpr unsigned int MAX_POOL_SIZE = (1 << INDEX_BITS);
+
     IDPool(unsigned int inPoolSize);
 
     /**
-     * Reserves and returns the next empty ID.
+     * Reserves and returns an available ID. O(1).
      *
-     * Marches forward, e.g. if 0-10 were reserved and freed, 11 will be the
-     * next reserved ID. This, along with SAFETY_BUFFER, aims to remove
-     * situations where an ID was reserved, freed, and re-reserved while old
-     * data exists in the system.
+     * Freed indices are reused in the order that they were freed, so an
+     * index sits unused for as long as possible before being reused.
      */
-    unsigned int reserveID();
+    NetworkID reserveID();
 
     /**
-     * Frees an ID for reuse.
+     * Frees an ID for reuse. O(1).
      */
-    void freeID(unsigned int ID);
+    void freeID(NetworkID ID);
+
+    /**
+     * Returns true if the given ID is currently reserved. IDs with an old
+     * generation aren't.
+     */
+    bool isReserved(NetworkID ID) const;
+
+    /** Returns the given ID's index. */
+    static constexpr unsigned int getIndex(NetworkID ID)
+    {
+        return (ID & (MAX_POOL_SIZE - 1));
+    }
+
+    /** Returns the given ID's generation. */
+    static constexpr unsigned int getGeneration(NetworkID ID)
+    {
+        return (ID >> INDEX_BITS);
+    }
 
 private:
-    /** Extra room so that we don't run into reuse issues when almost all IDs
-        are reserved. */
-    static constexpr unsigned int SAFETY_BUFFER = 100;
+    /** The largest generation that fits in an ID. Generations wrap back to
+        1 after this. */
+    static constexpr unsigned int MAX_GENERATION = (0xFFFFFFFF >> INDEX_BITS);
 
     /** The maximum number of IDs that we can give out. */
     unsigned int poolSize;
 
-    /** The size of our container. Equal to poolSize + SAFETY_BUFFER. */
-    unsigned int containerSize;
-
-    /** The last index that we added an ID to. */
-    unsigned int lastAddedIndex;
-
     /** The number of currently reserved IDs. */
     unsigned int reservedIDCount;
 
-    /**
-     * If ID 'x' is available, IDs[x] will be true. Else, it will be false.
-     */
-    std::vector<bool> IDs;
+    /** The current generation of each index. */
+    std::vector<Uint32> generations;
+
+    /** If index 'x' is reserved, reservedIndices[x] will be true. */
+    std::vector<bool> reservedIndices;
+
+    /** A ring of the free indices, in the order that they were freed.
+        Sized to poolSize, since every index may be free at once. */
+    std::vector<Uint32> freeIndices;
+
+    /** The position of the oldest free index in freeIndices. */
+    unsigned int freeHead;
 };
 
 } // namespace Server
@@ -4,7 +4,9 @@
 #include "SDL_stdinc.h"
 #include <array>
 #include <queue>
-#include <mutex>
+#include <vector>
+#include <memory>
+#include <atomic>
 #include "Log.h"
 
 namespace AM
@@ -36,13 +38,21 @@ public:
  * A specialized container that sorts messages into an appropriate queue based
  * on the tick number they're associated with.
  *
- * Thread-safe, the intended usage is for an asynch receiver thread to act as
- * the producer, and for the main game loop to periodically consume the messages
- * for its current tick.
+ * Thread-safe and lock-free. The intended usage is for asynch receiver
+ * threads to act as producers, and for the main game loop to periodically
+ * consume the messages for its current tick.
  *
  * To consume: Call startReceive, process all messages from the queue, then call
- * endReceive. Producer note: Will block on pushing until the consumer lock is
- * released.
+ * endReceive. Producers never wait on the consumer. While a tick is being
+ * received, its slot is closed and pushes for it are treated as too low, but
+ * pushes for future ticks go through as normal.
+ *
+ * Internally, each tick slot is a lock-free stack that producers push onto.
+ * startReceive takes the whole stack at once and puts it back in order.
+ *
+ * Each slot preallocates its stack nodes and keeps the unused ones in a
+ * lock-free free list, so pushes don't allocate. If a slot runs out of nodes,
+ * push falls back to allocating one.
  */
 template<typename T>
 class MessageSorter : public MessageSorterBase
@@ -64,25 +74,66 @@ public:
     static constexpr int MESSAGE_DROP_BOUND_LOWER = 0;
     static constexpr int MESSAGE_DROP_BOUND_UPPER = BUFFER_SIZE - 1;
 
-    MessageSorter()
+    /** The default number of nodes to preallocate for each tick slot. */
+    static constexpr Uint32 DEFAULT_NODES_PER_SLOT = 256;
+
+    /**
+     * @param nodesPerSlot  The number of nodes to preallocate for each tick
+     *                      slot. Should cover the messages that a tick
+     *                      usually receives.
+     */
+    explicit MessageSorter(Uint32 nodesPerSlot = DEFAULT_NODES_PER_SLOT)
     : currentTick(0)
-    , head(0)
+    , receivingSlot(0)
     , isReceiving(false)
+    , staleMessageCount(0)
     {
+        for (Slot& slot : slots) {
+            slot.head = nullptr;
+
+            // Allocate the slot's nodes and link them into its free list.
+            slot.nodes = std::make_unique<Node[]>(nodesPerSlot);
+            for (Uint32 i = 0; i < nodesPerSlot; ++i) {
+                slot.nodes[i].isPooled = true;
+                slot.nodes[i].nextFree
+                    = ((i + 1) < nodesPerSlot) ? (i + 1) : NO_NODE;
+            }
+            slot.freeHead = packFreeHead(0, ((nodesPerSlot > 0) ? 0 : NO_NODE));
+        }
+    }
+
+    ~MessageSorter()
+    {
+        // Free any nodes that were allocated after a slot ran out.
+        // Note: Pooled nodes are freed along with their slot.
+        for (Slot& slot : slots) {
+            Node* node = slot.head.load();
+            if (node == closedSlot()) {
+                continue;
+            }
+
+            while (node != nullptr) {
+                Node* next = node->next;
+                if (!(node->isPooled)) {
+                    delete node;
+                }
+                node = next;
+            }
+        }
     }
 
     /**
      * Starts a receive operation.
      *
-     * NOTE: If tickNum is valid, locks the MessageSorter until endReceive is
-     *       called.
+     * NOTE: Closes the given tick's slot until endReceive is called. Pushes
+     *       for this tick will be rejected as TooLow.
      *
-     * Returns a pointer to the queue holding messages for the given tick
+     * Returns a reference to the queue holding messages for the given tick
      * number. If tickNum < currentTick or tickNum > (currentTick +
      * VALID_DIFFERENCE), it is considered not valid and an error occurs.
      *
-     * @return If tickNum is valid (not too new or old), returns a pointer to a
-     *         queue. Else, raises an error.
+     * @return If tickNum is valid (not too new or old), returns a reference to
+     *         a queue. Else, raises an error.
      */
     std::queue<value_type>& startReceive(Uint32 tickNum)
     {
@@ -91,33 +142,62 @@ public:
                       "forgot to call endReceive.");
         }
 
-        // Acquire the mutex.
-        mutex.lock();
-
         // Check if the tick is valid.
         if (isTickValid(tickNum) != ValidityResult::Valid) {
-            // tickNum is invalid, release the lock.
-            mutex.unlock();
             LOG_ERROR("Tried to start receive for an invalid tick number.");
         }
 
+        // Take the slot's messages, closing it to further pushes.
+        receivingSlot = tickNum % BUFFER_SIZE;
+        Slot& slot = slots[receivingSlot];
+        Node* node
+            = slot.head.exchange(closedSlot(), std::memory_order_acq_rel);
+
+        // The stack is newest-first, reverse it so we can receive in order.
+        Node* reversed = nullptr;
+        while (node != nullptr) {
+            Node* next = node->next;
+            node->next = reversed;
+            reversed = node;
+            node = next;
+        }
+
+        // Move the messages into the receive queue.
+        while (reversed != nullptr) {
+            Node* next = reversed->next;
+
+            // Note: A producer that stalled across a whole tick may have
+            //       pushed a message into this slot after it was reused. We
+            //       have no way to process it, so we drop it and hand it back
+            //       through getStaleMessages() so the drop can be reported.
+            if (reversed->tickNum == tickNum) {
+                receiveQueue.push(std::move(reversed->message));
+            }
+            else {
+                staleMessageCount++;
+                LOG_INFO("Dropped stale message. tickNum: %u, current: %u",
+                         reversed->tickNum, tickNum);
+                staleMessages.push_back(std::move(reversed->message));
+            }
+
+            freeNode(slot, reversed);
+            reversed = next;
+        }
+
         // Flag that we've started the receive operation.
         isReceiving = true;
 
-        return queueBuffer[tickNum % BUFFER_SIZE];
+        return receiveQueue;
     }
 
     /**
      * Ends an ongoing receive operation.
      *
-     * NOTE: This function releases the lock set by startReceive.
+     * NOTE: This function re-opens the slot that was closed by startReceive.
      *
-     * Increments currentTick and head, effectively removing the element at the
-     * old currentTick and making messages at currentTick + BUFFER_SIZE - 1
-     * valid to be pushed.
-     *
-     * @post The index previously pointed to by head is now head - 1,
-     *       effectively making it the new end of the buffer.
+     * Increments currentTick, effectively removing the element at the old
+     * currentTick and making messages at currentTick + BUFFER_SIZE - 1 valid
+     * to be pushed.
      */
     void endReceive()
     {
@@ -125,54 +205,191 @@ public:
             LOG_ERROR("Tried to endReceive() while not receiving.");
         }
 
+        // Clear out any messages that the consumer didn't process.
+        receiveQueue = {};
+        staleMessages.clear();
+
+        // Re-open the slot for its next tick.
+        // Note: This must happen before currentTick is advanced, so that
+        //       producers that see the new tick also see the open slot.
+        slots[receivingSlot].head.store(nullptr, std::memory_order_release);
+
         // Advance the state.
-        head++;
-        currentTick++;
+        currentTick.fetch_add(1, std::memory_order_release);
 
         // Flag that we're ending the receive operation.
         isReceiving = false;
-
-        // Release the mutex.
-        mutex.unlock();
     }
 
     /**
      * If tickNum is valid, buffers the message.
      *
-     * Note: Blocks on mutex if there's a receive ongoing.
+     * Note: Never blocks. If tickNum's slot is currently being received, the
+     *       message is treated as TooLow.
      *
-     * @return True if tickNum was valid and the message was pushed, else false.
+     * @return The validity of tickNum and its difference from currentTick.
+     *         If the result is Valid, the message was pushed.
      */
     PushResult push(Uint32 tickNum, value_type message)
     {
-        /** Try to push the message. */
-        // Acquire the mutex.
-        mutex.lock();
-
         // Check validity of the message's tick.
-        ValidityResult validity = isTickValid(tickNum);
-
-        // If tickNum is valid, push the message.
-        if (validity == ValidityResult::Valid) {
-            queueBuffer[tickNum % BUFFER_SIZE].push(std::move(message));
-        }
+        Uint32 tickSnapshot = currentTick.load(std::memory_order_acquire);
+        ValidityResult validity = isTickValid(tickNum, tickSnapshot);
 
         // Calc the tick diff.
         Sint64 diff
-            = static_cast<Sint64>(tickNum) - static_cast<Sint64>(currentTick);
+            = static_cast<Sint64>(tickNum) - static_cast<Sint64>(tickSnapshot);
 
-        // Release the mutex.
-        mutex.unlock();
+        // If tickNum isn't valid, drop the message.
+        if (validity != ValidityResult::Valid) {
+            return {validity, diff};
+        }
+
+        // Try to push the message onto its tick's slot.
+        Slot& slot = slots[tickNum % BUFFER_SIZE];
+        Node* node = allocateNode(slot);
+        node->tickNum = tickNum;
+        node->message = std::move(message);
+        Node* head = slot.head.load(std::memory_order_acquire);
+        do {
+            // If the slot is being received, we're too late for this tick.
+            if (head == closedSlot()) {
+                freeNode(slot, node);
+                return {ValidityResult::TooLow, diff};
+            }
+
+            node->next = head;
+        } while (!(slot.head.compare_exchange_weak(
+            head, node, std::memory_order_release,
+            std::memory_order_acquire)));
 
         return {validity, diff};
     }
 
     /** Helper for checking if a tick number is within the bounds. */
     ValidityResult isTickValid(Uint32 tickNum)
+    {
+        return isTickValid(tickNum,
+                           currentTick.load(std::memory_order_acquire));
+    }
+
+    /**
+     * Returns the MessageSorter's internal currentTick.
+     * NOTE: Should not be used to fetch the current tick, get a ref to the
+     *       Game's currentTick instead. This is just for unit testing.
+     */
+    Uint32 getCurrentTick() { return currentTick; }
+
+    /**
+     * Returns the number of messages that were pushed as valid, but had to be
+     * dropped because their tick had already been received.
+     */
+    unsigned int getStaleMessageCount() { return staleMessageCount; }
+
+    /**
+     * Returns the messages that the current receive operation dropped because
+     * they were stale, so the consumer can report the drops.
+     *
+     * Note: Only valid between startReceive and endReceive. Only call from the
+     *       consumer thread.
+     */
+    std::vector<value_type>& getStaleMessages() { return staleMessages; }
+
+private:
+    /** Used in place of a node index to mean "no node". */
+    static constexpr Uint32 NO_NODE = UINT32_MAX;
+
+    /** A message, linked into its tick slot's stack. */
+    struct Node {
+        Uint32 tickNum{0};
+        value_type message{};
+        Node* next{nullptr};
+
+        /** If this node is in its slot's free list, the index of the next
+            free node. Atomic since a producer may read it while racing to
+            take this node (the free list's tag makes the loser retry). */
+        std::atomic<Uint32> nextFree{NO_NODE};
+
+        /** If true, this node belongs to its slot's pool. Else, it was
+            allocated because the pool ran out. */
+        bool isPooled{false};
+    };
+
+    /** A tick's stack of messages, and the nodes that it can use. */
+    struct Slot {
+        /** The head of the stack. See slots. */
+        std::atomic<Node*> head;
+
+        /** This slot's preallocated nodes. */
+        std::unique_ptr<Node[]> nodes;
+
+        /** The head of the free list. The low 32 bits are the index of the
+            first free node, the high 32 bits are a tag that's incremented on
+            every change, so that a stale compare-exchange can't succeed
+            (the ABA problem). */
+        std::atomic<Uint64> freeHead;
+    };
+
+    static Uint64 packFreeHead(Uint32 tag, Uint32 index)
+    {
+        return ((static_cast<Uint64>(tag) << 32) | index);
+    }
+
+    /**
+     * Takes a node from the given slot's free list. If the list is empty,
+     * allocates one instead.
+     */
+    static Node* allocateNode(Slot& slot)
+    {
+        Uint64 freeHead = slot.freeHead.load(std::memory_order_acquire);
+        while (true) {
+            Uint32 index = static_cast<Uint32>(freeHead);
+            if (index == NO_NODE) {
+                return new Node{};
+            }
+
+            Uint32 tag = static_cast<Uint32>(freeHead >> 32);
+            Uint32 nextFree
+                = slot.nodes[index].nextFree.load(std::memory_order_relaxed);
+            if (slot.freeHead.compare_exchange_weak(
+                    freeHead, packFreeHead((tag + 1), nextFree),
+                    std::memory_order_acq_rel, std::memory_order_acquire)) {
+                return &(slot.nodes[index]);
+            }
+        }
+    }
+
+    /**
+     * Returns the given node to the given slot's free list, or deletes it if
+     * it didn't come from the pool.
+     */
+    static void freeNode(Slot& slot, Node* node)
+    {
+        if (!(node->isPooled)) {
+            delete node;
+            return;
+        }
+
+        // Release the message's resources now, instead of when it's reused.
+        node->message = value_type{};
+
+        Uint32 index = static_cast<Uint32>(node - slot.nodes.get());
+        Uint64 freeHead = slot.freeHead.load(std::memory_order_relaxed);
+        do {
+            node->nextFree.store(static_cast<Uint32>(freeHead),
+                                 std::memory_order_relaxed);
+        } while (!(slot.freeHead.compare_exchange_weak(
+            freeHead,
+            packFreeHead((static_cast<Uint32>(freeHead >> 32) + 1), index),
+            std::memory_order_release, std::memory_order_relaxed)));
+    }
+
+    /** Checks if tickNum is within the bounds, relative to the given tick. */
+    static ValidityResult isTickValid(Uint32 tickNum, Uint32 relativeTick)
     {
         // Check if tickNum is within our lower and upper bounds.
-        Uint32 upperBound = (currentTick + BUFFER_SIZE - 1);
-        if (tickNum < currentTick) {
+        Uint32 upperBound = (relativeTick + BUFFER_SIZE - 1);
+        if (tickNum < relativeTick) {
             return ValidityResult::TooLow;
         }
         else if (tickNum > upperBound) {
@@ -184,38 +401,38 @@ public:
     }
 
     /**
-     * Returns the MessageSorter's internal currentTick.
-     * NOTE: Should not be used to fetch the current tick, get a ref to the
-     *       Game's currentTick instead. This is just for unit testing.
+     * Returns the marker that a slot holds while it's being received.
+     * Never dereferenced, just needs to be distinct from any real node.
      */
-    Uint32 getCurrentTick() { return currentTick; }
+    Node* closedSlot() { return reinterpret_cast<Node*>(&closedMarker); }
 
-private:
     /**
-     * Holds the queues used for sorting and storing messages.
+     * Holds the stacks used for sorting and storing messages.
      *
-     * Holds messages at the index equal to their tick number - currentTick.
-     * (e.g. if currentTick is 42, the queue in index 0 holds messages for tick
-     * number 42, index 1: 43, ..., index (VALID_DIFFERENCE): (42 +
-     * VALID_DIFFERENCE)).
+     * Holds messages at the index equal to their tick number % BUFFER_SIZE.
+     * Each slot's head is a newest-first linked list, nullptr if empty, or
+     * closedSlot() if it's being received.
      */
-    std::array<std::queue<T>, BUFFER_SIZE> queueBuffer;
+    std::array<Slot, BUFFER_SIZE> slots;
+
+    /** The address of this is used as the closed slot marker. */
+    char closedMarker;
 
     /**
      * The current tick that we've advanced to.
      */
-    Uint32 currentTick;
+    std::atomic<Uint32> currentTick;
 
     /**
-     * The index at which we're holding the current tick.
+     * The messages for the tick that's currently being received.
+     * Only accessed by the consumer.
      */
-    std::size_t head;
+    std::queue<value_type> receiveQueue;
 
     /**
-     * Used to prevent queueBuffer and head updates while a push or receive is
-     * happening.
+     * The index of the slot that's currently being received.
      */
-    std::mutex mutex;
+    std::size_t receivingSlot;
 
     /**
      * Tracks whether a receive operation has been started or not.
@@ -224,17 +441,13 @@ private:
      */
     bool isReceiving;
 
-    //----------------------------------------------------------------------------
-    // Convenience Functions
-    //----------------------------------------------------------------------------
-    /**
-     * Returns the index, incremented by amount. Accounts for wrap-around.
-     */
-    std::size_t increment(const std::size_t index,
-                          const std::size_t amount) const
-    {
-        return (index + amount) % BUFFER_SIZE;
-    }
+    /** The messages that the current receive operation dropped because they
+        were stale. Only accessed by the consumer. */
+    std::vector<value_type> staleMessages;
+
+    /** The number of messages that were dropped by startReceive because they
+        were stale. */
+    std::atomic<unsigned int> staleMessageCount;
 };
 
 } // namespace Server
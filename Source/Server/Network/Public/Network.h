@@ -4,14 +4,20 @@
 #include "ServerNetworkDefs.h"
 #include "SharedConfig.h"
 #include "ClientHandler.h"
+#include "ClientStats.h"
+#include "NetworkStats.h"
 #include "MessageSorter.h"
 #include "ClientInput.h"
 #include "readerwriterqueue.h"
 #include <memory>
 #include <cstddef>
+#include <optional>
 #include <unordered_map>
-#include <shared_mutex>
 #include <queue>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 namespace AM
 {
@@ -20,6 +26,18 @@ class Peer;
 
 namespace Server
 {
+/** A copy of the server's network statistics. */
+struct NetworkStatsSnapshot {
+    /** The sim tick that the snapshot was taken on. */
+    Uint32 tickNum = 0;
+
+    /** The totals for each MessageType, since the server started. */
+    MessageTypeStatsArr messageTypes{};
+
+    /** The totals for each connected client, since they connected. */
+    std::vector<ClientStatsSnapshot> clients;
+};
+
 /**
  * Provides Network functionality in the format that the Game wants.
  */
@@ -28,7 +46,12 @@ class Network
 public:
     static constexpr unsigned int SERVER_PORT = 41499;
 
-    Network();
+    /**
+     * @param transport  The transport that clients will connect over.
+     */
+    Network(Transport transport);
+
+    ~Network();
 
     /**
      * Sends any queued messages over the network.
@@ -54,14 +77,26 @@ public:
      * When a message with a tick number is received, updates the associated
      * client's tick diff data.
      *
+     * Note: Must be called from the ClientHandler's receive thread, since it
+     *       accesses the clientMap without a ReadGuard.
+     *
      * @param receiveQueue  A queue with messages to process.
      */
     void processReceivedMessages(std::queue<ClientMessage>& receiveQueue);
 
-    /** Forwards to the inputMessageSorter's startReceive. */
+    /** Forwards to the inputMessageSorter's startReceive. Records any stale
+        messages that it dropped. */
     std::queue<std::unique_ptr<ClientInput>>&
         startReceiveInputMessages(Uint32 tickNum);
 
+    /**
+     * Returns the input messages that the current receive operation dropped
+     * because they were stale. The sim must handle them like any other
+     * dropped message.
+     * Only valid between startReceiveInputMessages and endReceiveInputMessages.
+     */
+    std::vector<std::unique_ptr<ClientInput>>& getStaleInputMessages();
+
     /** Forward to the inputMessageSorter's endReceive. */
     void endReceiveInputMessages();
 
@@ -72,7 +107,26 @@ public:
     // to attempt to re-assign the obtained ref (can't re-seat a reference once
     // bound).
     ClientMap& getClientMap();
-    std::shared_mutex& getClientMapMutex();
+
+    /**
+     * Returns the client with the given netID, or nullptr if it doesn't exist.
+     * IDs from an erased client are rejected, even if their index has since
+     * been reused by a new client.
+     *
+     * Note: The caller must hold a ClientMap::ReadGuard, or be the
+     *       ClientHandler's receive thread.
+     */
+    Client* findClient(NetworkID netID);
+
+    /**
+     * Returns what we've learned about the delivery of the EntityUpdates
+     * that were sent to the given client, since the last call.
+     * See Client::takeUpdateDelivery().
+     *
+     * @return The client's UpdateDelivery, or a default one if the client
+     *         doesn't exist.
+     */
+    UpdateDelivery takeUpdateDelivery(NetworkID networkID);
 
     moodycamel::ReaderWriterQueue<NetworkID>& getConnectEventQueue();
     moodycamel::ReaderWriterQueue<NetworkID>& getDisconnectEventQueue();
@@ -101,18 +155,43 @@ public:
     /** Convenience for network-owned objects to get the current tick. */
     Uint32 getCurrentTick();
 
+    /**
+     * Returns a copy of our per-MessageType and per-client statistics.
+     * Safe to call from any thread.
+     */
+    NetworkStatsSnapshot getStatsSnapshot();
+
 private:
     /**
      * Logs the network stats such as bytes sent/received per second.
      */
     void logNetworkStatistics();
 
+    /**
+     * Hands a snapshot of our statistics to the stats writer thread, to be
+     * written to Config::NETWORK_STATS_FILE_PATH.
+     */
+    void queueStatsFileWrite();
+
+    /**
+     * Thread function, writes each queued stats snapshot to the stats file.
+     */
+    void statsWriterLoop();
+
+    /**
+     * Writes the given snapshot to Config::NETWORK_STATS_FILE_PATH as JSON,
+     * so that external tools can watch it.
+     */
+    static void writeStatsFile(const NetworkStatsSnapshot& snapshot);
+
     /**
      * Handles a received ClientInputs message.
-     * @return The tick diff that inputMessageSorter.push() returned.
+     * @return The tick diff that inputMessageSorter.push() returned, or
+     *         nullopt if the message was a copy of inputs that we already
+     *         received.
      */
-    Sint64 handleClientInputs(ClientMessage& clientMessage,
-                              BinaryBufferPtr& messageBuffer);
+    std::optional<Sint64> handleClientInputs(Client& client,
+                                             BinaryBufferPtr& messageBuffer);
 
     /**
      * Handles a received Heartbeat message.
@@ -121,15 +200,14 @@ private:
     Sint64 handleHeartbeat(BinaryBufferPtr& messageBuffer);
 
     /** Maps IDs to their connections. Allows the game to say "send this message
-        to this entity" instead of needing to track the connection objects. */
+        to this entity" instead of needing to track the connection objects.
+        Indexed by IDPool::getIndex(netID), use findClient() to also check
+        the generation.
+        Note: ClientHandler's receive thread is the only one that modifies
+              the map, so it doesn't bother with ReadGuards. All other
+              threads must hold a ReadGuard while accessing clients. */
     ClientMap clientMap;
 
-    /** Used to lock access to the clientMap.
-        Note: ClientHandler's thread is the only one that obtains exclusive
-              access to this mutex, so it doesn't bother obtaining shared
-              access. If that changes, it will need to be updated. */
-    std::shared_mutex clientMapMutex;
-
     ClientHandler clientHandler;
 
     /** Used to inform the sim of client connections. */
@@ -155,6 +233,23 @@ private:
 
     /** Pointer to the game's current tick. */
     const std::atomic<Uint32>* currentTickPtr;
+
+    /** Serializes and writes the stats file, so the network tick doesn't
+        have to. */
+    std::thread statsWriterThreadObj;
+
+    /** Guards pendingStatsSnapshot and statsWriterExitRequested. */
+    std::mutex statsWriterMutex;
+
+    /** Used to wake the stats writer when there's something to do. */
+    std::condition_variable statsWriterCondVar;
+
+    /** The latest snapshot that hasn't been written yet.
+        If the writer falls behind, older snapshots are replaced. */
+    std::optional<NetworkStatsSnapshot> pendingStatsSnapshot;
+
+    /** Set to tell the stats writer to exit. */
+    bool statsWriterExitRequested;
 };
 
 } // namespace Server
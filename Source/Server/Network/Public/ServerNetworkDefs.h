@@ -1,8 +1,7 @@
 #pragma once
 
 #include "NetworkDefs.h"
-#include <unordered_map>
-#include <memory>
+#include "EpochSlotArray.h"
 
 /**
  * This file contains client-specific network definitions.
@@ -14,9 +13,9 @@ namespace Server
 //--------------------------------------------------------------------------
 // Typedefs
 //--------------------------------------------------------------------------
-/** A map type used to manage clients. */
+/** The container used to manage clients, indexed by IDPool::getIndex(). */
 class Client;
-typedef std::unordered_map<NetworkID, std::shared_ptr<Client>> ClientMap;
+typedef EpochSlotArray<Client> ClientMap;
 
 //--------------------------------------------------------------------------
 // Structs
@@ -24,22 +23,35 @@ typedef std::unordered_map<NetworkID, std::shared_ptr<Client>> ClientMap;
 /**
  * Used after receiving messages from a client to defer processing until later.
  * When we eventually do process the message, we need to optionally update the
- * Client's tick diff info.
+ * Client's tick diff info, so we look the client back up by its netID.
+ *
+ * Since netID includes the client's generation, messages from an erased
+ * client are rejected even if a new client has reused its index.
  */
 struct ClientMessage {
     // TEMP: Only here until C++20 where emplacing brace lists is allowed.
-    ClientMessage(NetworkID inNetID, const std::weak_ptr<Client>& inClientPtr,
-                  Message inMessage)
+    ClientMessage(NetworkID inNetID, Message inMessage)
     : netID(inNetID)
-    , clientPtr(inClientPtr)
     , message(std::move(inMessage))
     {
     }
 
     NetworkID netID = 0;
-    std::weak_ptr<Client> clientPtr;
     Message message = {MessageType::NotSet, nullptr};
 };
 
+/**
+ * What we've learned about the delivery of the EntityUpdates that were sent
+ * to a client. See Client::takeUpdateDelivery().
+ */
+struct UpdateDelivery {
+    /** Every update up to and including this tick has been reported on.
+        0 if none have. */
+    Uint32 settledTick = 0;
+    /** The earliest tick whose update was lost since the last report.
+        0 if none were. */
+    Uint32 lostTick = 0;
+};
+
 } // End namespace Server
 } // End namespace AM
@@ -0,0 +1,119 @@
+#include "EntityGrid.h"
+#include "AreaOfInterest.h"
+#include "Log.h"
+#include <algorithm>
+#include <cmath>
+
+namespace AM
+{
+namespace Server
+{
+void EntityGrid::addEntity(entt::entity entity, const Position& position)
+{
+    Uint64 cellKey
+        = toCellKey(toCellCoord(position.x), toCellCoord(position.y));
+    if (!(entityCellKeys.emplace(entity, cellKey).second)) {
+        LOG_ERROR("Tried to add an entity that's already in the grid.");
+    }
+
+    cells[cellKey].push_back(entity);
+}
+
+void EntityGrid::updateEntity(entt::entity entity, const Position& position)
+{
+    auto cellKeyIt = entityCellKeys.find(entity);
+    if (cellKeyIt == entityCellKeys.end()) {
+        LOG_ERROR("Tried to update an entity that isn't in the grid.");
+    }
+
+    // If the entity is still in the same cell, there's nothing to do.
+    Uint64 newCellKey
+        = toCellKey(toCellCoord(position.x), toCellCoord(position.y));
+    Uint64& oldCellKey = cellKeyIt->second;
+    if (newCellKey == oldCellKey) {
+        return;
+    }
+
+    // Move the entity to its new cell.
+    // Note: We keep the old cell even if it's now empty, so its memory can be
+    //       reused when an entity moves back into it.
+    std::erase(cells[oldCellKey], entity);
+
+    cells[newCellKey].push_back(entity);
+    oldCellKey = newCellKey;
+}
+
+void EntityGrid::removeEntity(entt::entity entity)
+{
+    auto cellKeyIt = entityCellKeys.find(entity);
+    if (cellKeyIt == entityCellKeys.end()) {
+        LOG_ERROR("Tried to remove an entity that isn't in the grid.");
+    }
+
+    // Remove the entity from its cell (keeping the cell, even if it's empty).
+    std::erase(cells[cellKeyIt->second], entity);
+
+    entityCellKeys.erase(cellKeyIt);
+}
+
+void EntityGrid::queryEntities(const AreaOfInterest& aoi,
+                               std::vector<entt::entity>& results) const
+{
+    // Find the range of cells that the AoI overlaps.
+    Sint32 minCellX = toCellCoord(aoi.origin.x);
+    Sint32 minCellY = toCellCoord(aoi.origin.y);
+    Sint32 maxCellX = toCellCoord(aoi.origin.x + aoi.width);
+    Sint32 maxCellY = toCellCoord(aoi.origin.y + aoi.height);
+
+    // Collect the entities from each occupied cell.
+    for (Sint32 cellY = minCellY; cellY <= maxCellY; ++cellY) {
+        for (Sint32 cellX = minCellX; cellX <= maxCellX; ++cellX) {
+            auto cellIt = cells.find(toCellKey(cellX, cellY));
+            if (cellIt != cells.end()) {
+                results.insert(results.end(), cellIt->second.begin(),
+                               cellIt->second.end());
+            }
+        }
+    }
+}
+
+GridOccupancyStats EntityGrid::getOccupancyStats() const
+{
+    GridOccupancyStats stats{};
+    stats.entityCount = static_cast<unsigned int>(entityCellKeys.size());
+
+    for (const auto& cellPair : cells) {
+        // Skip cells that emptied out.
+        if (cellPair.second.empty()) {
+            continue;
+        }
+
+        stats.occupiedCells++;
+        stats.maxCellEntities
+            = std::max(stats.maxCellEntities,
+                       static_cast<unsigned int>(cellPair.second.size()));
+    }
+
+    if (stats.occupiedCells > 0) {
+        stats.averageCellEntities
+            = static_cast<float>(stats.entityCount) / stats.occupiedCells;
+    }
+
+    return stats;
+}
+
+Sint32 EntityGrid::toCellCoord(float worldCoord)
+{
+    // Floor so that negative coordinates get their own cells instead of
+    // sharing cell 0.
+    return static_cast<Sint32>(std::floor(worldCoord / CELL_SIZE));
+}
+
+Uint64 EntityGrid::toCellKey(Sint32 cellX, Sint32 cellY)
+{
+    return (static_cast<Uint64>(static_cast<Uint32>(cellX)) << 32)
+           | static_cast<Uint32>(cellY);
+}
+
+} // namespace Server
+} // namespace AM
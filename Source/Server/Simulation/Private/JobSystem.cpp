@@ -0,0 +1,154 @@
+#include "JobSystem.h"
+#include "Log.h"
+#include <algorithm>
+
+namespace AM
+{
+namespace Server
+{
+JobSystem::JobSystem(unsigned int numWorkers)
+: remainingJobs(0)
+, stealCount(0)
+, batchIteration(0)
+, exitRequested(false)
+{
+    // Add the caller's queue, then the workers' queues.
+    for (unsigned int i = 0; i < (numWorkers + 1); ++i) {
+        jobQueues.push_back(std::make_unique<JobQueue>());
+    }
+
+    // Start the workers.
+    for (unsigned int i = 1; i <= numWorkers; ++i) {
+        workerThreadObjs.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        exitRequested = true;
+    }
+    wakeCondVar.notify_all();
+
+    for (std::thread& workerThreadObj : workerThreadObjs) {
+        workerThreadObj.join();
+    }
+}
+
+unsigned int JobSystem::dumpStealCount()
+{
+    return stealCount.exchange(0);
+}
+
+void JobSystem::runChunks(std::size_t count, std::size_t chunkSize,
+                          ChunkFunction function, void* context)
+{
+    if (chunkSize == 0) {
+        LOG_ERROR("Chunk size must be greater than 0.");
+    }
+    else if (count == 0) {
+        return;
+    }
+
+    // If there's only 1 chunk or no workers, just run it here.
+    std::size_t numChunks = ((count + chunkSize - 1) / chunkSize);
+    if ((numChunks == 1) || workerThreadObjs.empty()) {
+        for (std::size_t i = 0; i < count; i += chunkSize) {
+            function(context, i, std::min(i + chunkSize, count));
+        }
+        return;
+    }
+
+    // Spread the chunks across the queues.
+    // Note: The workers are asleep and our queue is empty, so there's no
+    //       contention on the queue locks here.
+    remainingJobs.store(numChunks, std::memory_order_relaxed);
+    for (std::size_t i = 0; i < numChunks; ++i) {
+        std::size_t beginIndex = (i * chunkSize);
+        Job job{function, context, beginIndex,
+                std::min(beginIndex + chunkSize, count)};
+
+        JobQueue& jobQueue = *(jobQueues[i % jobQueues.size()]);
+        std::unique_lock<std::mutex> lock(jobQueue.mutex);
+        jobQueue.jobs.push_back(job);
+    }
+
+    // Wake the workers.
+    {
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        batchIteration++;
+    }
+    wakeCondVar.notify_all();
+
+    // Help out until there's nothing left to take.
+    processJobs(0);
+
+    // Wait for any jobs that are still running on the workers.
+    while (remainingJobs.load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+    }
+}
+
+void JobSystem::workerLoop(unsigned int queueIndex)
+{
+    Uint64 lastBatchIteration = 0;
+    while (true) {
+        // Wait until a batch is queued.
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCondVar.wait(lock, [&] {
+                return (exitRequested
+                        || (batchIteration != lastBatchIteration));
+            });
+
+            if (exitRequested) {
+                return;
+            }
+            lastBatchIteration = batchIteration;
+        }
+
+        processJobs(queueIndex);
+    }
+}
+
+void JobSystem::processJobs(unsigned int queueIndex)
+{
+    Job job{};
+    while (getJob(queueIndex, job)) {
+        job.function(job.context, job.beginIndex, job.endIndex);
+        remainingJobs.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+bool JobSystem::getJob(unsigned int queueIndex, Job& outJob)
+{
+    // Try to take the newest job from our own queue.
+    {
+        JobQueue& ownQueue = *(jobQueues[queueIndex]);
+        std::unique_lock<std::mutex> lock(ownQueue.mutex);
+        if (!(ownQueue.jobs.empty())) {
+            outJob = ownQueue.jobs.back();
+            ownQueue.jobs.pop_back();
+            return true;
+        }
+    }
+
+    // Our queue is empty, try to steal the oldest job from another queue.
+    for (std::size_t i = 1; i < jobQueues.size(); ++i) {
+        std::size_t otherIndex = ((queueIndex + i) % jobQueues.size());
+        JobQueue& otherQueue = *(jobQueues[otherIndex]);
+        std::unique_lock<std::mutex> lock(otherQueue.mutex);
+        if (!(otherQueue.jobs.empty())) {
+            outJob = otherQueue.jobs.front();
+            otherQueue.jobs.pop_front();
+            stealCount.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+} // namespace Server
+} // namespace AM
@@ -1,6 +1,7 @@
 #include "MovementSystem.h"
 #include "MovementHelpers.h"
 #include "World.h"
+#include "JobSystem.h"
 #include "Input.h"
 #include "Position.h"
 #include "Movement.h"
@@ -13,8 +14,9 @@ namespace AM
 {
 namespace Server
 {
-MovementSystem::MovementSystem(World& inWorld)
+MovementSystem::MovementSystem(World& inWorld, JobSystem& inJobSystem)
 : world(inWorld)
+, jobSystem(inJobSystem)
 {
     // Init the groups that we'll be using.
     auto group = world.registry.group<Input, Position, Movement>();
@@ -27,14 +29,30 @@ void MovementSystem::processMovements()
 
     /* Move all entities that have an input, position, and movement
        component. */
+    // Note: Each entity's movement only touches its own components, so the
+    //       results don't depend on how the chunks get split across threads.
+    // Note: The group owns all 3 components, so their storage is packed in
+    //       the same order and we can move them as arrays.
     auto group = world.registry.group<Input, Position, Movement>();
-    for (entt::entity entity : group) {
-        auto [input, position, movement]
-            = group.get<Input, Position, Movement>(entity);
+    Input* inputs = group.raw<Input>();
+    Position* positions = group.raw<Position>();
+    Movement* movements = group.raw<Movement>();
+    jobSystem.parallelFor(
+        group.size(), CHUNK_SIZE,
+        [&](std::size_t beginIndex, std::size_t endIndex) {
+            BEGIN_CPU_SAMPLE(processMovementChunk);
+            MovementHelpers::moveEntities(
+                &(positions[beginIndex]), &(movements[beginIndex]),
+                &(inputs[beginIndex]), (endIndex - beginIndex),
+                SharedConfig::SIM_TICK_TIMESTEP_S);
+            END_CPU_SAMPLE();
+        });
 
-        // Process their movement.
-        MovementHelpers::moveEntity(position, movement, input.inputStates,
-                                    SharedConfig::SIM_TICK_TIMESTEP_S);
+    // Keep the spatial index in sync.
+    // Note: The grid isn't thread safe, so we do this after the movement jobs
+    //       are done.
+    for (entt::entity entity : group) {
+        world.entityGrid.updateEntity(entity, group.get<Position>(entity));
     }
 }
 
@@ -4,6 +4,7 @@
 #include "Network.h"
 #include "SharedConfig.h"
 #include "MessageTools.h"
+#include "MessageBufferPool.h"
 #include "ConnectionResponse.h"
 #include "Input.h"
 #include "Position.h"
@@ -62,9 +63,9 @@ void NetworkConnectionSystem::processConnectEvents()
         registry.emplace<Input>(newEntity);
         registry.emplace<ClientSimData>(
             newEntity, clientNetworkID, false,
-            AreaOfInterest{(SharedConfig::SCREEN_WIDTH + SharedConfig::AOI_BUFFER_DISTANCE),
-                           (SharedConfig::SCREEN_HEIGHT + SharedConfig::AOI_BUFFER_DISTANCE)});
+            AreaOfInterest{SharedConfig::AOI_WIDTH, SharedConfig::AOI_HEIGHT});
         world.netIdMap[clientNetworkID] = newEntity;
+        world.entityGrid.addEntity(newEntity, spawnPoint);
 
         LOG_INFO("Constructed entity with netID: %u, entityID: %u",
                  clientNetworkID, newEntity);
@@ -93,6 +94,7 @@ void NetworkConnectionSystem::processDisconnectEvents()
         if (clientEntityIt != world.netIdMap.end()) {
             // Found the entity, remove it.
             entt::entity clientEntity = clientEntityIt->second;
+            world.entityGrid.removeEntity(clientEntity);
             world.registry.destroy(clientEntity);
             world.netIdMap.erase(clientEntityIt);
             LOG_INFO("Removed entity with netID: %u", clientEntity);
@@ -115,7 +117,7 @@ void NetworkConnectionSystem::sendConnectionResponse(NetworkID networkID,
 
     // Serialize the connection response message.
     BinaryBufferSharedPtr messageBuffer
-        = std::make_shared<BinaryBuffer>(Peer::MAX_MESSAGE_SIZE);
+        = MessageBufferPool::acquire();
     std::size_t messageSize = MessageTools::serialize(
         *messageBuffer, connectionResponse, MESSAGE_HEADER_SIZE);
 
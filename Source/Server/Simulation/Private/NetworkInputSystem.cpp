@@ -34,6 +34,17 @@ void NetworkInputSystem::processInputMessages()
     std::queue<std::unique_ptr<ClientInput>>& messageQueue
         = network.startReceiveInputMessages(sim.getCurrentTick());
 
+    // Handle any messages that arrived too late to be received.
+    // Note: This must happen before the tick's messages are applied, so that
+    //       a newer input isn't reset.
+    for (const std::unique_ptr<ClientInput>& staleMessage :
+         network.getStaleInputMessages()) {
+        auto clientEntityIt = world.netIdMap.find(staleMessage->netID);
+        if (clientEntityIt != world.netIdMap.end()) {
+            handleDropForEntity(clientEntityIt->second);
+        }
+    }
+
     // Process all messages.
     while (!(messageQueue.empty())) {
         std::unique_ptr<ClientInput> inputMessage
@@ -88,9 +99,9 @@ void NetworkInputSystem::processMessageDropEvents()
                 handleDropForEntity(clientEntity);
             }
             else {
-                LOG_ERROR("Failed to find entity with netID: %u while "
-                          "processing a message drop event.",
-                          clientNetworkID);
+                // The client disconnected before we processed the event (if
+                // its index was reused, the generation won't match). Nothing
+                // to reset.
             }
         }
         else {
@@ -111,7 +122,10 @@ void NetworkInputSystem::handleDropForEntity(entt::entity entity)
         entityInput.inputStates = defaultInput.inputStates;
 
         // Flag the entity as dirty.
-        world.registry.emplace<IsDirty>(entity);
+        // It might already be dirty from another drop, so check first.
+        if (!(registry.has<IsDirty>(entity))) {
+            registry.emplace<IsDirty>(entity);
+        }
     }
 
     // Flag that a drop occurred for this entity.
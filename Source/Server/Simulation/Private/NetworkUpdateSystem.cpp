@@ -3,15 +3,24 @@
 #include "World.h"
 #include "Network.h"
 #include "MessageTools.h"
+#include "MessageBufferPool.h"
 #include "EntityUpdate.h"
+#include "EntityState.h"
+#include "CompactEntityState.h"
 #include "Input.h"
 #include "Position.h"
 #include "Movement.h"
 #include "ClientSimData.h"
+#include "ReplicationHelpers.h"
 #include "IsDirty.h"
+#include "Peer.h"
+#include "Config.h"
+#include "SharedConfig.h"
 #include "Ignore.h"
 #include "Log.h"
 #include <algorithm>
+#include <bit>
+#include <cmath>
 #include "Profiler.h"
 
 namespace AM
@@ -35,85 +44,519 @@ void NetworkUpdateSystem::sendClientUpdates()
 {
     SCOPED_CPU_SAMPLE(sendClientUpdate);
 
-    // Collect the dirty entities.
-    auto dirtyView = world.registry.view<IsDirty>();
-    auto movementGroup = world.registry.group<Input, Position, Movement>();
-    std::vector<EntityStateRefs> dirtyEntities;
-    for (entt::entity entity : dirtyView) {
-        auto [input, position, movement]
-            = movementGroup.get<Input, Position, Movement>(entity);
-        dirtyEntities.push_back({entity, input, position, movement});
-    }
+    // Clear out last tick's data.
+    stateBlobBuffer.clear();
+    stateBlobs.clear();
+    stateBlobIndices.clear();
+    sentMessages.clear();
 
     /* Update clients as necessary. */
-    auto clientGroup = world.registry.group<ClientSimData>(entt::get<Position>);
+    entt::registry& registry = world.registry;
+    Uint32 currentTick = sim.getCurrentTick();
+    auto clientGroup = registry.group<ClientSimData>(entt::get<Position>);
     for (entt::entity entity : clientGroup) {
         // Center this entity's AoI on its current position.
         auto [client, clientPosition]
             = clientGroup.get<ClientSimData, Position>(entity);
         client.aoi.setCenter(clientPosition);
 
-        /* Collect the entities that need to be sent to this client. */
-        EntityUpdate entityUpdate{};
+        // If any of this client's updates were lost, mark what they held.
+        handleUpdateDelivery(client);
+
+        /* Diff the visible entities against last tick's. */
+        findVisibleEntities(entity, client);
+        blobIndices.clear();
+        compactStates.clear();
+        exitedEntities.clear();
+        exitingEntities.clear();
+        nextVisibleEntities.clear();
+        pendingStates.clear();
 
-        // Add all the dirty entities.
-        for (EntityStateRefs& state : dirtyEntities) {
-            // Check if the dirty entity is in this client's AOI before adding.
-            if (client.aoi.contains(state.position)) {
-                entityUpdate.entityStates.push_back({state.entity, state.input,
-                                                     state.position,
-                                                     state.movement});
+        // Both sets are sorted, so we can walk them together.
+        auto previousIt = client.visibleEntities.begin();
+        auto currentIt = visibleEntities.begin();
+        while ((previousIt != client.visibleEntities.end())
+               || (currentIt != visibleEntities.end())) {
+            if ((currentIt == visibleEntities.end())
+                || ((previousIt != client.visibleEntities.end())
+                    && (previousIt->entity < *currentIt))) {
+                // The entity left the AoI (or was destroyed). If the client
+                // knows about it, it needs to be told.
+                if (previousIt->isKnownByClient) {
+                    exitingEntities.push_back(*previousIt);
+                }
+                ++previousIt;
+            }
+            else if ((previousIt == client.visibleEntities.end())
+                     || (*currentIt < previousIt->entity)) {
+                // The entity entered the AoI, its full state needs to be
+                // sent.
+                nextVisibleEntities.emplace_back().entity = *currentIt;
+                addPendingState(client, clientPosition,
+                                (nextVisibleEntities.size() - 1));
+                ++currentIt;
+            }
+            else {
+                // The entity is still visible. If it has changes that the
+                // client hasn't received, or is due for a keyframe, they need
+                // to be sent.
+                VisibleEntity& visibleEntity
+                    = nextVisibleEntities.emplace_back(*previousIt);
+                if (isKeyframeTick(*currentIt)) {
+                    visibleEntity.needsKeyframe = true;
+                }
+                bool hasChanges = (registry.has<IsDirty>(*currentIt)
+                                   || visibleEntity.needsKeyframe
+                                   || (visibleEntity.priority > 0));
+
+                // Entities in farther tiers only have their changes sent
+                // every few ticks. Note any that we skip.
+                // Note: Full states are always sent, regardless of tier.
+                if (!(visibleEntity.isKnownByClient)
+                    || visibleEntity.needsFullState) {
+                    addPendingState(client, clientPosition,
+                                    (nextVisibleEntities.size() - 1));
+                }
+                else if (isTierUpdateTick(clientPosition, visibleEntity)) {
+                    if (hasChanges || visibleEntity.hasSkippedChanges) {
+                        visibleEntity.hasSkippedChanges = false;
+                        addPendingState(client, clientPosition,
+                                        (nextVisibleEntities.size() - 1));
+                    }
+                }
+                else if (hasChanges) {
+                    visibleEntity.hasSkippedChanges = true;
+                    ReplicationHelpers::deferChanges(
+                        Config::REPLICATION_MODE, visibleEntity,
+                        getVisibleEntity(*currentIt));
+                }
+                ++previousIt;
+                ++currentIt;
             }
         }
 
-        // If this entity had a drop, add it.
+        /* Choose what to send, within this client's byte budget. */
+        unsigned int budget = refillByteAllowance(client);
+
+        // If this client's entity changed, add it.
+        // If this client had a drop, add it regardless.
         // (It mispredicted, so it needs to know the actual state it's in.)
-        if (client.messageWasDropped) {
-            // Only add entities if they will be unique.
-            bool playerFound = false;
-            for (EntityState& entityState : entityUpdate.entityStates) {
-                if (entityState.entity == entity) {
-                    playerFound = true;
-                }
+        // If an update that held it was lost, add it regardless.
+        // Note: The client's own entity is always sent, even if it's over
+        //       budget.
+        if (registry.has<IsDirty>(entity) || client.messageWasDropped
+            || client.ownStateWasLost) {
+            std::size_t blobIndex = getStateBlob(entity);
+            blobIndices.push_back(blobIndex);
+            budget -= std::min(budget, static_cast<unsigned int>(
+                                           stateBlobs[blobIndex].size));
+            client.messageWasDropped = false;
+            client.ownStateWasLost = false;
+            client.ownStateSentTick = currentTick;
+        }
+
+        // Add the exits. Any that don't fit are kept in the visible set, so
+        // they'll be tried again next tick.
+        bool exitWasDeferred = false;
+        for (const VisibleEntity& exitingEntity : exitingEntities) {
+            if (budget >= sizeof(entt::entity)) {
+                exitedEntities.push_back(exitingEntity.entity);
+                client.unsettledExits.push_back(
+                    {exitingEntity.entity, currentTick});
+                budget -= sizeof(entt::entity);
             }
-            if (!playerFound) {
-                auto [input, position, movement]
-                    = movementGroup.get<Input, Position, Movement>(entity);
-                entityUpdate.entityStates.push_back(
-                    {entity, input, position, movement});
-                client.messageWasDropped = false;
+            else {
+                nextVisibleEntities.push_back(exitingEntity);
+                exitWasDeferred = true;
             }
         }
 
+        // Add the highest priority changes that fit.
+        addPendingStatesInBudget(budget);
+
+        if (exitWasDeferred) {
+            std::sort(nextVisibleEntities.begin(), nextVisibleEntities.end(),
+                      [](const VisibleEntity& lhs, const VisibleEntity& rhs) {
+                          return (lhs.entity < rhs.entity);
+                      });
+        }
+        client.visibleEntities.swap(nextVisibleEntities);
+
+        // Put the entities in a consistent order, so that clients with the
+        // same entities can share a message.
+        std::sort(blobIndices.begin(), blobIndices.end());
+
         /* Send the collected entities to this client. */
-        sendUpdate(client, entityUpdate);
+        std::size_t messageSize = sendUpdate(client);
+        client.updateByteAllowance
+            -= std::min(client.updateByteAllowance,
+                        static_cast<unsigned int>(messageSize));
     }
 
     // Mark any dirty entities as clean.
-    world.registry.clear<IsDirty>();
+    registry.clear<IsDirty>();
+}
+
+void NetworkUpdateSystem::handleUpdateDelivery(ClientSimData& client)
+{
+    UpdateDelivery delivery = network.takeUpdateDelivery(client.netID);
+
+    if (delivery.lostTick != 0) {
+        // Re-send the full state of every entity that was sent in or after
+        // the lost update.
+        for (VisibleEntity& visibleEntity : client.visibleEntities) {
+            if (visibleEntity.isKnownByClient
+                && (visibleEntity.lastSentTick >= delivery.lostTick)) {
+                visibleEntity.needsFullState = true;
+            }
+        }
+
+        // Put any lost exits back in the visible set. If they're still out
+        // of the AoI, they'll be exited again. If they came back, the client
+        // still has them, so their full state is sent.
+        for (const SentExit& sentExit : client.unsettledExits) {
+            if (sentExit.tickNum < delivery.lostTick) {
+                continue;
+            }
+
+            auto visibleIt = std::lower_bound(
+                client.visibleEntities.begin(), client.visibleEntities.end(),
+                sentExit.entity,
+                [](const VisibleEntity& lhs, entt::entity rhs) {
+                    return (lhs.entity < rhs);
+                });
+            if ((visibleIt == client.visibleEntities.end())
+                || (visibleIt->entity != sentExit.entity)) {
+                visibleIt = client.visibleEntities.emplace(visibleIt);
+                visibleIt->entity = sentExit.entity;
+            }
+            visibleIt->isKnownByClient = true;
+            visibleIt->needsFullState = true;
+        }
+
+        // Re-send the client's own entity, if it was sent.
+        if (client.ownStateSentTick >= delivery.lostTick) {
+            client.ownStateWasLost = true;
+        }
+    }
+
+    // Forget the exits that can no longer be reported as lost.
+    std::erase_if(client.unsettledExits, [&](const SentExit& sentExit) {
+        return (sentExit.tickNum <= delivery.settledTick);
+    });
+}
+
+void NetworkUpdateSystem::findVisibleEntities(entt::entity clientEntity,
+                                              ClientSimData& client)
+{
+    // Find the entities in the nearby grid cells.
+    nearbyEntities.clear();
+    world.entityGrid.queryEntities(client.aoi, nearbyEntities);
+
+    // Keep the ones that are actually in the AoI.
+    visibleEntities.clear();
+    auto movementGroup = world.registry.group<Input, Position, Movement>();
+    for (entt::entity nearbyEntity : nearbyEntities) {
+        if ((nearbyEntity != clientEntity)
+            && client.aoi.contains(
+                movementGroup.get<Position>(nearbyEntity))) {
+            visibleEntities.push_back(nearbyEntity);
+        }
+    }
+
+    std::sort(visibleEntities.begin(), visibleEntities.end());
+}
+
+VisibleEntity NetworkUpdateSystem::getVisibleEntity(entt::entity entity)
+{
+    auto movementGroup = world.registry.group<Input, Position, Movement>();
+    auto [input, position, movement]
+        = movementGroup.get<Input, Position, Movement>(entity);
+
+    return {entity, input.inputStates,
+            CompactEntityState::encodeVelocity(movement), position};
+}
+
+bool NetworkUpdateSystem::isTierUpdateTick(const Position& clientPosition,
+                                           VisibleEntity& visibleEntity)
+{
+    // Find the first tier that contains the entity, or the last if none do.
+    auto movementGroup = world.registry.group<Input, Position, Movement>();
+    const Position& position
+        = movementGroup.get<Position>(visibleEntity.entity);
+    float distanceX = std::abs(position.x - clientPosition.x);
+    float distanceY = std::abs(position.y - clientPosition.y);
+    unsigned int updateInterval
+        = Config::REPLICATION_TIERS.back().updateInterval;
+    for (const Config::ReplicationTier& tier : Config::REPLICATION_TIERS) {
+        if ((distanceX <= tier.halfWidth) && (distanceY <= tier.halfHeight)) {
+            updateInterval = tier.updateInterval;
+            break;
+        }
+    }
+
+    // Count the ticks since this entity's tier was last due.
+    // Note: Each client/entity pair starts counting when the entity enters
+    //       the client's AoI, which staggers them across the interval.
+    visibleEntity.ticksSinceTierUpdate++;
+    if (visibleEntity.ticksSinceTierUpdate >= updateInterval) {
+        visibleEntity.ticksSinceTierUpdate = 0;
+        return true;
+    }
+
+    return false;
+}
+
+bool NetworkUpdateSystem::isKeyframeTick(entt::entity entity)
+{
+    if (Config::REPLICATION_MODE != Config::ReplicationMode::InputOnly) {
+        return false;
+    }
+
+    // Offset by the entity's ID to stagger the keyframes.
+    Uint32 currentTick = sim.getCurrentTick();
+    return (((currentTick + static_cast<Uint32>(entity))
+             % Config::KEYFRAME_INTERVAL_TICKS)
+            == 0);
+}
+
+unsigned int NetworkUpdateSystem::refillByteAllowance(ClientSimData& client)
+{
+    client.updateByteAllowance
+        = std::min((client.updateByteAllowance + BYTES_PER_SIM_TICK),
+                   Config::CLIENT_UPDATE_BYTES_PER_NETWORK_TICK);
+
+    // A single update can't be larger than a message.
+    unsigned int messageBudget
+        = std::min(client.updateByteAllowance, Peer::MAX_MESSAGE_SIZE);
+    if (messageBudget <= UPDATE_OVERHEAD_BYTES) {
+        return 0;
+    }
+    return (messageBudget - UPDATE_OVERHEAD_BYTES);
+}
+
+void NetworkUpdateSystem::addPendingState(ClientSimData& client,
+                                          const Position& clientPosition,
+                                          std::size_t visibleIndex)
+{
+    VisibleEntity& baseline = nextVisibleEntities[visibleIndex];
+    PendingState pendingState{};
+    pendingState.visibleIndex = visibleIndex;
+    pendingState.currentState = getVisibleEntity(baseline.entity);
+    pendingState.isFullState
+        = (!(baseline.isKnownByClient) || baseline.needsFullState);
+
+    // If the client doesn't know about the entity (or its state for it was
+    // lost), it needs the full state.
+    // Otherwise, find what changed since the client's state.
+    float changePriority = Config::MAX_CHANGE_PRIORITY;
+    if (!(pendingState.isFullState)) {
+        changePriority = ReplicationHelpers::buildCompactState(
+            Config::REPLICATION_MODE, client.aoi.origin, baseline,
+            pendingState.currentState, pendingState.compactState);
+
+        // If nothing differs from what the client has, there's nothing to
+        // send.
+        if (pendingState.compactState.changeMask == 0) {
+            baseline.priority = 0;
+            return;
+        }
+    }
+
+    // Accumulate priority. Closer and more-changed entities accumulate it
+    // faster, and entities that don't get sent keep accumulating it until
+    // they are.
+    baseline.priority
+        += (getProximityPriority(client, clientPosition,
+                                 pendingState.currentState.position)
+            * (1 + changePriority));
+    pendingState.priority = baseline.priority;
+    pendingStates.push_back(pendingState);
+}
+
+float NetworkUpdateSystem::getProximityPriority(const ClientSimData& client,
+                                                const Position& clientPosition,
+                                                const Position& position)
+{
+    // Normalize the distance by the AoI's half-size, so that the center is
+    // 0 and the edge is 1.
+    float distanceX = std::abs(position.x - clientPosition.x)
+                      / (client.aoi.width / 2);
+    float distanceY = std::abs(position.y - clientPosition.y)
+                      / (client.aoi.height / 2);
+    float distance = std::min(std::max(distanceX, distanceY), 1.0f);
+
+    return (1 + (Config::PROXIMITY_PRIORITY_SCALE * (1 - distance)));
+}
+
+void NetworkUpdateSystem::addPendingStatesInBudget(unsigned int budget)
+{
+    // Highest priority first.
+    std::sort(pendingStates.begin(), pendingStates.end(),
+              [](const PendingState& lhs, const PendingState& rhs) {
+                  return (lhs.priority > rhs.priority);
+              });
+
+    // Add each state that fits.
+    // Note: A state that doesn't fit may be followed by a smaller one that
+    //       does, so we keep going.
+    for (PendingState& pendingState : pendingStates) {
+        VisibleEntity& visibleEntity
+            = nextVisibleEntities[pendingState.visibleIndex];
+        bool wasAdded = false;
+        if (budget < MIN_STATE_SIZE) {
+            // Nothing else will fit.
+        }
+        else if (pendingState.isFullState) {
+            std::size_t blobIndex = getStateBlob(visibleEntity.entity);
+            unsigned int size
+                = static_cast<unsigned int>(stateBlobs[blobIndex].size);
+            if (size <= budget) {
+                blobIndices.push_back(blobIndex);
+                budget -= size;
+                wasAdded = true;
+            }
+        }
+        else {
+            unsigned int size = getMaxSerializedSize(pendingState.compactState);
+            if (size <= budget) {
+                compactStates.push_back(pendingState.compactState);
+                budget -= size;
+                wasAdded = true;
+            }
+        }
+
+        // If it didn't fit, it'll wait for a later tick.
+        if (!wasAdded) {
+            ReplicationHelpers::deferChanges(Config::REPLICATION_MODE,
+                                             visibleEntity,
+                                             pendingState.currentState);
+            continue;
+        }
+
+        // The client now has the entity's current state.
+        // Note: In InputOnly mode, only the baseline's inputs are used.
+        // Note: This also clears needsFullState.
+        visibleEntity = pendingState.currentState;
+        visibleEntity.isKnownByClient = true;
+        visibleEntity.lastSentTick = sim.getCurrentTick();
+    }
 }
 
-void NetworkUpdateSystem::sendUpdate(ClientSimData& client,
-                                     EntityUpdate& entityUpdate)
+unsigned int
+    NetworkUpdateSystem::getMaxSerializedSize(const CompactEntityState& state)
+{
+    // The bits used by each field in serialize(CompactEntityState).
+    static constexpr unsigned int MASK_BITS
+        = std::bit_width(static_cast<unsigned int>(
+            CompactEntityState::AllChanged));
+    static constexpr unsigned int INPUT_BITS = Input::NumTypes;
+    static constexpr unsigned int VELOCITY_BITS
+        = std::bit_width(static_cast<unsigned int>(
+            CompactEntityState::MAX_VELOCITY_CODE));
+    static constexpr unsigned int POSITION_X_BITS
+        = std::bit_width(static_cast<unsigned int>(
+            SharedConfig::AOI_WIDTH / CompactEntityState::POSITION_PRECISION));
+    static constexpr unsigned int POSITION_Y_BITS
+        = std::bit_width(static_cast<unsigned int>(
+            SharedConfig::AOI_HEIGHT / CompactEntityState::POSITION_PRECISION));
+    static constexpr unsigned int POSITION_Z_BITS = 32;
+
+    unsigned int bits = MASK_BITS;
+    if (state.changeMask & CompactEntityState::InputChanged) {
+        bits += INPUT_BITS;
+    }
+    if (state.changeMask & CompactEntityState::VelocityChanged) {
+        bits += VELOCITY_BITS;
+    }
+    if (state.changeMask & CompactEntityState::PositionXYChanged) {
+        bits += (POSITION_X_BITS + POSITION_Y_BITS);
+    }
+    if (state.changeMask & CompactEntityState::PositionZChanged) {
+        bits += POSITION_Z_BITS;
+    }
+
+    // The bit packed fields are padded to a whole byte.
+    return (sizeof(entt::entity) + ((bits + 7) / 8));
+}
+
+std::size_t NetworkUpdateSystem::getStateBlob(entt::entity entity)
+{
+    // If we already serialized this entity's state, return it.
+    auto blobIndexIt = stateBlobIndices.find(entity);
+    if (blobIndexIt != stateBlobIndices.end()) {
+        return blobIndexIt->second;
+    }
+
+    // Serialize onto the end of the buffer. The serializer grows the buffer
+    // as needed, so we only track offsets until the spans are built.
+    auto movementGroup = world.registry.group<Input, Position, Movement>();
+    auto [input, position, movement]
+        = movementGroup.get<Input, Position, Movement>(entity);
+    EntityState entityState{entity, input, position, movement};
+    std::size_t offset = stateBlobBuffer.size();
+    std::size_t size
+        = MessageTools::serialize(stateBlobBuffer, entityState, offset);
+    stateBlobBuffer.resize(offset + size);
+
+    stateBlobs.push_back({offset, size});
+    std::size_t blobIndex = (stateBlobs.size() - 1);
+    stateBlobIndices.emplace(entity, blobIndex);
+
+    return blobIndex;
+}
+
+std::size_t NetworkUpdateSystem::sendUpdate(ClientSimData& client)
 {
     /* If there are updates to send, send an update message. */
-    if (entityUpdate.entityStates.size() > 0) {
-        // Finish filling the EntityUpdate.
-        entityUpdate.tickNum = sim.getCurrentTick();
+    if ((blobIndices.size() == 0) && (compactStates.size() == 0)
+        && (exitedEntities.size() == 0)) {
+        return 0;
+    }
+    Uint32 currentTick = sim.getCurrentTick();
 
-        // Serialize the EntityUpdate.
-        BinaryBufferSharedPtr messageBuffer
-            = std::make_shared<BinaryBuffer>(Peer::MAX_MESSAGE_SIZE);
-        std::size_t messageSize = MessageTools::serialize(
-            *messageBuffer, entityUpdate, MESSAGE_HEADER_SIZE);
+    // If we already built a message with these contents, share it.
+    // Note: Compact states are relative to each client's AoI, so messages
+    //       that hold them can't be shared.
+    auto messageKey = std::make_pair(blobIndices, exitedEntities);
+    bool isShareable = compactStates.empty();
+    if (isShareable) {
+        auto messagePair = sentMessages.find(messageKey);
+        if (messagePair != sentMessages.end()) {
+            network.send(client.netID, messagePair->second, currentTick);
+            return messagePair->second->size();
+        }
+    }
 
-        // Fill the buffer with the appropriate message header.
-        MessageTools::fillMessageHeader(MessageType::EntityUpdate, messageSize,
-                                        messageBuffer, 0);
+    // Fill an EntityUpdate with the pre-serialized entity states.
+    PreSerializedEntityUpdate entityUpdate{};
+    entityUpdate.tickNum = currentTick;
+    for (std::size_t blobIndex : blobIndices) {
+        const StateBlob& blob = stateBlobs[blobIndex];
+        entityUpdate.entityStateBlobs.emplace_back(
+            (stateBlobBuffer.data() + blob.offset), blob.size);
+    }
+    entityUpdate.compactEntityStates = compactStates;
+    entityUpdate.aoiOriginX = client.aoi.origin.x;
+    entityUpdate.aoiOriginY = client.aoi.origin.y;
+    entityUpdate.exitedEntities = exitedEntities;
 
-        // Send the message.
-        network.send(client.netID, messageBuffer, entityUpdate.tickNum);
+    // Serialize the EntityUpdate.
+    BinaryBufferSharedPtr messageBuffer = MessageBufferPool::acquire();
+    std::size_t messageSize = MessageTools::serialize(
+        *messageBuffer, entityUpdate, MESSAGE_HEADER_SIZE);
+
+    // Fill the buffer with the appropriate message header.
+    MessageTools::fillMessageHeader(MessageType::EntityUpdate, messageSize,
+                                    messageBuffer, 0);
+
+    // Send the message.
+    network.send(client.netID, messageBuffer, currentTick);
+    if (isShareable) {
+        sentMessages.emplace(std::move(messageKey), messageBuffer);
     }
+
+    return messageBuffer->size();
 }
 
 } // namespace Server
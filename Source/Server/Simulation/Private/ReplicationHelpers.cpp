@@ -0,0 +1,82 @@
+#include "ReplicationHelpers.h"
+#include "ClientSimData.h"
+#include "CompactEntityState.h"
+#include "Position.h"
+#include "SharedConfig.h"
+#include <algorithm>
+#include <cmath>
+
+namespace AM
+{
+namespace Server
+{
+float ReplicationHelpers::buildCompactState(
+    Config::ReplicationMode replicationMode, const Position& aoiOrigin,
+    const VisibleEntity& baseline, const VisibleEntity& current,
+    CompactEntityState& state)
+{
+    // In InputOnly mode, the client moves the entity using its inputs, so
+    // velocity and position are only sent on keyframes. Since the client's
+    // copy may have drifted from the baseline, keyframes send them
+    // regardless of whether they changed.
+    bool diffMovement
+        = (replicationMode == Config::ReplicationMode::FullState);
+    bool sendMovement = (!diffMovement && baseline.needsKeyframe);
+
+    // Flag each field that differs from what the client last received.
+    float changePriority = 0;
+    state.entity = current.entity;
+    if (current.inputStates != baseline.inputStates) {
+        state.changeMask |= CompactEntityState::InputChanged;
+        state.input.inputStates = current.inputStates;
+        changePriority++;
+    }
+    if (sendMovement
+        || (diffMovement && (current.velocityCode != baseline.velocityCode))) {
+        state.changeMask |= CompactEntityState::VelocityChanged;
+        state.velocityCode = current.velocityCode;
+        changePriority++;
+    }
+    if (sendMovement
+        || (diffMovement && ((current.position.x != baseline.position.x)
+                             || (current.position.y != baseline.position.y)))) {
+        // Note: The relative position is serialized into a fixed range, so
+        //       an entity on the AoI's edge must not fall outside of it.
+        state.changeMask |= CompactEntityState::PositionXYChanged;
+        state.relativeX
+            = std::clamp((current.position.x - aoiOrigin.x), 0.0f,
+                         static_cast<float>(SharedConfig::AOI_WIDTH));
+        state.relativeY
+            = std::clamp((current.position.y - aoiOrigin.y), 0.0f,
+                         static_cast<float>(SharedConfig::AOI_HEIGHT));
+    }
+    if (sendMovement
+        || (diffMovement && (current.position.z != baseline.position.z))) {
+        state.changeMask |= CompactEntityState::PositionZChanged;
+        state.z = current.position.z;
+    }
+
+    // Account for how far the entity moved from the client's state.
+    float distanceMoved
+        = std::hypot((current.position.x - baseline.position.x),
+                     (current.position.y - baseline.position.y),
+                     (current.position.z - baseline.position.z));
+    changePriority += (distanceMoved / Config::CHANGE_PRIORITY_DISTANCE);
+
+    return std::min(changePriority, Config::MAX_CHANGE_PRIORITY);
+}
+
+void ReplicationHelpers::deferChanges(Config::ReplicationMode replicationMode,
+                                      VisibleEntity& baseline,
+                                      const VisibleEntity& current)
+{
+    // Full states hold everything, so only known entities can fall behind.
+    if ((replicationMode == Config::ReplicationMode::InputOnly)
+        && baseline.isKnownByClient
+        && (current.inputStates != baseline.inputStates)) {
+        baseline.needsKeyframe = true;
+    }
+}
+
+} // End namespace Server
+} // End namespace AM
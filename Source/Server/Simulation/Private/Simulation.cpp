@@ -1,5 +1,6 @@
 #include "Simulation.h"
 #include "Network.h"
+#include "Config.h"
 #include "Log.h"
 #include "Profiler.h"
 
@@ -10,11 +11,13 @@ namespace Server
 Simulation::Simulation(Network& inNetwork)
 : world()
 , network(inNetwork)
+, jobSystem(Config::JOB_THREAD_COUNT)
 , networkConnectionSystem(*this, world, network)
 , networkInputSystem(*this, world, network)
-, movementSystem(world)
+, movementSystem(world, jobSystem)
 , networkUpdateSystem(*this, world, network)
 , currentTick(0)
+, ticksSinceStatsLog(0)
 {
     Log::registerCurrentTickPtr(&currentTick);
     network.registerCurrentTickPtr(&currentTick);
@@ -34,6 +37,13 @@ void Simulation::tick()
     END_CPU_SAMPLE();
 
     currentTick++;
+
+    // If it's time to log our statistics, do so.
+    ticksSinceStatsLog++;
+    if (ticksSinceStatsLog == TICKS_TILL_STATS_DUMP) {
+        logStatistics();
+        ticksSinceStatsLog = 0;
+    }
 }
 
 Uint32 Simulation::getCurrentTick()
@@ -41,5 +51,16 @@ Uint32 Simulation::getCurrentTick()
     return currentTick;
 }
 
+void Simulation::logStatistics()
+{
+    GridOccupancyStats gridStats = world.entityGrid.getOccupancyStats();
+    LOG_INFO("Entity grid: occupied cells: %u, entities: %u, max per cell: %u, "
+             "average per cell: %.2f",
+             gridStats.occupiedCells, gridStats.entityCount,
+             gridStats.maxCellEntities, gridStats.averageCellEntities);
+
+    LOG_INFO("Job system: jobs stolen: %u", jobSystem.dumpStealCount());
+}
+
 } // namespace Server
 } // namespace AM
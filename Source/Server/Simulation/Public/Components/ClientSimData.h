@@ -2,11 +2,75 @@
 
 #include "NetworkDefs.h"
 #include "AreaOfInterest.h"
+#include "Input.h"
+#include "Position.h"
+#include "entt/entity/registry.hpp"
+#include <vector>
 
 namespace AM
 {
 namespace Server
 {
+/**
+ * An entity in a client's AoI, along with the state that the client last
+ * received for it. Used as the baseline for CompactEntityState change masks.
+ *
+ * Note: The last sent state is treated as received. If the Network reports
+ *       that an update was lost, any entity that was sent in or after it is
+ *       marked with needsFullState, since the client's state for it can't be
+ *       trusted.
+ */
+struct VisibleEntity {
+    entt::entity entity{entt::null};
+
+    Input::StateArr inputStates{};
+
+    /** See CompactEntityState::encodeVelocity(). */
+    Uint8 velocityCode{0};
+
+    Position position{};
+
+    /** If false, the entity entered the AoI but its full state hasn't been
+        sent yet (the client's byte budget ran out). The other fields are
+        only valid if this is true. */
+    bool isKnownByClient{false};
+
+    /** The update priority that this entity has accumulated while it had
+        changes waiting to be sent. 0 if it has none. */
+    float priority{0};
+
+    /** If true, this entity's keyframe is due but hasn't been sent yet.
+        Also set if an input change couldn't be sent on the tick that it
+        happened. See ReplicationHelpers::deferChanges(). */
+    bool needsKeyframe{false};
+
+    /** The number of ticks since this entity's replication tier was last
+        due. See Config::REPLICATION_TIERS. */
+    Uint8 ticksSinceTierUpdate{0};
+
+    /** If true, this entity changed on a tick when its tier wasn't due, so
+        its changes need to be checked when it is. */
+    bool hasSkippedChanges{false};
+
+    /** The tick that this entity's state was last sent to the client on.
+        0 if it hasn't been. */
+    Uint32 lastSentTick{0};
+
+    /** If true, an update that held this entity's state was lost, so its
+        full state needs to be sent. */
+    bool needsFullState{false};
+};
+
+/**
+ * An exit that was sent to a client, but hasn't been confirmed as delivered.
+ */
+struct SentExit {
+    entt::entity entity{entt::null};
+
+    /** The tick that the exit was sent on. */
+    Uint32 tickNum{0};
+};
+
 /**
  * Holds any Client data that is relevant to the sim systems.
  *
@@ -30,6 +94,28 @@ public:
         Note: width and height should be set, but the NetworkUpdateSystem
               manages the x/y position. */
     AreaOfInterest aoi{};
+
+    /** The entities that were in this client's AoI as of the last update,
+        excluding its own entity. Also holds entities that left the AoI
+        before the client could be told. Sorted by entity. Managed by the
+        NetworkUpdateSystem. */
+    std::vector<VisibleEntity> visibleEntities{};
+
+    /** How many bytes of updates we can currently send this client. Refilled
+        every sim tick. Managed by the NetworkUpdateSystem. */
+    unsigned int updateByteAllowance{0};
+
+    /** The exits that were sent to this client and may still be lost, in
+        the order that they were sent. Managed by the NetworkUpdateSystem. */
+    std::vector<SentExit> unsettledExits{};
+
+    /** The tick that this client's own entity state was last sent on.
+        Managed by the NetworkUpdateSystem. */
+    Uint32 ownStateSentTick{0};
+
+    /** If true, an update that held this client's own entity state was lost,
+        so it needs to be sent again. Managed by the NetworkUpdateSystem. */
+    bool ownStateWasLost{false};
 };
 
 } // namespace Server
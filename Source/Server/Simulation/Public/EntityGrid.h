@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Position.h"
+#include "SharedConfig.h"
+#include "entt/entity/registry.hpp"
+#include "SDL_stdinc.h"
+#include <unordered_map>
+#include <vector>
+
+namespace AM
+{
+struct AreaOfInterest;
+
+namespace Server
+{
+/** Used to pass occupancy data out to the consumer. */
+struct GridOccupancyStats {
+    /** The number of cells that hold at least 1 entity. */
+    unsigned int occupiedCells = 0;
+    /** The number of entities in the grid. */
+    unsigned int entityCount = 0;
+    /** The number of entities in the most crowded cell. */
+    unsigned int maxCellEntities = 0;
+    /** The average number of entities per occupied cell. */
+    float averageCellEntities = 0;
+};
+
+/**
+ * A uniform grid spatial index over entity positions.
+ *
+ * Lets us find the entities near an area without checking every entity in
+ * the world. Cells are only allocated once an entity enters them, so the
+ * world doesn't need to be bounded. Cells are kept after they empty, so that
+ * entities moving around an area don't keep allocating and freeing them.
+ *
+ * Entities are bucketed by their Position, which is their top left point.
+ * Queries return every entity in the touched cells, so callers still need to
+ * do their own precise checks.
+ */
+class EntityGrid
+{
+public:
+    /** The width and height of a cell in world coordinates. Matches the AoI
+        buffer distance so that an AoI query only touches a few cells. */
+    static constexpr float CELL_SIZE
+        = static_cast<float>(SharedConfig::AOI_BUFFER_DISTANCE);
+
+    /**
+     * Adds the given entity to the cell that contains the given position.
+     * Errors if the entity is already in the grid.
+     */
+    void addEntity(entt::entity entity, const Position& position);
+
+    /**
+     * Moves the given entity to the cell that contains the given position, if
+     * it isn't already there.
+     * Errors if the entity isn't in the grid.
+     */
+    void updateEntity(entt::entity entity, const Position& position);
+
+    /**
+     * Removes the given entity from the grid.
+     * Errors if the entity isn't in the grid.
+     */
+    void removeEntity(entt::entity entity);
+
+    /**
+     * Adds every entity in the cells that overlap the given AoI to the end of
+     * the given vector.
+     */
+    void queryEntities(const AreaOfInterest& aoi,
+                       std::vector<entt::entity>& results) const;
+
+    /**
+     * Returns the current cell occupancy.
+     */
+    GridOccupancyStats getOccupancyStats() const;
+
+private:
+    /** Returns the cell coordinate that the given world coordinate falls
+        into. */
+    static Sint32 toCellCoord(float worldCoord);
+
+    /** Packs the given cell coordinates into a key for the cell map. */
+    static Uint64 toCellKey(Sint32 cellX, Sint32 cellY);
+
+    /** Every cell that has held an entity, keyed by their packed
+        coordinates. May be empty. */
+    std::unordered_map<Uint64, std::vector<entt::entity>> cells;
+
+    /** The key of the cell that each entity is currently in. */
+    std::unordered_map<entt::entity, Uint64> entityCellKeys;
+};
+
+} // namespace Server
+} // namespace AM
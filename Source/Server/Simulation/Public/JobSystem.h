@@ -0,0 +1,147 @@
+#pragma once
+
+#include "SDL_stdinc.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace AM
+{
+namespace Server
+{
+/**
+ * A work-stealing thread pool, used by systems to split their per-entity work
+ * across threads.
+ *
+ * Work is submitted through parallelFor(), which splits an index range into
+ * fixed-size chunks and spreads them over each thread's job queue. Threads
+ * pop from the back of their own queue, and steal from the front of the
+ * others' queues once theirs is empty. The calling thread runs jobs too,
+ * and only returns once every chunk has finished.
+ *
+ * Chunk boundaries only depend on the range and chunk size, so as long as
+ * each chunk only touches its own elements, results don't depend on which
+ * thread ran which chunk.
+ *
+ * Not re-entrant: parallelFor() must only be called from one thread at a
+ * time, and never from inside a job.
+ */
+class JobSystem
+{
+public:
+    /**
+     * @param numWorkers  The number of worker threads to start. If 0, all
+     *                    work will be ran on the calling thread.
+     */
+    JobSystem(unsigned int numWorkers);
+
+    ~JobSystem();
+
+    /**
+     * Calls func(beginIndex, endIndex) for each chunk of [0, count), in
+     * parallel. Blocks until every chunk has been processed.
+     *
+     * @param count  The number of elements to process.
+     * @param chunkSize  The max number of elements in each chunk.
+     * @param func  The function to call on each chunk. Must be safe to call
+     *              concurrently for separate chunks.
+     */
+    template<typename Func>
+    void parallelFor(std::size_t count, std::size_t chunkSize, Func&& func)
+    {
+        using FuncType = std::remove_reference_t<Func>;
+        runChunks(count, chunkSize, &invokeChunk<FuncType>, &func);
+    }
+
+    /**
+     * Returns the number of jobs that were stolen from another thread's
+     * queue since the last call, and resets the count.
+     */
+    unsigned int dumpStealCount();
+
+private:
+    /** A function that processes [beginIndex, endIndex) for the given
+        context. */
+    using ChunkFunction = void (*)(void* context, std::size_t beginIndex,
+                                   std::size_t endIndex);
+
+    /** A single chunk of work. */
+    struct Job {
+        ChunkFunction function;
+        void* context;
+        std::size_t beginIndex;
+        std::size_t endIndex;
+    };
+
+    /** A thread's job queue. Padded so that queues don't share a cache
+        line. */
+    struct alignas(64) JobQueue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    /** Casts the context back to the user's function and calls it. */
+    template<typename Func>
+    static void invokeChunk(void* context, std::size_t beginIndex,
+                            std::size_t endIndex)
+    {
+        (*static_cast<Func*>(context))(beginIndex, endIndex);
+    }
+
+    /**
+     * Splits [0, count) into chunks, queues them, and helps process them
+     * until they're all done.
+     */
+    void runChunks(std::size_t count, std::size_t chunkSize,
+                   ChunkFunction function, void* context);
+
+    /**
+     * Thread function, one instance per worker. Sleeps until a batch of jobs
+     * is queued, then processes jobs until there are none left.
+     */
+    void workerLoop(unsigned int queueIndex);
+
+    /**
+     * Processes jobs until every queue is empty.
+     */
+    void processJobs(unsigned int queueIndex);
+
+    /**
+     * Tries to get a job, first from the back of our own queue, then from the
+     * front of the other queues.
+     *
+     * @return true if a job was found, else false.
+     */
+    bool getJob(unsigned int queueIndex, Job& outJob);
+
+    /** One queue per thread. Index 0 belongs to the thread that calls
+        parallelFor(), the rest belong to the workers. */
+    std::vector<std::unique_ptr<JobQueue>> jobQueues;
+
+    /** The worker threads. */
+    std::vector<std::thread> workerThreadObjs;
+
+    /** The number of jobs from the current batch that haven't finished. */
+    std::atomic<std::size_t> remainingJobs;
+
+    /** The number of jobs that were stolen since the last dump. */
+    std::atomic<unsigned int> stealCount;
+
+    /** Used for waking the workers. */
+    std::mutex wakeMutex;
+    /** Used for waking the workers. */
+    std::condition_variable wakeCondVar;
+    /** Incremented when a batch is queued, to signal the workers. */
+    Uint64 batchIteration;
+    /** Turn true to signal that the workers should end. */
+    bool exitRequested;
+};
+
+} // namespace Server
+} // namespace AM
@@ -1,12 +1,13 @@
 #pragma once
 
-#include <array>
+#include <cstddef>
 
 namespace AM
 {
 namespace Server
 {
 class World;
+class JobSystem;
 
 /**
  * This system is in charge of moving entities.
@@ -14,17 +15,23 @@ class World;
 class MovementSystem
 {
 public:
-    MovementSystem(World& inWorld);
+    /** The max number of entities that each movement job will process. */
+    static constexpr std::size_t CHUNK_SIZE = 256;
+
+    MovementSystem(World& inWorld, JobSystem& inJobSystem);
 
     /**
      * Moves the all entities 1 sim tick into the future.
      * Updates movement components based on input state, moves position
      * components based on movement, updates sprites based on position.
+     *
+     * Movement is split into chunks and processed in parallel.
      */
     void processMovements();
 
 private:
     World& world;
+    JobSystem& jobSystem;
 };
 
 } // namespace Server
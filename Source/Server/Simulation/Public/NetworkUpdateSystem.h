@@ -1,26 +1,67 @@
 #pragma once
 
+#include "NetworkDefs.h"
+#include "CompactEntityState.h"
+#include "ClientSimData.h"
+#include "Config.h"
+#include "SharedConfig.h"
 #include "entt/entity/registry.hpp"
 #include <vector>
+#include <map>
+#include <unordered_map>
 
 namespace AM
 {
 class Input;
-class Position;
 class Movement;
-class EntityUpdate;
 
 namespace Server
 {
 class Simulation;
 class World;
 class Network;
-class ClientSimData;
 
 /**
  * This system is in charge of checking for data that needs to be sent to
  * clients, wrapping it appropriately, and passing it to the Network's send
  * queue.
+ *
+ * Each client's set of visible entities is tracked and diffed every tick.
+ * Entities that enter a client's AoI are sent in full, entities that leave it
+ * are sent as an exit, and visible entities are only sent when they change.
+ * Changes are sent as CompactEntityStates, holding only the fields that
+ * differ from what the client last received.
+ *
+ * In Config::ReplicationMode::InputOnly, only input changes are sent for
+ * visible entities. Clients move them using the same deterministic
+ * MovementHelpers, and each entity's velocity and position are sent every
+ * Config::KEYFRAME_INTERVAL_TICKS to correct any drift. If an input change
+ * can't be sent on the tick that it happens, the client can't replay it
+ * from that tick, so the velocity and position are sent along with it.
+ *
+ * Each entity's full state is serialized at most once per tick. Client
+ * updates are then assembled by concatenating the serialized states that they
+ * need.
+ *
+ * Each client has a byte budget (Config::CLIENT_UPDATE_BYTES_PER_NETWORK_TICK)
+ * and each update must fit in a single message, so a client may not be sent
+ * every change on every tick. Visible entities with unsent changes accumulate
+ * priority each tick, faster if they're close to the client's entity or
+ * changed a lot. The highest priority changes that fit are sent, and the
+ * rest wait for a later tick. Since changes are diffed against what the
+ * client last received, nothing is lost by waiting. The client's own entity
+ * is always sent.
+ *
+ * Entities that are farther from a client's entity have their changes sent
+ * less often, as set by Config::REPLICATION_TIERS (e.g. every tick on
+ * screen, every few ticks in the AoI's off-screen buffer zone). The client
+ * extrapolates them in between.
+ *
+ * Updates may be lost in transit (see Client::sendWaitingMessages()). When
+ * the Network reports that one was, every entity that was sent in or after
+ * it has its full state re-sent (later compact states were built on the
+ * lost ones), any exits that it held are re-sent, and the client's own
+ * entity is re-sent.
  */
 class NetworkUpdateSystem
 {
@@ -33,27 +74,162 @@ public:
     void sendClientUpdates();
 
 private:
+    /** The location of a serialized entity state within stateBlobBuffer. */
+    struct StateBlob {
+        std::size_t offset;
+        std::size_t size;
+    };
+
+    /** A change that a client needs, waiting for room in its update. */
+    struct PendingState {
+        /** The entity's accumulated priority. Higher is sent first. */
+        float priority{0};
+
+        /** The entity's index within nextVisibleEntities. */
+        std::size_t visibleIndex{0};
+
+        /** The entity's current state. */
+        VisibleEntity currentState{};
+
+        /** If true, the client needs the entity's full state. Else, it
+            needs compactState. */
+        bool isFullState{false};
+
+        CompactEntityState compactState{};
+    };
+
+    /** How many bytes of each client's allowance are refilled per sim
+        tick. */
+    static constexpr unsigned int BYTES_PER_SIM_TICK
+        = static_cast<unsigned int>(
+            Config::CLIENT_UPDATE_BYTES_PER_NETWORK_TICK
+            * (SharedConfig::SIM_TICK_TIMESTEP_S
+               / SharedConfig::NETWORK_TICK_TIMESTEP_S));
+
+    /** The most bytes that an EntityUpdate uses, apart from its entity
+        states: the message header, tickNum, 3 container sizes (each up to 2
+        bytes for MAX_ENTITIES), and the AoI origin. */
+    static constexpr unsigned int UPDATE_OVERHEAD_BYTES
+        = (MESSAGE_HEADER_SIZE + 4 + (3 * 2) + 8);
+
+    /** The size of the smallest possible state (a compact state with one
+        changed field). */
+    static constexpr unsigned int MIN_STATE_SIZE = sizeof(entt::entity) + 1;
+
     /**
-     * Holds references to relevant entity state.
-     * Note: These references are potentially invalidated whenever the
-     *       component pool changes. We just use them locally here.
+     * Applies what the Network has learned about the delivery of the given
+     * client's updates. If any were lost, marks what they held to be re-sent.
      */
-    struct EntityStateRefs {
-        entt::entity entity;
-        Input& input;
-        Position& position;
-        Movement& movement;
-    };
+    void handleUpdateDelivery(ClientSimData& client);
+
+    /**
+     * Fills visibleEntities with the entities that are within the given
+     * client's AoI, excluding the client's own entity. Sorted by entity.
+     */
+    void findVisibleEntities(entt::entity clientEntity, ClientSimData& client);
+
+    /**
+     * Returns the given entity's current state, in the form that we track
+     * for each client.
+     */
+    VisibleEntity getVisibleEntity(entt::entity entity);
+
+    /**
+     * Advances the given entity's replication tier counter.
+     * @return true if the entity's tier is due this tick, so its changes
+     *         should be sent.
+     */
+    bool isTierUpdateTick(const Position& clientPosition,
+                          VisibleEntity& visibleEntity);
+
+    /**
+     * Returns true if the given entity is due for a keyframe this tick.
+     * Always false if we aren't in InputOnly replication mode.
+     */
+    bool isKeyframeTick(entt::entity entity);
 
     /**
-     * Fills the given vector with the entities that must be sent to the given
-     * entityID on this tick.
+     * Refills the given client's byte allowance.
+     * @return The number of bytes that this tick's update can spend on
+     *         entity states.
      */
-    void sendUpdate(ClientSimData& client, EntityUpdate& entityUpdate);
+    unsigned int refillByteAllowance(ClientSimData& client);
+
+    /**
+     * If the given entity's state differs from what the client last
+     * received, adds its priority and adds it to pendingStates.
+     *
+     * @param visibleIndex  The entity's index within nextVisibleEntities.
+     */
+    void addPendingState(ClientSimData& client,
+                         const Position& clientPosition,
+                         std::size_t visibleIndex);
+
+    /**
+     * Returns how fast an entity at the given position accumulates priority,
+     * based on its distance from the client's entity. Between 1 (at the edge
+     * of the AoI) and 1 + Config::PROXIMITY_PRIORITY_SCALE (at the center).
+     */
+    float getProximityPriority(const ClientSimData& client,
+                               const Position& clientPosition,
+                               const Position& position);
+
+    /**
+     * Adds the highest priority pendingStates that fit in the given budget
+     * to blobIndices or compactStates, and updates their baselines.
+     * The rest are deferred through ReplicationHelpers::deferChanges().
+     */
+    void addPendingStatesInBudget(unsigned int budget);
+
+    /**
+     * Returns the most bytes that the given state could serialize to.
+     */
+    static unsigned int getMaxSerializedSize(const CompactEntityState& state);
+
+    /**
+     * Returns the index of the given entity's serialized state within
+     * stateBlobs, serializing it first if it hasn't been this tick.
+     */
+    std::size_t getStateBlob(entt::entity entity);
+
+    /**
+     * Sends an EntityUpdate containing blobIndices, compactStates, and
+     * exitedEntities to the given client.
+     * If another client was already sent the same contents this tick, the
+     * message buffer is shared instead of being built again.
+     *
+     * @return The size of the sent message. 0 if there was nothing to send.
+     */
+    std::size_t sendUpdate(ClientSimData& client);
 
     Simulation& sim;
     World& world;
     Network& network;
+
+    /** Holds each entity state that was serialized this tick. */
+    BinaryBuffer stateBlobBuffer;
+
+    /** The blobs in stateBlobBuffer. */
+    std::vector<StateBlob> stateBlobs;
+
+    /** Maps entities to their blob in stateBlobs, if they have one. */
+    std::unordered_map<entt::entity, std::size_t> stateBlobIndices;
+
+    /** The messages that were built this tick, keyed by their contents. */
+    std::map<std::pair<std::vector<std::size_t>, std::vector<entt::entity>>,
+             BinaryBufferSharedPtr>
+        sentMessages;
+
+    /** Scratch vectors used while building each client's update. Kept
+        around to avoid re-allocating. */
+    std::vector<entt::entity> nearbyEntities;
+    std::vector<entt::entity> visibleEntities;
+    std::vector<std::size_t> blobIndices;
+    std::vector<CompactEntityState> compactStates;
+    std::vector<entt::entity> exitedEntities;
+    std::vector<VisibleEntity> exitingEntities;
+    std::vector<VisibleEntity> nextVisibleEntities;
+    std::vector<PendingState> pendingStates;
 };
 
 } // namespace Server
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Config.h"
+
+namespace AM
+{
+class Position;
+class CompactEntityState;
+
+namespace Server
+{
+class VisibleEntity;
+
+/**
+ * Static functions for deciding which of a visible entity's fields a client
+ * needs to be sent.
+ *
+ * Used by NetworkUpdateSystem. The replication mode is passed in, so that
+ * both modes can be tested regardless of Config::REPLICATION_MODE.
+ */
+class ReplicationHelpers
+{
+public:
+    /**
+     * Fills the given state with the fields of current that differ from the
+     * given baseline.
+     *
+     * If the baseline needs a keyframe and we're in InputOnly replication
+     * mode, the entity's velocity and position are sent even if they match.
+     *
+     * @param aoiOrigin  The client's AoI origin. Positions are sent relative
+     *                   to it.
+     * @return How much the entity changed, between 0 and
+     *         Config::MAX_CHANGE_PRIORITY.
+     */
+    static float buildCompactState(Config::ReplicationMode replicationMode,
+                                   const Position& aoiOrigin,
+                                   const VisibleEntity& baseline,
+                                   const VisibleEntity& current,
+                                   CompactEntityState& state);
+
+    /**
+     * Call when the entity's changes won't be sent to the client this tick,
+     * e.g. if they didn't fit in its budget.
+     *
+     * In InputOnly replication mode, the client replays an input change from
+     * the tick that it receives it on. If current's inputs differ from the
+     * baseline's, they're being sent late, so the baseline is flagged for a
+     * keyframe. The entity's velocity and position are then sent alongside
+     * its inputs, correcting the client's copy.
+     */
+    static void deferChanges(Config::ReplicationMode replicationMode,
+                             VisibleEntity& baseline,
+                             const VisibleEntity& current);
+};
+
+} // End namespace Server
+} // End namespace AM
@@ -1,10 +1,12 @@
 #pragma once
 
 #include "World.h"
+#include "JobSystem.h"
 #include "NetworkConnectionSystem.h"
 #include "NetworkInputSystem.h"
 #include "MovementSystem.h"
 #include "NetworkUpdateSystem.h"
+#include "SharedConfig.h"
 #include <atomic>
 
 namespace AM
@@ -33,9 +35,23 @@ public:
     Uint32 getCurrentTick();
 
 private:
+    /** The number of seconds we'll wait before logging our spatial index
+        and job statistics. */
+    static constexpr unsigned int SECONDS_TILL_STATS_DUMP = 5;
+    static constexpr unsigned int TICKS_TILL_STATS_DUMP
+        = SharedConfig::SIM_TICKS_PER_SECOND * SECONDS_TILL_STATS_DUMP;
+
+    /**
+     * Logs the world's entity grid occupancy and the job system's steals.
+     */
+    void logStatistics();
+
     World world;
     Network& network;
 
+    /** Used by systems to split their work across threads. */
+    JobSystem jobSystem;
+
     NetworkConnectionSystem networkConnectionSystem;
     NetworkInputSystem networkInputSystem;
     MovementSystem movementSystem;
@@ -45,6 +61,9 @@ private:
      * The number of the tick that we're currently on.
      */
     std::atomic<Uint32> currentTick;
+
+    /** The number of ticks since we last logged our statistics. */
+    unsigned int ticksSinceStatsLog;
 };
 
 } // namespace Server
@@ -2,6 +2,7 @@
 
 #include "NetworkDefs.h"
 #include "Position.h"
+#include "EntityGrid.h"
 
 #include "entt/entity/registry.hpp"
 
@@ -29,9 +30,16 @@ public:
     entt::registry registry;
 
     /** Maps network IDs to entity IDs, used for interfacing with the
-        Network. */
+        Network.
+        Network IDs include a generation, so a late message or event for a
+        disconnected client won't be found, even if a new client has reused
+        its index. */
     std::unordered_map<NetworkID, entt::entity> netIdMap;
 
+    /** Spatial index of entity positions. Must be kept up to date by any
+        system that adds, moves, or removes an entity with a Position. */
+    EntityGrid entityGrid;
+
     /**
      * Returns a random spawn point position, with all points being within a
      * single AoI.
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "SDL_stdinc.h"
+#include "Input.h"
+#include "Movement.h"
+#include "MovementHelpers.h"
+#include "SharedConfig.h"
+#include "Log.h"
+#include "entt/entity/registry.hpp"
+#include "bitsery/ext/value_range.h"
+
+namespace AM
+{
+/**
+ * A compact form of EntityState, used to update an entity that the receiver
+ * already knows about.
+ *
+ * Only the fields that changed since the receiver's last update for this
+ * entity are sent (see changeMask). X/Y position is quantized relative to
+ * the receiver's AoI origin, and velocity is sent as a direction per axis.
+ */
+struct CompactEntityState {
+    /** Flags for the fields that are present in this state. */
+    enum ChangeFlag : Uint8 {
+        InputChanged = 1 << 0,
+        VelocityChanged = 1 << 1,
+        PositionXYChanged = 1 << 2,
+        PositionZChanged = 1 << 3,
+        AllChanged = 0b1111
+    };
+
+    /** The precision that X/Y positions are quantized to, in world units. */
+    static constexpr float POSITION_PRECISION = 1.0f / 32;
+
+    /** The largest possible velocity code (each axis is a base-3 digit). */
+    static constexpr Uint8 MAX_VELOCITY_CODE = 26;
+
+    /** The entity that this state belongs to. */
+    entt::entity entity{entt::null};
+
+    /** Which fields are present. A combination of ChangeFlags. */
+    Uint8 changeMask{0};
+
+    Input input;
+
+    /** The direction of each velocity axis. See encodeVelocity(). */
+    Uint8 velocityCode{0};
+
+    /** The position, with X/Y relative to the receiver's AoI origin.
+        X/Y must be within [0, AOI_WIDTH] and [0, AOI_HEIGHT]. */
+    float relativeX{0};
+    float relativeY{0};
+    float z{0};
+
+    /**
+     * Encodes the given movement's velocity into a velocity code.
+     * Errors if any axis isn't 0 or +/- MovementHelpers::VELOCITY.
+     */
+    static Uint8 encodeVelocity(const Movement& movement)
+    {
+        return encodeAxis(movement.velX) + (3 * encodeAxis(movement.velY))
+               + (9 * encodeAxis(movement.velZ));
+    }
+
+    /**
+     * Sets the given movement's velocity to match the given velocity code.
+     */
+    static void decodeVelocity(Uint8 velocityCode, Movement& movement)
+    {
+        movement.velX = decodeAxis(velocityCode % 3);
+        movement.velY = decodeAxis((velocityCode / 3) % 3);
+        movement.velZ = decodeAxis(velocityCode / 9);
+    }
+
+private:
+    static Uint8 encodeAxis(float velocity)
+    {
+        if (velocity == 0) {
+            return 0;
+        }
+        else if (velocity == MovementHelpers::VELOCITY) {
+            return 1;
+        }
+        else if (velocity == -MovementHelpers::VELOCITY) {
+            return 2;
+        }
+        else {
+            LOG_ERROR("Velocity can't be encoded: %.4f", velocity);
+        }
+    }
+
+    static float decodeAxis(Uint8 axisCode)
+    {
+        static constexpr float AXIS_VELOCITIES[3]
+            = {0, MovementHelpers::VELOCITY, -MovementHelpers::VELOCITY};
+        return AXIS_VELOCITIES[axisCode];
+    }
+};
+
+template<typename S>
+void serialize(S& serializer, CompactEntityState& state)
+{
+    serializer.value4b(state.entity);
+
+    // Bit pack the rest, only writing the fields that changed.
+    serializer.enableBitPacking([&state](typename S::BPEnabledType& sbp) {
+        sbp.ext(state.changeMask, bitsery::ext::ValueRange<Uint8>{
+                                      0, CompactEntityState::AllChanged});
+
+        if (state.changeMask & CompactEntityState::InputChanged) {
+            sbp.object(state.input);
+        }
+
+        if (state.changeMask & CompactEntityState::VelocityChanged) {
+            sbp.ext(state.velocityCode,
+                    bitsery::ext::ValueRange<Uint8>{
+                        0, CompactEntityState::MAX_VELOCITY_CODE});
+        }
+
+        if (state.changeMask & CompactEntityState::PositionXYChanged) {
+            const bitsery::ext::ValueRange<float> xRange{
+                0.0f, static_cast<float>(SharedConfig::AOI_WIDTH),
+                CompactEntityState::POSITION_PRECISION};
+            const bitsery::ext::ValueRange<float> yRange{
+                0.0f, static_cast<float>(SharedConfig::AOI_HEIGHT),
+                CompactEntityState::POSITION_PRECISION};
+            sbp.ext(state.relativeX, xRange);
+            sbp.ext(state.relativeY, yRange);
+        }
+
+        if (state.changeMask & CompactEntityState::PositionZChanged) {
+            sbp.value4b(state.z);
+        }
+    });
+}
+
+} // End namespace AM
@@ -1,9 +1,11 @@
 #pragma once
 
 #include "EntityState.h"
+#include "CompactEntityState.h"
 #include "SharedConfig.h"
 #include "SDL_stdinc.h"
 #include <vector>
+#include <span>
 #include "bitsery/bitsery.h"
 
 namespace AM
@@ -15,8 +17,20 @@ struct EntityUpdate {
     /** The tick that this EntityUpdate corresponds to. */
     Uint32 tickNum{0};
 
-    /** All updated entity data. */
+    /** Full entity data. Holds the state of any entities that entered the
+        receiver's AoI on this tick, and of the receiver's own entity. */
     std::vector<EntityState> entityStates;
+
+    /** Changes to entities that were already in the receiver's AoI. */
+    std::vector<CompactEntityState> compactEntityStates;
+
+    /** The receiver's AoI origin, which compactEntityStates positions are
+        relative to. Only sent if there are compactEntityStates. */
+    float aoiOriginX{0};
+    float aoiOriginY{0};
+
+    /** The entities that left the receiver's AoI on this tick. */
+    std::vector<entt::entity> exitedEntities;
 };
 
 template<typename S>
@@ -25,6 +39,63 @@ void serialize(S& serializer, EntityUpdate& entityUpdate)
     serializer.value4b(entityUpdate.tickNum);
     serializer.container(entityUpdate.entityStates,
                          static_cast<std::size_t>(SharedConfig::MAX_ENTITIES));
+    serializer.container(entityUpdate.compactEntityStates,
+                         static_cast<std::size_t>(SharedConfig::MAX_ENTITIES));
+    if (!(entityUpdate.compactEntityStates.empty())) {
+        serializer.value4b(entityUpdate.aoiOriginX);
+        serializer.value4b(entityUpdate.aoiOriginY);
+    }
+    serializer.container4b(
+        entityUpdate.exitedEntities,
+        static_cast<std::size_t>(SharedConfig::MAX_ENTITIES));
+}
+
+/**
+ * An EntityUpdate whose entity states have already been serialized.
+ *
+ * Serializes to the same bytes as an EntityUpdate holding the same states,
+ * so receivers just deserialize an EntityUpdate. Lets the server serialize
+ * each entity's full state once per tick and reuse it for every client that
+ * needs it. Compact states are specific to each client, so they're held
+ * as-is.
+ */
+struct PreSerializedEntityUpdate {
+    /** The tick that this EntityUpdate corresponds to. */
+    Uint32 tickNum{0};
+
+    /** Each entity state, serialized through serialize(EntityState). */
+    std::vector<std::span<const Uint8>> entityStateBlobs;
+
+    /** See EntityUpdate. */
+    std::vector<CompactEntityState> compactEntityStates;
+    float aoiOriginX{0};
+    float aoiOriginY{0};
+
+    /** The entities that left the receiver's AoI on this tick. */
+    std::vector<entt::entity> exitedEntities;
+};
+
+template<typename S>
+void serialize(S& serializer, PreSerializedEntityUpdate& entityUpdate)
+{
+    // Note: This must match serialize(EntityUpdate).
+    serializer.value4b(entityUpdate.tickNum);
+    serializer.container(
+        entityUpdate.entityStateBlobs,
+        static_cast<std::size_t>(SharedConfig::MAX_ENTITIES),
+        [](S& blobSerializer, std::span<const Uint8>& blob) {
+            blobSerializer.adapter().template writeBuffer<1>(blob.data(),
+                                                             blob.size());
+        });
+    serializer.container(entityUpdate.compactEntityStates,
+                         static_cast<std::size_t>(SharedConfig::MAX_ENTITIES));
+    if (!(entityUpdate.compactEntityStates.empty())) {
+        serializer.value4b(entityUpdate.aoiOriginX);
+        serializer.value4b(entityUpdate.aoiOriginY);
+    }
+    serializer.container4b(
+        entityUpdate.exitedEntities,
+        static_cast<std::size_t>(SharedConfig::MAX_ENTITIES));
 }
 
 } // End namespace AM
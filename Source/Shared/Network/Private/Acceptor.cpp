@@ -13,7 +13,7 @@ Acceptor::Acceptor(Uint16 port, const std::shared_ptr<SocketSet>& inClientSet)
 
 Acceptor::~Acceptor() {}
 
-std::unique_ptr<Peer> Acceptor::accept()
+std::unique_ptr<TcpPeer> Acceptor::accept()
 {
     listenerSet.checkSockets(0);
 
@@ -23,7 +23,7 @@ std::unique_ptr<Peer> Acceptor::accept()
             LOG_ERROR("Listener socket showed ready, but accept() failed.");
         }
         else {
-            return std::make_unique<Peer>(std::move(newSocket), clientSet);
+            return std::make_unique<TcpPeer>(std::move(newSocket), clientSet);
         }
     }
 
@@ -0,0 +1,101 @@
+#include "ByteRingBuffer.h"
+#include "Log.h"
+#include <algorithm>
+#include <cstring>
+
+namespace AM
+{
+ByteRingBuffer::ByteRingBuffer(std::size_t inCapacity)
+: buffer(inCapacity)
+, indexMask(inCapacity - 1)
+, readCount(0)
+, writeCount(0)
+{
+    if ((inCapacity == 0) || ((inCapacity & indexMask) != 0)) {
+        LOG_ERROR("Capacity must be a power of 2. Capacity: %u", inCapacity);
+    }
+}
+
+std::size_t ByteRingBuffer::size() const
+{
+    return (writeCount - readCount);
+}
+
+std::size_t ByteRingBuffer::getFreeSpace() const
+{
+    return (buffer.size() - size());
+}
+
+Uint8* ByteRingBuffer::getWritePtr()
+{
+    return &(buffer[writeCount & indexMask]);
+}
+
+std::size_t ByteRingBuffer::getContiguousFreeSpace() const
+{
+    std::size_t bytesTillEnd = buffer.size() - (writeCount & indexMask);
+    return std::min(bytesTillEnd, getFreeSpace());
+}
+
+void ByteRingBuffer::commitWrite(std::size_t numBytes)
+{
+    if (numBytes > getContiguousFreeSpace()) {
+        LOG_ERROR("Wrote past the free space. numBytes: %u, free: %u",
+                  numBytes, getContiguousFreeSpace());
+    }
+
+    writeCount += numBytes;
+}
+
+void ByteRingBuffer::write(const Uint8* source, std::size_t numBytes)
+{
+    if (numBytes > getFreeSpace()) {
+        LOG_ERROR("Tried to write more bytes than are free. Requested: %u, "
+                  "free: %u",
+                  numBytes, getFreeSpace());
+    }
+
+    // Copy in up to 2 parts, in case the data wraps around.
+    std::size_t firstPartSize = std::min(numBytes, getContiguousFreeSpace());
+    std::memcpy(getWritePtr(), source, firstPartSize);
+    std::memcpy(&(buffer[0]), (source + firstPartSize),
+                (numBytes - firstPartSize));
+    writeCount += numBytes;
+}
+
+void ByteRingBuffer::peek(Uint8* destination, std::size_t numBytes,
+                          std::size_t offset) const
+{
+    if ((offset + numBytes) > size()) {
+        LOG_ERROR("Tried to peek more bytes than are held. Requested: %u, "
+                  "held: %u",
+                  (offset + numBytes), size());
+    }
+
+    // Copy in up to 2 parts, in case the data wraps around.
+    std::size_t startIndex = (readCount + offset) & indexMask;
+    std::size_t firstPartSize
+        = std::min(numBytes, (buffer.size() - startIndex));
+    std::memcpy(destination, &(buffer[startIndex]), firstPartSize);
+    std::memcpy((destination + firstPartSize), &(buffer[0]),
+                (numBytes - firstPartSize));
+}
+
+void ByteRingBuffer::read(Uint8* destination, std::size_t numBytes)
+{
+    peek(destination, numBytes);
+    readCount += numBytes;
+}
+
+void ByteRingBuffer::discard(std::size_t numBytes)
+{
+    if (numBytes > size()) {
+        LOG_ERROR("Tried to discard more bytes than are held. Requested: %u, "
+                  "held: %u",
+                  numBytes, size());
+    }
+
+    readCount += numBytes;
+}
+
+} // End namespace AM
@@ -0,0 +1,129 @@
+#include "MessageBufferPool.h"
+#include "Peer.h"
+#include <memory>
+#include <new>
+
+namespace AM
+{
+namespace
+{
+/**
+ * Pools the shared_ptr control blocks that get allocated for our buffers.
+ * The standard library rebinds this to its internal control block type, so
+ * we only ever see one block size per instantiation.
+ */
+template<typename T>
+struct ControlBlockAllocator {
+    using value_type = T;
+
+    ControlBlockAllocator() = default;
+
+    template<typename U>
+    ControlBlockAllocator(const ControlBlockAllocator<U>&)
+    {
+    }
+
+    T* allocate(std::size_t count)
+    {
+        if (count == 1) {
+            std::unique_lock lock(blocksMutex);
+            if (!freeBlocks.empty()) {
+                void* block = freeBlocks.back();
+                freeBlocks.pop_back();
+                return static_cast<T*>(block);
+            }
+        }
+
+        return static_cast<T*>(::operator new(count * sizeof(T)));
+    }
+
+    void deallocate(T* block, std::size_t count)
+    {
+        if (count == 1) {
+            std::unique_lock lock(blocksMutex);
+            if (freeBlocks.size() < MessageBufferPool::MAX_POOLED_BUFFERS) {
+                freeBlocks.push_back(block);
+                return;
+            }
+        }
+
+        ::operator delete(block);
+    }
+
+    template<typename U>
+    bool operator==(const ControlBlockAllocator<U>&) const
+    {
+        return true;
+    }
+
+    /** Holds blocks that are ready to be reused. */
+    static inline std::vector<void*> freeBlocks;
+
+    /** Used to lock access to freeBlocks. */
+    static inline std::mutex blocksMutex;
+};
+
+} // End anonymous namespace
+
+// Initialize data.
+std::vector<BinaryBuffer*> MessageBufferPool::freeBuffers;
+std::mutex MessageBufferPool::freeBuffersMutex;
+std::atomic<unsigned int> MessageBufferPool::hits = 0;
+std::atomic<unsigned int> MessageBufferPool::misses = 0;
+
+BinaryBufferSharedPtr MessageBufferPool::acquire()
+{
+    // Try to reuse a buffer.
+    BinaryBuffer* buffer = nullptr;
+    {
+        std::unique_lock lock(freeBuffersMutex);
+        if (!freeBuffers.empty()) {
+            buffer = freeBuffers.back();
+            freeBuffers.pop_back();
+        }
+    }
+
+    if (buffer != nullptr) {
+        hits++;
+    }
+    else {
+        // No buffers available, allocate a new one.
+        buffer = new BinaryBuffer();
+        buffer->reserve(Peer::MAX_MESSAGE_SIZE);
+        misses++;
+    }
+
+    // Note: Users may have shrunk the buffer to fit their message. Since the
+    //       capacity is kept, this doesn't allocate.
+    buffer->resize(Peer::MAX_MESSAGE_SIZE);
+
+    return BinaryBufferSharedPtr(buffer, Releaser{},
+                                 ControlBlockAllocator<BinaryBuffer>{});
+}
+
+BufferPoolStatsDump MessageBufferPool::dumpStats()
+{
+    // Fill the dump object while resetting the tracked values.
+    BufferPoolStatsDump bufferPoolStatsDump;
+
+    bufferPoolStatsDump.hits = hits.exchange(0);
+    bufferPoolStatsDump.misses = misses.exchange(0);
+
+    return bufferPoolStatsDump;
+}
+
+void MessageBufferPool::Releaser::operator()(BinaryBuffer* buffer) const
+{
+    {
+        std::unique_lock lock(freeBuffersMutex);
+        if (freeBuffers.size() < MAX_POOLED_BUFFERS) {
+            freeBuffers.push_back(buffer);
+            return;
+        }
+    }
+
+    // The pool is full, free the buffer.
+    delete buffer;
+}
+
+} // End namespace AM
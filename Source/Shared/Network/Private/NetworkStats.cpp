@@ -5,6 +5,13 @@ namespace AM
 // Initialize data.
 std::atomic<unsigned int> NetworkStats::bytesSent = 0;
 std::atomic<unsigned int> NetworkStats::bytesReceived = 0;
+std::atomic<unsigned int> NetworkStats::sendCount = 0;
+std::atomic<unsigned int> NetworkStats::totalSendTimeUs = 0;
+std::atomic<unsigned int> NetworkStats::maxSendTimeUs = 0;
+std::atomic<unsigned int> NetworkStats::socketSyscalls = 0;
+std::array<NetworkStats::MessageTypeSlot, NetworkStats::MAX_THREAD_SLOTS>
+    NetworkStats::messageTypeSlots{};
+std::atomic<std::size_t> NetworkStats::assignedSlotCount = 0;
 
 NetStatsDump NetworkStats::dumpStats()
 {
@@ -14,6 +21,16 @@ NetStatsDump NetworkStats::dumpStats()
     netStatsDump.bytesSent = bytesSent.exchange(0);
     netStatsDump.bytesReceived = bytesReceived.exchange(0);
 
+    netStatsDump.sendCount = sendCount.exchange(0);
+    unsigned int totalSendTime = totalSendTimeUs.exchange(0);
+    if (netStatsDump.sendCount != 0) {
+        netStatsDump.averageSendTime
+            = (totalSendTime / 1000000.0) / netStatsDump.sendCount;
+    }
+    netStatsDump.maxSendTime = maxSendTimeUs.exchange(0) / 1000000.0;
+
+    netStatsDump.socketSyscalls = socketSyscalls.exchange(0);
+
     return netStatsDump;
 }
 
@@ -27,4 +44,83 @@ void NetworkStats::recordBytesReceived(unsigned int inBytesReceived)
     bytesReceived += inBytesReceived;
 }
 
+void NetworkStats::recordSendTime(double sendTimeS)
+{
+    unsigned int sendTimeUs = static_cast<unsigned int>(sendTimeS * 1000000);
+    sendCount++;
+    totalSendTimeUs += sendTimeUs;
+
+    // Update the max, retrying if another thread changed it first.
+    unsigned int currentMax = maxSendTimeUs;
+    while ((sendTimeUs > currentMax)
+           && !(maxSendTimeUs.compare_exchange_weak(currentMax, sendTimeUs))) {
+    }
+}
+
+void NetworkStats::recordSocketSyscalls(unsigned int count)
+{
+    socketSyscalls.fetch_add(count, std::memory_order_relaxed);
+}
+
+void NetworkStats::recordMessageSent(MessageType messageType, std::size_t bytes)
+{
+    MessageTypeCounters& counters = getThreadCounters(messageType);
+    counters.messagesSent.fetch_add(1, std::memory_order_relaxed);
+    counters.bytesSent.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void NetworkStats::recordMessageReceived(MessageType messageType,
+                                         std::size_t bytes)
+{
+    MessageTypeCounters& counters = getThreadCounters(messageType);
+    counters.messagesReceived.fetch_add(1, std::memory_order_relaxed);
+    counters.bytesReceived.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void NetworkStats::recordMessageDropped(MessageType messageType)
+{
+    getThreadCounters(messageType)
+        .messagesDropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+MessageTypeStatsArr NetworkStats::getMessageTypeStats()
+{
+    // Sum each thread's counters.
+    MessageTypeStatsArr stats{};
+    for (MessageTypeSlot& slot : messageTypeSlots) {
+        for (std::size_t i = 0; i < MESSAGE_TYPE_COUNT; ++i) {
+            MessageTypeCounters& counters = slot.counters[i];
+            stats[i].messagesSent
+                += counters.messagesSent.load(std::memory_order_relaxed);
+            stats[i].bytesSent
+                += counters.bytesSent.load(std::memory_order_relaxed);
+            stats[i].messagesReceived
+                += counters.messagesReceived.load(std::memory_order_relaxed);
+            stats[i].bytesReceived
+                += counters.bytesReceived.load(std::memory_order_relaxed);
+            stats[i].messagesDropped
+                += counters.messagesDropped.load(std::memory_order_relaxed);
+        }
+    }
+
+    return stats;
+}
+
+NetworkStats::MessageTypeCounters&
+    NetworkStats::getThreadCounters(MessageType messageType)
+{
+    // Assign this thread a slot the first time it records.
+    thread_local std::size_t slotIndex
+        = (assignedSlotCount.fetch_add(1, std::memory_order_relaxed)
+           % MAX_THREAD_SLOTS);
+
+    // Count any unknown types as NotSet.
+    std::size_t typeIndex = static_cast<std::size_t>(messageType);
+    if (typeIndex >= MESSAGE_TYPE_COUNT) {
+        typeIndex = static_cast<std::size_t>(MessageType::NotSet);
+    }
+
+    return messageTypeSlots[slotIndex].counters[typeIndex];
+}
+
 } // End namespace AM
@@ -1,50 +1,818 @@
 #include "SocketSet.h"
 #include "TcpSocket.h"
+#include "NetworkStats.h"
 #include "Log.h"
+#include "Ignore.h"
+#include <algorithm>
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+#if defined(AM_HAS_IO_URING)
+#include <liburing.h>
+#include <sys/socket.h>
+#include <unordered_map>
+#endif
 
 namespace AM
 {
-SocketSet::SocketSet(int maxSockets)
-: numSockets(0)
+struct SocketSet::PollState {
+#if defined(__linux__)
+    /** The max number of sockets that the set can hold. */
+    std::size_t maxSockets = 0;
+
+    /** Filled from the set's sockets before each poll(). */
+    std::vector<pollfd> pollFds;
+#endif
+};
+
+struct SocketSet::EpollState {
+#if defined(__linux__)
+    /** The epoll instance. */
+    int epollFd = -1;
+
+    /** Filled by epoll_wait(). Sized to the max number of sockets. */
+    std::vector<epoll_event> events;
+#endif
+};
+
+struct SocketSet::IoUringState {
+#if defined(AM_HAS_IO_URING)
+    /** The size of our submission queue. */
+    static constexpr unsigned int SUBMISSION_QUEUE_SIZE = 256;
+
+    /** The size of our completion queue. Large enough that a full set's
+        receives usually fit without overflowing into the kernel's backlog. */
+    static constexpr unsigned int COMPLETION_QUEUE_SIZE = 4096;
+
+    /** The number of buffers that we provide for receives. Must be a power
+        of 2. */
+    static constexpr unsigned int BUFFER_COUNT = 512;
+
+    /** The size of each provided buffer. */
+    static constexpr unsigned int BUFFER_SIZE = 2048;
+
+    /** The ID of our provided buffer group. */
+    static constexpr int BUFFER_GROUP_ID = 0;
+
+    /** The most provided buffers that we'll hold for a socket. If exceeded,
+        the socket isn't being read and is treated as closed. */
+    static constexpr std::size_t MAX_HELD_BUFFERS = 32;
+
+    /** Completions that carry this token aren't tied to a socket, and are
+        ignored. */
+    static constexpr Uint64 IGNORED_TOKEN = 0;
+
+    /** A provided buffer that holds received data that hasn't been read. */
+    struct HeldBuffer {
+        unsigned int bufferID = 0;
+        /** How far into the buffer we've read. */
+        unsigned int readOffset = 0;
+        /** The number of bytes that were received into the buffer. */
+        unsigned int size = 0;
+    };
+
+    /** The data that's been received for a single socket. */
+    struct ReceivedInput {
+        /** The token that this socket's receives are tagged with.
+            Tokens are never reused, so stale completions for a removed socket
+            can't be mistaken for a new socket's. */
+        Uint64 token = IGNORED_TOKEN;
+
+        /** The provided buffers that hold this socket's unread data, in
+            receive order. They're read from directly, and given back to the
+            kernel once they've been fully read. */
+        std::vector<HeldBuffer> heldBuffers;
+
+        /** The index of the first held buffer that hasn't been fully read. */
+        std::size_t nextHeldBuffer = 0;
+
+        /** Returns true if there's unread data. */
+        bool hasUnreadData() const
+        {
+            return (nextHeldBuffer < heldBuffers.size());
+        }
+
+        /** If true, the connection was closed or errored. */
+        bool isClosed = false;
+
+        /** If true, the socket is in readySockets. */
+        bool isReady = false;
+    };
+
+    /**
+     * Returns a free submission queue entry, submitting the queue to make
+     * room if necessary.
+     */
+    io_uring_sqe* getSqe()
+    {
+        io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+        if (sqe == nullptr) {
+            io_uring_submit(&ring);
+            NetworkStats::recordSocketSyscalls(1);
+            sqe = io_uring_get_sqe(&ring);
+        }
+
+        return sqe;
+    }
+
+    /**
+     * Queues a multishot receive on the given socket. It'll keep pulling data
+     * into our provided buffers until it's cancelled or runs out of buffers.
+     */
+    void armReceive(int fileDescriptor, Uint64 token)
+    {
+        io_uring_sqe* sqe = getSqe();
+        io_uring_prep_recv_multishot(sqe, fileDescriptor, nullptr, 0, 0);
+        sqe->flags |= IOSQE_BUFFER_SELECT;
+        sqe->buf_group = BUFFER_GROUP_ID;
+        io_uring_sqe_set_data64(sqe, token);
+    }
+
+    /** Returns the memory for the given provided buffer. */
+    Uint8* getBuffer(unsigned int bufferID)
+    {
+        return &(bufferMemory[bufferID * BUFFER_SIZE]);
+    }
+
+    /** Gives the given provided buffer back to the kernel. */
+    void recycleBuffer(unsigned int bufferID)
+    {
+        io_uring_buf_ring_add(bufferRing, getBuffer(bufferID), BUFFER_SIZE,
+                              bufferID, io_uring_buf_ring_mask(BUFFER_COUNT),
+                              0);
+        io_uring_buf_ring_advance(bufferRing, 1);
+        freeBufferCount++;
+    }
+
+    /**
+     * If any buffers have been given back to the kernel, re-arms the
+     * receives that ended because we ran out.
+     */
+    void rearmStarvedReceives()
+    {
+        if (starvedTokens.empty() || (freeBufferCount == 0)) {
+            return;
+        }
+
+        for (Uint64 token : starvedTokens) {
+            // Note: The socket may have been removed since it was starved.
+            auto socketIt = tokenSockets.find(token);
+            if (socketIt == tokenSockets.end()) {
+                continue;
+            }
+
+            const TcpSocket* socket = socketIt->second;
+            if (!(inputs.at(socket).isClosed)) {
+                armReceive(socket->getFileDescriptor(), token);
+            }
+        }
+        starvedTokens.clear();
+    }
+
+    /**
+     * Returns true if the kernel can do multishot receives into our provided
+     * buffers.
+     *
+     * Multishot is a flag on IORING_OP_RECV rather than an opcode, so it
+     * can't be found through io_uring_get_probe(). Instead, we send a byte
+     * over a socket pair and check that it's received into a buffer.
+     */
+    bool probeMultishotReceive()
+    {
+        int socketPair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, socketPair) != 0) {
+            return false;
+        }
+
+        // Send a byte and close our end. A working receive completes once
+        // with the byte, then ends with the close.
+        armReceive(socketPair[0], IGNORED_TOKEN);
+        Uint8 byte = 0;
+        bool isSupported = (write(socketPair[1], &byte, 1) == 1);
+        close(socketPair[1]);
+
+        bool receiveEnded = false;
+        while (!receiveEnded) {
+            __kernel_timespec timeout{};
+            timeout.tv_sec = 1;
+            io_uring_cqe* cqe = nullptr;
+            if (io_uring_submit_and_wait_timeout(&ring, &cqe, 1, &timeout,
+                                                 nullptr)
+                < 0) {
+                isSupported = false;
+                break;
+            }
+
+            if (cqe->flags & IORING_CQE_F_BUFFER) {
+                freeBufferCount--;
+                recycleBuffer(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+            }
+            else if (cqe->res != 0) {
+                // Either an error, or the data didn't use our buffers.
+                isSupported = false;
+            }
+
+            receiveEnded = !(cqe->flags & IORING_CQE_F_MORE);
+            io_uring_cqe_seen(&ring, cqe);
+        }
+
+        close(socketPair[0]);
+        return isSupported;
+    }
+
+    /** Gives all of the given input's unread buffers back to the kernel. */
+    void recycleHeldBuffers(ReceivedInput& input)
+    {
+        for (std::size_t i = input.nextHeldBuffer;
+             i < input.heldBuffers.size(); ++i) {
+            recycleBuffer(input.heldBuffers[i].bufferID);
+        }
+        input.heldBuffers.clear();
+        input.nextHeldBuffer = 0;
+    }
+
+    /** The io_uring instance. */
+    io_uring ring{};
+
+    /** The ring that we provide receive buffers through. */
+    io_uring_buf_ring* bufferRing = nullptr;
+
+    /** The memory backing our provided buffers. */
+    std::vector<Uint8> bufferMemory;
+
+    /** The received data for each socket in the set. */
+    std::unordered_map<const TcpSocket*, ReceivedInput> inputs;
+
+    /** Maps each receive token to its socket. */
+    std::unordered_map<Uint64, const TcpSocket*> tokenSockets;
+
+    /** The token to give the next added socket. */
+    Uint64 nextToken = IGNORED_TOKEN + 1;
+
+    /** The number of provided buffers that the kernel can receive into. */
+    unsigned int freeBufferCount = BUFFER_COUNT;
+
+    /** The tokens of the sockets whose receives ended because we ran out of
+        buffers. If we re-armed them right away, they'd just fail again, so
+        they wait until some buffers are recycled. */
+    std::vector<Uint64> starvedTokens;
+#endif
+};
+
+SocketSet::SocketSet(int maxSockets, Backend inBackend)
+: backend(inBackend)
+, set(nullptr)
+, pollState(nullptr)
+, epollState(nullptr)
+, ioUringState(nullptr)
+, numSockets(0)
 {
-    set = SDLNet_AllocSocketSet(maxSockets);
-    if (set == nullptr) {
-        LOG_ERROR("Error allocating socket set: %s", SDLNet_GetError());
+    if ((backend == Backend::IoUring) && !initIoUring(maxSockets)) {
+        backend = Backend::Epoll;
+    }
+
+#if !defined(__linux__)
+    if (backend == Backend::Epoll) {
+        LOG_INFO("epoll is unavailable on this platform. Falling back to "
+                 "SDLNet.");
+        backend = Backend::SDLNet;
     }
+#endif
+
+#if defined(__linux__)
+    if (backend == Backend::SDLNet) {
+        pollState = std::make_unique<PollState>();
+        pollState->maxSockets = static_cast<std::size_t>(maxSockets);
+        pollState->pollFds.reserve(maxSockets);
+    }
+    else if (backend == Backend::Epoll) {
+        epollState = std::make_unique<EpollState>();
+        epollState->epollFd = epoll_create1(0);
+        if (epollState->epollFd == -1) {
+            LOG_ERROR("Error creating epoll instance: %s", strerror(errno));
+        }
+
+        epollState->events.resize(maxSockets);
+    }
+#else
+    if (backend == Backend::SDLNet) {
+        set = SDLNet_AllocSocketSet(maxSockets);
+        if (set == nullptr) {
+            LOG_ERROR("Error allocating socket set: %s", SDLNet_GetError());
+        }
+    }
+#endif
+
+    sockets.reserve(maxSockets);
+    readySockets.reserve(maxSockets);
 }
 
 SocketSet::~SocketSet()
 {
-    SDLNet_FreeSocketSet(set);
-    set = nullptr;
+    if (backend == Backend::SDLNet) {
+#if !defined(__linux__)
+        SDLNet_FreeSocketSet(set);
+        set = nullptr;
+#endif
+    }
+#if defined(__linux__)
+    else if (backend == Backend::Epoll) {
+        close(epollState->epollFd);
+    }
+#endif
+#if defined(AM_HAS_IO_URING)
+    else {
+        // Note: Exiting the ring cancels any receives that are still armed.
+        io_uring_free_buf_ring(&(ioUringState->ring), ioUringState->bufferRing,
+                               IoUringState::BUFFER_COUNT,
+                               IoUringState::BUFFER_GROUP_ID);
+        io_uring_queue_exit(&(ioUringState->ring));
+    }
+#endif
 }
 
 void SocketSet::addSocket(const TcpSocket& socket)
 {
-    int numAdded = SDLNet_TCP_AddSocket(set, socket.getUnderlyingSocket());
-    if (numAdded < 1) {
-        LOG_ERROR("Error while adding socket: %s", SDLNet_GetError());
+    if (backend == Backend::SDLNet) {
+#if defined(__linux__)
+        if (sockets.size() >= pollState->maxSockets) {
+            LOG_ERROR("Error while adding socket: socket set is full.");
+        }
+        numSockets++;
+#else
+        int numAdded = SDLNet_TCP_AddSocket(set, socket.getUnderlyingSocket());
+        if (numAdded < 1) {
+            LOG_ERROR("Error while adding socket: %s", SDLNet_GetError());
+        }
+        else {
+            numSockets += numAdded;
+        }
+#endif
     }
+    else if (backend == Backend::IoUring) {
+        addSocketIoUring(socket);
+        numSockets++;
+    }
+#if defined(__linux__)
     else {
-        numSockets += numAdded;
+        // Edge-triggered, so we're only woken when new data arrives.
+        // Sockets that weren't fully drained are tracked in readySockets.
+        epoll_event event{};
+        event.events = (EPOLLIN | EPOLLRDHUP | EPOLLET);
+        event.data.ptr = const_cast<TcpSocket*>(&socket);
+        if (epoll_ctl(epollState->epollFd, EPOLL_CTL_ADD,
+                      socket.getFileDescriptor(), &event)
+            == -1) {
+            LOG_ERROR("Error while adding socket: %s", strerror(errno));
+        }
+        else {
+            numSockets++;
+        }
     }
+#endif
+
+    sockets.push_back(&socket);
 }
 
 void SocketSet::remSocket(const TcpSocket& socket)
 {
-    SDLNet_TCP_DelSocket(set, socket.getUnderlyingSocket());
+    // If the socket was already removed, there's nothing to do.
+    auto socketIt = std::find(sockets.begin(), sockets.end(), &socket);
+    if (socketIt == sockets.end()) {
+        return;
+    }
+    sockets.erase(socketIt);
+
+    if (backend == Backend::SDLNet) {
+#if !defined(__linux__)
+        SDLNet_TCP_DelSocket(set, socket.getUnderlyingSocket());
+#endif
+    }
+    else if (backend == Backend::IoUring) {
+        remSocketIoUring(socket);
+    }
+#if defined(__linux__)
+    else {
+        epoll_ctl(epollState->epollFd, EPOLL_CTL_DEL,
+                  socket.getFileDescriptor(), nullptr);
+    }
+#endif
+    numSockets--;
+
+    // The socket is about to be destroyed, make sure we don't hand it out.
+    std::erase(readySockets, &socket);
 }
 
 int SocketSet::checkSockets(unsigned int timeoutMs)
 {
+    if (backend == Backend::SDLNet) {
+        return checkSocketsSDLNet(timeoutMs);
+    }
+    else if (backend == Backend::Epoll) {
+        return checkSocketsEpoll(timeoutMs);
+    }
+    else {
+        return checkSocketsIoUring(timeoutMs);
+    }
+}
+
+const std::vector<const TcpSocket*>& SocketSet::getReadySockets() const
+{
+    return readySockets;
+}
+
+int SocketSet::receiveAvailable(TcpSocket& socket, void* dataBuffer,
+                                int maxLen)
+{
+    if (backend != Backend::IoUring) {
+        return socket.receiveAvailable(dataBuffer, maxLen);
+    }
+
+#if defined(AM_HAS_IO_URING)
+    auto inputIt = ioUringState->inputs.find(&socket);
+    if (inputIt == ioUringState->inputs.end()) {
+        LOG_ERROR("Tried to receive from a socket that isn't in this set.");
+    }
+
+    // If nothing is waiting, report whether the connection is still open.
+    IoUringState& state = *ioUringState;
+    IoUringState::ReceivedInput& input = inputIt->second;
+    if (!(input.hasUnreadData())) {
+        return input.isClosed ? -1 : 0;
+    }
+
+    // Copy straight out of the provided buffers, giving each one back to the
+    // kernel once it's been fully read.
+    Uint8* destination = static_cast<Uint8*>(dataBuffer);
+    std::size_t bytesCopied = 0;
+    std::size_t maxBytes = static_cast<std::size_t>(maxLen);
+    while (input.hasUnreadData() && (bytesCopied < maxBytes)) {
+        IoUringState::HeldBuffer& heldBuffer
+            = input.heldBuffers[input.nextHeldBuffer];
+        std::size_t bytesToCopy
+            = std::min(static_cast<std::size_t>(heldBuffer.size
+                                                - heldBuffer.readOffset),
+                       (maxBytes - bytesCopied));
+        std::copy_n(
+            (state.getBuffer(heldBuffer.bufferID) + heldBuffer.readOffset),
+            bytesToCopy, (destination + bytesCopied));
+        heldBuffer.readOffset += static_cast<unsigned int>(bytesToCopy);
+        bytesCopied += bytesToCopy;
+
+        if (heldBuffer.readOffset == heldBuffer.size) {
+            state.recycleBuffer(heldBuffer.bufferID);
+            input.nextHeldBuffer++;
+        }
+    }
+
+    // If we've read everything, reset the list.
+    if (!(input.hasUnreadData())) {
+        input.heldBuffers.clear();
+        input.nextHeldBuffer = 0;
+    }
+
+    return static_cast<int>(bytesCopied);
+#else
+    ignore(dataBuffer);
+    return -1;
+#endif
+}
+
+SocketSet::Backend SocketSet::getBackend() const
+{
+    return backend;
+}
+
+int SocketSet::checkSocketsSDLNet(unsigned int timeoutMs)
+{
+    readySockets.clear();
+
+#if defined(__linux__)
+    // Poll every socket, the same way that SDLNet_CheckSockets() would.
+    std::vector<pollfd>& pollFds = pollState->pollFds;
+    pollFds.clear();
+    for (const TcpSocket* socket : sockets) {
+        pollFds.push_back({socket->getFileDescriptor(), POLLIN, 0});
+    }
+
+    int numReady = -1;
+    do {
+        numReady = poll(pollFds.data(), pollFds.size(),
+                        static_cast<int>(timeoutMs));
+        NetworkStats::recordSocketSyscalls(1);
+    } while ((numReady == -1) && (errno == EINTR));
+    if (numReady == -1) {
+        LOG_INFO("Error while checking sockets: %s", strerror(errno));
+    }
+    else {
+        // Like SDLNet, update every socket's mark. Hangups and errors count
+        // as activity, so that receive() can report them.
+        for (std::size_t i = 0; i < sockets.size(); ++i) {
+            if (pollFds[i].revents != 0) {
+                sockets[i]->markReady();
+                readySockets.push_back(sockets[i]);
+            }
+            else {
+                sockets[i]->clearReady();
+            }
+        }
+    }
+#else
     int numReady = SDLNet_CheckSockets(set, timeoutMs);
+    NetworkStats::recordSocketSyscalls(1);
     if (numReady == -1) {
         LOG_INFO("Error while checking sockets: %s", SDLNet_GetError());
         // Most of the time this is a system error, where perror might help.
         perror("SDLNet_CheckSockets");
     }
+    else if (numReady > 0) {
+        for (const TcpSocket* socket : sockets) {
+            if (SDLNet_SocketReady(socket->getUnderlyingSocket())) {
+                readySockets.push_back(socket);
+            }
+        }
+    }
+#endif
 
     return numReady;
 }
 
+int SocketSet::checkSocketsEpoll(unsigned int timeoutMs)
+{
+#if defined(__linux__)
+    // Edge-triggered sockets won't be reported again until more data arrives,
+    // so carry over any that still have unread data from the last check.
+    std::erase_if(readySockets, [](const TcpSocket* socket) {
+        return !(socket->hasWaitingData());
+    });
+
+    // If we already have work to hand out, don't wait for more.
+    int timeout = readySockets.empty() ? static_cast<int>(timeoutMs) : 0;
+    int numEvents = epoll_wait(epollState->epollFd, epollState->events.data(),
+                               epollState->events.size(), timeout);
+    NetworkStats::recordSocketSyscalls(1);
+    if (numEvents == -1) {
+        if (errno != EINTR) {
+            LOG_INFO("Error while checking sockets: %s", strerror(errno));
+        }
+        numEvents = 0;
+    }
+
+    // Add the newly active sockets. epoll won't report duplicates, so we
+    // only need to check against the carried over sockets.
+    std::size_t numCarried = readySockets.size();
+    for (int i = 0; i < numEvents; ++i) {
+        const TcpSocket* socket
+            = static_cast<const TcpSocket*>(epollState->events[i].data.ptr);
+        auto carriedEnd = readySockets.begin() + numCarried;
+        if (std::find(readySockets.begin(), carriedEnd, socket) == carriedEnd) {
+            readySockets.push_back(socket);
+        }
+    }
+
+    // Mark the ready sockets so that TcpSocket::isReady() keeps working.
+    for (const TcpSocket* socket : readySockets) {
+        socket->markReady();
+    }
+
+    return static_cast<int>(readySockets.size());
+#else
+    ignore(timeoutMs);
+    return 0;
+#endif
+}
+
+bool SocketSet::initIoUring(int maxSockets)
+{
+#if defined(AM_HAS_IO_URING)
+    ioUringState = std::make_unique<IoUringState>();
+    IoUringState& state = *ioUringState;
+
+    // Set up the ring.
+    io_uring_params params{};
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = IoUringState::COMPLETION_QUEUE_SIZE;
+    int result = io_uring_queue_init_params(
+        IoUringState::SUBMISSION_QUEUE_SIZE, &(state.ring), &params);
+    if (result < 0) {
+        LOG_INFO("io_uring is unavailable (%s). Falling back to epoll.",
+                 strerror(-result));
+        ioUringState = nullptr;
+        return false;
+    }
+
+    // Provide our receive buffers.
+    state.bufferRing = io_uring_setup_buf_ring(
+        &(state.ring), IoUringState::BUFFER_COUNT,
+        IoUringState::BUFFER_GROUP_ID, 0, &result);
+    if (state.bufferRing == nullptr) {
+        LOG_INFO("Failed to set up io_uring provided buffers (%s). Falling "
+                 "back to epoll.",
+                 strerror(-result));
+        io_uring_queue_exit(&(state.ring));
+        ioUringState = nullptr;
+        return false;
+    }
+
+    state.bufferMemory.resize(IoUringState::BUFFER_COUNT
+                              * IoUringState::BUFFER_SIZE);
+    int bufferMask = io_uring_buf_ring_mask(IoUringState::BUFFER_COUNT);
+    for (unsigned int i = 0; i < IoUringState::BUFFER_COUNT; ++i) {
+        io_uring_buf_ring_add(state.bufferRing, state.getBuffer(i),
+                              IoUringState::BUFFER_SIZE, i, bufferMask, i);
+    }
+    io_uring_buf_ring_advance(state.bufferRing, IoUringState::BUFFER_COUNT);
+
+    // Make sure that multishot receives into our provided buffers work.
+    if (!(state.probeMultishotReceive())) {
+        LOG_INFO("This kernel doesn't support io_uring multishot receives "
+                 "into provided buffers. Falling back to epoll.");
+        io_uring_free_buf_ring(&(state.ring), state.bufferRing,
+                               IoUringState::BUFFER_COUNT,
+                               IoUringState::BUFFER_GROUP_ID);
+        io_uring_queue_exit(&(state.ring));
+        ioUringState = nullptr;
+        return false;
+    }
+
+    state.inputs.reserve(maxSockets);
+    state.tokenSockets.reserve(maxSockets);
+
+    return true;
+#else
+    ignore(maxSockets);
+    LOG_INFO("Built without liburing, io_uring is unavailable. Falling back "
+             "to epoll.");
+    return false;
+#endif
+}
+
+void SocketSet::addSocketIoUring(const TcpSocket& socket)
+{
+#if defined(AM_HAS_IO_URING)
+    IoUringState& state = *ioUringState;
+
+    // Start tracking the socket.
+    Uint64 token = state.nextToken++;
+    IoUringState::ReceivedInput& input = state.inputs[&socket];
+    input = IoUringState::ReceivedInput{};
+    input.token = token;
+    state.tokenSockets.emplace(token, &socket);
+
+    // Start receiving. The receive is submitted during the next
+    // checkSockets().
+    state.armReceive(socket.getFileDescriptor(), token);
+#else
+    ignore(socket);
+#endif
+}
+
+void SocketSet::remSocketIoUring(const TcpSocket& socket)
+{
+#if defined(AM_HAS_IO_URING)
+    IoUringState& state = *ioUringState;
+
+    auto inputIt = state.inputs.find(&socket);
+    if (inputIt == state.inputs.end()) {
+        return;
+    }
+
+    // Stop tracking the socket. Any completions that are still on their way
+    // will no longer match a socket, and will be ignored.
+    state.recycleHeldBuffers(inputIt->second);
+    Uint64 token = inputIt->second.token;
+    state.tokenSockets.erase(token);
+    state.inputs.erase(inputIt);
+
+    // Cancel the socket's receive.
+    // Note: The receive holds a reference to the socket, so it won't actually
+    //       close until the cancel goes through. We submit it right away so
+    //       that the other side sees the close promptly.
+    io_uring_sqe* sqe = state.getSqe();
+    io_uring_prep_cancel64(sqe, token, 0);
+    io_uring_sqe_set_data64(sqe, IoUringState::IGNORED_TOKEN);
+    io_uring_submit(&(state.ring));
+    NetworkStats::recordSocketSyscalls(1);
+#else
+    ignore(socket);
+#endif
+}
+
+int SocketSet::checkSocketsIoUring(unsigned int timeoutMs)
+{
+#if defined(AM_HAS_IO_URING)
+    IoUringState& state = *ioUringState;
+
+    // Carry over any sockets that still have unread data from the last check.
+    std::erase_if(readySockets, [&state](const TcpSocket* socket) {
+        IoUringState::ReceivedInput& input = state.inputs.at(socket);
+        input.isReady = (input.isClosed || input.hasUnreadData());
+        return !(input.isReady);
+    });
+
+    // Submit any new receives. If we don't already have work to hand out,
+    // wait for some to complete.
+    state.rearmStarvedReceives();
+    if (readySockets.empty()) {
+        __kernel_timespec timeout{};
+        timeout.tv_sec = timeoutMs / 1000;
+        timeout.tv_nsec = (timeoutMs % 1000) * 1000000;
+        io_uring_cqe* firstCqe = nullptr;
+        int result = io_uring_submit_and_wait_timeout(
+            &(state.ring), &firstCqe, 1, &timeout, nullptr);
+        NetworkStats::recordSocketSyscalls(1);
+        if ((result < 0) && (result != -ETIME) && (result != -EINTR)) {
+            LOG_INFO("Error while checking sockets: %s", strerror(-result));
+        }
+    }
+    else if (io_uring_submit(&(state.ring)) > 0) {
+        NetworkStats::recordSocketSyscalls(1);
+    }
+
+    // Process the completed receives.
+    unsigned int numCompletions = 0;
+    unsigned int head;
+    io_uring_cqe* cqe;
+    io_uring_for_each_cqe(&(state.ring), head, cqe)
+    {
+        numCompletions++;
+
+        int bufferID = -1;
+        if (cqe->flags & IORING_CQE_F_BUFFER) {
+            bufferID = (cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+            state.freeBufferCount--;
+        }
+
+        // If the completion belongs to a socket in the set, process it.
+        Uint64 token = io_uring_cqe_get_data64(cqe);
+        auto socketIt = state.tokenSockets.find(token);
+        if (socketIt != state.tokenSockets.end()) {
+            const TcpSocket* socket = socketIt->second;
+            IoUringState::ReceivedInput& input = state.inputs.at(socket);
+            if ((cqe->res > 0) && !(input.isClosed)) {
+                // Hold on to the buffer until it's read.
+                input.heldBuffers.push_back(
+                    {static_cast<unsigned int>(bufferID), 0,
+                     static_cast<unsigned int>(cqe->res)});
+                bufferID = -1;
+
+                // If the socket isn't being read, close it so that it doesn't
+                // starve the others of buffers.
+                if ((input.heldBuffers.size() - input.nextHeldBuffer)
+                    > IoUringState::MAX_HELD_BUFFERS) {
+                    LOG_INFO("Socket isn't being read, closing it.");
+                    state.recycleHeldBuffers(input);
+                    input.isClosed = true;
+                }
+            }
+            else if ((cqe->res <= 0) && (cqe->res != -ENOBUFS)) {
+                // 0 means that the connection was closed, anything else is
+                // an error.
+                // Note: ENOBUFS just means that we ran out of buffers.
+                input.isClosed = true;
+            }
+
+            // If the multishot receive ended, re-arm it.
+            // Note: If it ended because we ran out of buffers, it has to wait
+            //       until some are recycled.
+            if (!(cqe->flags & IORING_CQE_F_MORE) && !(input.isClosed)) {
+                if (cqe->res == -ENOBUFS) {
+                    state.starvedTokens.push_back(token);
+                }
+                else {
+                    state.armReceive(socket->getFileDescriptor(), token);
+                }
+            }
+
+            // If there's something to read, report the socket as ready.
+            bool hasWork = (input.isClosed || input.hasUnreadData());
+            if (hasWork && !(input.isReady)) {
+                readySockets.push_back(socket);
+                input.isReady = true;
+            }
+        }
+
+        // If we didn't hold on to the buffer, give it back to the kernel.
+        if (bufferID >= 0) {
+            state.recycleBuffer(bufferID);
+        }
+    }
+    io_uring_cq_advance(&(state.ring), numCompletions);
+
+    // Mark the ready sockets so that TcpSocket::isReady() keeps working.
+    for (const TcpSocket* socket : readySockets) {
+        socket->markReady();
+    }
+
+    return static_cast<int>(readySockets.size());
+#else
+    ignore(timeoutMs);
+    return 0;
+#endif
+}
+
 } // End namespace AM
@@ -0,0 +1,462 @@
+#include "TcpPeer.h"
+#include "TcpSocket.h"
+#include "TcpSendRing.h"
+#include <SDL_stdinc.h>
+#include <algorithm>
+#include <cerrno>
+#include "Log.h"
+#include "Ignore.h"
+
+namespace AM
+{
+TcpPeer::TcpPeer(std::unique_ptr<TcpSocket> inSocket)
+: socket(std::move(inSocket))
+, set(std::make_shared<SocketSet>(
+      1)) // No set given, create a set of size 1 for this peer.
+, bIsConnected(false)
+, deliveryNotices()
+, pendingOutputOffset(0)
+, sendRing(nullptr)
+, isQueuedForSend(false)
+, queuedBuffers()
+, receiveBuffer(RECEIVE_BUFFER_SIZE)
+, receiveState(ReceiveState::Header)
+, pendingMessageType(MessageType::NotSet)
+, pendingMessageSize(0)
+{
+    set->addSocket(*socket);
+
+    bIsConnected = true;
+}
+
+TcpPeer::TcpPeer(std::unique_ptr<TcpSocket> inSocket,
+                 const std::shared_ptr<SocketSet>& inSet)
+: socket(std::move(inSocket))
+, set(inSet)
+, bIsConnected(false)
+, deliveryNotices()
+, pendingOutputOffset(0)
+, sendRing(nullptr)
+, isQueuedForSend(false)
+, queuedBuffers()
+, receiveBuffer(RECEIVE_BUFFER_SIZE)
+, receiveState(ReceiveState::Header)
+, pendingMessageType(MessageType::NotSet)
+, pendingMessageSize(0)
+{
+    set->addSocket(*socket);
+
+    bIsConnected = true;
+}
+
+TcpPeer::~TcpPeer()
+{
+    set->remSocket(*socket);
+}
+
+bool TcpPeer::isConnected() const
+{
+    return bIsConnected;
+}
+
+const TcpSocket& TcpPeer::getSocket() const
+{
+    return *socket;
+}
+
+void TcpPeer::setSendRing(TcpSendRing* inSendRing)
+{
+    sendRing = inSendRing;
+}
+
+NetworkResult TcpPeer::send(const Uint8* messageBuffer,
+                            unsigned int messageSize)
+{
+    if (!bIsConnected) {
+        return NetworkResult::Disconnected;
+    }
+
+    if (messageSize > MAX_MESSAGE_SIZE) {
+        LOG_ERROR("Tried to send a too-large message. Size: %u, max: %u",
+                  messageSize, MAX_MESSAGE_SIZE);
+    }
+
+    int bytesSent = socket->send(messageBuffer, messageSize);
+    if (bytesSent < 0) {
+        LOG_ERROR("TCP_Send returned < 0. This should never happen, the socket"
+                  "was likely misused.");
+    }
+
+    if (static_cast<unsigned int>(bytesSent) < messageSize) {
+        // The peer probably disconnected (could be a different issue).
+        bIsConnected = false;
+        return NetworkResult::Disconnected;
+    }
+    else {
+        return NetworkResult::Success;
+    }
+}
+
+NetworkResult TcpPeer::sendUnreliable(const BinaryBufferSharedPtr& message)
+{
+    return send(message->data(), static_cast<unsigned int>(message->size()));
+}
+
+NetworkResult
+    TcpPeer::sendUnreliable(std::span<const std::span<const Uint8>> buffers,
+                            Uint32 notifyToken)
+{
+    NetworkResult result = sendNonBlocking(buffers);
+    if (result == NetworkResult::Success) {
+        deliveryNotices.push_back({notifyToken, true});
+    }
+
+    return result;
+}
+
+bool TcpPeer::popDeliveryNotice(DeliveryNotice& notice)
+{
+    if (deliveryNotices.empty()) {
+        return false;
+    }
+
+    notice = deliveryNotices.front();
+    deliveryNotices.pop_front();
+    return true;
+}
+
+NetworkResult
+    TcpPeer::sendNonBlocking(std::span<const std::span<const Uint8>> buffers)
+{
+    // If we're batching through a ring, the ring will do the sending.
+    if (sendRing != nullptr) {
+        return queueOutput(buffers);
+    }
+
+    // Send any older output first, so that ordering is preserved.
+    if (flushPendingOutput() == NetworkResult::Disconnected) {
+        return NetworkResult::Disconnected;
+    }
+
+    // If the older output went through, try to send the buffers directly.
+    std::size_t bytesSent = 0;
+    if (getPendingOutputSize() == 0) {
+        int result = socket->sendAvailable(buffers);
+        if (result < 0) {
+            // The peer probably disconnected (could be a different issue).
+            bIsConnected = false;
+            return NetworkResult::Disconnected;
+        }
+
+        bytesSent = static_cast<std::size_t>(result);
+    }
+
+    // Hold on to whatever the socket didn't accept.
+    std::size_t totalSize = 0;
+    for (const std::span<const Uint8>& buffer : buffers) {
+        totalSize += buffer.size();
+    }
+
+    if (bytesSent < totalSize) {
+        std::size_t bytesLeft = totalSize - bytesSent;
+        if ((getPendingOutputSize() + bytesLeft) > MAX_PENDING_OUTPUT_SIZE) {
+            LOG_INFO("Peer isn't keeping up with sends, dropping it. Pending "
+                     "bytes: %u",
+                     getPendingOutputSize());
+            bIsConnected = false;
+            return NetworkResult::Disconnected;
+        }
+
+        // Skip the bytes that were sent, then copy the rest.
+        std::size_t bytesToSkip = bytesSent;
+        for (const std::span<const Uint8>& buffer : buffers) {
+            if (bytesToSkip >= buffer.size()) {
+                bytesToSkip -= buffer.size();
+                continue;
+            }
+
+            pendingOutput.insert(pendingOutput.end(),
+                                 (buffer.begin() + bytesToSkip), buffer.end());
+            bytesToSkip = 0;
+        }
+    }
+
+    return NetworkResult::Success;
+}
+
+NetworkResult TcpPeer::flushPendingOutput()
+{
+    if (!bIsConnected) {
+        return NetworkResult::Disconnected;
+    }
+
+    std::size_t pendingSize = getPendingOutputSize();
+    if (pendingSize == 0) {
+        return NetworkResult::Success;
+    }
+    else if (sendRing != nullptr) {
+        // The ring will send it.
+        queueForSend();
+        return NetworkResult::Success;
+    }
+
+    int result = socket->sendAvailable(&(pendingOutput[pendingOutputOffset]),
+                                       static_cast<int>(pendingSize));
+    if (result < 0) {
+        // The peer probably disconnected (could be a different issue).
+        bIsConnected = false;
+        return NetworkResult::Disconnected;
+    }
+
+    // If we sent everything, reset the buffer.
+    pendingOutputOffset += result;
+    if (pendingOutputOffset == pendingOutput.size()) {
+        pendingOutput.clear();
+        pendingOutputOffset = 0;
+    }
+
+    return NetworkResult::Success;
+}
+
+std::size_t TcpPeer::getPendingOutputSize() const
+{
+    return (pendingOutput.size() - pendingOutputOffset);
+}
+
+MessageResult TcpPeer::receiveMessage(BinaryBufferPtr& messageBuffer,
+                                      Uint8* prefixBuffer,
+                                      unsigned int prefixSize)
+{
+    // If we already have a complete message buffered, return it without
+    // touching the socket.
+    MessageResult result
+        = popBufferedMessage(messageBuffer, prefixBuffer, prefixSize);
+    if (result.networkResult == NetworkResult::Success) {
+        return result;
+    }
+    else if (!bIsConnected) {
+        return {NetworkResult::Disconnected};
+    }
+
+    // Receive whatever is waiting and try again.
+    if (fillReceiveBuffer() == NetworkResult::Disconnected) {
+        return {NetworkResult::Disconnected};
+    }
+
+    return popBufferedMessage(messageBuffer, prefixBuffer, prefixSize);
+}
+
+NetworkResult TcpPeer::receiveBytesWait(Uint8* messageBuffer,
+                                        Uint16 numBytes)
+{
+    if (!bIsConnected) {
+        return NetworkResult::Disconnected;
+    }
+    else if (numBytes > MAX_MESSAGE_SIZE) {
+        LOG_ERROR("Tried to receive too large of a message. messageSize: %u, "
+                  "MaxSize: %u",
+                  numBytes, MAX_MESSAGE_SIZE);
+    }
+
+    // If any bytes were previously buffered, use them first.
+    Uint16 bytesReceived = std::min(static_cast<std::size_t>(numBytes),
+                                    receiveBuffer.size());
+    receiveBuffer.read(messageBuffer, bytesReceived);
+
+    // Receive the rest, waiting for them if necessary.
+    // Note: The bytes may arrive across multiple reads.
+    while (bytesReceived < numBytes) {
+        int result = socket->receive((messageBuffer + bytesReceived),
+                                     (numBytes - bytesReceived));
+        if (result <= 0) {
+            // Disconnected
+            bIsConnected = false;
+            return NetworkResult::Disconnected;
+        }
+
+        bytesReceived += result;
+    }
+
+    return NetworkResult::Success;
+}
+
+NetworkResult TcpPeer::receiveUnreliable(BinaryBuffer& datagram,
+                                         unsigned int timeoutMs)
+{
+    ignore(datagram);
+    ignore(timeoutMs);
+    LOG_ERROR("TCP has no datagrams to receive.");
+    return NetworkResult::Disconnected;
+}
+
+NetworkResult
+    TcpPeer::queueOutput(std::span<const std::span<const Uint8>> buffers)
+{
+    if (!bIsConnected) {
+        return NetworkResult::Disconnected;
+    }
+
+    // If the peer isn't keeping up, drop it.
+    std::size_t totalSize = 0;
+    for (const std::span<const Uint8>& buffer : buffers) {
+        totalSize += buffer.size();
+    }
+
+    std::size_t heldSize = getPendingOutputSize();
+    if ((heldSize + totalSize) > MAX_PENDING_OUTPUT_SIZE) {
+        LOG_INFO("Peer isn't keeping up with sends, dropping it. Pending "
+                 "bytes: %u",
+                 heldSize);
+        bIsConnected = false;
+        return NetworkResult::Disconnected;
+    }
+
+    // Hold views of the buffers. The ring will gather them straight from
+    // their owner's memory.
+    queuedBuffers.insert(queuedBuffers.end(), buffers.begin(), buffers.end());
+
+    queueForSend();
+
+    return NetworkResult::Success;
+}
+
+void TcpPeer::queueForSend()
+{
+    if (!isQueuedForSend
+        && ((getPendingOutputSize() > 0) || !(queuedBuffers.empty()))) {
+        sendRing->queue(*this);
+        isQueuedForSend = true;
+    }
+}
+
+void TcpPeer::getUnsentOutput(
+    std::vector<std::span<const Uint8>>& outBuffers) const
+{
+    if (getPendingOutputSize() > 0) {
+        outBuffers.emplace_back((pendingOutput.data() + pendingOutputOffset),
+                                getPendingOutputSize());
+    }
+    outBuffers.insert(outBuffers.end(), queuedBuffers.begin(),
+                      queuedBuffers.end());
+}
+
+void TcpPeer::completeSend(int result)
+{
+    isQueuedForSend = false;
+
+    std::size_t bytesSent = 0;
+    if (result >= 0) {
+        bytesSent = static_cast<std::size_t>(result);
+    }
+    else if ((result != -EAGAIN) && (result != -EINTR)) {
+        // The peer probably disconnected (could be a different issue).
+        // Note: EAGAIN just means that the socket's send buffer is full.
+        bIsConnected = false;
+    }
+
+    // The pending output went first, so it's what was sent first.
+    std::size_t pendingSent = std::min(bytesSent, getPendingOutputSize());
+    pendingOutputOffset += pendingSent;
+    bytesSent -= pendingSent;
+
+    // If we sent everything, reset the buffer.
+    if (pendingOutputOffset == pendingOutput.size()) {
+        pendingOutput.clear();
+        pendingOutputOffset = 0;
+    }
+
+    // Copy whatever the socket didn't accept from the queued buffers, since
+    // they may not outlive the submit.
+    if (bIsConnected) {
+        for (const std::span<const Uint8>& buffer : queuedBuffers) {
+            if (bytesSent >= buffer.size()) {
+                bytesSent -= buffer.size();
+                continue;
+            }
+
+            pendingOutput.insert(pendingOutput.end(),
+                                 (buffer.begin() + bytesSent), buffer.end());
+            bytesSent = 0;
+        }
+    }
+    queuedBuffers.clear();
+}
+
+NetworkResult TcpPeer::fillReceiveBuffer()
+{
+    // Receive until the socket is drained or our buffer is full.
+    while (receiveBuffer.getFreeSpace() > 0) {
+        int maxBytes = static_cast<int>(receiveBuffer.getContiguousFreeSpace());
+        // Note: We go through the set, since it may be receiving on our
+        //       socket's behalf.
+        int result = set->receiveAvailable(
+            *socket, receiveBuffer.getWritePtr(), maxBytes);
+        if (result < 0) {
+            // Disconnected
+            bIsConnected = false;
+            return NetworkResult::Disconnected;
+        }
+
+        receiveBuffer.commitWrite(result);
+
+        // If we got less than we asked for, the socket has been drained.
+        if (result < maxBytes) {
+            break;
+        }
+    }
+
+    return NetworkResult::Success;
+}
+
+MessageResult TcpPeer::popBufferedMessage(BinaryBufferPtr& messageBuffer,
+                                          Uint8* prefixBuffer,
+                                          unsigned int prefixSize)
+{
+    if (receiveState == ReceiveState::Header) {
+        // Wait until we have the full prefix and message header.
+        if (receiveBuffer.size() < (prefixSize + MESSAGE_HEADER_SIZE)) {
+            return {NetworkResult::NoWaitingData};
+        }
+
+        // Parse the message header.
+        Uint8 headerBuf[MESSAGE_HEADER_SIZE];
+        receiveBuffer.peek(headerBuf, MESSAGE_HEADER_SIZE, prefixSize);
+        pendingMessageType = static_cast<MessageType>(
+            headerBuf[MessageHeaderIndex::MessageType]);
+        pendingMessageSize
+            = _SDLNet_Read16(&(headerBuf[MessageHeaderIndex::Size]));
+        // Note: The size came from the remote, so a bad one means the
+        //       remote is misbehaving. Drop it rather than crashing.
+        if (pendingMessageSize > MAX_MESSAGE_SIZE) {
+            LOG_INFO("Received too large of a message size, disconnecting. "
+                     "messageSize: %u, MaxSize: %u",
+                     pendingMessageSize, MAX_MESSAGE_SIZE);
+            bIsConnected = false;
+            return {NetworkResult::Disconnected};
+        }
+
+        receiveState = ReceiveState::Payload;
+    }
+
+    // Wait until we have the full message.
+    // Note: The prefix and header are left in the buffer until now, so that we
+    //       can hand them all out at once.
+    std::size_t frameSize
+        = prefixSize + MESSAGE_HEADER_SIZE + pendingMessageSize;
+    if (receiveBuffer.size() < frameSize) {
+        return {NetworkResult::NoWaitingData};
+    }
+
+    // Pop the message.
+    if (prefixSize > 0) {
+        receiveBuffer.read(prefixBuffer, prefixSize);
+    }
+    receiveBuffer.discard(MESSAGE_HEADER_SIZE);
+    messageBuffer = std::make_unique<BinaryBuffer>(pendingMessageSize);
+    receiveBuffer.read(messageBuffer->data(), pendingMessageSize);
+
+    receiveState = ReceiveState::Header;
+    return {NetworkResult::Success, pendingMessageType, pendingMessageSize};
+}
+
+} // End namespace AM
@@ -0,0 +1,181 @@
+#include "TcpSendRing.h"
+#include "TcpPeer.h"
+#include "TcpSocket.h"
+#include "NetworkStats.h"
+#include "Log.h"
+#include "Ignore.h"
+#if defined(AM_HAS_IO_URING)
+#include <liburing.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <algorithm>
+#include <span>
+#include <utility>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace AM
+{
+struct TcpSendRing::RingState {
+#if defined(AM_HAS_IO_URING)
+    /** The largest submission queue that we'll ask for. Larger batches are
+        sent in multiple submissions. */
+    static constexpr unsigned int MAX_QUEUE_SIZE = 1024;
+
+    /** The most I/O vectors that a single sendmsg accepts (UIO_MAXIOV).
+        Anything past this is held by the peer and sent next time. */
+    static constexpr std::size_t MAX_IOVECS_PER_SEND = 1024;
+
+    /** The io_uring instance. */
+    io_uring ring{};
+
+    /** The size of the ring's submission queue. */
+    unsigned int queueSize = 0;
+
+    /** Scratch buffer for each peer's unsent output. */
+    std::vector<std::span<const Uint8>> peerBuffers;
+
+    /** The I/O vectors of every send in the current chunk. */
+    std::vector<iovec> ioVectors;
+
+    /** The first ioVectors index and the I/O vector count of each send in
+        the current chunk. */
+    std::vector<std::pair<std::size_t, std::size_t>> ioVectorRanges;
+
+    /** The message header of each send in the current chunk. These point
+        into ioVectors, so they're filled after it stops growing. */
+    std::vector<msghdr> messageHeaders;
+#endif
+};
+
+TcpSendRing::TcpSendRing(unsigned int inMaxPeers)
+: ringState(nullptr)
+{
+#if defined(AM_HAS_IO_URING)
+    ringState = std::make_unique<RingState>();
+    unsigned int queueSize
+        = std::clamp(inMaxPeers, 1U, RingState::MAX_QUEUE_SIZE);
+    int result = io_uring_queue_init(queueSize, &(ringState->ring), 0);
+    if (result < 0) {
+        LOG_INFO("io_uring is unavailable for sends (%s).", strerror(-result));
+        ringState = nullptr;
+        return;
+    }
+
+    ringState->queueSize = ringState->ring.sq.ring_entries;
+    queuedPeers.reserve(inMaxPeers);
+#else
+    ignore(inMaxPeers);
+#endif
+}
+
+TcpSendRing::~TcpSendRing()
+{
+#if defined(AM_HAS_IO_URING)
+    if (ringState != nullptr) {
+        io_uring_queue_exit(&(ringState->ring));
+    }
+#endif
+}
+
+bool TcpSendRing::isAvailable() const
+{
+    return (ringState != nullptr);
+}
+
+void TcpSendRing::queue(TcpPeer& peer)
+{
+    queuedPeers.push_back(&peer);
+}
+
+void TcpSendRing::submit()
+{
+#if defined(AM_HAS_IO_URING)
+    io_uring& ring = ringState->ring;
+
+    // Send in chunks that fit in the submission queue.
+    std::size_t chunkStart = 0;
+    while (chunkStart < queuedPeers.size()) {
+        std::size_t chunkEnd = std::min(
+            queuedPeers.size(), (chunkStart + ringState->queueSize));
+
+        // Gather each peer's unsent output, without copying it.
+        std::vector<iovec>& ioVectors = ringState->ioVectors;
+        auto& ioVectorRanges = ringState->ioVectorRanges;
+        ioVectors.clear();
+        ioVectorRanges.clear();
+        for (std::size_t i = chunkStart; i < chunkEnd; ++i) {
+            std::vector<std::span<const Uint8>>& peerBuffers
+                = ringState->peerBuffers;
+            peerBuffers.clear();
+            queuedPeers[i]->getUnsentOutput(peerBuffers);
+
+            std::size_t count = std::min(peerBuffers.size(),
+                                         RingState::MAX_IOVECS_PER_SEND);
+            ioVectorRanges.emplace_back(ioVectors.size(), count);
+            for (std::size_t j = 0; j < count; ++j) {
+                ioVectors.push_back({const_cast<Uint8*>(peerBuffers[j].data()),
+                                     peerBuffers[j].size()});
+            }
+        }
+
+        // Queue a gathered send for each peer's output.
+        // Note: MSG_DONTWAIT makes sends to a full socket complete right
+        //       away instead of waiting for room, so a slow peer can't
+        //       delay the others.
+        std::vector<msghdr>& messageHeaders = ringState->messageHeaders;
+        messageHeaders.assign(ioVectorRanges.size(), msghdr{});
+        for (std::size_t i = chunkStart; i < chunkEnd; ++i) {
+            auto [firstIndex, count] = ioVectorRanges[i - chunkStart];
+            msghdr& messageHeader = messageHeaders[i - chunkStart];
+            messageHeader.msg_iov = (ioVectors.data() + firstIndex);
+            messageHeader.msg_iovlen = count;
+
+            TcpPeer& peer = *(queuedPeers[i]);
+            io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+            io_uring_prep_sendmsg(sqe, peer.getSocket().getFileDescriptor(),
+                                  &messageHeader,
+                                  (MSG_DONTWAIT | MSG_NOSIGNAL));
+            io_uring_sqe_set_data64(sqe, i);
+        }
+
+        // Submit the sends and wait for them all to complete.
+        unsigned int numSends
+            = static_cast<unsigned int>(chunkEnd - chunkStart);
+        int result = io_uring_submit_and_wait(&ring, numSends);
+        NetworkStats::recordSocketSyscalls(1);
+        if ((result < 0) && (result != -EINTR)) {
+            LOG_ERROR("Failed to submit sends: %s", strerror(-result));
+        }
+
+        // Hand each result to its peer.
+        unsigned int numCompleted = 0;
+        while (numCompleted < numSends) {
+            unsigned int numSeen = 0;
+            unsigned int head;
+            io_uring_cqe* cqe;
+            io_uring_for_each_cqe(&ring, head, cqe)
+            {
+                queuedPeers[io_uring_cqe_get_data64(cqe)]->completeSend(
+                    cqe->res);
+                numSeen++;
+            }
+            io_uring_cq_advance(&ring, numSeen);
+            numCompleted += numSeen;
+
+            // If our wait was interrupted, wait for the rest.
+            if (numCompleted < numSends) {
+                io_uring_wait_cqe(&ring, &cqe);
+                NetworkStats::recordSocketSyscalls(1);
+            }
+        }
+
+        chunkStart = chunkEnd;
+    }
+#endif
+
+    queuedPeers.clear();
+}
+
+} // End namespace AM
@@ -1,9 +1,38 @@
 #include "TcpSocket.h"
+#include "NetworkStats.h"
 #include <SDL2/SDL_net.h>
 #include "Log.h"
+#if defined(__linux__)
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#endif
 
 namespace AM
 {
+#if defined(__linux__)
+namespace
+{
+/**
+ * Disables Nagle's algorithm on the given socket, as SDLNet is built to do.
+ */
+void setNoDelay(int fileDescriptor)
+{
+    int enable = 1;
+    setsockopt(fileDescriptor, IPPROTO_TCP, TCP_NODELAY, &enable,
+               sizeof(enable));
+}
+
+} // End anonymous namespace
+#endif
+
 TcpSocket::TcpSocket(Uint16 inPort)
 : ip("")
 , port(inPort)
@@ -13,6 +42,33 @@ TcpSocket::TcpSocket(Uint16 inPort)
         LOG_ERROR("Tried to use port 0.");
     }
 
+#if defined(__linux__)
+    ready = false;
+    fileDescriptor = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fileDescriptor == -1) {
+        LOG_ERROR("Could not open TCP socket: %s", strerror(errno));
+    }
+
+    // Match SDLNet's listeners: reusable address, and non-blocking so that
+    // accept() returns immediately if nothing is waiting.
+    int enable = 1;
+    setsockopt(fileDescriptor, SOL_SOCKET, SO_REUSEADDR, &enable,
+               sizeof(enable));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if ((bind(fileDescriptor, reinterpret_cast<sockaddr*>(&address),
+              sizeof(address))
+         == -1)
+        || (listen(fileDescriptor, SOMAXCONN) == -1)) {
+        LOG_ERROR("Could not open TCP socket: %s", strerror(errno));
+    }
+
+    int flags = fcntl(fileDescriptor, F_GETFL, 0);
+    fcntl(fileDescriptor, F_SETFL, (flags | O_NONBLOCK));
+#else
     IPaddress ip;
     if (SDLNet_ResolveHost(&ip, nullptr, port) == -1) {
         LOG_ERROR("Could not resolve host: %s", SDLNet_GetError());
@@ -22,14 +78,26 @@ TcpSocket::TcpSocket(Uint16 inPort)
     if (socket == nullptr) {
         LOG_ERROR("Could not open TCP socket: %s", SDLNet_GetError());
     }
+#endif
 }
 
+#if defined(__linux__)
+TcpSocket::TcpSocket(Accepted, int inFileDescriptor)
+: fileDescriptor(inFileDescriptor)
+, ready(false)
+, ip("")
+, port(0)
+{
+    setNoDelay(fileDescriptor);
+}
+#else
 TcpSocket::TcpSocket(TCPsocket inSdlSocket)
 : socket(inSdlSocket)
 , ip("")
 , port(0)
 {
 }
+#endif
 
 TcpSocket::TcpSocket(std::string inIp, Uint16 inPort)
 : ip(inIp)
@@ -40,6 +108,31 @@ TcpSocket::TcpSocket(std::string inIp, Uint16 inPort)
         LOG_ERROR("Tried to use port 0.");
     }
 
+#if defined(__linux__)
+    ready = false;
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    int result = getaddrinfo(ip.c_str(), nullptr, &hints, &addresses);
+    if ((result != 0) || (addresses == nullptr)) {
+        LOG_ERROR("Could not resolve host: %s", gai_strerror(result));
+    }
+
+    sockaddr_in address
+        = *reinterpret_cast<sockaddr_in*>(addresses->ai_addr);
+    address.sin_port = htons(port);
+    freeaddrinfo(addresses);
+
+    fileDescriptor = ::socket(AF_INET, SOCK_STREAM, 0);
+    if ((fileDescriptor == -1)
+        || (connect(fileDescriptor, reinterpret_cast<sockaddr*>(&address),
+                    sizeof(address))
+            == -1)) {
+        LOG_ERROR("Could not open TCP socket: %s", strerror(errno));
+    }
+    setNoDelay(fileDescriptor);
+#else
     IPaddress ipObj;
 
     if (SDLNet_ResolveHost(&ipObj, ip.c_str(), port) == -1) {
@@ -50,37 +143,259 @@ TcpSocket::TcpSocket(std::string inIp, Uint16 inPort)
     if (socket == nullptr) {
         LOG_ERROR("Could not open TCP socket: %s", SDLNet_GetError());
     }
+#endif
 }
 
 TcpSocket::~TcpSocket()
 {
+#if defined(__linux__)
+    close(fileDescriptor);
+#else
     SDLNet_TCP_Close(socket);
+#endif
 }
 
 int TcpSocket::send(const void* dataBuffer, int len)
 {
+#if defined(__linux__)
+    // Like SDLNet_TCP_Send(), block until everything is sent or we error.
+    const Uint8* data = static_cast<const Uint8*>(dataBuffer);
+    int totalSent = 0;
+    while (totalSent < len) {
+        ssize_t result = ::send(fileDescriptor, (data + totalSent),
+                                (len - totalSent), MSG_NOSIGNAL);
+        NetworkStats::recordSocketSyscalls(1);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        totalSent += static_cast<int>(result);
+    }
+
+    return totalSent;
+#else
     return SDLNet_TCP_Send(socket, dataBuffer, len);
+#endif
+}
+
+int TcpSocket::sendAvailable(const void* dataBuffer, int len)
+{
+#if defined(__linux__)
+    ssize_t result = ::send(getFileDescriptor(), dataBuffer, len,
+                            (MSG_DONTWAIT | MSG_NOSIGNAL));
+    NetworkStats::recordSocketSyscalls(1);
+    if (result >= 0) {
+        return static_cast<int>(result);
+    }
+    else if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)) {
+        // The send buffer is full.
+        return 0;
+    }
+    else {
+        return -1;
+    }
+#else
+    int result = SDLNet_TCP_Send(socket, dataBuffer, len);
+    return (result < len) ? -1 : result;
+#endif
+}
+
+int TcpSocket::sendAvailable(std::span<const std::span<const Uint8>> buffers)
+{
+#if defined(__linux__)
+    // Gather the buffers in chunks that fit in our stack array.
+    static constexpr std::size_t MAX_IOVECS = 64;
+    iovec iovecs[MAX_IOVECS];
+
+    std::size_t totalSent = 0;
+    std::size_t bufferIndex = 0;
+    while (bufferIndex < buffers.size()) {
+        std::size_t iovecCount
+            = std::min(MAX_IOVECS, (buffers.size() - bufferIndex));
+        std::size_t chunkSize = 0;
+        for (std::size_t i = 0; i < iovecCount; ++i) {
+            const std::span<const Uint8>& buffer = buffers[bufferIndex + i];
+            iovecs[i].iov_base = const_cast<Uint8*>(buffer.data());
+            iovecs[i].iov_len = buffer.size();
+            chunkSize += buffer.size();
+        }
+
+        msghdr message{};
+        message.msg_iov = iovecs;
+        message.msg_iovlen = iovecCount;
+        ssize_t result = sendmsg(getFileDescriptor(), &message,
+                                 (MSG_DONTWAIT | MSG_NOSIGNAL));
+        NetworkStats::recordSocketSyscalls(1);
+        if (result < 0) {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK)
+                || (errno == EINTR)) {
+                // The send buffer is full.
+                break;
+            }
+            else {
+                return -1;
+            }
+        }
+
+        totalSent += result;
+
+        // If the socket didn't take the whole chunk, its send buffer is full.
+        if (static_cast<std::size_t>(result) < chunkSize) {
+            break;
+        }
+
+        bufferIndex += iovecCount;
+    }
+
+    return static_cast<int>(totalSent);
+#else
+    int totalSent = 0;
+    for (const std::span<const Uint8>& buffer : buffers) {
+        int result = sendAvailable(buffer.data(), buffer.size());
+        if (result < 0) {
+            return -1;
+        }
+
+        totalSent += result;
+    }
+
+    return totalSent;
+#endif
 }
 
 int TcpSocket::receive(void* dataBuffer, int maxLen)
 {
+#if defined(__linux__)
+    ready = false;
+    ssize_t result;
+    do {
+        result = recv(fileDescriptor, dataBuffer, maxLen, 0);
+    } while ((result < 0) && (errno == EINTR));
+    NetworkStats::recordSocketSyscalls(1);
+
+    return static_cast<int>(result);
+#else
     return SDLNet_TCP_Recv(socket, dataBuffer, maxLen);
+#endif
+}
+
+int TcpSocket::receiveAvailable(void* dataBuffer, int maxLen)
+{
+#if defined(__linux__)
+    ready = false;
+    ssize_t result = recv(fileDescriptor, dataBuffer, maxLen, MSG_DONTWAIT);
+    NetworkStats::recordSocketSyscalls(1);
+    if (result > 0) {
+        return static_cast<int>(result);
+    }
+    else if ((result < 0)
+             && ((errno == EAGAIN) || (errno == EWOULDBLOCK)
+                 || (errno == EINTR))) {
+        // No data waiting.
+        return 0;
+    }
+    else {
+        // Connection closed or errored.
+        return -1;
+    }
+#else
+    // select() reported data, so a single receive won't block.
+    // Note: SDLNet clears the ready flag on receive, so we only do one.
+    if (!isReady()) {
+        return 0;
+    }
+
+    int result = SDLNet_TCP_Recv(socket, dataBuffer, maxLen);
+    return (result > 0) ? result : -1;
+#endif
 }
 
 bool TcpSocket::isReady()
 {
+#if defined(__linux__)
+    return ready;
+#else
+    return SDLNet_SocketReady(socket);
+#endif
+}
+
+void TcpSocket::markReady() const
+{
+#if defined(__linux__)
+    ready = true;
+#else
+    // SDLNet's sockets all start with its public generic socket header.
+    reinterpret_cast<SDLNet_GenericSocket>(socket)->ready = 1;
+#endif
+}
+
+void TcpSocket::clearReady() const
+{
+#if defined(__linux__)
+    ready = false;
+#else
+    reinterpret_cast<SDLNet_GenericSocket>(socket)->ready = 0;
+#endif
+}
+
+bool TcpSocket::hasWaitingData() const
+{
+#if defined(__linux__)
+    Uint8 peekByte;
+    ssize_t result = recv(fileDescriptor, &peekByte, 1,
+                          (MSG_PEEK | MSG_DONTWAIT));
+    NetworkStats::recordSocketSyscalls(1);
+
+    // If the socket would block, there's no data. Anything else (data,
+    // a closed connection, an error) needs to be seen by receive().
+    if ((result < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) {
+        return false;
+    }
+    else {
+        return true;
+    }
+#else
+    // No non-blocking peek available, rely on the last checkSockets().
     return SDLNet_SocketReady(socket);
+#endif
+}
+
+int TcpSocket::getFileDescriptor() const
+{
+#if defined(__linux__)
+    return fileDescriptor;
+#else
+    LOG_ERROR("getFileDescriptor() is only supported on Linux.");
+    return -1;
+#endif
 }
 
 std::unique_ptr<TcpSocket> TcpSocket::accept()
 {
+#if defined(__linux__)
+    ready = false;
+    int newFileDescriptor = ::accept(fileDescriptor, nullptr, nullptr);
+    if (newFileDescriptor == -1) {
+        return nullptr;
+    }
+    else {
+        // Note: We can't use make_unique since the constructor is private.
+        return std::unique_ptr<TcpSocket>(
+            new TcpSocket(Accepted{}, newFileDescriptor));
+    }
+#else
     TCPsocket newSocket = SDLNet_TCP_Accept(socket);
     if (newSocket == nullptr) {
         return nullptr;
     }
     else {
-        return std::make_unique<TcpSocket>(newSocket);
+        // Note: We can't use make_unique since the constructor is private.
+        return std::unique_ptr<TcpSocket>(new TcpSocket(newSocket));
     }
+#endif
 }
 
 std::string TcpSocket::getAddress()
@@ -92,6 +407,22 @@ std::string TcpSocket::getAddress()
     else if (port == 0) {
         // Socket was received through a listener and hasn't yet retrieved its
         // address.
+#if defined(__linux__)
+        sockaddr_in remoteAddress{};
+        socklen_t addressLength = sizeof(remoteAddress);
+        if (getpeername(fileDescriptor,
+                        reinterpret_cast<sockaddr*>(&remoteAddress),
+                        &addressLength)
+            == -1) {
+            LOG_ERROR("Failed to get peer address: %s", strerror(errno));
+        }
+        else {
+            // Successfully got the address, save it in our members.
+            // Note: We keep SDLNet's network byte order formatting.
+            ip = std::to_string(remoteAddress.sin_addr.s_addr);
+            port = remoteAddress.sin_port;
+        }
+#else
         IPaddress* remoteIP = SDLNet_TCP_GetPeerAddress(socket);
         if (remoteIP == nullptr) {
             LOG_ERROR("Failed to get peer address: %s", SDLNet_GetError());
@@ -101,14 +432,17 @@ std::string TcpSocket::getAddress()
             ip = std::to_string(remoteIP->host);
             port = remoteIP->port;
         }
+#endif
     }
 
     return ip + std::to_string(port);
 }
 
+#if !defined(__linux__)
 TCPsocket TcpSocket::getUnderlyingSocket() const
 {
     return socket;
 }
+#endif
 
 } // End namespace AM
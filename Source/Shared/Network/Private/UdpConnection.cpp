@@ -0,0 +1,437 @@
+#include "UdpConnection.h"
+#include "Log.h"
+#include <SDL2/SDL_net.h>
+#include <algorithm>
+
+namespace AM
+{
+UdpConnection::UdpConnection()
+: localSequence(0)
+, sentPackets{}
+, pendingReliables()
+, nextReliableID(0)
+, pendingUnreliables()
+, unresolvedNotifieds()
+, notices()
+, unackedReliableBytes(0)
+, resendCount(0)
+, roundTripTimeS(INITIAL_RTT_S)
+, hasReceivedAny(false)
+, remoteSequence(0)
+, receivedBits(0)
+, ackIsOwed(false)
+, nextDeliverID(0)
+, receiveWindow{}
+, deliveredReliables()
+, hasDeliveredUnreliable(false)
+, lastUnreliableSequence(0)
+, deliveredUnreliables()
+{
+}
+
+bool UdpConnection::queue(Channel channel, std::span<const Uint8> payload)
+{
+    if (payload.size() > MAX_PAYLOAD_SIZE) {
+        LOG_ERROR("Tried to queue a too-large payload. Size: %u, max: %u",
+                  payload.size(), MAX_PAYLOAD_SIZE);
+    }
+
+    if (channel == Channel::Unreliable) {
+        pendingUnreliables.emplace_back().payload.assign(payload.begin(),
+                                                         payload.end());
+        return true;
+    }
+
+    if (pendingReliables.size() == RELIABLE_WINDOW_SIZE) {
+        return false;
+    }
+
+    PendingReliable& pending = pendingReliables.emplace_back();
+    pending.reliableID = nextReliableID++;
+    pending.payload.assign(payload.begin(), payload.end());
+    unackedReliableBytes += payload.size();
+
+    return true;
+}
+
+void UdpConnection::queueNotified(std::span<const Uint8> payload,
+                                  Uint32 notifyToken)
+{
+    if (payload.size() > MAX_PAYLOAD_SIZE) {
+        LOG_ERROR("Tried to queue a too-large payload. Size: %u, max: %u",
+                  payload.size(), MAX_PAYLOAD_SIZE);
+    }
+
+    PendingUnreliable& pending = pendingUnreliables.emplace_back();
+    pending.payload.assign(payload.begin(), payload.end());
+    pending.isNotified = true;
+    pending.notifyToken = notifyToken;
+}
+
+void UdpConnection::writeDatagrams(double currentTimeS,
+                                   std::vector<BinaryBuffer>& datagrams)
+{
+    std::size_t startCount = datagrams.size();
+
+    // Report on any notified datagrams whose acks are overdue.
+    resolveNotices(currentTimeS);
+
+    // Send any new reliable payloads, and resend any whose acks are late.
+    // Note: Resends are paced, oldest first. The rest stay due, so they'll
+    //       go out in a later write.
+    double resendIntervalS = getResendInterval();
+    std::size_t resendsLeft = MAX_RESENDS_PER_WRITE;
+    for (PendingReliable& pending : pendingReliables) {
+        if (pending.isAcked) {
+            continue;
+        }
+        else if (pending.wasSent
+                 && (((currentTimeS - pending.lastSendTimeS)
+                      < resendIntervalS)
+                     || (resendsLeft == 0))) {
+            continue;
+        }
+
+        if (pending.wasSent) {
+            resendCount++;
+            resendsLeft--;
+        }
+        writeDatagram(PacketType::Reliable, pending.reliableID,
+                      pending.payload, currentTimeS, datagrams);
+        pending.wasSent = true;
+        pending.lastSendTimeS = currentTimeS;
+    }
+
+    // Send the unreliable payloads.
+    for (PendingUnreliable& pending : pendingUnreliables) {
+        Uint16 sequence = localSequence;
+        writeDatagram(PacketType::Unreliable, 0, pending.payload,
+                      currentTimeS, datagrams);
+
+        // If we owe a notice for it, track its ack.
+        if (pending.isNotified) {
+            unresolvedNotifieds.push_back({sequence, pending.notifyToken});
+        }
+    }
+    pendingUnreliables.clear();
+
+    // If we didn't send anything to carry our acks, send them alone.
+    if ((datagrams.size() == startCount) && ackIsOwed) {
+        writeDatagram(PacketType::AckOnly, 0, {}, currentTimeS, datagrams);
+    }
+}
+
+void UdpConnection::writeConnect(double currentTimeS,
+                                 std::vector<BinaryBuffer>& datagrams)
+{
+    writeDatagram(PacketType::Connect, 0, {}, currentTimeS, datagrams);
+}
+
+bool UdpConnection::processDatagram(std::span<const Uint8> datagram,
+                                    double currentTimeS)
+{
+    if ((datagram.size() < HEADER_SIZE)
+        || (datagram.size() > UdpSocket::MAX_DATAGRAM_SIZE)) {
+        return false;
+    }
+
+    // Parse the header.
+    const Uint8* header = datagram.data();
+    if (_SDLNet_Read16(&(header[HeaderIndex::ProtocolID])) != PROTOCOL_ID) {
+        return false;
+    }
+
+    Uint8 typeByte = header[HeaderIndex::Type];
+    bool hasAcks = ((typeByte & HAS_ACKS_FLAG) != 0);
+    PacketType type = static_cast<PacketType>(typeByte & ~HAS_ACKS_FLAG);
+    if (type > PacketType::Connect) {
+        return false;
+    }
+
+    Uint16 sequence = _SDLNet_Read16(&(header[HeaderIndex::Sequence]));
+    Uint16 ack = _SDLNet_Read16(&(header[HeaderIndex::Ack]));
+    Uint32 ackBits = _SDLNet_Read32(&(header[HeaderIndex::AckBits]));
+    Uint16 reliableID = _SDLNet_Read16(&(header[HeaderIndex::ReliableID]));
+
+    // If it's an unreliable payload and a newer one was already delivered,
+    // it'll be dropped.
+    // Note: We don't ack dropped payloads, so the sender's notice (if it
+    //       asked for one) reports them as lost.
+    bool isStaleUnreliable = ((type == PacketType::Unreliable)
+                              && hasDeliveredUnreliable
+                              && !isNewer(sequence, lastUnreliableSequence));
+
+    // Update our acks and apply theirs.
+    if (!isStaleUnreliable) {
+        recordReceived(sequence);
+    }
+    if (hasAcks) {
+        processAcks(ack, ackBits, currentTimeS);
+    }
+
+    // Deliver the payload.
+    std::span<const Uint8> payload{datagram.subspan(HEADER_SIZE)};
+    if (type == PacketType::Reliable) {
+        receiveReliable(reliableID, payload);
+        ackIsOwed = true;
+    }
+    else if ((type == PacketType::Unreliable) && !isStaleUnreliable) {
+        if (deliveredUnreliables.size() == MAX_DELIVERED_UNRELIABLES) {
+            deliveredUnreliables.pop_front();
+        }
+        deliveredUnreliables.emplace_back(payload.begin(), payload.end());
+        lastUnreliableSequence = sequence;
+        hasDeliveredUnreliable = true;
+        ackIsOwed = true;
+    }
+
+    return true;
+}
+
+bool UdpConnection::popReliable(BinaryBuffer& payload)
+{
+    if (deliveredReliables.empty()) {
+        return false;
+    }
+
+    payload = std::move(deliveredReliables.front());
+    deliveredReliables.pop_front();
+    return true;
+}
+
+std::size_t UdpConnection::peekReliableSize() const
+{
+    return deliveredReliables.empty() ? 0 : deliveredReliables.front().size();
+}
+
+bool UdpConnection::popUnreliable(BinaryBuffer& payload)
+{
+    if (deliveredUnreliables.empty()) {
+        return false;
+    }
+
+    payload = std::move(deliveredUnreliables.front());
+    deliveredUnreliables.pop_front();
+    return true;
+}
+
+bool UdpConnection::popNotice(DeliveryNotice& notice)
+{
+    if (notices.empty()) {
+        return false;
+    }
+
+    notice = notices.front();
+    notices.pop_front();
+    return true;
+}
+
+bool UdpConnection::isConnect(std::span<const Uint8> datagram)
+{
+    if (datagram.size() < HEADER_SIZE) {
+        return false;
+    }
+
+    const Uint8* header = datagram.data();
+    Uint8 type = (header[HeaderIndex::Type] & ~HAS_ACKS_FLAG);
+    return (_SDLNet_Read16(&(header[HeaderIndex::ProtocolID])) == PROTOCOL_ID)
+           && (type == static_cast<Uint8>(PacketType::Connect));
+}
+
+bool UdpConnection::hasReceived() const
+{
+    return hasReceivedAny;
+}
+
+double UdpConnection::getRoundTripTime() const
+{
+    return roundTripTimeS;
+}
+
+std::size_t UdpConnection::getUnackedReliableBytes() const
+{
+    return unackedReliableBytes;
+}
+
+std::size_t UdpConnection::getResendCount() const
+{
+    return resendCount;
+}
+
+bool UdpConnection::isNewer(Uint16 a, Uint16 b)
+{
+    return (a != b) && (static_cast<Uint16>(a - b) < 0x8000);
+}
+
+double UdpConnection::getResendInterval() const
+{
+    return std::max(MIN_RESEND_INTERVAL_S, (1.5 * roundTripTimeS));
+}
+
+void UdpConnection::writeDatagram(PacketType type, Uint16 reliableID,
+                                  std::span<const Uint8> payload,
+                                  double currentTimeS,
+                                  std::vector<BinaryBuffer>& datagrams)
+{
+    BinaryBuffer& datagram = datagrams.emplace_back(HEADER_SIZE
+                                                    + payload.size());
+
+    // Fill the header.
+    Uint8 typeByte = static_cast<Uint8>(type);
+    if (hasReceivedAny) {
+        typeByte |= HAS_ACKS_FLAG;
+    }
+    _SDLNet_Write16(PROTOCOL_ID, &(datagram[HeaderIndex::ProtocolID]));
+    datagram[HeaderIndex::Type] = typeByte;
+    _SDLNet_Write16(localSequence, &(datagram[HeaderIndex::Sequence]));
+    _SDLNet_Write16(remoteSequence, &(datagram[HeaderIndex::Ack]));
+    _SDLNet_Write32(receivedBits, &(datagram[HeaderIndex::AckBits]));
+    _SDLNet_Write16(reliableID, &(datagram[HeaderIndex::ReliableID]));
+    std::copy(payload.begin(), payload.end(),
+              (datagram.begin() + HEADER_SIZE));
+
+    // Record it so we can match its ack.
+    SentPacket& sentPacket
+        = sentPackets[localSequence % SENT_PACKET_BUFFER_SIZE];
+    sentPacket.sequence = localSequence;
+    sentPacket.isValid = true;
+    sentPacket.isAcked = false;
+    sentPacket.sendTimeS = currentTimeS;
+    sentPacket.hasReliable = (type == PacketType::Reliable);
+    sentPacket.reliableID = reliableID;
+
+    localSequence++;
+
+    // Every datagram carries our acks.
+    ackIsOwed = false;
+}
+
+void UdpConnection::recordReceived(Uint16 sequence)
+{
+    if (!hasReceivedAny) {
+        remoteSequence = sequence;
+        receivedBits = 0;
+        hasReceivedAny = true;
+    }
+    else if (isNewer(sequence, remoteSequence)) {
+        // Shift the bits up, then mark the old remoteSequence.
+        Uint16 distance = sequence - remoteSequence;
+        if (distance > 32) {
+            receivedBits = 0;
+        }
+        else {
+            receivedBits = (distance == 32) ? 0 : (receivedBits << distance);
+            receivedBits |= (1u << (distance - 1));
+        }
+        remoteSequence = sequence;
+    }
+    else {
+        // An old (or duplicate) sequence number. Mark it if it's in range.
+        Uint16 distance = remoteSequence - sequence;
+        if ((distance >= 1) && (distance <= 32)) {
+            receivedBits |= (1u << (distance - 1));
+        }
+    }
+}
+
+void UdpConnection::processAcks(Uint16 ack, Uint32 ackBits,
+                                double currentTimeS)
+{
+    // Bit n acks (ack - 1 - n). Check ack itself first.
+    for (unsigned int i = 0; i <= 32; ++i) {
+        if ((i > 0) && !(ackBits & (1u << (i - 1)))) {
+            continue;
+        }
+
+        Uint16 sequence = static_cast<Uint16>(ack - i);
+        SentPacket& sentPacket
+            = sentPackets[sequence % SENT_PACKET_BUFFER_SIZE];
+        if (!(sentPacket.isValid) || (sentPacket.sequence != sequence)
+            || sentPacket.isAcked) {
+            continue;
+        }
+        sentPacket.isAcked = true;
+
+        // Update our RTT.
+        double sampleS = currentTimeS - sentPacket.sendTimeS;
+        roundTripTimeS += (RTT_SMOOTHING_FACTOR * (sampleS - roundTripTimeS));
+
+        // If the packet held a reliable payload, it's been delivered.
+        if (sentPacket.hasReliable && !(pendingReliables.empty())) {
+            Uint16 offset = static_cast<Uint16>(
+                sentPacket.reliableID - pendingReliables.front().reliableID);
+            if (offset < pendingReliables.size()) {
+                pendingReliables[offset].isAcked = true;
+            }
+        }
+    }
+
+    // Release the acked payloads from the front of the window.
+    while (!(pendingReliables.empty()) && pendingReliables.front().isAcked) {
+        unackedReliableBytes -= pendingReliables.front().payload.size();
+        pendingReliables.pop_front();
+    }
+
+    // Report on any notified datagrams that were just acked.
+    resolveNotices(currentTimeS);
+}
+
+void UdpConnection::receiveReliable(Uint16 reliableID,
+                                    std::span<const Uint8> payload)
+{
+    // If it's a duplicate of one we've delivered, or too far ahead to hold,
+    // drop it.
+    Uint16 offset = static_cast<Uint16>(reliableID - nextDeliverID);
+    if (offset >= RELIABLE_WINDOW_SIZE) {
+        return;
+    }
+
+    ReceivedReliable& received
+        = receiveWindow[reliableID % RELIABLE_WINDOW_SIZE];
+    if (received.isValid) {
+        return;
+    }
+    received.isValid = true;
+    received.payload.assign(payload.begin(), payload.end());
+
+    // Deliver everything that's now in order.
+    while (receiveWindow[nextDeliverID % RELIABLE_WINDOW_SIZE].isValid) {
+        ReceivedReliable& next
+            = receiveWindow[nextDeliverID % RELIABLE_WINDOW_SIZE];
+        deliveredReliables.push_back(std::move(next.payload));
+        next.payload = BinaryBuffer{};
+        next.isValid = false;
+        nextDeliverID++;
+    }
+}
+
+void UdpConnection::resolveNotices(double currentTimeS)
+{
+    // Notices are produced in send order, so stop at the first datagram
+    // that's still in flight.
+    double timeoutS = NOTICE_TIMEOUT_INTERVALS * getResendInterval();
+    while (!(unresolvedNotifieds.empty())) {
+        const UnresolvedNotified& notified = unresolvedNotifieds.front();
+        const SentPacket& sentPacket
+            = sentPackets[notified.sequence % SENT_PACKET_BUFFER_SIZE];
+
+        // Note: If its record was overwritten, its ack can no longer be
+        //       matched, so we treat it as lost.
+        bool wasOverwritten = (!(sentPacket.isValid)
+                               || (sentPacket.sequence != notified.sequence));
+        if (!wasOverwritten && sentPacket.isAcked) {
+            notices.push_back({notified.notifyToken, true});
+        }
+        else if (wasOverwritten
+                 || ((currentTimeS - sentPacket.sendTimeS) > timeoutS)) {
+            notices.push_back({notified.notifyToken, false});
+        }
+        else {
+            break;
+        }
+
+        unresolvedNotifieds.pop_front();
+    }
+}
+
+} // End namespace AM
@@ -0,0 +1,95 @@
+#include "UdpHost.h"
+#include "UdpConnection.h"
+#include "Log.h"
+#include <algorithm>
+
+namespace AM
+{
+UdpHost::UdpHost(Uint16 port)
+: socket(std::make_shared<UdpSocket>(port))
+, receivedDatagrams(UdpSocket::MAX_BATCH_SIZE)
+{
+}
+
+const std::vector<UdpPeer*>& UdpHost::receive(unsigned int timeoutMs)
+{
+    // Note: readyPeers may hold peers that were accepted since the last call,
+    //       so that any data that came with their Connect is received.
+    int numReceived = socket->receiveBatch(receivedDatagrams);
+    if ((numReceived == 0) && readyPeers.empty()
+        && socket->waitForData(timeoutMs)) {
+        numReceived = socket->receiveBatch(receivedDatagrams);
+    }
+
+    while (numReceived > 0) {
+        for (int i = 0; i < numReceived; ++i) {
+            UdpSocket::ReceivedDatagram& datagram = receivedDatagrams[i];
+            std::span<const Uint8> data{datagram.data.data(), datagram.size};
+
+            // If the sender has a peer, hand the datagram to it.
+            auto peerIt = peers.find(getAddressKey(datagram.address));
+            if (peerIt != peers.end()) {
+                peerIt->second->receiveDatagram(data);
+                readyPeers.push_back(peerIt->second);
+                continue;
+            }
+
+            // If it's a new connection, make a peer for it.
+            if (UdpConnection::isConnect(data)
+                && (pendingPeers.size() < MAX_PENDING_PEERS)) {
+                std::unique_ptr<UdpPeer> peer = std::make_unique<UdpPeer>(
+                    datagram.address, socket, weak_from_this());
+                peer->receiveDatagram(data);
+                peers.emplace(getAddressKey(datagram.address), peer.get());
+                pendingPeers.push_back(std::move(peer));
+            }
+        }
+
+        numReceived = socket->receiveBatch(receivedDatagrams);
+    }
+
+    // Remove any duplicates.
+    std::sort(readyPeers.begin(), readyPeers.end());
+    readyPeers.erase(std::unique(readyPeers.begin(), readyPeers.end()),
+                     readyPeers.end());
+
+    // Hand them out, and start collecting the next batch.
+    returnedPeers.swap(readyPeers);
+    readyPeers.clear();
+
+    return returnedPeers;
+}
+
+std::unique_ptr<UdpPeer> UdpHost::accept()
+{
+    if (pendingPeers.empty()) {
+        return nullptr;
+    }
+
+    std::unique_ptr<UdpPeer> peer = std::move(pendingPeers.front());
+    pendingPeers.erase(pendingPeers.begin());
+
+    // Report it as ready, in case it has already received data.
+    readyPeers.push_back(peer.get());
+
+    return peer;
+}
+
+void UdpHost::unregisterPeer(const IPaddress& address)
+{
+    auto peerIt = peers.find(getAddressKey(address));
+    if (peerIt == peers.end()) {
+        return;
+    }
+
+    std::erase(readyPeers, peerIt->second);
+    std::erase(returnedPeers, peerIt->second);
+    peers.erase(peerIt);
+}
+
+Uint64 UdpHost::getAddressKey(const IPaddress& address)
+{
+    return ((static_cast<Uint64>(address.host) << 16) | address.port);
+}
+
+} // End namespace AM
@@ -0,0 +1,478 @@
+#include "UdpPeer.h"
+#include "UdpHost.h"
+#include <SDL2/SDL_net.h>
+#include <algorithm>
+#include "Log.h"
+
+namespace AM
+{
+// Each frame of a server batch is sent as a single datagram.
+static_assert((SERVER_HEADER_SIZE + Peer::MAX_MESSAGE_SIZE)
+                  <= UdpConnection::MAX_PAYLOAD_SIZE,
+              "A frame with a max size message must fit in a datagram.");
+
+std::unique_ptr<UdpPeer> UdpPeer::initiate(std::string serverIP,
+                                           unsigned int serverPort)
+{
+    IPaddress address;
+    if (SDLNet_ResolveHost(&address, serverIP.c_str(), serverPort) == -1) {
+        LOG_ERROR("Could not resolve host: %s", SDLNet_GetError());
+    }
+
+    // Bind to an ephemeral port, we only talk to the server.
+    std::shared_ptr<UdpSocket> socket = std::make_shared<UdpSocket>(0);
+    std::unique_ptr<UdpPeer> peer
+        = std::make_unique<UdpPeer>(address, socket, std::weak_ptr<UdpHost>{});
+
+    // Send our first Connect datagram.
+    peer->flushPendingOutput();
+
+    return peer;
+}
+
+UdpPeer::UdpPeer(const IPaddress& inAddress,
+                 std::shared_ptr<UdpSocket> inSocket,
+                 std::weak_ptr<UdpHost> inHost)
+: address(inAddress)
+, socket(std::move(inSocket))
+, host(std::move(inHost))
+, isInitiator(host.expired())
+, lastReceiveTimeS(0)
+, lastConnectTimeS(-CONNECT_RESEND_INTERVAL_S)
+, bIsConnected(true)
+, payloadBuffer()
+, receiveBuffer(RECEIVE_BUFFER_SIZE)
+, receiveState(ReceiveState::Header)
+, pendingMessageType(MessageType::NotSet)
+, pendingMessageSize(0)
+{
+    clock.updateSavedTime();
+    payloadBuffer.reserve(UdpConnection::MAX_PAYLOAD_SIZE);
+    if (isInitiator) {
+        receivedDatagrams.resize(UdpSocket::MAX_BATCH_SIZE);
+    }
+}
+
+UdpPeer::~UdpPeer()
+{
+    if (std::shared_ptr<UdpHost> sharedHost = host.lock()) {
+        sharedHost->unregisterPeer(address);
+    }
+}
+
+void UdpPeer::receiveDatagram(std::span<const Uint8> datagram)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    double currentTimeS = clock.getDeltaSeconds(false);
+    if (connection.processDatagram(datagram, currentTimeS)) {
+        lastReceiveTimeS = currentTimeS;
+    }
+}
+
+const IPaddress& UdpPeer::getAddress() const
+{
+    return address;
+}
+
+double UdpPeer::getRoundTripTime() const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return connection.getRoundTripTime();
+}
+
+bool UdpPeer::isConnected() const
+{
+    return bIsConnected;
+}
+
+NetworkResult UdpPeer::send(const Uint8* messageBuffer,
+                            unsigned int messageSize)
+{
+    if (messageSize > MAX_MESSAGE_SIZE) {
+        LOG_ERROR("Tried to send a too-large message. Size: %u, max: %u",
+                  messageSize, MAX_MESSAGE_SIZE);
+    }
+
+    std::span<const Uint8> buffer{messageBuffer, messageSize};
+    return sendNonBlocking({&buffer, 1});
+}
+
+NetworkResult UdpPeer::sendUnreliable(const BinaryBufferSharedPtr& message)
+{
+    if (message->size() > UdpConnection::MAX_PAYLOAD_SIZE) {
+        LOG_ERROR("Tried to send a too-large unreliable message. Size: %u, "
+                  "max: %u",
+                  message->size(), UdpConnection::MAX_PAYLOAD_SIZE);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!bIsConnected) {
+        return NetworkResult::Disconnected;
+    }
+
+    connection.queue(Channel::Unreliable, *message);
+    return flush();
+}
+
+NetworkResult
+    UdpPeer::sendUnreliable(std::span<const std::span<const Uint8>> buffers,
+                            Uint32 notifyToken)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!bIsConnected) {
+        return NetworkResult::Disconnected;
+    }
+
+    // Gather the buffers into a single payload.
+    payloadBuffer.clear();
+    for (const std::span<const Uint8>& buffer : buffers) {
+        payloadBuffer.insert(payloadBuffer.end(), buffer.begin(),
+                             buffer.end());
+    }
+    if (payloadBuffer.size() > UdpConnection::MAX_PAYLOAD_SIZE) {
+        LOG_ERROR("Tried to send a too-large unreliable frame. Size: %u, "
+                  "max: %u",
+                  payloadBuffer.size(), UdpConnection::MAX_PAYLOAD_SIZE);
+    }
+
+    connection.queueNotified(payloadBuffer, notifyToken);
+    return flush();
+}
+
+bool UdpPeer::popDeliveryNotice(DeliveryNotice& notice)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return connection.popNotice(notice);
+}
+
+NetworkResult
+    UdpPeer::sendNonBlocking(std::span<const std::span<const Uint8>> buffers)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!bIsConnected) {
+        return NetworkResult::Disconnected;
+    }
+
+    return sendReliable(buffers);
+}
+
+NetworkResult UdpPeer::flushPendingOutput()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!bIsConnected) {
+        return NetworkResult::Disconnected;
+    }
+
+    return flush();
+}
+
+std::size_t UdpPeer::getPendingOutputSize() const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return connection.getUnackedReliableBytes();
+}
+
+MessageResult UdpPeer::receiveMessage(BinaryBufferPtr& messageBuffer,
+                                      Uint8* prefixBuffer,
+                                      unsigned int prefixSize)
+{
+    // If we own our socket, receive whatever is waiting.
+    if (isInitiator) {
+        pumpSocket(0);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // Unreliable messages are always complete, so return them first.
+    MessageResult result
+        = popUnreliableMessage(messageBuffer, prefixBuffer, prefixSize);
+    if (result.networkResult == NetworkResult::Success) {
+        return result;
+    }
+
+    // Try to pop a reliable message.
+    fillReceiveBuffer();
+    result = popBufferedMessage(messageBuffer, prefixBuffer, prefixSize);
+    if ((result.networkResult != NetworkResult::Success) && !bIsConnected) {
+        return {NetworkResult::Disconnected};
+    }
+
+    return result;
+}
+
+NetworkResult UdpPeer::receiveBytesWait(Uint8* messageBuffer, Uint16 numBytes)
+{
+    if (!isInitiator) {
+        LOG_ERROR("Blocking receives are only supported on the initiating "
+                  "side.");
+    }
+    else if (numBytes > MAX_MESSAGE_SIZE) {
+        LOG_ERROR("Tried to receive too large of a message. messageSize: %u, "
+                  "MaxSize: %u",
+                  numBytes, MAX_MESSAGE_SIZE);
+    }
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            fillReceiveBuffer();
+            if (receiveBuffer.size() >= numBytes) {
+                receiveBuffer.read(messageBuffer, numBytes);
+                return NetworkResult::Success;
+            }
+            else if (!bIsConnected) {
+                return NetworkResult::Disconnected;
+            }
+        }
+
+        // Wait for more data.
+        pumpSocket(SOCKET_WAIT_TIMEOUT_MS);
+    }
+}
+
+NetworkResult UdpPeer::receiveUnreliable(BinaryBuffer& datagram,
+                                         unsigned int timeoutMs)
+{
+    if (!isInitiator) {
+        LOG_ERROR("Blocking receives are only supported on the initiating "
+                  "side.");
+    }
+
+    // Return any datagram that was already delivered, else wait for one.
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (connection.popUnreliable(datagram)) {
+            return NetworkResult::Success;
+        }
+    }
+    pumpSocket(timeoutMs);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if (connection.popUnreliable(datagram)) {
+        return NetworkResult::Success;
+    }
+    else if (!bIsConnected) {
+        return NetworkResult::Disconnected;
+    }
+
+    return NetworkResult::NoWaitingData;
+}
+
+NetworkResult
+    UdpPeer::sendReliable(std::span<const std::span<const Uint8>> buffers)
+{
+    // Gather the buffers into as few payloads as possible.
+    payloadBuffer.clear();
+    bool windowIsFull = false;
+    for (const std::span<const Uint8>& buffer : buffers) {
+        std::size_t bytesQueued = 0;
+        while (bytesQueued < buffer.size()) {
+            std::size_t bytesToCopy = std::min(
+                (buffer.size() - bytesQueued),
+                (UdpConnection::MAX_PAYLOAD_SIZE - payloadBuffer.size()));
+            payloadBuffer.insert(payloadBuffer.end(),
+                                 (buffer.begin() + bytesQueued),
+                                 (buffer.begin() + bytesQueued + bytesToCopy));
+            bytesQueued += bytesToCopy;
+
+            if (payloadBuffer.size() == UdpConnection::MAX_PAYLOAD_SIZE) {
+                windowIsFull
+                    |= !(connection.queue(Channel::Reliable, payloadBuffer));
+                payloadBuffer.clear();
+            }
+        }
+    }
+    if (!(payloadBuffer.empty())) {
+        windowIsFull |= !(connection.queue(Channel::Reliable, payloadBuffer));
+    }
+
+    // If the other side isn't acking our data, drop it.
+    if (windowIsFull
+        || (connection.getUnackedReliableBytes() > MAX_PENDING_OUTPUT_SIZE)) {
+        disconnect("Peer isn't acking our sends, dropping it.");
+        return NetworkResult::Disconnected;
+    }
+
+    return flush();
+}
+
+NetworkResult UdpPeer::flush()
+{
+    double currentTimeS = clock.getDeltaSeconds(false);
+
+    // If we're initiating and haven't heard back yet, keep knocking.
+    outgoingDatagrams.clear();
+    if (isInitiator && !(connection.hasReceived())
+        && ((currentTimeS - lastConnectTimeS) >= CONNECT_RESEND_INTERVAL_S)) {
+        connection.writeConnect(currentTimeS, outgoingDatagrams);
+        lastConnectTimeS = currentTimeS;
+    }
+
+    connection.writeDatagrams(currentTimeS, outgoingDatagrams);
+    if (outgoingDatagrams.empty()) {
+        return NetworkResult::Success;
+    }
+
+    // Send the datagrams.
+    // Note: If the socket's buffer is full, the rest are dropped. Any
+    //       reliable data in them will be resent.
+    outgoingViews.clear();
+    for (const BinaryBuffer& datagram : outgoingDatagrams) {
+        outgoingViews.emplace_back(datagram);
+    }
+    if (socket->sendBatch(address, outgoingViews) < 0) {
+        disconnect("Datagram send failed.");
+        return NetworkResult::Disconnected;
+    }
+
+    return NetworkResult::Success;
+}
+
+void UdpPeer::pumpSocket(unsigned int timeoutMs)
+{
+    if (timeoutMs > 0) {
+        socket->waitForData(timeoutMs);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    double currentTimeS = clock.getDeltaSeconds(false);
+
+    // Process everything that's waiting.
+    int numReceived = socket->receiveBatch(receivedDatagrams);
+    while (numReceived > 0) {
+        for (int i = 0; i < numReceived; ++i) {
+            // Ignore anything that didn't come from the other side.
+            UdpSocket::ReceivedDatagram& datagram = receivedDatagrams[i];
+            if ((datagram.address.host != address.host)
+                || (datagram.address.port != address.port)) {
+                continue;
+            }
+
+            if (connection.processDatagram({datagram.data.data(),
+                                            datagram.size},
+                                           currentTimeS)) {
+                lastReceiveTimeS = currentTimeS;
+            }
+        }
+
+        numReceived = socket->receiveBatch(receivedDatagrams);
+    }
+
+    // If we haven't heard from the other side in too long, give up on it.
+    if ((currentTimeS - lastReceiveTimeS) > TIMEOUT_S) {
+        disconnect("Timed out waiting for datagrams.");
+        return;
+    }
+
+    // Send any acks that we owe (and anything else that's due).
+    if (bIsConnected) {
+        flush();
+    }
+}
+
+void UdpPeer::fillReceiveBuffer()
+{
+    std::size_t payloadSize = connection.peekReliableSize();
+    while ((payloadSize > 0) && (payloadSize <= receiveBuffer.getFreeSpace())) {
+        connection.popReliable(payloadBuffer);
+        receiveBuffer.write(payloadBuffer.data(), payloadBuffer.size());
+
+        payloadSize = connection.peekReliableSize();
+    }
+}
+
+MessageResult UdpPeer::popBufferedMessage(BinaryBufferPtr& messageBuffer,
+                                          Uint8* prefixBuffer,
+                                          unsigned int prefixSize)
+{
+    if (receiveState == ReceiveState::Header) {
+        // Wait until we have the full prefix and message header.
+        if (receiveBuffer.size() < (prefixSize + MESSAGE_HEADER_SIZE)) {
+            return {NetworkResult::NoWaitingData};
+        }
+
+        // Parse the message header.
+        Uint8 headerBuf[MESSAGE_HEADER_SIZE];
+        receiveBuffer.peek(headerBuf, MESSAGE_HEADER_SIZE, prefixSize);
+        pendingMessageType = static_cast<MessageType>(
+            headerBuf[MessageHeaderIndex::MessageType]);
+        pendingMessageSize
+            = _SDLNet_Read16(&(headerBuf[MessageHeaderIndex::Size]));
+        // Note: The size came from the remote, so a bad one means the
+        //       remote is misbehaving. Drop it rather than crashing.
+        if (pendingMessageSize > MAX_MESSAGE_SIZE) {
+            LOG_INFO("Received too large of a message size, disconnecting. "
+                     "messageSize: %u, MaxSize: %u",
+                     pendingMessageSize, MAX_MESSAGE_SIZE);
+            bIsConnected = false;
+            return {NetworkResult::Disconnected};
+        }
+
+        receiveState = ReceiveState::Payload;
+    }
+
+    // Wait until we have the full message.
+    std::size_t frameSize
+        = prefixSize + MESSAGE_HEADER_SIZE + pendingMessageSize;
+    if (receiveBuffer.size() < frameSize) {
+        return {NetworkResult::NoWaitingData};
+    }
+
+    // Pop the message.
+    if (prefixSize > 0) {
+        receiveBuffer.read(prefixBuffer, prefixSize);
+    }
+    receiveBuffer.discard(MESSAGE_HEADER_SIZE);
+    messageBuffer = std::make_unique<BinaryBuffer>(pendingMessageSize);
+    receiveBuffer.read(messageBuffer->data(), pendingMessageSize);
+
+    receiveState = ReceiveState::Header;
+    return {NetworkResult::Success, pendingMessageType, pendingMessageSize};
+}
+
+MessageResult UdpPeer::popUnreliableMessage(BinaryBufferPtr& messageBuffer,
+                                            Uint8* prefixBuffer,
+                                            unsigned int prefixSize)
+{
+    // Note: payloadBuffer is free, so we reuse it to hold the datagrams.
+    BinaryBuffer& datagram = payloadBuffer;
+    while (connection.popUnreliable(datagram)) {
+        // Each unreliable datagram should hold exactly one complete frame.
+        // Drop any that don't.
+        if (datagram.size() < (prefixSize + MESSAGE_HEADER_SIZE)) {
+            continue;
+        }
+        Uint8* header = &(datagram[prefixSize]);
+        MessageType messageType
+            = static_cast<MessageType>(header[MessageHeaderIndex::MessageType]);
+        Uint16 messageSize
+            = _SDLNet_Read16(&(header[MessageHeaderIndex::Size]));
+        std::size_t frameSize = prefixSize + MESSAGE_HEADER_SIZE + messageSize;
+        if (datagram.size() != frameSize) {
+            continue;
+        }
+
+        // Pop the message.
+        if (prefixSize > 0) {
+            std::copy_n(datagram.begin(), prefixSize, prefixBuffer);
+        }
+        messageBuffer = std::make_unique<BinaryBuffer>(
+            (datagram.begin() + prefixSize + MESSAGE_HEADER_SIZE),
+            datagram.end());
+
+        return {NetworkResult::Success, messageType, messageSize};
+    }
+
+    return {NetworkResult::NoWaitingData};
+}
+
+void UdpPeer::disconnect(const char* reason)
+{
+    if (bIsConnected) {
+        LOG_INFO("%s", reason);
+        bIsConnected = false;
+    }
+}
+
+} // End namespace AM
@@ -0,0 +1,210 @@
+#include "UdpSocket.h"
+#include "NetworkStats.h"
+#include "Log.h"
+#if defined(__linux__)
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#endif
+
+namespace AM
+{
+UdpSocket::UdpSocket(Uint16 inPort)
+#if defined(__linux__)
+: fileDescriptor(-1)
+{
+    fileDescriptor = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (fileDescriptor == -1) {
+        LOG_ERROR("Could not open UDP socket: %s", strerror(errno));
+    }
+
+    // Note: Port 0 binds to an ephemeral port, like SDLNet_UDP_Open().
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(inPort);
+    if (bind(fileDescriptor, reinterpret_cast<sockaddr*>(&address),
+             sizeof(address))
+        == -1) {
+        LOG_ERROR("Could not open UDP socket: %s", strerror(errno));
+    }
+
+    int flags = fcntl(fileDescriptor, F_GETFL, 0);
+    fcntl(fileDescriptor, F_SETFL, (flags | O_NONBLOCK));
+}
+#else
+: socket(nullptr)
+, set(nullptr)
+{
+    socket = SDLNet_UDP_Open(inPort);
+    if (socket == nullptr) {
+        LOG_ERROR("Could not open UDP socket: %s", SDLNet_GetError());
+    }
+
+    set = SDLNet_AllocSocketSet(1);
+    if (set == nullptr) {
+        LOG_ERROR("Error allocating socket set: %s", SDLNet_GetError());
+    }
+    SDLNet_UDP_AddSocket(set, socket);
+
+    packet = SDLNet_AllocPacket(MAX_DATAGRAM_SIZE);
+    if (packet == nullptr) {
+        LOG_ERROR("Error allocating packet: %s", SDLNet_GetError());
+    }
+}
+#endif
+
+UdpSocket::~UdpSocket()
+{
+#if defined(__linux__)
+    close(fileDescriptor);
+#else
+    SDLNet_FreePacket(packet);
+    SDLNet_UDP_DelSocket(set, socket);
+    SDLNet_FreeSocketSet(set);
+    SDLNet_UDP_Close(socket);
+#endif
+}
+
+int UdpSocket::sendBatch(const IPaddress& address,
+                         std::span<const std::span<const Uint8>> datagrams)
+{
+#if defined(__linux__)
+    // Note: IPaddress is already in network byte order.
+    sockaddr_in destination{};
+    destination.sin_family = AF_INET;
+    destination.sin_addr.s_addr = address.host;
+    destination.sin_port = address.port;
+
+    std::array<iovec, MAX_BATCH_SIZE> iovecs;
+    std::array<mmsghdr, MAX_BATCH_SIZE> headers;
+
+    // Send in batches of up to MAX_BATCH_SIZE.
+    std::size_t totalSent = 0;
+    while (totalSent < datagrams.size()) {
+        std::size_t batchSize
+            = std::min((datagrams.size() - totalSent), MAX_BATCH_SIZE);
+        for (std::size_t i = 0; i < batchSize; ++i) {
+            const std::span<const Uint8>& datagram = datagrams[totalSent + i];
+            iovecs[i].iov_base = const_cast<Uint8*>(datagram.data());
+            iovecs[i].iov_len = datagram.size();
+
+            headers[i] = {};
+            headers[i].msg_hdr.msg_name = &destination;
+            headers[i].msg_hdr.msg_namelen = sizeof(destination);
+            headers[i].msg_hdr.msg_iov = &(iovecs[i]);
+            headers[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int result = sendmmsg(fileDescriptor, headers.data(),
+                              static_cast<unsigned int>(batchSize),
+                              MSG_DONTWAIT);
+        NetworkStats::recordSocketSyscalls(1);
+        if (result < 0) {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK)
+                || (errno == EINTR)) {
+                // Send buffer is full.
+                break;
+            }
+            return -1;
+        }
+
+        totalSent += result;
+        if (static_cast<std::size_t>(result) < batchSize) {
+            // Send buffer is full.
+            break;
+        }
+    }
+
+    return static_cast<int>(totalSent);
+#else
+    std::unique_lock<std::mutex> lock(packetMutex);
+
+    int totalSent = 0;
+    for (const std::span<const Uint8>& datagram : datagrams) {
+        std::copy(datagram.begin(), datagram.end(), packet->data);
+        packet->len = static_cast<int>(datagram.size());
+        packet->address = address;
+        if (SDLNet_UDP_Send(socket, -1, packet) == 0) {
+            break;
+        }
+
+        totalSent++;
+    }
+
+    return totalSent;
+#endif
+}
+
+int UdpSocket::receiveBatch(std::span<ReceivedDatagram> datagrams)
+{
+#if defined(__linux__)
+    std::size_t batchSize = std::min(datagrams.size(), MAX_BATCH_SIZE);
+    std::array<iovec, MAX_BATCH_SIZE> iovecs;
+    std::array<sockaddr_in, MAX_BATCH_SIZE> sources;
+    std::array<mmsghdr, MAX_BATCH_SIZE> headers;
+    for (std::size_t i = 0; i < batchSize; ++i) {
+        iovecs[i].iov_base = datagrams[i].data.data();
+        iovecs[i].iov_len = MAX_DATAGRAM_SIZE;
+
+        headers[i] = {};
+        headers[i].msg_hdr.msg_name = &(sources[i]);
+        headers[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        headers[i].msg_hdr.msg_iov = &(iovecs[i]);
+        headers[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int result = recvmmsg(fileDescriptor, headers.data(),
+                          static_cast<unsigned int>(batchSize), MSG_DONTWAIT,
+                          nullptr);
+    NetworkStats::recordSocketSyscalls(1);
+    if (result < 0) {
+        // Nothing was waiting (or the receive failed, which for UDP only
+        // means that this attempt didn't get anything).
+        return 0;
+    }
+
+    for (int i = 0; i < result; ++i) {
+        datagrams[i].address.host = sources[i].sin_addr.s_addr;
+        datagrams[i].address.port = sources[i].sin_port;
+        datagrams[i].size = static_cast<Uint16>(headers[i].msg_len);
+    }
+
+    return result;
+#else
+    std::unique_lock<std::mutex> lock(packetMutex);
+
+    int totalReceived = 0;
+    for (ReceivedDatagram& datagram : datagrams) {
+        if (SDLNet_UDP_Recv(socket, packet) <= 0) {
+            break;
+        }
+
+        std::copy(packet->data, (packet->data + packet->len),
+                  datagram.data.begin());
+        datagram.size = static_cast<Uint16>(packet->len);
+        datagram.address = packet->address;
+        totalReceived++;
+    }
+
+    return totalReceived;
+#endif
+}
+
+bool UdpSocket::waitForData(unsigned int timeoutMs)
+{
+    NetworkStats::recordSocketSyscalls(1);
+#if defined(__linux__)
+    pollfd pollFd{fileDescriptor, POLLIN, 0};
+    return (poll(&pollFd, 1, static_cast<int>(timeoutMs)) > 0);
+#else
+    return (SDLNet_CheckSockets(set, timeoutMs) > 0);
+#endif
+}
+
+} // End namespace AM
@@ -1,7 +1,7 @@
 #ifndef ACCEPTOR_H_
 #define ACCEPTOR_H_
 
-#include "Peer.h"
+#include "TcpPeer.h"
 #include "SocketSet.h"
 #include "TcpSocket.h"
 #include <SDL2/SDL_net.h>
@@ -23,7 +23,7 @@ public:
 
     ~Acceptor();
 
-    std::unique_ptr<Peer> accept();
+    std::unique_ptr<TcpPeer> accept();
 
 private:
     /** Our listener socket. */
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <SDL_stdinc.h>
+#include <vector>
+#include <cstddef>
+
+namespace AM
+{
+/**
+ * A fixed-capacity FIFO of bytes.
+ *
+ * Used to accumulate received bytes across multiple reads, until a complete
+ * message is available. The write side exposes its contiguous free space, so
+ * the socket can receive directly into the buffer.
+ *
+ * Not thread safe.
+ */
+class ByteRingBuffer
+{
+public:
+    /**
+     * @param inCapacity  The max number of bytes this buffer can hold. Must
+     *                    be a power of 2.
+     */
+    ByteRingBuffer(std::size_t inCapacity);
+
+    /**
+     * Returns the number of bytes currently held in the buffer.
+     */
+    std::size_t size() const;
+
+    /**
+     * Returns the number of bytes that can be written before the buffer is
+     * full.
+     */
+    std::size_t getFreeSpace() const;
+
+    /**
+     * Returns a pointer to the start of the free space, for writing into.
+     * Only getContiguousFreeSpace() bytes may be written at this pointer.
+     * Call commitWrite() after writing.
+     */
+    Uint8* getWritePtr();
+
+    /**
+     * Returns the number of free bytes that follow getWritePtr() without
+     * wrapping around.
+     */
+    std::size_t getContiguousFreeSpace() const;
+
+    /**
+     * Marks numBytes bytes at getWritePtr() as written.
+     */
+    void commitWrite(std::size_t numBytes);
+
+    /**
+     * Copies numBytes bytes from the given source onto the back of the
+     * buffer.
+     * Errors if the buffer doesn't have enough free space.
+     */
+    void write(const Uint8* source, std::size_t numBytes);
+
+    /**
+     * Copies numBytes bytes, starting offset bytes from the front of the
+     * buffer, into the given destination without removing them.
+     * Errors if the buffer doesn't hold enough bytes.
+     */
+    void peek(Uint8* destination, std::size_t numBytes,
+              std::size_t offset = 0) const;
+
+    /**
+     * Copies numBytes bytes from the front of the buffer into the given
+     * destination and removes them.
+     * Errors if the buffer doesn't hold enough bytes.
+     */
+    void read(Uint8* destination, std::size_t numBytes);
+
+    /**
+     * Removes numBytes bytes from the front of the buffer.
+     * Errors if the buffer doesn't hold enough bytes.
+     */
+    void discard(std::size_t numBytes);
+
+private:
+    std::vector<Uint8> buffer;
+
+    /** Used to wrap our indices, since the capacity is a power of 2. */
+    const std::size_t indexMask;
+
+    /** The total number of bytes that have been read. Masked to index. */
+    std::size_t readCount;
+
+    /** The total number of bytes that have been written. Masked to index. */
+    std::size_t writeCount;
+};
+
+} // End namespace AM
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "NetworkDefs.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace AM
+{
+/** Used to pass data out to the consumer. */
+struct BufferPoolStatsDump {
+    /** The number of acquired buffers that were reused from the pool. */
+    unsigned int hits = 0;
+    /** The number of acquired buffers that had to be newly allocated. */
+    unsigned int misses = 0;
+};
+
+/**
+ * A thread-safe pool of message buffers.
+ *
+ * Buffers are handed out as regular shared pointers. When the last reference
+ * is released (typically when the last Client's send queue lets go of a
+ * broadcast message), the buffer returns to the pool with its capacity intact.
+ * The shared pointer control blocks are pooled as well, so once the pool has
+ * warmed up, acquiring a buffer doesn't touch the heap.
+ *
+ * Note: This is a static class for the same reason as NetworkStats. Buffers
+ *       are acquired from deep within the sim and released from the network
+ *       threads, so injecting it would be very inconvenient.
+ */
+class MessageBufferPool
+{
+public:
+    /** The most unused buffers we'll hold on to. Any further buffers that are
+        released will be freed. */
+    static constexpr std::size_t MAX_POOLED_BUFFERS = 4096;
+
+    /**
+     * Returns a buffer with a size of Peer::MAX_MESSAGE_SIZE.
+     * The buffer's contents are unspecified.
+     */
+    static BinaryBufferSharedPtr acquire();
+
+    /**
+     * Dumps the pool's stats to the returned object, resetting the current
+     * values.
+     */
+    static BufferPoolStatsDump dumpStats();
+
+private:
+    /** Returns released buffers to the pool. Used as the shared_ptr
+        deleter. */
+    struct Releaser {
+        void operator()(BinaryBuffer* buffer) const;
+    };
+
+    /** Holds buffers that are ready to be reused. */
+    static std::vector<BinaryBuffer*> freeBuffers;
+
+    /** Used to lock access to freeBuffers. */
+    static std::mutex freeBuffersMutex;
+
+    /** The number of hits since the last dump. */
+    static std::atomic<unsigned int> hits;
+
+    /** The number of misses since the last dump. */
+    static std::atomic<unsigned int> misses;
+};
+
+} // End namespace AM
@@ -13,8 +13,8 @@ namespace AM
 //--------------------------------------------------------------------------
 // Typedefs
 //--------------------------------------------------------------------------
-/** Represents a single network client. Will be reused if the client
- * disconnects. */
+/** Represents a single network client. The server tags each ID with a
+ * generation, so a disconnected client's ID won't be reused as-is. */
 typedef Uint32 NetworkID;
 
 /** Dynamically allocated, portable buffers for messages. */
@@ -36,10 +36,13 @@ struct ServerHeaderIndex {
         AdjustmentIteration = 1,
         /** Uint8, the number of messages in this batch. */
         MessageCount = 2,
-        /** Uint8, the number of ticks that have passed with no update. */
-        ConfirmedTickCount = 3,
+        /** Uint32, the latest tick that the client has been sent all of the
+            updates for, or 0 if this frame doesn't confirm any ticks.
+            Absolute, so that a lost frame's confirmation is covered by the
+            next one. */
+        ConfirmedTick = 3,
         /** The start of the first message header if one is present. */
-        MessageHeaderStart = 4
+        MessageHeaderStart = 7
     };
 };
 /** The size of a server header in bytes. */
@@ -102,6 +105,35 @@ enum class MessageType : Uint8 {
     Heartbeat = 4,
 };
 
+/** The transport protocols that a connection can use. Both sides must use
+    the same transport. */
+enum class Transport {
+    /** A TCP stream. Everything is reliable and ordered. */
+    Tcp,
+    /** UDP datagrams, with our own sequencing and acks. Lets unreliable data
+        skip past lost packets instead of waiting for them. */
+    Udp
+};
+
+/** The delivery guarantees that a message can be sent with. */
+enum class Channel : Uint8 {
+    /** Resent until acknowledged, and delivered in order. */
+    Reliable,
+    /** Sent once. Delivered only if it arrives after any newer unreliable
+        data, so stale data is dropped instead of delaying fresh data.
+        On TCP, this is the same as Reliable. */
+    Unreliable
+};
+
+/** Reports whether a datagram that was sent with a notify token reached the
+    other side. See Peer::sendUnreliable(). */
+struct DeliveryNotice {
+    /** The token that the datagram was sent with. */
+    Uint32 notifyToken = 0;
+    /** true if the datagram was acked, false if it was presumed lost. */
+    bool wasDelivered = false;
+};
+
 /** Represents the result of trying to receive a message. */
 struct MessageResult {
     NetworkResult networkResult = NetworkResult::NotSet;
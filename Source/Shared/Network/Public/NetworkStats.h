@@ -1,5 +1,8 @@
 #pragma once
 
+#include "NetworkDefs.h"
+#include <SDL_stdinc.h>
+#include <array>
 #include <atomic>
 
 namespace AM
@@ -8,8 +11,37 @@ namespace AM
 struct NetStatsDump {
     unsigned int bytesSent = 0;
     unsigned int bytesReceived = 0;
+
+    /** The number of send times that were recorded. */
+    unsigned int sendCount = 0;
+    /** The average time in seconds that it took to send a tick's data. */
+    double averageSendTime = 0;
+    /** The longest time in seconds that it took to send a tick's data. */
+    double maxSendTime = 0;
+
+    /** The number of socket-related system calls that were made. */
+    unsigned int socketSyscalls = 0;
+};
+
+/** The number of MessageType values, including NotSet.
+    Must be updated if a MessageType is added. */
+static constexpr std::size_t MESSAGE_TYPE_COUNT
+    = static_cast<std::size_t>(MessageType::Heartbeat) + 1;
+
+/** The totals for a single MessageType. */
+struct MessageTypeStats {
+    Uint64 messagesSent = 0;
+    Uint64 bytesSent = 0;
+    Uint64 messagesReceived = 0;
+    Uint64 bytesReceived = 0;
+    /** The number of received messages that were dropped instead of being
+        processed. */
+    Uint64 messagesDropped = 0;
 };
 
+/** MessageTypeStats for every MessageType, indexed by MessageType. */
+typedef std::array<MessageTypeStats, MESSAGE_TYPE_COUNT> MessageTypeStatsArr;
+
 /**
  * This class is used for tracking relevant network statistics.
  *
@@ -35,13 +67,79 @@ public:
     static void recordBytesSent(unsigned int inBytesSent);
     /** Adds inBytesReceived to bytesReceived. */
     static void recordBytesReceived(unsigned int inBytesReceived);
+    /** Records how long it took to send all of a tick's data. */
+    static void recordSendTime(double sendTimeS);
+    /** Adds count to socketSyscalls. Called wherever we make a socket send,
+        receive, or poll system call. */
+    static void recordSocketSyscalls(unsigned int count);
+
+    /** Records a message of the given type and size being sent. */
+    static void recordMessageSent(MessageType messageType, std::size_t bytes);
+    /** Records a message of the given type and size being received. */
+    static void recordMessageReceived(MessageType messageType,
+                                      std::size_t bytes);
+    /** Records a received message of the given type being dropped. */
+    static void recordMessageDropped(MessageType messageType);
+
+    /**
+     * Returns the totals for each MessageType, since the app started.
+     * Unlike dumpStats(), doesn't reset anything.
+     */
+    static MessageTypeStatsArr getMessageTypeStats();
 
 private:
+    /** The counters for a single MessageType. */
+    struct MessageTypeCounters {
+        std::atomic<Uint64> messagesSent{0};
+        std::atomic<Uint64> bytesSent{0};
+        std::atomic<Uint64> messagesReceived{0};
+        std::atomic<Uint64> bytesReceived{0};
+        std::atomic<Uint64> messagesDropped{0};
+    };
+
+    /** A set of per-MessageType counters, used by a single thread.
+        Aligned so that threads don't share cache lines. */
+    struct alignas(64) MessageTypeSlot {
+        std::array<MessageTypeCounters, MESSAGE_TYPE_COUNT> counters;
+    };
+
+    /** The number of thread slots. If more threads than this record
+        message stats, slots are shared (which is still correct, but may
+        cause contention). */
+    static constexpr std::size_t MAX_THREAD_SLOTS = 16;
+
+    /**
+     * Returns the calling thread's counters for the given MessageType.
+     */
+    static MessageTypeCounters& getThreadCounters(MessageType messageType);
+
+    /** Each thread's per-MessageType counters. */
+    static std::array<MessageTypeSlot, MAX_THREAD_SLOTS> messageTypeSlots;
+
+    /** The number of threads that have been assigned a slot. */
+    static std::atomic<std::size_t> assignedSlotCount;
+
     /** The number of bytes that have been sent since the last dump. */
     static std::atomic<unsigned int> bytesSent;
 
     /** The number of bytes that have been received since the last dump. */
     static std::atomic<unsigned int> bytesReceived;
+
+    /** The number of send times that have been recorded since the last
+        dump. */
+    static std::atomic<unsigned int> sendCount;
+
+    /** The sum of the send times that have been recorded since the last dump,
+        in microseconds. */
+    static std::atomic<unsigned int> totalSendTimeUs;
+
+    /** The longest send time that has been recorded since the last dump, in
+        microseconds. */
+    static std::atomic<unsigned int> maxSendTimeUs;
+
+    /** The number of socket system calls that have been made since the last
+        dump. */
+    static std::atomic<unsigned int> socketSyscalls;
 };
 
 } // End namespace AM
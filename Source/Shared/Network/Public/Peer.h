@@ -1,16 +1,25 @@
 #pragma once
 
 #include "NetworkDefs.h"
-#include "SocketSet.h"
-#include "TcpSocket.h"
 #include <memory>
-#include <array>
-#include <atomic>
+#include <cstddef>
+#include <string>
+#include <span>
 
 namespace AM
 {
 /**
  * Represents a network peer for communication.
+ *
+ * Implemented by TcpPeer and UdpPeer. Either way, reliable data is presented
+ * as an ordered stream of framed messages, so users don't need to care which
+ * transport is in use.
+ *
+ * Data that can be lost (e.g. EntityUpdates, which the sender can re-send
+ * once it learns of the loss) can instead be sent as notified datagrams, so
+ * that a lost datagram doesn't hold up the ones behind it. See
+ * sendUnreliable() and popDeliveryNotice().
+ *
  * TODO: Peer/acceptor seem like a redundant layer and should probably be
  * removed. A Client/Server class and the SocketSet/TcpSocket classes should be
  * able to cleanly handle all the responsibilities.
@@ -22,68 +31,153 @@ public:
      * fragmentation. Can rethink if we need larger. */
     static constexpr unsigned int MAX_MESSAGE_SIZE = 1450;
 
+    /** The most output we'll hold for a peer that isn't keeping up with our
+        non-blocking sends. If exceeded, the peer is considered disconnected.
+     */
+    static constexpr std::size_t MAX_PENDING_OUTPUT_SIZE = 64 * 1024;
+
     /**
-     * Initiates a TCP connection that the other side can then accept.
+     * Initiates a connection that the other side can then accept.
      * (e.g. the client connecting to the server)
+     *
+     * @param transport  The transport to connect with. Must match the one
+     *                   that the other side is accepting on.
      */
     static std::unique_ptr<Peer> initiate(std::string serverIP,
-                                          unsigned int serverPort);
+                                          unsigned int serverPort,
+                                          Transport transport = Transport::Tcp);
+
+    virtual ~Peer() = default;
 
     /**
-     * Constructor for when you only need 1 peer (client connecting to server,
-     * anyone connecting to chat server.) Constructs a socket set for this peer
-     * to use and adds the socket to it.
+     * Returns false if the client was at some point found to be disconnected,
+     * else true.
      */
-    Peer(std::unique_ptr<TcpSocket> inSocket);
+    virtual bool isConnected() const = 0;
 
     /**
-     * Constructor for when you need a set of peers (server connecting to
-     * clients). Adds the socket to the given set.
+     * Sends the given message to this Peer.
+     * Will error if the message size is larger than a Uint16 can hold.
+     * @return Disconnected if the peer was found to be disconnected, else
+     * Success.
      */
-    Peer(std::unique_ptr<TcpSocket> inSocket,
-         const std::shared_ptr<SocketSet>& inSet);
+    NetworkResult send(const BinaryBufferSharedPtr& message);
 
     /**
-     * Removes the socket from the set.
+     * Sends the given message to this Peer.
+     * Will error if the message size is larger than a Uint16 can hold.
+     * @return Disconnected if the peer was found to be disconnected, else
+     * Success.
      */
-    ~Peer();
+    virtual NetworkResult send(const Uint8* messageBuffer,
+                               unsigned int messageSize)
+        = 0;
 
     /**
-     * Returns false if the client was at some point found to be disconnected,
-     * else true.
+     * Sends the given message to this Peer over the Unreliable channel.
+     *
+     * The message must be a complete frame (e.g. {client header, message
+     * header, payload}), since it may arrive out of order relative to
+     * reliable data, or not at all.
+     *
+     * @return Disconnected if the peer was found to be disconnected, else
+     * Success.
      */
-    bool isConnected() const;
+    virtual NetworkResult sendUnreliable(const BinaryBufferSharedPtr& message)
+        = 0;
 
     /**
-     * Sends the given message to this Peer.
-     * Will error if the message size is larger than a Uint16 can hold.
+     * Sends the given buffers to this Peer as a single datagram on the
+     * Unreliable channel, and tracks whether it was delivered.
+     *
+     * The buffers must hold one complete frame, since the datagram may
+     * arrive out of order relative to reliable data, or not at all. The
+     * other side receives it through receiveUnreliable().
+     *
+     * Once we know whether the datagram was delivered, a DeliveryNotice with
+     * the given token can be popped from popDeliveryNotice().
+     *
      * @return Disconnected if the peer was found to be disconnected, else
      * Success.
      */
-    NetworkResult send(const BinaryBufferSharedPtr& message);
+    virtual NetworkResult
+        sendUnreliable(std::span<const std::span<const Uint8>> buffers,
+                       Uint32 notifyToken)
+        = 0;
 
     /**
-     * Sends the given message to this Peer.
-     * Will error if the message size is larger than a Uint16 can hold.
+     * Pops the oldest notice for the datagrams that were sent through
+     * sendUnreliable(buffers, notifyToken).
+     * Notices are popped in the order that their datagrams were sent.
+     *
+     * @return true if a notice was popped, else false.
+     */
+    virtual bool popDeliveryNotice(DeliveryNotice& notice) = 0;
+
+    /**
+     * Sends the given message to this Peer, without blocking.
+     *
+     * Any output left pending from earlier calls is sent first, to preserve
+     * ordering. Whatever can't be sent without blocking is held in our
+     * pending output, to be sent by a later call or flushPendingOutput().
+     *
+     * @return Disconnected if the peer was found to be disconnected, or if its
+     *         pending output grew past MAX_PENDING_OUTPUT_SIZE. Else, Success.
+     */
+    NetworkResult sendNonBlocking(const Uint8* messageBuffer,
+                                  unsigned int messageSize);
+
+    /**
+     * Overload for sending a set of buffers, in order, without first copying
+     * them into a single contiguous buffer.
+     * Buffers that aren't fully sent are copied into our pending output, so
+     * they don't need to outlive this call (unless a TcpPeer is using a send
+     * ring, see TcpPeer::setSendRing()).
+     */
+    virtual NetworkResult
+        sendNonBlocking(std::span<const std::span<const Uint8>> buffers)
+        = 0;
+
+    /**
+     * Tries to send any pending output, without blocking.
      * @return Disconnected if the peer was found to be disconnected, else
      * Success.
      */
-    NetworkResult send(const Uint8* messageBuffer, unsigned int messageSize);
+    virtual NetworkResult flushPendingOutput() = 0;
 
     /**
-     * Tries to receive bytes over the network.
+     * Returns the number of bytes waiting in our pending output.
+     */
+    virtual std::size_t getPendingOutputSize() const = 0;
+
+    /**
+     * Tries to receive a message, without blocking.
      *
-     * @param messageBuffer  The buffer to fill with a message, if one was
-     * received.
-     * @param numBytes  The number of bytes to receive.
-     * @param checkSockets  If true, will call CheckSockets() before checking
-     *                      SocketReady(). Set this to false if you're going to
-     * call CheckSockets() yourself.
-     * @return An appropriate ReceiveResult. If return == Success,
-     *         messageBuffer contains the received message.
+     * Any received bytes are accumulated across calls, so a partially
+     * received message is held until the rest arrives. If a single read
+     * brings in multiple messages, subsequent calls will return them without
+     * touching the socket.
+     *
+     * Messages are expected to be framed as {prefix, message header,
+     * payload}, where the prefix is a fixed number of bytes that precede each
+     * message (e.g. the client header).
+     *
+     * Note: On platforms without non-blocking receives, checkSockets() must
+     *       have been called on this peer's set beforehand.
+     *
+     * @param messageBuffer  Allocated and filled with the message payload, if
+     *                       a message was received.
+     * @param prefixBuffer  Filled with the message's prefix bytes, if a
+     *                      message was received.
+     * @param prefixSize  The number of prefix bytes that precede each message.
+     * @return An appropriate MessageResult. If return.networkResult ==
+     *         Success, messageBuffer contains the received message.
+     *         NoWaitingData means a complete message isn't available yet.
      */
-    NetworkResult receiveBytes(Uint8* messageBuffer, Uint16 numBytes,
-                               bool checkSockets);
+    virtual MessageResult receiveMessage(BinaryBufferPtr& messageBuffer,
+                                         Uint8* prefixBuffer = nullptr,
+                                         unsigned int prefixSize = 0)
+        = 0;
 
     /**
      * Returns the requested number of bytes, waiting if they're not yet
@@ -94,20 +188,23 @@ public:
      * @return An appropriate ReceiveResult. If return == Success,
      *         messageBuffer contains the received message.
      */
-    NetworkResult receiveBytesWait(Uint8* messageBuffer, Uint16 numBytes);
+    virtual NetworkResult receiveBytesWait(Uint8* messageBuffer,
+                                           Uint16 numBytes)
+        = 0;
 
     /**
-     * Tries to receive a {size, message} pair over the network.
+     * Pops a datagram that was sent through sendUnreliable(buffers,
+     * notifyToken), waiting up to the given timeout for one to arrive.
      *
-     * @param messageBuffer  The buffer to fill with a message, if one was
-     * received.
-     * @param checkSockets  If true, will call CheckSockets() before checking
-     *                      SocketReady(). Set this to false if you're going to
-     * call CheckSockets() yourself.
-     * @return An appropriate ReceiveResult. If return.networkResult == Success,
-     *         messageBuffer contains the received message.
+     * @param datagram  The buffer to fill with the datagram, if one was
+     *                  received.
+     * @param timeoutMs  How long to wait.
+     * @return An appropriate NetworkResult. If return == Success, datagram
+     *         contains the received datagram.
      */
-    MessageResult receiveMessage(Uint8* messageBuffer, bool checkSockets);
+    virtual NetworkResult receiveUnreliable(BinaryBuffer& datagram,
+                                            unsigned int timeoutMs)
+        = 0;
 
     /**
      * Receives a {size, message} pair and returns a message, waiting if the
@@ -126,21 +223,6 @@ public:
      *         messageBuffer contains the received message.
      */
     MessageResult receiveMessageWait(BinaryBufferPtr& messageBuffer);
-
-private:
-    /** The socket for this peer. Must be a unique_ptr so we can move without
-     * copying. */
-    std::unique_ptr<TcpSocket> socket;
-    /** The set that this peer belongs to. Must be a shared_ptr since we may or
-       may not allocate it ourselves depending on which constructor is called.
-     */
-    std::shared_ptr<SocketSet> set;
-
-    /**
-     * Tracks whether or not this peer is connected. Is set to false if a
-     * disconnect was detected when trying to send or receive.
-     */
-    std::atomic<bool> bIsConnected;
 };
 
 } /* End namespace AM */
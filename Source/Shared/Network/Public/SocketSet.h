@@ -3,6 +3,7 @@
 
 #include <SDL2/SDL_net.h>
 #include <memory>
+#include <vector>
 
 namespace AM
 {
@@ -11,16 +12,46 @@ class TcpSocket;
 /**
  * Represents a set of sockets.
  * Wraps SDLNet's SocketSet in an RAII object interface.
+ *
+ * On Linux, the set can instead be backed by an edge-triggered epoll
+ * instance. This lets large sets (e.g. the server's client set) wait without
+ * spinning and only hand back the sockets that actually have activity.
+ *
+ * If built with liburing, the set can also be backed by io_uring. Each socket
+ * gets a multishot receive that pulls data into a shared ring of provided
+ * buffers, so a single system call both waits for activity and receives from
+ * every active socket. Each socket's filled buffers are held by the set until
+ * they're read through receiveAvailable(), which copies straight out of them.
+ *
+ * Note: The io_uring backend hasn't been measured against epoll yet (see
+ *       SocketBackendTest), so nothing uses it by default.
  */
 class SocketSet
 {
 public:
+    /**
+     * The polling mechanism that a set uses.
+     */
+    enum class Backend {
+        /** SDLNet_CheckSockets(), select() based. Available everywhere.
+            On Linux, our sockets aren't SDLNet sockets, so this uses an
+            equivalent poll() instead. */
+        SDLNet,
+        /** Edge-triggered epoll. Linux only, falls back to SDLNet elsewhere. */
+        Epoll,
+        /** io_uring multishot receives. Requires liburing at build time and
+            a kernel that can do multishot receives into provided buffers
+            (Linux 6.0+) at runtime. Falls back to Epoll otherwise. */
+        IoUring
+    };
+
     /**
      * Allocates the socket set.
      *
      * @param maxSockets  The max sockets this socket set can hold.
+     * @param inBackend  The polling mechanism to use.
      */
-    SocketSet(int maxSockets);
+    SocketSet(int maxSockets, Backend inBackend = Backend::SDLNet);
 
     /**
      * Deallocates the socket set.
@@ -38,6 +69,7 @@ public:
 
     /**
      * Removes the given socket from this set.
+     * Does nothing if the socket was already removed.
      */
     void remSocket(const TcpSocket& socket);
 
@@ -45,14 +77,97 @@ public:
      * Checks all sockets in the set for activity.
      * If a non-zero timeout is given, will wait up to that long for activity.
      *
+     * Sockets with activity are marked as ready (see TcpSocket::isReady()) and
+     * are available through getReadySockets() until the next call.
+     *
      * @param timeoutMs  The time in milliseconds to wait for activity.
      * @return The number of sockets with activity.
      */
     int checkSockets(unsigned int timeoutMs);
 
+    /**
+     * Returns the sockets that were found to have activity during the last
+     * call to checkSockets().
+     */
+    const std::vector<const TcpSocket*>& getReadySockets() const;
+
+    /**
+     * Receives up to maxLen bytes from the given socket, into the memory
+     * pointed to by dataBuffer. Never blocks.
+     *
+     * If we're using the IoUring backend, the set receives on behalf of its
+     * sockets, so this must be used instead of TcpSocket::receiveAvailable().
+     * Otherwise, this just calls it.
+     *
+     * Note: Not thread safe. Only call this from the thread that calls
+     *       checkSockets().
+     *
+     * @return The number of bytes received. 0 if no data was waiting, -1 if
+     *         an error occurred or the remote host has closed the connection.
+     */
+    int receiveAvailable(TcpSocket& socket, void* dataBuffer, int maxLen);
+
+    /**
+     * Returns the backend that this set is actually using.
+     */
+    Backend getBackend() const;
+
 private:
+    /** Holds the poll() descriptors that stand in for SDLNet's set on
+        Linux. Defined in the source file so that we don't pull platform
+        headers in here. */
+    struct PollState;
+
+    /** Holds the epoll instance and its event buffer. Defined in the source
+        file so that we don't pull platform headers in here. */
+    struct EpollState;
+
+    /** Holds the io_uring instance, its provided buffers, and the buffers
+        that each socket is holding. Defined in the source file so
+        that we don't pull liburing in here. */
+    struct IoUringState;
+
+    /**
+     * Tries to set up the io_uring backend.
+     * @return false if io_uring is unavailable, else true.
+     */
+    bool initIoUring(int maxSockets);
+
+    /** addSocket() for the io_uring backend. */
+    void addSocketIoUring(const TcpSocket& socket);
+
+    /** remSocket() for the io_uring backend. */
+    void remSocketIoUring(const TcpSocket& socket);
+
+    /** checkSockets() for the SDLNet backend. */
+    int checkSocketsSDLNet(unsigned int timeoutMs);
+
+    /** checkSockets() for the epoll backend. */
+    int checkSocketsEpoll(unsigned int timeoutMs);
+
+    /** checkSockets() for the io_uring backend. */
+    int checkSocketsIoUring(unsigned int timeoutMs);
+
+    Backend backend;
+
+    /** Only valid if backend == SDLNet, on platforms other than Linux. */
     SDLNet_SocketSet set;
 
+    /** Only valid if backend == SDLNet, on Linux. */
+    std::unique_ptr<PollState> pollState;
+
+    /** Only valid if backend == Epoll. */
+    std::unique_ptr<EpollState> epollState;
+
+    /** Only valid if backend == IoUring. */
+    std::unique_ptr<IoUringState> ioUringState;
+
+    /** The sockets currently in the set. */
+    std::vector<const TcpSocket*> sockets;
+
+    /** The sockets that had activity during the last checkSockets(). */
+    std::vector<const TcpSocket*> readySockets;
+
     /** The number of sockets currently in the set. */
     int numSockets;
 };
@@ -0,0 +1,229 @@
+#pragma once
+
+#include "Peer.h"
+#include "SocketSet.h"
+#include "TcpSocket.h"
+#include "ByteRingBuffer.h"
+#include <memory>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <vector>
+#include <span>
+
+namespace AM
+{
+class TcpSendRing;
+
+/**
+ * A peer that communicates over a TCP socket.
+ */
+class TcpPeer : public Peer
+{
+public:
+    /**
+     * Constructor for when you only need 1 peer (client connecting to server,
+     * anyone connecting to chat server.) Constructs a socket set for this peer
+     * to use and adds the socket to it.
+     */
+    TcpPeer(std::unique_ptr<TcpSocket> inSocket);
+
+    /**
+     * Constructor for when you need a set of peers (server connecting to
+     * clients). Adds the socket to the given set.
+     */
+    TcpPeer(std::unique_ptr<TcpSocket> inSocket,
+            const std::shared_ptr<SocketSet>& inSet);
+
+    /**
+     * Removes the socket from the set.
+     */
+    ~TcpPeer() override;
+
+    /**
+     * Returns the socket that this peer communicates through.
+     * Useful for matching a peer against its set's ready sockets.
+     */
+    const TcpSocket& getSocket() const;
+
+    /**
+     * Has this peer's non-blocking sends batched through the given ring,
+     * instead of sending immediately. See TcpSendRing.
+     *
+     * While using a ring, sendNonBlocking() doesn't copy the given buffers.
+     * The ring gathers them straight into the socket, so their data must
+     * stay valid until the ring's next submit(). Whatever the socket doesn't
+     * accept is then copied into our pending output.
+     *
+     * Note: Blocking sends (send()) still go out immediately. Don't mix them
+     *       with non-blocking sends while using a ring, or they'll be
+     *       reordered.
+     */
+    void setSendRing(TcpSendRing* inSendRing);
+
+    //-------------------------------------------------------------------------
+    // Base class overrides
+    //-------------------------------------------------------------------------
+    using Peer::send;
+    using Peer::sendNonBlocking;
+
+    bool isConnected() const override;
+
+    NetworkResult send(const Uint8* messageBuffer,
+                       unsigned int messageSize) override;
+
+    /**
+     * TCP has no unreliable channel, so this is the same as send().
+     */
+    NetworkResult sendUnreliable(const BinaryBufferSharedPtr& message) override;
+
+    /**
+     * TCP has no datagrams, so the buffers are sent on the stream, the same
+     * as sendNonBlocking(). Everything on the stream is delivered (or the
+     * peer is disconnected), so the notice is always a delivery.
+     */
+    NetworkResult
+        sendUnreliable(std::span<const std::span<const Uint8>> buffers,
+                       Uint32 notifyToken) override;
+
+    bool popDeliveryNotice(DeliveryNotice& notice) override;
+
+    NetworkResult sendNonBlocking(
+        std::span<const std::span<const Uint8>> buffers) override;
+
+    NetworkResult flushPendingOutput() override;
+
+    /**
+     * If we're using a send ring, output that hasn't been submitted yet isn't
+     * counted.
+     */
+    std::size_t getPendingOutputSize() const override;
+
+    MessageResult receiveMessage(BinaryBufferPtr& messageBuffer,
+                                 Uint8* prefixBuffer = nullptr,
+                                 unsigned int prefixSize = 0) override;
+
+    NetworkResult receiveBytesWait(Uint8* messageBuffer,
+                                   Uint16 numBytes) override;
+
+    /**
+     * TCP has no datagrams, so this isn't supported. Anything sent through
+     * sendUnreliable() is part of the stream.
+     */
+    NetworkResult receiveUnreliable(BinaryBuffer& datagram,
+                                    unsigned int timeoutMs) override;
+
+private:
+    /** Our send ring hands back its results through completeSend(). */
+    friend class TcpSendRing;
+
+    /** The size of our receive buffer. Must be a power of 2, and large enough
+        to hold a prefix, header, and max size message. */
+    static constexpr std::size_t RECEIVE_BUFFER_SIZE = 8192;
+
+    /** The states of our incremental message receive. */
+    enum class ReceiveState {
+        /** Waiting for a full {prefix, message header}. */
+        Header,
+        /** Have the header, waiting for the full payload. */
+        Payload
+    };
+
+    /**
+     * Send ring only. Holds views of the given buffers and queues us to send
+     * during the ring's next submit().
+     * @return Disconnected if the peer was found to be disconnected or isn't
+     *         keeping up, else Success.
+     */
+    NetworkResult queueOutput(std::span<const std::span<const Uint8>> buffers);
+
+    /**
+     * Send ring only. Queues us to send during the ring's next submit(), if
+     * we have pending output and aren't already queued.
+     */
+    void queueForSend();
+
+    /**
+     * Send ring only. Adds views of everything that the socket hasn't
+     * accepted yet to the end of the given vector, in send order: our
+     * pending output, then the buffers queued since the last submit().
+     */
+    void getUnsentOutput(std::vector<std::span<const Uint8>>& outBuffers) const;
+
+    /**
+     * Send ring only. Handles the result of a send of getUnsentOutput().
+     * Copies any queued buffers that weren't fully sent into our pending
+     * output, since they may not outlive the submit().
+     * @param result  The number of bytes sent, or a negative errno value.
+     */
+    void completeSend(int result);
+
+    /**
+     * Receives any waiting bytes into the receiveBuffer, without blocking.
+     * @return Disconnected if the peer was found to be disconnected, else
+     *         Success.
+     */
+    NetworkResult fillReceiveBuffer();
+
+    /**
+     * Advances our receive state using the bytes in receiveBuffer.
+     * If a complete message is available, pops it into the given buffers.
+     * @return Success if a message was popped, Disconnected if the remote
+     *         sent an invalid message size, else NoWaitingData.
+     */
+    MessageResult popBufferedMessage(BinaryBufferPtr& messageBuffer,
+                                     Uint8* prefixBuffer,
+                                     unsigned int prefixSize);
+
+    /** The socket for this peer. Must be a unique_ptr so we can move without
+     * copying. */
+    std::unique_ptr<TcpSocket> socket;
+    /** The set that this peer belongs to. Must be a shared_ptr since we may or
+       may not allocate it ourselves depending on which constructor is called.
+     */
+    std::shared_ptr<SocketSet> set;
+
+    /**
+     * Tracks whether or not this peer is connected. Is set to false if a
+     * disconnect was detected when trying to send or receive.
+     */
+    std::atomic<bool> bIsConnected;
+
+    /** Holds output that the socket wouldn't accept without blocking. */
+    std::vector<Uint8> pendingOutput;
+
+    /** Notices for the buffers sent through sendUnreliable(), waiting to be
+        popped. */
+    std::deque<DeliveryNotice> deliveryNotices;
+
+    /** How far into pendingOutput we've sent. */
+    std::size_t pendingOutputOffset;
+
+    /** If non-null, the ring that our non-blocking sends are batched
+        through. */
+    TcpSendRing* sendRing;
+
+    /** Send ring only. If true, we're queued to send during the ring's next
+        submit(). */
+    bool isQueuedForSend;
+
+    /** Send ring only. Views of the buffers that were queued since the last
+        submit(). They aren't copied, their owner keeps them alive until the
+        submit. */
+    std::vector<std::span<const Uint8>> queuedBuffers;
+
+    /** Accumulates received bytes until a complete message is available. */
+    ByteRingBuffer receiveBuffer;
+
+    /** The current state of our incremental message receive. */
+    ReceiveState receiveState;
+
+    /** If receiveState == Payload, the type of the message being received. */
+    MessageType pendingMessageType;
+
+    /** If receiveState == Payload, the size of the message being received. */
+    Uint16 pendingMessageSize;
+};
+
+} /* End namespace AM */
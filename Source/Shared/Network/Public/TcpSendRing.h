@@ -0,0 +1,72 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+namespace AM
+{
+class TcpPeer;
+
+/**
+ * Batches the sends of a group of TcpPeers into a single io_uring
+ * submission.
+ *
+ * Peers that use a send ring don't send immediately. Instead, they hold
+ * views of their output and queue themselves here. When submit() is called,
+ * a non-blocking gathered send (sendmsg) is issued for every queued peer,
+ * all in one system call. Anything that a peer's socket doesn't accept is
+ * copied and held by the peer, and resent during the next submit().
+ *
+ * Only available if built with liburing, on a kernel that supports
+ * io_uring. Check isAvailable() before using a ring.
+ *
+ * Not thread safe. Each thread that sends should have its own ring, and a
+ * peer should only ever be sent through by that ring's thread.
+ */
+class TcpSendRing
+{
+public:
+    /**
+     * @param inMaxPeers  The most peers that will be queued between calls to
+     *                    submit(). Used to size the ring.
+     */
+    TcpSendRing(unsigned int inMaxPeers);
+
+    ~TcpSendRing();
+
+    // Not copyable.
+    TcpSendRing(const TcpSendRing& otherRing) = delete;
+    TcpSendRing& operator=(const TcpSendRing& otherRing) = delete;
+
+    /**
+     * Returns false if io_uring couldn't be set up, in which case this ring
+     * must not be used.
+     */
+    bool isAvailable() const;
+
+    /**
+     * Queues the given peer to send its pending output during the next
+     * submit().
+     * Called by TcpPeer. The peer must stay alive until then.
+     */
+    void queue(TcpPeer& peer);
+
+    /**
+     * Sends the pending output of every queued peer, and waits for the
+     * results.
+     */
+    void submit();
+
+private:
+    /** Holds the io_uring instance. Defined in the source file so that we
+        don't pull liburing in here. */
+    struct RingState;
+
+    /** Only valid if isAvailable(). */
+    std::unique_ptr<RingState> ringState;
+
+    /** The peers that will send during the next submit(). */
+    std::vector<TcpPeer*> queuedPeers;
+};
+
+} // End namespace AM
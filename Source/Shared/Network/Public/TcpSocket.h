@@ -4,6 +4,7 @@
 #include <SDL_stdinc.h>
 #include <memory>
 #include <string>
+#include <span>
 
 // Forward declaration
 struct _TCPsocket;
@@ -14,6 +15,10 @@ namespace AM
 /**
  * Represents a single TCP socket.
  * Wraps SDLNet's TCPsocket in an RAII object interface.
+ *
+ * On Linux, we do our own polling and batched sends, which need the OS-level
+ * socket handle. SDLNet doesn't expose it, so there we use a native socket
+ * instead of an SDLNet one.
  */
 class TcpSocket
 {
@@ -25,13 +30,6 @@ public:
      */
     TcpSocket(Uint16 inPort);
 
-    /**
-     * Accepts the given SDLNet socket connection.
-     *
-     * @param inSdlSocket A connected socket.
-     */
-    TcpSocket(TCPsocket inSdlSocket);
-
     /**
      * Opens a socket connection to the given host.
      *
@@ -58,13 +56,39 @@ public:
     int send(const void* dataBuffer, int len);
 
     /**
-     * Receive data of exactly maxLen bytes from this socket, into the memory
-     * pointed to by dataBuffer.
+     * Sends up to len bytes from the given dataBuffer over this socket,
+     * without blocking.
+     *
+     * Note: On platforms without non-blocking sends, this falls back to a
+     *       blocking send.
+     *
+     * @return The number of bytes sent, which may be less than len if the
+     *         socket's send buffer is full. -1 if an error occurred, such as
+     *         the client disconnecting.
+     */
+    int sendAvailable(const void* dataBuffer, int len);
+
+    /**
+     * Sends the given buffers over this socket, in order, without blocking.
+     * On Linux, the buffers are gathered by the kernel (sendmsg()), so they
+     * don't need to be copied into a single contiguous buffer first.
+     *
+     * Note: On platforms without non-blocking sends, this falls back to
+     *       blocking sends.
+     *
+     * @return The total number of bytes sent, which may be less than the total
+     *         size of the buffers if the socket's send buffer is full. -1 if
+     *         an error occurred, such as the client disconnecting.
+     */
+    int sendAvailable(std::span<const std::span<const Uint8>> buffers);
+
+    /**
+     * Receive up to maxLen bytes from this socket, into the memory pointed to
+     * by dataBuffer.
      *
-     * Unless there is an error, or the connection is closed, the buffer will
-     * read maxLen bytes. If you read more than is sent from the other end, then
-     * it will wait until the full requested length is sent, or until the
-     * connection is closed from the other end.
+     * If no data is waiting, this will block until some arrives or the
+     * connection is closed from the other end. It may return fewer bytes than
+     * were requested, if fewer are available.
      *
      * Note: This function is not used for server (listener) sockets.
      *
@@ -74,6 +98,19 @@ public:
      */
     int receive(void* dataBuffer, int maxLen);
 
+    /**
+     * Receive up to maxLen bytes from this socket, into the memory pointed to
+     * by dataBuffer. Never blocks.
+     *
+     * Note: On platforms without non-blocking receives, this relies on
+     *       isReady(), so checkSockets() must have been called on this
+     *       socket's set beforehand.
+     *
+     * @return The number of bytes received. 0 if no data was waiting, -1 if
+     *         an error occurred or the remote host has closed the connection.
+     */
+    int receiveAvailable(void* dataBuffer, int maxLen);
+
     /**
      * Checks if a socket has been marked as active.
      *
@@ -82,6 +119,35 @@ public:
      */
     bool isReady();
 
+    /**
+     * Marks this socket as active, the same way that SDLNet_CheckSockets()
+     * would. Used by socket sets that do their own polling.
+     *
+     * Note: The flag lives in SDLNet's socket (or, on Linux, is only used by
+     *       isReady()), so this doesn't modify any of our other state.
+     */
+    void markReady() const;
+
+    /**
+     * Clears this socket's active mark. See markReady().
+     */
+    void clearReady() const;
+
+    /**
+     * Checks, without blocking, if there's unread data waiting on this socket.
+     * Also returns true if the connection was closed or errored, so that the
+     * next receive() will see it.
+     *
+     * Note: Only call this on a connected socket, not a listener.
+     */
+    bool hasWaitingData() const;
+
+    /**
+     * Returns the OS-level socket handle.
+     * Only supported on Linux, errors on other platforms.
+     */
+    int getFileDescriptor() const;
+
     /**
      * Accepts an incoming connection on this socket.
      *
@@ -103,13 +169,36 @@ public:
      */
     std::string getAddress();
 
+#if !defined(__linux__)
     /**
      * Returns the transport library's underlying socket type.
      */
     TCPsocket getUnderlyingSocket() const;
+#endif
 
 private:
+#if defined(__linux__)
+    /** Tags the constructor that's used by accept(). */
+    struct Accepted {};
+
+    /**
+     * Wraps the given connected native socket. Used by accept().
+     */
+    TcpSocket(Accepted, int inFileDescriptor);
+
+    /** Our native socket. */
+    int fileDescriptor;
+
+    /** Our active mark. See markReady(). */
+    mutable bool ready;
+#else
+    /**
+     * Wraps the given connected SDLNet socket. Used by accept().
+     */
+    TcpSocket(TCPsocket inSdlSocket);
+
     TCPsocket socket;
+#endif
 
     /** This socket's IP. Empty if this is a listener socket. */
     std::string ip;
@@ -0,0 +1,350 @@
+#pragma once
+
+#include "NetworkDefs.h"
+#include "UdpSocket.h"
+#include <array>
+#include <deque>
+#include <span>
+#include <vector>
+
+namespace AM
+{
+/**
+ * The protocol state of one side of a UDP connection.
+ *
+ * Each datagram carries a sequence number, along with an ack of the latest
+ * sequence number that we've received from the other side and a bitfield of
+ * the 32 before it. Since every datagram repeats the recent acks, a lost
+ * datagram only costs us an ack if all of the following ones are lost too.
+ *
+ * Payloads are sent on one of two channels:
+ *   Reliable: Resent until the datagram that holds them is acked, and
+ *             delivered in the order that they were queued.
+ *   Unreliable: Sent once. Only delivered if they're newer than the last
+ *               delivered unreliable payload.
+ *
+ * Unreliable payloads may be queued with a notify token, in which case a
+ * DeliveryNotice is produced once their datagram is acked (delivered) or its
+ * ack is overdue (lost). Notices are produced in the order that the payloads
+ * were sent, so the sender can re-send whatever state was lost instead of
+ * having the whole stream wait on a resend.
+ *
+ * Doesn't touch any sockets or clocks. Datagrams are handed in and out, and
+ * the current time is passed in, so the protocol can be driven directly
+ * (e.g. by tests that drop or reorder datagrams).
+ *
+ * Not thread safe.
+ */
+class UdpConnection
+{
+public:
+    /** Identifies our datagrams, so that stray traffic is ignored. */
+    static constexpr Uint16 PROTOCOL_ID = 0xA3A1;
+
+    /** The size of the header at the front of each datagram. */
+    static constexpr std::size_t HEADER_SIZE = 13;
+
+    /** The largest payload that fits in a datagram. */
+    static constexpr std::size_t MAX_PAYLOAD_SIZE
+        = UdpSocket::MAX_DATAGRAM_SIZE - HEADER_SIZE;
+
+    /** The most reliable payloads that may be unacked at once. Also the
+        size of the receiver's reorder window, so the receiver can always
+        hold anything that the sender sends. */
+    static constexpr std::size_t RELIABLE_WINDOW_SIZE = 512;
+
+    /** The shortest time that we'll wait for an ack before resending. */
+    static constexpr double MIN_RESEND_INTERVAL_S = 0.1;
+
+    /** The most reliable payloads that we'll resend in one writeDatagrams().
+        If more are due (e.g. after a burst of loss), the oldest are resent
+        first and the rest wait for later writes, instead of flooding the
+        link that just dropped them. */
+    static constexpr std::size_t MAX_RESENDS_PER_WRITE = 8;
+
+    /** How many resend intervals we'll wait for a notified payload's ack
+        before reporting it as lost. */
+    static constexpr double NOTICE_TIMEOUT_INTERVALS = 2;
+
+    /** The types of datagram that we send. */
+    enum class PacketType : Uint8 {
+        /** Only carries acks. */
+        AckOnly,
+        /** Carries a reliable payload. */
+        Reliable,
+        /** Carries an unreliable payload. */
+        Unreliable,
+        /** Sent by the initiating side until it hears back, to open the
+           connection. Otherwise the same as AckOnly. */
+        Connect
+    };
+
+    UdpConnection();
+
+    /**
+     * Queues the given payload to be sent during the next writeDatagrams().
+     * Must be no larger than MAX_PAYLOAD_SIZE.
+     *
+     * @return false if the payload is reliable and RELIABLE_WINDOW_SIZE
+     *         reliable payloads are already unacked. The other side isn't
+     *         keeping up (or is gone), and should be disconnected.
+     */
+    bool queue(Channel channel, std::span<const Uint8> payload);
+
+    /**
+     * Queues the given payload to be sent on the Unreliable channel during
+     * the next writeDatagrams(). Once we know whether it was delivered, a
+     * DeliveryNotice with the given token can be popped from popNotice().
+     * Must be no larger than MAX_PAYLOAD_SIZE.
+     */
+    void queueNotified(std::span<const Uint8> payload, Uint32 notifyToken);
+
+    /**
+     * Writes a datagram for each queued payload and each reliable payload
+     * that's due to be resent (up to MAX_RESENDS_PER_WRITE).
+     * If nothing was written but we owe the other side an ack, writes an
+     * AckOnly datagram.
+     *
+     * @param currentTimeS  The current time, in seconds.
+     * @param datagrams  The vector to push the datagrams into.
+     */
+    void writeDatagrams(double currentTimeS,
+                        std::vector<BinaryBuffer>& datagrams);
+
+    /**
+     * Writes a Connect datagram.
+     *
+     * @param currentTimeS  The current time, in seconds.
+     * @param datagrams  The vector to push the datagram into.
+     */
+    void writeConnect(double currentTimeS,
+                      std::vector<BinaryBuffer>& datagrams);
+
+    /**
+     * Processes the given received datagram, applying its acks and
+     * delivering its payload.
+     *
+     * @param currentTimeS  The current time, in seconds.
+     * @return false if the datagram isn't a valid datagram of ours, else true.
+     */
+    bool processDatagram(std::span<const Uint8> datagram,
+                         double currentTimeS);
+
+    /**
+     * Pops the oldest delivered reliable payload into the given buffer.
+     * @return true if a payload was popped, else false.
+     */
+    bool popReliable(BinaryBuffer& payload);
+
+    /**
+     * Returns the size of the oldest delivered reliable payload, or 0 if
+     * there are none.
+     */
+    std::size_t peekReliableSize() const;
+
+    /**
+     * Pops the oldest delivered unreliable payload into the given buffer.
+     * @return true if a payload was popped, else false.
+     */
+    bool popUnreliable(BinaryBuffer& payload);
+
+    /**
+     * Pops the oldest delivery notice for our notified payloads.
+     * @return true if a notice was popped, else false.
+     */
+    bool popNotice(DeliveryNotice& notice);
+
+    /**
+     * Returns true if the given datagram is a valid Connect datagram.
+     * Used to decide whether an unknown sender is opening a connection.
+     */
+    static bool isConnect(std::span<const Uint8> datagram);
+
+    /** Returns true if we've received any datagram from the other side. */
+    bool hasReceived() const;
+
+    /** Returns the smoothed round trip time, in seconds. */
+    double getRoundTripTime() const;
+
+    /** Returns the number of bytes in reliable payloads that have been
+        queued but not yet acked. */
+    std::size_t getUnackedReliableBytes() const;
+
+    /** Returns the number of times that a reliable payload was resent. */
+    std::size_t getResendCount() const;
+
+private:
+    /** The size of our sent packet history. Must be larger than the number
+        of datagrams that we'll have in flight. */
+    static constexpr std::size_t SENT_PACKET_BUFFER_SIZE = 1024;
+
+    /** The most delivered unreliable payloads that we'll hold. If they
+        aren't being popped, the oldest are dropped. */
+    static constexpr std::size_t MAX_DELIVERED_UNRELIABLES = 64;
+
+    /** The amount that each round trip sample moves the smoothed RTT. */
+    static constexpr double RTT_SMOOTHING_FACTOR = 0.1;
+
+    /** Our guess at the round trip time, until we've measured it. */
+    static constexpr double INITIAL_RTT_S = 0.1;
+
+    /** Set on the type byte if the header's acks are valid (i.e. the sender
+        has received something to ack). */
+    static constexpr Uint8 HAS_ACKS_FLAG = 0x80;
+
+    /** The indices of each header field. */
+    struct HeaderIndex {
+        enum Index : Uint8 {
+            ProtocolID = 0,
+            Type = 2,
+            Sequence = 3,
+            Ack = 5,
+            AckBits = 7,
+            ReliableID = 11,
+        };
+    };
+
+    /** A datagram that we've sent. */
+    struct SentPacket {
+        Uint16 sequence{0};
+        bool isValid{false};
+        bool isAcked{false};
+        double sendTimeS{0};
+        bool hasReliable{false};
+        Uint16 reliableID{0};
+    };
+
+    /** A notified datagram that we haven't produced a notice for. */
+    struct UnresolvedNotified {
+        Uint16 sequence{0};
+        Uint32 notifyToken{0};
+    };
+
+    /** An unreliable payload waiting for the next writeDatagrams(). */
+    struct PendingUnreliable {
+        BinaryBuffer payload;
+        bool isNotified{false};
+        Uint32 notifyToken{0};
+    };
+
+    /** A reliable payload that hasn't been acked. */
+    struct PendingReliable {
+        Uint16 reliableID{0};
+        BinaryBuffer payload;
+        bool wasSent{false};
+        bool isAcked{false};
+        double lastSendTimeS{0};
+    };
+
+    /** A reliable payload that arrived ahead of one that it follows. */
+    struct ReceivedReliable {
+        bool isValid{false};
+        BinaryBuffer payload;
+    };
+
+    /** Returns true if a is newer than b, accounting for wraparound. */
+    static bool isNewer(Uint16 a, Uint16 b);
+
+    /** Returns how long we wait for an ack before resending. */
+    double getResendInterval() const;
+
+    /**
+     * Writes a datagram with the given type and payload.
+     */
+    void writeDatagram(PacketType type, Uint16 reliableID,
+                       std::span<const Uint8> payload, double currentTimeS,
+                       std::vector<BinaryBuffer>& datagrams);
+
+    /**
+     * Marks the given sequence number as received, updating our acks.
+     */
+    void recordReceived(Uint16 sequence);
+
+    /**
+     * Applies the acks in a received header to our sent packets.
+     */
+    void processAcks(Uint16 ack, Uint32 ackBits, double currentTimeS);
+
+    /**
+     * Stores the given reliable payload, then delivers any that are now in
+     * order.
+     */
+    void receiveReliable(Uint16 reliableID, std::span<const Uint8> payload);
+
+    /**
+     * Produces notices for the oldest notified datagrams, as long as they've
+     * been acked or their acks are overdue.
+     */
+    void resolveNotices(double currentTimeS);
+
+    //-------------------------------------------------------------------------
+    // Send side
+    //-------------------------------------------------------------------------
+    /** The sequence number of our next datagram. */
+    Uint16 localSequence;
+
+    /** The datagrams that we've sent, indexed by sequence % size. */
+    std::array<SentPacket, SENT_PACKET_BUFFER_SIZE> sentPackets;
+
+    /** Reliable payloads that haven't been acked, in ID order. */
+    std::deque<PendingReliable> pendingReliables;
+
+    /** The ID of the next reliable payload that we queue. */
+    Uint16 nextReliableID;
+
+    /** Unreliable payloads waiting for the next writeDatagrams(). */
+    std::vector<PendingUnreliable> pendingUnreliables;
+
+    /** Our notified datagrams that haven't been resolved yet, in send
+        order. */
+    std::deque<UnresolvedNotified> unresolvedNotifieds;
+
+    /** Notices that are ready to be popped, in send order. */
+    std::deque<DeliveryNotice> notices;
+
+    /** The total size of the payloads in pendingReliables. */
+    std::size_t unackedReliableBytes;
+
+    /** The number of times that a reliable payload was resent. */
+    std::size_t resendCount;
+
+    /** The smoothed round trip time. */
+    double roundTripTimeS;
+
+    //-------------------------------------------------------------------------
+    // Receive side
+    //-------------------------------------------------------------------------
+    /** If true, we've received a datagram and remoteSequence is valid. */
+    bool hasReceivedAny;
+
+    /** The newest sequence number that we've received. */
+    Uint16 remoteSequence;
+
+    /** Bit n is set if we've received (remoteSequence - 1 - n). */
+    Uint32 receivedBits;
+
+    /** If true, we've received something that needs acking. */
+    bool ackIsOwed;
+
+    /** The ID of the next reliable payload to deliver. */
+    Uint16 nextDeliverID;
+
+    /** Reliable payloads that arrived out of order, indexed by
+        ID % RELIABLE_WINDOW_SIZE. */
+    std::array<ReceivedReliable, RELIABLE_WINDOW_SIZE> receiveWindow;
+
+    /** Reliable payloads that are ready to be popped, in order. */
+    std::deque<BinaryBuffer> deliveredReliables;
+
+    /** If true, we've delivered an unreliable payload and
+        lastUnreliableSequence is valid. */
+    bool hasDeliveredUnreliable;
+
+    /** The sequence number of the newest delivered unreliable payload. */
+    Uint16 lastUnreliableSequence;
+
+    /** Unreliable payloads that are ready to be popped. */
+    std::deque<BinaryBuffer> deliveredUnreliables;
+};
+
+} // End namespace AM
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "UdpPeer.h"
+#include "UdpSocket.h"
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace AM
+{
+/**
+ * The UDP counterpart to Acceptor. Owns a socket bound to a known port,
+ * receives all datagrams that arrive on it, and hands each to the UdpPeer
+ * for its sender's address.
+ *
+ * A Connect datagram from an unknown address creates a new peer, which can
+ * then be accepted. Other datagrams from unknown addresses are ignored.
+ *
+ * Must be owned by a shared_ptr, since peers keep a weak reference to it.
+ * Not thread safe, except that accepted peers may send from any thread.
+ */
+class UdpHost : public std::enable_shared_from_this<UdpHost>
+{
+public:
+    /** The most peers that may be waiting to be accepted. Protects us from
+        Connect floods. */
+    static constexpr std::size_t MAX_PENDING_PEERS = 64;
+
+    UdpHost(Uint16 port);
+
+    /**
+     * Receives all waiting datagrams and hands them to their peers. If none
+     * are waiting, waits up to timeoutMs for some to arrive.
+     *
+     * @return The peers that received datagrams, and any that were accepted
+     *         since the last call. Valid until the next call.
+     */
+    const std::vector<UdpPeer*>& receive(unsigned int timeoutMs);
+
+    /**
+     * Returns a peer that opened a connection, if there are any.
+     */
+    std::unique_ptr<UdpPeer> accept();
+
+    /**
+     * Stops handing datagrams to the peer at the given address.
+     * Called by UdpPeer's destructor.
+     */
+    void unregisterPeer(const IPaddress& address);
+
+private:
+    /** Returns a key that uniquely identifies the given address. */
+    static Uint64 getAddressKey(const IPaddress& address);
+
+    /** Our socket. Shared with our peers, so they can send through it. */
+    std::shared_ptr<UdpSocket> socket;
+
+    /** The peer at each address. */
+    std::unordered_map<Uint64, UdpPeer*> peers;
+
+    /** Peers that have opened a connection but haven't been accepted. */
+    std::vector<std::unique_ptr<UdpPeer>> pendingPeers;
+
+    /** The peers that will be returned by the next receive(). */
+    std::vector<UdpPeer*> readyPeers;
+
+    /** The peers that were returned by the last receive(). */
+    std::vector<UdpPeer*> returnedPeers;
+
+    /** Holds received datagrams. */
+    std::vector<UdpSocket::ReceivedDatagram> receivedDatagrams;
+};
+
+} // End namespace AM
@@ -0,0 +1,263 @@
+#pragma once
+
+#include "Peer.h"
+#include "UdpConnection.h"
+#include "UdpSocket.h"
+#include "ByteRingBuffer.h"
+#include "Timer.h"
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace AM
+{
+class UdpHost;
+
+/**
+ * A peer that communicates over UDP, through a UdpConnection.
+ *
+ * Reliable sends are treated as a byte stream: they're split into
+ * datagram-sized payloads, sent on the Reliable channel, and reassembled in
+ * order on the other side, so messages are framed the same way as they are
+ * over TCP. Unreliable sends are sent as a single datagram each, and must
+ * hold a complete frame. Notified unreliable sends are reported on through
+ * popDeliveryNotice(), once their datagram is acked or presumed lost.
+ *
+ * An initiating peer (e.g. the client) owns its socket and receives from it
+ * directly. An accepted peer (e.g. one of the server's clients) shares the
+ * UdpHost's socket, and is handed its datagrams by the host.
+ *
+ * Thread safe.
+ */
+class UdpPeer : public Peer
+{
+public:
+    /** How often an initiating peer resends its Connect datagram, until it
+        hears back. */
+    static constexpr double CONNECT_RESEND_INTERVAL_S = 0.1;
+
+    /** How long an initiating peer will go without hearing from the other
+        side before considering it disconnected. */
+    static constexpr double TIMEOUT_S = 10;
+
+    /**
+     * Opens a socket and starts a connection to the given server.
+     */
+    static std::unique_ptr<UdpPeer> initiate(std::string serverIP,
+                                             unsigned int serverPort);
+
+    /**
+     * @param inAddress  The address of the other side.
+     * @param inSocket  The socket to send through.
+     * @param inHost  If non-empty, the host that hands us our datagrams.
+     *                If empty, we're the initiating side and receive from
+     *                inSocket ourselves.
+     */
+    UdpPeer(const IPaddress& inAddress, std::shared_ptr<UdpSocket> inSocket,
+            std::weak_ptr<UdpHost> inHost);
+
+    /**
+     * Unregisters from our host, if we have one.
+     */
+    ~UdpPeer() override;
+
+    /**
+     * Processes a datagram that was received from our address.
+     * Used by UdpHost.
+     */
+    void receiveDatagram(std::span<const Uint8> datagram);
+
+    /** Returns the address of the other side. */
+    const IPaddress& getAddress() const;
+
+    /** Returns the smoothed round trip time, in seconds. */
+    double getRoundTripTime() const;
+
+    //-------------------------------------------------------------------------
+    // Base class overrides
+    //-------------------------------------------------------------------------
+    using Peer::send;
+    using Peer::sendNonBlocking;
+
+    bool isConnected() const override;
+
+    NetworkResult send(const Uint8* messageBuffer,
+                       unsigned int messageSize) override;
+
+    NetworkResult sendUnreliable(const BinaryBufferSharedPtr& message) override;
+
+    NetworkResult
+        sendUnreliable(std::span<const std::span<const Uint8>> buffers,
+                       Uint32 notifyToken) override;
+
+    bool popDeliveryNotice(DeliveryNotice& notice) override;
+
+    /**
+     * Datagram sends don't block, so this queues the buffers on the
+     * Reliable channel and sends them right away. Our pending output is the
+     * reliable data that hasn't been acked yet.
+     */
+    NetworkResult sendNonBlocking(
+        std::span<const std::span<const Uint8>> buffers) override;
+
+    /**
+     * Sends any acks that we owe, and resends any reliable data whose acks
+     * are late.
+     */
+    NetworkResult flushPendingOutput() override;
+
+    std::size_t getPendingOutputSize() const override;
+
+    /**
+     * Unreliable messages are returned first, since they're always complete.
+     */
+    MessageResult receiveMessage(BinaryBufferPtr& messageBuffer,
+                                 Uint8* prefixBuffer = nullptr,
+                                 unsigned int prefixSize = 0) override;
+
+    /**
+     * Only supported on the initiating side, since it pumps our socket while
+     * waiting. Only reliable data is returned.
+     */
+    NetworkResult receiveBytesWait(Uint8* messageBuffer,
+                                   Uint16 numBytes) override;
+
+    /**
+     * Only supported on the initiating side, since it pumps our socket while
+     * waiting. Don't mix with receiveMessage(), which also pops unreliable
+     * datagrams.
+     */
+    NetworkResult receiveUnreliable(BinaryBuffer& datagram,
+                                    unsigned int timeoutMs) override;
+
+private:
+    /** The size of our receive buffer. Must be a power of 2, and large enough
+        to hold a prefix, header, and max size message. */
+    static constexpr std::size_t RECEIVE_BUFFER_SIZE = 8192;
+
+    /** How long an initiating peer waits on its socket during each step of a
+        blocking receive. */
+    static constexpr unsigned int SOCKET_WAIT_TIMEOUT_MS = 10;
+
+    /** The states of our incremental message receive. */
+    enum class ReceiveState {
+        /** Waiting for a full {prefix, message header}. */
+        Header,
+        /** Have the header, waiting for the full payload. */
+        Payload
+    };
+
+    /**
+     * Splits the given buffers into payloads and queues them on the Reliable
+     * channel, then sends them.
+     * @pre mutex is locked.
+     */
+    NetworkResult sendReliable(std::span<const std::span<const Uint8>> buffers);
+
+    /**
+     * Writes and sends any datagrams that are due.
+     * @pre mutex is locked.
+     */
+    NetworkResult flush();
+
+    /**
+     * Initiating side only. Waits up to timeoutMs for datagrams, processes
+     * all that are waiting, then flushes our acks.
+     */
+    void pumpSocket(unsigned int timeoutMs);
+
+    /**
+     * Moves delivered reliable payloads into receiveBuffer, as space allows.
+     * @pre mutex is locked.
+     */
+    void fillReceiveBuffer();
+
+    /**
+     * Advances our receive state using the bytes in receiveBuffer.
+     * If a complete message is available, pops it into the given buffers.
+     * @pre mutex is locked.
+     * @return Success if a message was popped, Disconnected if the remote
+     *         sent an invalid message size, else NoWaitingData.
+     */
+    MessageResult popBufferedMessage(BinaryBufferPtr& messageBuffer,
+                                     Uint8* prefixBuffer,
+                                     unsigned int prefixSize);
+
+    /**
+     * Pops the next well-formed unreliable message, if there is one.
+     * @pre mutex is locked.
+     * @return Success if a message was popped, else NoWaitingData.
+     */
+    MessageResult popUnreliableMessage(BinaryBufferPtr& messageBuffer,
+                                       Uint8* prefixBuffer,
+                                       unsigned int prefixSize);
+
+    /**
+     * Marks us as disconnected.
+     */
+    void disconnect(const char* reason);
+
+    /** The address of the other side. */
+    IPaddress address;
+
+    /** The socket that we send through. Shared with the host, if we have
+        one. */
+    std::shared_ptr<UdpSocket> socket;
+
+    /** The host that hands us our datagrams. Empty if we're the initiating
+        side. */
+    std::weak_ptr<UdpHost> host;
+
+    /** If true, we're the initiating side. */
+    const bool isInitiator;
+
+    /** Guards all of our protocol and receive state. */
+    mutable std::mutex mutex;
+
+    /** Our protocol state. */
+    UdpConnection connection;
+
+    /** The clock that we pass to connection. */
+    Timer clock;
+
+    /** The time that we last received a datagram at. */
+    double lastReceiveTimeS;
+
+    /** The time that we last sent a Connect datagram at. */
+    double lastConnectTimeS;
+
+    /**
+     * Tracks whether or not this peer is connected. Is set to false if a
+     * disconnect was detected when trying to send or receive.
+     */
+    std::atomic<bool> bIsConnected;
+
+    /** Holds the datagrams that are being sent. */
+    std::vector<BinaryBuffer> outgoingDatagrams;
+
+    /** Views of outgoingDatagrams, for the socket. */
+    std::vector<std::span<const Uint8>> outgoingViews;
+
+    /** Used to gather the buffers that are being sent into payloads. */
+    BinaryBuffer payloadBuffer;
+
+    /** Holds received datagrams. Initiating side only. */
+    std::vector<UdpSocket::ReceivedDatagram> receivedDatagrams;
+
+    /** Accumulates received reliable bytes until a complete message is
+        available. */
+    ByteRingBuffer receiveBuffer;
+
+    /** The current state of our incremental message receive. */
+    ReceiveState receiveState;
+
+    /** If receiveState == Payload, the type of the message being received. */
+    MessageType pendingMessageType;
+
+    /** If receiveState == Payload, the size of the message being received. */
+    Uint16 pendingMessageSize;
+};
+
+} /* End namespace AM */
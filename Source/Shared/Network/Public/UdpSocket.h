@@ -0,0 +1,101 @@
+#pragma once
+
+#include <SDL2/SDL_net.h>
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <span>
+
+namespace AM
+{
+/**
+ * Represents a single UDP socket.
+ * Wraps SDLNet's UDPsocket in an RAII object interface.
+ *
+ * On Linux, datagrams are sent and received in batches (sendmmsg() and
+ * recvmmsg()), so a full batch costs a single syscall. Those need the OS-level
+ * socket handle, which SDLNet doesn't expose, so there we use a native socket
+ * instead of an SDLNet one.
+ */
+class UdpSocket
+{
+public:
+    /** The largest datagram that we'll send or accept. Sized to fit in a
+        1500 byte ethernet MTU after the IP (20) and UDP (8) headers, so
+        datagrams aren't fragmented. */
+    static constexpr std::size_t MAX_DATAGRAM_SIZE = 1472;
+
+    /** The most datagrams that we'll send or receive in one call. */
+    static constexpr std::size_t MAX_BATCH_SIZE = 64;
+
+    /** A datagram that was received through receiveBatch(). */
+    struct ReceivedDatagram {
+        /** The address that the datagram was sent from. */
+        IPaddress address{};
+
+        /** The number of bytes in data. */
+        Uint16 size{0};
+
+        std::array<Uint8, MAX_DATAGRAM_SIZE> data{};
+    };
+
+    /**
+     * Opens the socket.
+     *
+     * @param inPort  The port to bind to. If 0, an ephemeral port is used
+     *                (e.g. a client that only talks to a server).
+     */
+    UdpSocket(Uint16 inPort);
+
+    /**
+     * Closes the socket.
+     */
+    ~UdpSocket();
+
+    // Not copyable.
+    UdpSocket(const UdpSocket& otherSocket) = delete;
+    UdpSocket& operator=(const UdpSocket& otherSocket) = delete;
+
+    /**
+     * Sends each of the given buffers to the given address as its own
+     * datagram, without blocking.
+     *
+     * @return The number of datagrams sent, which may be less than the number
+     *         given if the socket's send buffer is full. -1 if an error
+     *         occurred.
+     */
+    int sendBatch(const IPaddress& address,
+                  std::span<const std::span<const Uint8>> datagrams);
+
+    /**
+     * Receives up to datagrams.size() waiting datagrams, without blocking.
+     *
+     * @return The number of datagrams received. 0 if none were waiting.
+     */
+    int receiveBatch(std::span<ReceivedDatagram> datagrams);
+
+    /**
+     * Waits up to timeoutMs for a datagram to be available.
+     * @return true if a datagram is available, else false.
+     */
+    bool waitForData(unsigned int timeoutMs);
+
+private:
+#if defined(__linux__)
+    /** Our native socket. */
+    int fileDescriptor;
+#else
+    UDPsocket socket;
+
+    /** Used by waitForData(). */
+    SDLNet_SocketSet set;
+
+    /** Used by the SDLNet send and receive fallbacks. */
+    UDPpacket* packet;
+
+    /** Guards packet, since sends may come from multiple threads. */
+    std::mutex packetMutex;
+#endif
+};
+
+} // End namespace AM
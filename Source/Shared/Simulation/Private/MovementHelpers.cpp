@@ -3,74 +3,175 @@
 #include "PreviousPosition.h"
 #include "Movement.h"
 #include "Sprite.h"
-#include "Ignore.h"
+
+// The SIMD kernel matches the double precision math, so it can't be used
+// with fixed-point movement.
+#if defined(__SSE2__) && !defined(AM_FIXED_POINT_MOVEMENT)
+#define AM_SIMD_MOVEMENT
+#include <immintrin.h>
+#endif
 
 namespace AM
 {
+#if defined(AM_SIMD_MOVEMENT)
+namespace
+{
+/**
+ * Returns the velocity along one axis for 4 entities, matching the selection
+ * in updateVelocity() without branching.
+ *
+ * @param upType  The input that gives this axis upVelocity. Favored if both
+ *                inputs are pressed.
+ * @param downType  The input that gives this axis downVelocity.
+ */
+__m128 selectVelocity(const Input* inputs, Input::Type upType,
+                      Input::Type downType, __m128 upVelocity,
+                      __m128 downVelocity)
+{
+    const __m128i pressed = _mm_set1_epi32(Input::Pressed);
+    __m128i upStates = _mm_setr_epi32(
+        inputs[0].inputStates[upType], inputs[1].inputStates[upType],
+        inputs[2].inputStates[upType], inputs[3].inputStates[upType]);
+    __m128i downStates = _mm_setr_epi32(
+        inputs[0].inputStates[downType], inputs[1].inputStates[downType],
+        inputs[2].inputStates[downType], inputs[3].inputStates[downType]);
+    __m128 upMask = _mm_castsi128_ps(_mm_cmpeq_epi32(upStates, pressed));
+    __m128 downMask = _mm_castsi128_ps(_mm_cmpeq_epi32(downStates, pressed));
+
+    // Start with down (or 0), then let up override it.
+    __m128 velocity = _mm_and_ps(downMask, downVelocity);
+    return _mm_or_ps(_mm_and_ps(upMask, upVelocity),
+                     _mm_andnot_ps(upMask, velocity));
+}
+
+/**
+ * Returns position + (deltaSeconds * velocity) for 4 entities.
+ *
+ * Note: To match moveEntity(), this is done in double precision and rounded
+ *       back to float. An FMA would skip the intermediate rounding and give
+ *       different results, so we keep the multiply and add separate.
+ */
+__m128 integratePosition(__m128 position, __m128 velocity,
+                         double deltaSeconds)
+{
+#if defined(__AVX__)
+    __m256d product = _mm256_mul_pd(_mm256_set1_pd(deltaSeconds),
+                                    _mm256_cvtps_pd(velocity));
+    return _mm256_cvtpd_ps(_mm256_add_pd(_mm256_cvtps_pd(position), product));
+#else
+    const __m128d delta = _mm_set1_pd(deltaSeconds);
+    __m128d lowResult
+        = _mm_add_pd(_mm_cvtps_pd(position),
+                     _mm_mul_pd(delta, _mm_cvtps_pd(velocity)));
+    __m128d highResult = _mm_add_pd(
+        _mm_cvtps_pd(_mm_movehl_ps(position, position)),
+        _mm_mul_pd(delta, _mm_cvtps_pd(_mm_movehl_ps(velocity, velocity))));
+    return _mm_movelh_ps(_mm_cvtpd_ps(lowResult), _mm_cvtpd_ps(highResult));
+#endif
+}
+
+} // End anonymous namespace
+#endif
+
 void MovementHelpers::moveEntity(Position& position, Movement& movement,
                                  Input::StateArr& inputStates,
                                  double deltaSeconds)
 {
-    // Update the velocity.
-    updateVelocity(movement, inputStates, deltaSeconds);
+    // Convert to our scalar type.
+    BasicPosition<MovementScalar> scalarPosition{
+        toScalar<MovementScalar>(position.x),
+        toScalar<MovementScalar>(position.y),
+        toScalar<MovementScalar>(position.z)};
+    BasicMovement<MovementScalar> scalarMovement{
+        toScalar<MovementScalar>(movement.velX),
+        toScalar<MovementScalar>(movement.velY),
+        toScalar<MovementScalar>(movement.velZ)};
 
-    // Update the position.
-    position.x += (deltaSeconds * movement.velX);
-    position.y += (deltaSeconds * movement.velY);
-    position.z += (deltaSeconds * movement.velZ);
-}
+    // Move.
+    moveEntity(scalarPosition, scalarMovement, inputStates,
+               toScalar<MovementScalar>(deltaSeconds));
 
-Position MovementHelpers::interpolatePosition(PreviousPosition& previousPos,
-                                              Position& position, double alpha)
-{
-    float interpX = (position.x * alpha) + (previousPos.x * (1.0 - alpha));
-    float interpY = (position.y * alpha) + (previousPos.y * (1.0 - alpha));
-    float interpZ = (position.z * alpha) + (previousPos.z * (1.0 - alpha));
-    return {interpX, interpY, interpZ};
+    // Convert back.
+    position.x = fromScalar(scalarPosition.x);
+    position.y = fromScalar(scalarPosition.y);
+    position.z = fromScalar(scalarPosition.z);
+    movement.velX = fromScalar(scalarMovement.velX);
+    movement.velY = fromScalar(scalarMovement.velY);
+    movement.velZ = fromScalar(scalarMovement.velZ);
 }
 
-void MovementHelpers::updateVelocity(Movement& movement,
-                                     Input::StateArr& inputStates,
-                                     double deltaSeconds)
+void MovementHelpers::moveEntities(Position* positions, Movement* movements,
+                                   Input* inputs, std::size_t count,
+                                   double deltaSeconds)
 {
-    // TODO: Ignoring while velocity is constant for testing.
-    ignore(deltaSeconds);
+    std::size_t i = 0;
 
-    static constexpr double VELOCITY = 30;
-    // Y-axis (favors up).
-    if (inputStates[Input::YUp] == Input::Pressed) {
-        movement.velY = -VELOCITY;
-    }
-    else if (inputStates[Input::YDown] == Input::Pressed) {
-        movement.velY = VELOCITY;
-    }
-    else {
-        movement.velY = 0;
-    }
+#if defined(AM_SIMD_MOVEMENT)
+    // Process 4 entities at a time.
+    const __m128 positiveVelocity = _mm_set1_ps(VELOCITY);
+    const __m128 negativeVelocity = _mm_set1_ps(-VELOCITY);
+    for (; (i + 4) <= count; i += 4) {
+        Position* position = &(positions[i]);
+        Movement* movement = &(movements[i]);
 
-    // X-axis (favors up).
-    if (inputStates[Input::XUp] == Input::Pressed) {
-        movement.velX = VELOCITY;
-    }
-    else if (inputStates[Input::XDown] == Input::Pressed) {
-        movement.velX = -VELOCITY;
-    }
-    else {
-        movement.velX = 0;
-    }
+        // Update the velocities (Y is flipped, up is negative).
+        __m128 velX = selectVelocity(&(inputs[i]), Input::XUp, Input::XDown,
+                                     positiveVelocity, negativeVelocity);
+        __m128 velY = selectVelocity(&(inputs[i]), Input::YUp, Input::YDown,
+                                     negativeVelocity, positiveVelocity);
+        __m128 velZ = selectVelocity(&(inputs[i]), Input::ZUp, Input::ZDown,
+                                     positiveVelocity, negativeVelocity);
 
-    // Z-axis (favors up).
-    if (inputStates[Input::ZUp] == Input::Pressed) {
-        movement.velZ = VELOCITY;
-    }
-    else if (inputStates[Input::ZDown] == Input::Pressed) {
-        movement.velZ = -VELOCITY;
+        // Update the positions.
+        __m128 posX = integratePosition(
+            _mm_setr_ps(position[0].x, position[1].x, position[2].x,
+                        position[3].x),
+            velX, deltaSeconds);
+        __m128 posY = integratePosition(
+            _mm_setr_ps(position[0].y, position[1].y, position[2].y,
+                        position[3].y),
+            velY, deltaSeconds);
+        __m128 posZ = integratePosition(
+            _mm_setr_ps(position[0].z, position[1].z, position[2].z,
+                        position[3].z),
+            velZ, deltaSeconds);
+
+        // Write the results back to the components.
+        alignas(16) float results[6][4];
+        _mm_store_ps(results[0], velX);
+        _mm_store_ps(results[1], velY);
+        _mm_store_ps(results[2], velZ);
+        _mm_store_ps(results[3], posX);
+        _mm_store_ps(results[4], posY);
+        _mm_store_ps(results[5], posZ);
+        for (std::size_t j = 0; j < 4; ++j) {
+            movement[j].velX = results[0][j];
+            movement[j].velY = results[1][j];
+            movement[j].velZ = results[2][j];
+            position[j].x = results[3][j];
+            position[j].y = results[4][j];
+            position[j].z = results[5][j];
+        }
     }
-    else {
-        movement.velZ = 0;
+#endif
+
+    // Move any remaining entities one at a time.
+    // Note: If SIMD isn't available, this handles every entity.
+    for (; i < count; ++i) {
+        moveEntity(positions[i], movements[i], inputs[i].inputStates,
+                   deltaSeconds);
     }
 }
 
+Position MovementHelpers::interpolatePosition(PreviousPosition& previousPos,
+                                              Position& position, double alpha)
+{
+    float interpX = (position.x * alpha) + (previousPos.x * (1.0 - alpha));
+    float interpY = (position.y * alpha) + (previousPos.y * (1.0 - alpha));
+    float interpZ = (position.z * alpha) + (previousPos.z * (1.0 - alpha));
+    return {interpX, interpY, interpZ};
+}
+
 void MovementHelpers::moveSpriteWorldBounds(Position& position, Sprite& sprite)
 {
     // Move the sprite's world bounds to the given position.
@@ -1,7 +1,10 @@
 #pragma once
 
 #include "Input.h"
+#include "MovementScalar.h"
+#include "Ignore.h"
 #include <array>
+#include <cstddef>
 
 namespace AM
 {
@@ -22,16 +25,62 @@ public:
      */
     static constexpr float acceleration = 750;
 
+    /**
+     * The speed that entities move at along each axis. Velocities are always
+     * 0 or +/- this value.
+     * TODO: Eventually move this to be dynamic based on the player stats.
+     */
+    static constexpr float VELOCITY = 30;
+
     /**
      * Moves the given PositionComponent and MovementComponent based on the
      * given inputStates and deltaSeconds.
      *
+     * The math is done in MovementScalar.
+     *
      * @post The given position and movement components are modified in-place to
      * the new data.
      */
     static void moveEntity(Position& position, Movement& movement,
                            Input::StateArr& inputStates, double deltaSeconds);
 
+    /**
+     * Moves the given position and movement based on the given inputStates
+     * and deltaSeconds, using the math of the given scalar type.
+     *
+     * @post The given position and movement are modified in-place to the new
+     * data.
+     */
+    template<typename T>
+    static void moveEntity(BasicPosition<T>& position,
+                           BasicMovement<T>& movement,
+                           const Input::StateArr& inputStates, T deltaSeconds)
+    {
+        // Update the velocity.
+        updateVelocity(movement, inputStates, deltaSeconds);
+
+        // Update the position.
+        position.x += (deltaSeconds * movement.velX);
+        position.y += (deltaSeconds * movement.velY);
+        position.z += (deltaSeconds * movement.velZ);
+    }
+
+    /**
+     * Moves count entities, where the i'th entity's components are at
+     * positions[i], movements[i], and inputs[i].
+     *
+     * Processes several entities at a time with SIMD when it's available.
+     * Results are bit-exact with calling moveEntity() on each entity, since
+     * client prediction relies on the server and client getting the same
+     * results.
+     *
+     * @post The given position and movement components are modified in-place
+     * to the new data.
+     */
+    static void moveEntities(Position* positions, Movement* movements,
+                             Input* inputs, std::size_t count,
+                             double deltaSeconds);
+
     /**
      * Returns a position interpolated between previousPos and position.
      */
@@ -45,13 +94,53 @@ public:
 
 private:
     /**
-     * Moves the given MovementComponent based on the given inputStates and
+     * Moves the given movement based on the given inputStates and
      * deltaSeconds.
      *
-     * @post The given movement component is modified in-place to the new data.
+     * @post The given movement is modified in-place to the new data.
      */
-    static void updateVelocity(Movement& movement, Input::StateArr& inputStates,
-                               double deltaSeconds);
+    template<typename T>
+    static void updateVelocity(BasicMovement<T>& movement,
+                               const Input::StateArr& inputStates,
+                               T deltaSeconds)
+    {
+        // TODO: Ignoring while velocity is constant for testing.
+        ignore(deltaSeconds);
+        const T velocity = toScalar<T>(VELOCITY);
+
+        // Y-axis (favors up).
+        if (inputStates[Input::YUp] == Input::Pressed) {
+            movement.velY = -velocity;
+        }
+        else if (inputStates[Input::YDown] == Input::Pressed) {
+            movement.velY = velocity;
+        }
+        else {
+            movement.velY = T{};
+        }
+
+        // X-axis (favors up).
+        if (inputStates[Input::XUp] == Input::Pressed) {
+            movement.velX = velocity;
+        }
+        else if (inputStates[Input::XDown] == Input::Pressed) {
+            movement.velX = -velocity;
+        }
+        else {
+            movement.velX = T{};
+        }
+
+        // Z-axis (favors up).
+        if (inputStates[Input::ZUp] == Input::Pressed) {
+            movement.velZ = velocity;
+        }
+        else if (inputStates[Input::ZDown] == Input::Pressed) {
+            movement.velZ = -velocity;
+        }
+        else {
+            movement.velZ = T{};
+        }
+    }
 };
 
 } // namespace AM
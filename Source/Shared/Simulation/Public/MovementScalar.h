@@ -0,0 +1,77 @@
+#pragma once
+
+#include "FixedPoint.h"
+#include "SDL_stdinc.h"
+#include <type_traits>
+
+namespace AM
+{
+/**
+ * The scalar type that MovementHelpers does its math in.
+ *
+ * By default, this is double (matching the original float/double mixed
+ * math). If AM_FIXED_POINT_MOVEMENT is defined, this is a fixed-point type,
+ * so that the client's prediction and the server's simulation get identical
+ * results regardless of compiler or CPU.
+ *
+ * Components are still stored as float. Conversions between float and the
+ * scalar type are deterministic, so this only changes how each step is
+ * calculated.
+ */
+#if defined(AM_FIXED_POINT_MOVEMENT)
+/** 16 fractional bits, so 1/30s steps stay close to exact. 64-bit storage
+    leaves plenty of room for products. */
+using MovementScalar = FixedPoint<Sint64, 16>;
+#else
+using MovementScalar = double;
+#endif
+
+/**
+ * A Position, in a given scalar type.
+ */
+template<typename T>
+struct BasicPosition {
+    T x{};
+    T y{};
+    T z{};
+};
+
+/**
+ * A Movement's velocity, in a given scalar type.
+ */
+template<typename T>
+struct BasicMovement {
+    T velX{};
+    T velY{};
+    T velZ{};
+};
+
+/**
+ * Converts the given value to the given scalar type.
+ */
+template<typename T>
+T toScalar(double value)
+{
+    if constexpr (std::is_floating_point_v<T>) {
+        return static_cast<T>(value);
+    }
+    else {
+        return T::fromFloat(value);
+    }
+}
+
+/**
+ * Converts the given scalar value back to float.
+ */
+template<typename T>
+float fromScalar(T value)
+{
+    if constexpr (std::is_floating_point_v<T>) {
+        return static_cast<float>(value);
+    }
+    else {
+        return value.toFloat();
+    }
+}
+
+} // End namespace AM
@@ -0,0 +1,120 @@
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace AM
+{
+LatencyHistogram::LatencyHistogram()
+: bucketCounts{}
+, totalCount(0)
+, maxValue(0)
+{
+}
+
+void LatencyHistogram::record(double seconds)
+{
+    // Negative durations can come from clock mismatches, treat them as 0.
+    if (seconds <= 0) {
+        recordValue(0);
+    }
+    else {
+        recordValue(static_cast<Uint64>(std::llround(seconds * 1e6)));
+    }
+}
+
+void LatencyHistogram::recordValue(Uint64 value)
+{
+    value = std::min(value, MAX_VALUE_US);
+
+    bucketCounts[getBucketIndex(value)].fetch_add(1,
+                                                  std::memory_order_relaxed);
+    totalCount.fetch_add(1, std::memory_order_relaxed);
+
+    // Raise the max if this value is higher.
+    Uint64 currentMax = maxValue.load(std::memory_order_relaxed);
+    while ((value > currentMax)
+           && !(maxValue.compare_exchange_weak(currentMax, value,
+                                               std::memory_order_relaxed))) {
+    }
+}
+
+Uint64 LatencyHistogram::getPercentile(double percentile) const
+{
+    Uint64 count = totalCount.load(std::memory_order_relaxed);
+    if (count == 0) {
+        return 0;
+    }
+
+    // Find the number of values that must be at or below the result.
+    percentile = std::clamp(percentile, 0.0, 100.0);
+    Uint64 targetCount = static_cast<Uint64>(
+        std::ceil((percentile / 100.0) * static_cast<double>(count)));
+    targetCount = std::max(targetCount, Uint64{1});
+
+    // Walk the buckets until we've passed that many values.
+    // Note: If values are recorded while we walk, we may see more than count
+    //       values, but never fewer (unless we're reset).
+    Uint64 max = maxValue.load(std::memory_order_relaxed);
+    Uint64 seenCount = 0;
+    for (std::size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seenCount += bucketCounts[i].load(std::memory_order_relaxed);
+        if (seenCount >= targetCount) {
+            // Don't report a value higher than what was actually recorded.
+            return std::min(getBucketMaxValue(i), max);
+        }
+    }
+
+    return max;
+}
+
+Uint64 LatencyHistogram::getCount() const
+{
+    return totalCount.load(std::memory_order_relaxed);
+}
+
+Uint64 LatencyHistogram::getMax() const
+{
+    return maxValue.load(std::memory_order_relaxed);
+}
+
+void LatencyHistogram::reset()
+{
+    for (std::atomic<Uint64>& bucketCount : bucketCounts) {
+        bucketCount.store(0, std::memory_order_relaxed);
+    }
+    totalCount.store(0, std::memory_order_relaxed);
+    maxValue.store(0, std::memory_order_relaxed);
+}
+
+std::size_t LatencyHistogram::getBucketIndex(Uint64 value)
+{
+    // Small values get their own bucket.
+    if (value < SUB_BUCKET_COUNT) {
+        return static_cast<std::size_t>(value);
+    }
+
+    // Larger values are bucketed by their top SUB_BUCKET_BITS bits.
+    unsigned int magnitude = (std::bit_width(value) - 1);
+    unsigned int shift = (magnitude - (SUB_BUCKET_BITS - 1));
+    Uint64 subBucket = ((value >> shift) - SUB_BUCKET_HALF_COUNT);
+    return static_cast<std::size_t>(SUB_BUCKET_COUNT
+                                    + ((shift - 1) * SUB_BUCKET_HALF_COUNT)
+                                    + subBucket);
+}
+
+Uint64 LatencyHistogram::getBucketMaxValue(std::size_t bucketIndex)
+{
+    if (bucketIndex < SUB_BUCKET_COUNT) {
+        return bucketIndex;
+    }
+
+    // Reverse the math from getBucketIndex().
+    std::size_t offset = (bucketIndex - SUB_BUCKET_COUNT);
+    unsigned int shift
+        = static_cast<unsigned int>(offset / SUB_BUCKET_HALF_COUNT) + 1;
+    Uint64 topBits = ((offset % SUB_BUCKET_HALF_COUNT) + SUB_BUCKET_HALF_COUNT);
+    return (((topBits + 1) << shift) - 1);
+}
+
+} // End namespace AM
@@ -1,6 +1,14 @@
 #include "Log.h"
+#include "LogRingBuffer.h"
 #include <cstdio>
 #include <cstdarg>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace AM
 {
@@ -8,6 +16,227 @@ const std::atomic<Uint32>* Log::currentTickPtr = nullptr;
 std::atomic<bool> Log::tickPtrIsRegistered = false;
 FILE* logFilePtr = nullptr;
 
+namespace
+{
+/**
+ * Drains each logging thread's ring buffer and writes the messages in
+ * batches.
+ */
+class AsyncLogWriter
+{
+public:
+    /** How often we write queued messages, if nothing asks us to sooner. */
+    static constexpr std::chrono::milliseconds WRITE_INTERVAL{10};
+
+    AsyncLogWriter()
+    : isEnabled(false)
+    , exitRequested(false)
+    , flushRequests(0)
+    , flushesCompleted(0)
+    , totalDropCount(0)
+    {
+    }
+
+    ~AsyncLogWriter() { stop(); }
+
+    void start()
+    {
+        std::unique_lock<std::mutex> lock(writerMutex);
+        if (isEnabled) {
+            return;
+        }
+
+        exitRequested = false;
+        writerThreadObj = std::thread(&AsyncLogWriter::writerLoop, this);
+        isEnabled.store(true, std::memory_order_release);
+    }
+
+    void stop()
+    {
+        {
+            std::unique_lock<std::mutex> lock(writerMutex);
+            if (!isEnabled) {
+                return;
+            }
+
+            isEnabled.store(false, std::memory_order_release);
+            exitRequested = true;
+        }
+        writerCondVar.notify_one();
+
+        // Note: The writer does a final drain before it exits.
+        writerThreadObj.join();
+    }
+
+    bool enabled() const { return isEnabled.load(std::memory_order_acquire); }
+
+    /**
+     * Returns the calling thread's ring, creating it if necessary.
+     */
+    LogRingBuffer& getThreadRing()
+    {
+        // Rings are never destroyed, so any records that a thread leaves
+        // behind when it exits still get written.
+        thread_local LogRingBuffer* threadRing = nullptr;
+        if (threadRing == nullptr) {
+            std::unique_lock<std::mutex> lock(ringsMutex);
+            rings.push_back(std::make_unique<LogRingBuffer>());
+            reportedDropCounts.push_back(0);
+            threadRing = rings.back().get();
+        }
+
+        return *threadRing;
+    }
+
+    /**
+     * Blocks until all messages that were queued before this call have been
+     * written.
+     */
+    void flush()
+    {
+        std::unique_lock<std::mutex> lock(writerMutex);
+        if (!isEnabled) {
+            return;
+        }
+
+        Uint64 flushRequest = ++flushRequests;
+        writerCondVar.notify_one();
+        flushCondVar.wait(
+            lock, [&]() { return (flushesCompleted >= flushRequest); });
+    }
+
+    Uint64 getDropCount() const
+    {
+        return totalDropCount.load(std::memory_order_relaxed);
+    }
+
+private:
+    void writerLoop()
+    {
+        std::string batch;
+        while (true) {
+            // Wait until it's time to write, or someone needs us to.
+            Uint64 flushRequest = 0;
+            bool shouldExit = false;
+            {
+                std::unique_lock<std::mutex> lock(writerMutex);
+                writerCondVar.wait_for(lock, WRITE_INTERVAL, [&]() {
+                    return (exitRequested
+                            || (flushRequests != flushesCompleted));
+                });
+                flushRequest = flushRequests;
+                shouldExit = exitRequested;
+            }
+
+            // Write everything that's been queued.
+            drainRings(batch);
+            writeBatch(batch);
+
+            // Let any flush() callers know that we're done.
+            {
+                std::unique_lock<std::mutex> lock(writerMutex);
+                flushesCompleted = flushRequest;
+            }
+            flushCondVar.notify_all();
+
+            if (shouldExit) {
+                return;
+            }
+        }
+    }
+
+    /**
+     * Appends all queued messages, and a note for any new drops, to the
+     * given batch.
+     */
+    void drainRings(std::string& batch)
+    {
+        // Note: This lock is only contended when a thread logs for the
+        //       first time.
+        std::unique_lock<std::mutex> lock(ringsMutex);
+        char prefix[32];
+        for (std::size_t i = 0; i < rings.size(); ++i) {
+            LogRingBuffer& ring = *(rings[i]);
+            while (const LogRecord* record = ring.front()) {
+                int prefixLength = std::snprintf(prefix, sizeof(prefix),
+                                                 "Tick %u: ", record->tickNum);
+                batch.append(prefix, static_cast<std::size_t>(prefixLength));
+                batch.append(record->text, record->textLength);
+                batch.push_back('\n');
+                ring.popFront();
+            }
+
+            // If this ring dropped anything since we last checked, note it.
+            Uint64 dropCount = ring.getDropCount();
+            if (dropCount != reportedDropCounts[i]) {
+                Uint64 newDrops = (dropCount - reportedDropCounts[i]);
+                batch.append("Dropped " + std::to_string(newDrops)
+                             + " log messages (ring buffer was full).\n");
+                totalDropCount.fetch_add(newDrops, std::memory_order_relaxed);
+                reportedDropCounts[i] = dropCount;
+            }
+        }
+    }
+
+    /**
+     * Writes the given batch to stdout and the log file (if enabled), then
+     * clears it.
+     */
+    void writeBatch(std::string& batch)
+    {
+        if (batch.empty()) {
+            return;
+        }
+
+        if (logFilePtr != nullptr) {
+            std::fwrite(batch.data(), 1, batch.size(), logFilePtr);
+            std::fflush(logFilePtr);
+        }
+        std::fwrite(batch.data(), 1, batch.size(), stdout);
+        std::fflush(stdout);
+
+        batch.clear();
+    }
+
+    /** If true, info messages should be pushed to the rings. */
+    std::atomic<bool> isEnabled;
+
+    /** Protects rings and reportedDropCounts. */
+    std::mutex ringsMutex;
+
+    /** Each logging thread's ring. */
+    std::vector<std::unique_ptr<LogRingBuffer>> rings;
+
+    /** The drop count of each ring, as of our last report. */
+    std::vector<Uint64> reportedDropCounts;
+
+    std::thread writerThreadObj;
+
+    /** Protects exitRequested, flushRequests, and flushesCompleted. */
+    std::mutex writerMutex;
+
+    /** Used to wake the writer early. */
+    std::condition_variable writerCondVar;
+
+    /** Used to wake flush() callers once we've written. */
+    std::condition_variable flushCondVar;
+
+    bool exitRequested;
+
+    /** Incremented each time that flush() is called. */
+    Uint64 flushRequests;
+
+    /** The latest flush request that has been completed. */
+    Uint64 flushesCompleted;
+
+    /** The total number of dropped messages that we've reported. */
+    std::atomic<Uint64> totalDropCount;
+};
+
+AsyncLogWriter asyncLogWriter;
+
+} // End anonymous namespace
+
 void Log::registerCurrentTickPtr(const std::atomic<Uint32>* inCurrentTickPtr)
 {
     currentTickPtr = inCurrentTickPtr;
@@ -26,6 +255,23 @@ void Log::info(const char* expression, ...)
     std::va_list arg;
     va_start(arg, expression);
 
+    // If async logging is enabled, format into our ring and let the writer
+    // thread handle the rest.
+    if (asyncLogWriter.enabled()) {
+        LogRingBuffer& ring = asyncLogWriter.getThreadRing();
+        if (LogRecord* record = ring.beginPush()) {
+            record->tickNum = currentTick;
+            int length = std::vsnprintf(
+                record->text, LogRecord::MAX_TEXT_LENGTH, expression, arg);
+            record->textLength = static_cast<Uint16>(std::clamp(
+                length, 0, static_cast<int>(LogRecord::MAX_TEXT_LENGTH - 1)));
+            ring.endPush();
+        }
+
+        va_end(arg);
+        return;
+    }
+
     // If enabled, write to file.
     if (logFilePtr != nullptr) {
         // Copy the va_list since it's undefined to use it twice.
@@ -57,6 +303,9 @@ void Log::error(const char* fileName, int line, const char* expression, ...)
         currentTick = *currentTickPtr;
     }
 
+    // Make sure any queued messages get written before the error.
+    asyncLogWriter.flush();
+
     // Get the va_list into arg.
     std::va_list arg;
     va_start(arg, expression);
@@ -96,4 +345,19 @@ void Log::enableFileLogging(const std::string& fileName)
     }
 }
 
+void Log::enableAsyncLogging()
+{
+    asyncLogWriter.start();
+}
+
+void Log::disableAsyncLogging()
+{
+    asyncLogWriter.stop();
+}
+
+Uint64 Log::getDroppedMessageCount()
+{
+    return asyncLogWriter.getDropCount();
+}
+
 } // namespace AM
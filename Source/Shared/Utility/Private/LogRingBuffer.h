@@ -0,0 +1,125 @@
+#pragma once
+
+#include <SDL_stdinc.h>
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace AM
+{
+/**
+ * A single log message, formatted by the thread that logged it.
+ */
+struct LogRecord {
+    /** The longest message that we'll store. Longer messages are truncated.
+     */
+    static constexpr std::size_t MAX_TEXT_LENGTH = 256;
+
+    /** The sim tick that the message was logged during. */
+    Uint32 tickNum;
+
+    /** The length of text, not including the null terminator. */
+    Uint16 textLength;
+
+    /** The formatted message. Null terminated. */
+    char text[MAX_TEXT_LENGTH];
+};
+
+/**
+ * A fixed-size, lock-free ring of log records, written to by a single
+ * logging thread and read by the log writer thread.
+ *
+ * If the ring is full, new records are dropped and counted instead of
+ * blocking the logging thread.
+ */
+class LogRingBuffer
+{
+public:
+    /** The number of records that the ring can hold. Must be a power of 2.
+     */
+    static constexpr std::size_t CAPACITY = 1024;
+
+    LogRingBuffer()
+    : head(0)
+    , tail(0)
+    , dropCount(0)
+    {
+    }
+
+    /**
+     * Returns the next record to write into, or nullptr if the ring is full.
+     * If a record is returned, call endPush() once it's filled in.
+     *
+     * Only call from the producer thread.
+     */
+    LogRecord* beginPush()
+    {
+        std::size_t currentHead = head.load(std::memory_order_relaxed);
+        if ((currentHead - tail.load(std::memory_order_acquire)) == CAPACITY) {
+            // Full, drop the record.
+            dropCount.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        return &(records[currentHead & (CAPACITY - 1)]);
+    }
+
+    /**
+     * Publishes the record returned by beginPush() to the consumer.
+     */
+    void endPush()
+    {
+        head.store(head.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_release);
+    }
+
+    /**
+     * Returns the oldest record, or nullptr if the ring is empty.
+     * If a record is returned, call popFront() once it's been used.
+     *
+     * Only call from the consumer thread.
+     */
+    const LogRecord* front() const
+    {
+        std::size_t currentTail = tail.load(std::memory_order_relaxed);
+        if (currentTail == head.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+
+        return &(records[currentTail & (CAPACITY - 1)]);
+    }
+
+    /**
+     * Releases the record returned by front() back to the producer.
+     */
+    void popFront()
+    {
+        tail.store(tail.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_release);
+    }
+
+    /** Returns the number of records that have been dropped. */
+    Uint64 getDropCount() const
+    {
+        return dropCount.load(std::memory_order_relaxed);
+    }
+
+private:
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0,
+                  "CAPACITY must be a power of 2.");
+
+    std::array<LogRecord, CAPACITY> records;
+
+    /** The number of records that have been pushed. Written by the
+        producer. */
+    alignas(64) std::atomic<std::size_t> head;
+
+    /** The number of records that have been popped. Written by the
+        consumer. */
+    alignas(64) std::atomic<std::size_t> tail;
+
+    /** The number of records that were dropped because we were full. */
+    alignas(64) std::atomic<Uint64> dropCount;
+};
+
+} // End namespace AM
@@ -1,5 +1,6 @@
 #include "PeriodicCaller.h"
 #include "Log.h"
+#include <cmath>
 
 namespace AM
 {
@@ -12,6 +13,8 @@ PeriodicCaller::PeriodicCaller(std::function<void(void)> inGivenFunctNoTimestep,
 , skipLateSteps(inSkipLateSteps)
 , accumulatedTime(0.0)
 , delayedTimeS(-1)
+, callsTillStatsDump(0)
+, callsSinceStatsDump(0)
 {
     // Prime the timer so we don't get a giant value on the first usage.
     timer.updateSavedTime();
@@ -26,6 +29,8 @@ PeriodicCaller::PeriodicCaller(std::function<void(double)> inGivenFunctTimestep,
 , skipLateSteps(inSkipLateSteps)
 , accumulatedTime(0.0)
 , delayedTimeS(-1)
+, callsTillStatsDump(0)
+, callsSinceStatsDump(0)
 {
     // Prime the timer so we don't get a giant value on the first usage.
     timer.updateSavedTime();
@@ -41,9 +46,20 @@ void PeriodicCaller::update()
     // Accumulate the time passed since the last update().
     accumulatedTime += timer.getDeltaSeconds(true);
 
+    // If more than 1 step is due, the extras are either going to run late or
+    // be skipped.
+    double dueSteps = std::floor(accumulatedTime / timestepS);
+    if (dueSteps >= 1) {
+        missedSteps.recordValue(static_cast<Uint64>(dueSteps) - 1);
+    }
+
     // Process as many time steps as have accumulated.
     while (accumulatedTime >= timestepS) {
+        // Track how late this step is starting.
+        startDelays.record(accumulatedTime - timestepS);
+
         // Call whichever function we were given on construction.
+        executionTimer.updateSavedTime();
         if (givenFunctNoTimestep != nullptr) {
             givenFunctNoTimestep();
         }
@@ -52,12 +68,20 @@ void PeriodicCaller::update()
         }
 
         // Check our execution time.
-        double executionTime = timer.getDeltaSeconds(false);
+        double executionTime = executionTimer.getDeltaSeconds(false);
+        executionTimes.record(executionTime);
         if (executionTime > timestepS) {
             LOG_INFO("%s overran its update timestep. executionTime: %.5fs",
                      debugName.c_str(), executionTime);
         }
 
+        // If it's time to log our statistics, do so.
+        if ((callsTillStatsDump != 0)
+            && (++callsSinceStatsDump == callsTillStatsDump)) {
+            logStatistics();
+            callsSinceStatsDump = 0;
+        }
+
         // Deduct this time step from the accumulator and check for delays.
         accumulatedTime -= timestepS;
         if (accumulatedTime >= timestepS) {
@@ -105,4 +129,58 @@ void PeriodicCaller::reportDelays(double inDelayedTimeS)
     delayedTimeS = inDelayedTimeS;
 }
 
+void PeriodicCaller::reportStatistics(double intervalS)
+{
+    callsTillStatsDump
+        = static_cast<unsigned int>(std::ceil(intervalS / timestepS));
+    callsSinceStatsDump = 0;
+}
+
+const std::string& PeriodicCaller::getDebugName() const
+{
+    return debugName;
+}
+
+const LatencyHistogram& PeriodicCaller::getExecutionTimes() const
+{
+    return executionTimes;
+}
+
+const LatencyHistogram& PeriodicCaller::getStartDelays() const
+{
+    return startDelays;
+}
+
+const LatencyHistogram& PeriodicCaller::getMissedSteps() const
+{
+    return missedSteps;
+}
+
+void PeriodicCaller::logStatistics()
+{
+    LOG_INFO("%s execution time (us): calls: %u, p50: %u, p99: %u, "
+             "p99.9: %u, max: %u",
+             debugName.c_str(),
+             static_cast<unsigned int>(executionTimes.getCount()),
+             static_cast<unsigned int>(executionTimes.getPercentile(50)),
+             static_cast<unsigned int>(executionTimes.getPercentile(99)),
+             static_cast<unsigned int>(executionTimes.getPercentile(99.9)),
+             static_cast<unsigned int>(executionTimes.getMax()));
+    LOG_INFO("%s start delay (us): p50: %u, p99: %u, p99.9: %u, max: %u",
+             debugName.c_str(),
+             static_cast<unsigned int>(startDelays.getPercentile(50)),
+             static_cast<unsigned int>(startDelays.getPercentile(99)),
+             static_cast<unsigned int>(startDelays.getPercentile(99.9)),
+             static_cast<unsigned int>(startDelays.getMax()));
+    LOG_INFO("%s missed steps: p99: %u, p99.9: %u, max: %u", debugName.c_str(),
+             static_cast<unsigned int>(missedSteps.getPercentile(99)),
+             static_cast<unsigned int>(missedSteps.getPercentile(99.9)),
+             static_cast<unsigned int>(missedSteps.getMax()));
+
+    // Start fresh, so that each summary only covers its own interval.
+    executionTimes.reset();
+    startDelays.reset();
+    missedSteps.reset();
+}
+
 } // namespace AM
@@ -0,0 +1,110 @@
+#include "TickScheduler.h"
+#include "PeriodicCaller.h"
+#include "Log.h"
+#include "SDL_timer.h"
+#include <algorithm>
+#include <limits>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <ctime>
+#endif
+
+namespace AM
+{
+TickScheduler::TickScheduler()
+{
+    statsTimer.updateSavedTime();
+}
+
+void TickScheduler::addCaller(PeriodicCaller& caller)
+{
+    scheduledCallers.emplace_back().caller = &caller;
+}
+
+void TickScheduler::initTimers()
+{
+    for (ScheduledCaller& scheduledCaller : scheduledCallers) {
+        scheduledCaller.caller->initTimer();
+    }
+    statsTimer.updateSavedTime();
+}
+
+void TickScheduler::update()
+{
+    // Sleep until the next caller is due.
+    double timeLeft = std::numeric_limits<double>::max();
+    for (ScheduledCaller& scheduledCaller : scheduledCallers) {
+        timeLeft
+            = std::min(timeLeft, scheduledCaller.caller->getTimeTillNextCall());
+    }
+    if (timeLeft > 0) {
+        sleepFor(timeLeft);
+    }
+
+    // Update each caller, recording how late the due ones are starting.
+    for (ScheduledCaller& scheduledCaller : scheduledCallers) {
+        double callerTimeLeft = scheduledCaller.caller->getTimeTillNextCall();
+        if (callerTimeLeft <= 0) {
+            scheduledCaller.startLatencies.record(-callerTimeLeft);
+        }
+
+        scheduledCaller.caller->update();
+    }
+
+    // If it's time to log our statistics, do so.
+    if (statsTimer.getDeltaSeconds(false) >= SECONDS_TILL_STATS_DUMP) {
+        logStatistics();
+        statsTimer.updateSavedTime();
+    }
+}
+
+const LatencyHistogram&
+    TickScheduler::getStartLatencies(std::size_t callerIndex) const
+{
+    return scheduledCallers.at(callerIndex).startLatencies;
+}
+
+void TickScheduler::sleepFor(double seconds)
+{
+#if defined(__linux__)
+    // Calculate the absolute time to wake at.
+    timespec deadline{};
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    Uint64 nanoseconds = (static_cast<Uint64>(deadline.tv_nsec)
+                          + static_cast<Uint64>(seconds * 1e9));
+    deadline.tv_sec += static_cast<time_t>(nanoseconds / 1'000'000'000);
+    deadline.tv_nsec = static_cast<long>(nanoseconds % 1'000'000'000);
+
+    // Sleep until the deadline. Since it's absolute, we can just go back to
+    // sleep if a signal interrupts us.
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr)
+           == EINTR) {
+    }
+#else
+    if (seconds > SLEEP_MINIMUM_TIME_S) {
+        // We have enough time to sleep for a few ms.
+        // Note: We try to delay for 1ms because the OS will generally end
+        //       up delaying us for 1-3ms.
+        SDL_Delay(1);
+    }
+#endif
+}
+
+void TickScheduler::logStatistics()
+{
+    for (ScheduledCaller& scheduledCaller : scheduledCallers) {
+        LatencyHistogram& latencies = scheduledCaller.startLatencies;
+        LOG_INFO("%s start latency (us): calls: %u, p50: %u, p99: %u, "
+                 "p99.9: %u, max: %u",
+                 scheduledCaller.caller->getDebugName().c_str(),
+                 static_cast<unsigned int>(latencies.getCount()),
+                 static_cast<unsigned int>(latencies.getPercentile(50)),
+                 static_cast<unsigned int>(latencies.getPercentile(99)),
+                 static_cast<unsigned int>(latencies.getPercentile(99.9)),
+                 static_cast<unsigned int>(latencies.getMax()));
+        latencies.reset();
+    }
+}
+
+} // End namespace AM
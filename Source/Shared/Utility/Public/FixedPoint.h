@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cmath>
+#include <type_traits>
+
+namespace AM
+{
+/**
+ * A fixed-point number, stored as an integer scaled by 2^FractionalBits.
+ *
+ * All arithmetic is integer arithmetic, so results are the same on every
+ * compiler and CPU, unlike floating point (which can change with x87 use,
+ * FMA contraction, etc).
+ *
+ * Conversions to and from floating point round to nearest, which IEEE
+ * defines exactly, so they're also deterministic.
+ *
+ * @tparam StorageType  The signed integer type to store the value in. Must
+ *                      be wide enough to hold the product of two values
+ *                      before it's shifted back down.
+ * @tparam FractionalBits  The number of bits used for the fractional part.
+ */
+template<typename StorageType, int FractionalBits>
+class FixedPoint
+{
+public:
+    static_assert(std::is_integral_v<StorageType>
+                      && std::is_signed_v<StorageType>,
+                  "StorageType must be a signed integer.");
+    static_assert((FractionalBits > 0)
+                      && (FractionalBits < (sizeof(StorageType) * 8 - 1)),
+                  "FractionalBits must leave room for the integer part.");
+
+    /** The value that 1.0 is stored as. */
+    static constexpr StorageType ONE = (StorageType{1} << FractionalBits);
+
+    constexpr FixedPoint()
+    : rawValue(0)
+    {
+    }
+
+    /**
+     * Returns the fixed-point value closest to the given value.
+     */
+    static FixedPoint fromFloat(double value)
+    {
+        return fromRaw(static_cast<StorageType>(std::llround(value * ONE)));
+    }
+
+    /**
+     * Returns a fixed-point value with the given underlying integer.
+     */
+    static constexpr FixedPoint fromRaw(StorageType rawValue)
+    {
+        FixedPoint fixedPoint;
+        fixedPoint.rawValue = rawValue;
+        return fixedPoint;
+    }
+
+    /** Returns the floating point value closest to this value. */
+    float toFloat() const
+    {
+        return static_cast<float>(static_cast<double>(rawValue) / ONE);
+    }
+
+    /** Returns the underlying integer. */
+    constexpr StorageType getRaw() const { return rawValue; }
+
+    constexpr FixedPoint operator+(FixedPoint other) const
+    {
+        return fromRaw(rawValue + other.rawValue);
+    }
+
+    constexpr FixedPoint operator-(FixedPoint other) const
+    {
+        return fromRaw(rawValue - other.rawValue);
+    }
+
+    constexpr FixedPoint operator-() const { return fromRaw(-rawValue); }
+
+    /** Rounds to nearest, with halves rounding towards positive infinity. */
+    constexpr FixedPoint operator*(FixedPoint other) const
+    {
+        StorageType product = (rawValue * other.rawValue);
+        return fromRaw((product + (ONE / 2)) >> FractionalBits);
+    }
+
+    constexpr FixedPoint& operator+=(FixedPoint other)
+    {
+        rawValue += other.rawValue;
+        return *this;
+    }
+
+    constexpr FixedPoint& operator-=(FixedPoint other)
+    {
+        rawValue -= other.rawValue;
+        return *this;
+    }
+
+    constexpr bool operator==(const FixedPoint& other) const = default;
+
+private:
+    StorageType rawValue;
+};
+
+} // End namespace AM
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "SDL_stdinc.h"
+#include <array>
+#include <atomic>
+
+namespace AM
+{
+/**
+ * A histogram of durations, used to track latency percentiles.
+ *
+ * Values are recorded in microseconds, into buckets that grow exponentially
+ * (like an HDR histogram): values below SUB_BUCKET_COUNT get their own
+ * bucket, and each power of 2 above that is split into SUB_BUCKET_COUNT / 2
+ * linear buckets. This keeps the relative error under ~6% at every scale,
+ * with a small, fixed amount of memory.
+ * Plain counts (e.g. a number of missed steps) can also be recorded, through
+ * recordValue().
+ *
+ * Values larger than MAX_VALUE_US are recorded as MAX_VALUE_US.
+ *
+ * Thread safety: Recording and querying are lock-free, and can be done from
+ * any thread. Queries that run during a record may not see it yet.
+ * reset() shouldn't be called while other threads are recording.
+ */
+class LatencyHistogram
+{
+public:
+    /** The number of bits of precision that each bucket range has. */
+    static constexpr unsigned int SUB_BUCKET_BITS = 5;
+    static constexpr Uint64 SUB_BUCKET_COUNT = (1 << SUB_BUCKET_BITS);
+    static constexpr Uint64 SUB_BUCKET_HALF_COUNT = (SUB_BUCKET_COUNT / 2);
+
+    /** The largest power of 2 that we track. 2^26us is just over a minute. */
+    static constexpr unsigned int MAX_MAGNITUDE = 26;
+    static constexpr Uint64 MAX_VALUE_US = ((Uint64{1} << MAX_MAGNITUDE) - 1);
+
+    /** The total number of buckets. */
+    static constexpr std::size_t BUCKET_COUNT
+        = (SUB_BUCKET_COUNT
+           + ((MAX_MAGNITUDE - SUB_BUCKET_BITS) * SUB_BUCKET_HALF_COUNT));
+
+    LatencyHistogram();
+
+    /**
+     * Records the given duration.
+     */
+    void record(double seconds);
+
+    /**
+     * Records the given value (for durations, in microseconds).
+     */
+    void recordValue(Uint64 value);
+
+    /**
+     * Returns the value (for durations, in microseconds) that the given
+     * percentage of recorded values are less than or equal to.
+     * Reported values are the top of their bucket, so they may be slightly
+     * higher than the actual recorded values.
+     *
+     * @param percentile  The percentile to find, e.g. 99.9.
+     * @return The value at the given percentile, or 0 if nothing has been
+     *         recorded.
+     */
+    Uint64 getPercentile(double percentile) const;
+
+    /** Returns the number of recorded values. */
+    Uint64 getCount() const;
+
+    /** Returns the largest recorded value. */
+    Uint64 getMax() const;
+
+    /**
+     * Clears all recorded values.
+     */
+    void reset();
+
+private:
+    /**
+     * Returns the index of the bucket that the given value falls into.
+     */
+    static std::size_t getBucketIndex(Uint64 value);
+
+    /**
+     * Returns the largest value that falls into the given bucket.
+     */
+    static Uint64 getBucketMaxValue(std::size_t bucketIndex);
+
+    /** The number of values recorded in each bucket. */
+    std::array<std::atomic<Uint64>, BUCKET_COUNT> bucketCounts;
+
+    /** The total number of recorded values. */
+    std::atomic<Uint64> totalCount;
+
+    /** The largest recorded value. */
+    std::atomic<Uint64> maxValue;
+};
+
+} // End namespace AM
@@ -23,6 +23,13 @@ namespace AM
 {
 /**
  * Facilitates logging info and errors to stdout or a log file.
+ *
+ * By default, messages are written synchronously by the logging thread. If
+ * enableAsyncLogging() is called, info messages are instead formatted into a
+ * per-thread ring buffer and written in batches by a background thread, so
+ * logging never blocks on I/O. If a thread's ring is full, its messages are
+ * dropped and counted. Errors are always written synchronously, after
+ * flushing any queued messages.
  */
 class Log
 {
@@ -33,6 +40,7 @@ public:
     /**
      * Prints the given info to stdout (and a file, if enableFileLogging() was
      * called.), then flushes the buffer.
+     * If async logging is enabled, the info is instead queued to be printed.
      */
     static void info(const char* expression, ...);
 
@@ -48,6 +56,26 @@ public:
      */
     static void enableFileLogging(const std::string& fileName);
 
+    /**
+     * Starts the background writer thread and routes info messages through
+     * it.
+     * Messages longer than LogRecord::MAX_TEXT_LENGTH will be truncated.
+     */
+    static void enableAsyncLogging();
+
+    /**
+     * Writes any queued messages, stops the background writer thread, and
+     * goes back to writing messages synchronously.
+     * Called automatically at exit, if async logging is still enabled.
+     */
+    static void disableAsyncLogging();
+
+    /**
+     * Returns the total number of info messages that have been dropped
+     * because a thread's ring buffer was full.
+     */
+    static Uint64 getDroppedMessageCount();
+
 private:
     /**
      * Should be passed the sim's tick through registerCurrentTickPtr.
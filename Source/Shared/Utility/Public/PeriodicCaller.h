@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Timer.h"
+#include "LatencyHistogram.h"
 #include <functional>
 #include <string>
 #include <string_view>
@@ -23,6 +24,10 @@ namespace AM
  * using thread sleep/wake mechanisms.
  *
  * Must be fed by calling update() regularly.
+ *
+ * Always tracks histograms of each call's execution time and start delay,
+ * and of how many steps were missed. These can be queried from any thread,
+ * and can be periodically logged (see reportStatistics()).
  */
 class PeriodicCaller
 {
@@ -73,6 +78,27 @@ public:
      */
     void reportDelays(double inDelayedTimeS);
 
+    /**
+     * Enables logging a summary of our statistics every intervalS seconds
+     * (approximately, based on our timestep).
+     * The histograms are reset after each summary is logged.
+     */
+    void reportStatistics(double intervalS);
+
+    /** Returns the name used to identify this caller. */
+    const std::string& getDebugName() const;
+
+    /** Returns how long each call of givenFunct took to execute. */
+    const LatencyHistogram& getExecutionTimes() const;
+
+    /** Returns how late each call of givenFunct was started, relative to its
+        ideal call time. */
+    const LatencyHistogram& getStartDelays() const;
+
+    /** Returns how many steps were missed (ran late, or were skipped) each
+        time that update() found a step to run. */
+    const LatencyHistogram& getMissedSteps() const;
+
 private:
     /** The function to call every timestepS seconds, if given a callback with
         no arguments. */
@@ -106,6 +132,26 @@ private:
     /** An unreasonable amount of time for the update to be late by.
         If <= 0, no delay reporting will occur. */
     double delayedTimeS;
+
+    /**
+     * Logs a summary of our statistics, then resets them.
+     */
+    void logStatistics();
+
+    /** Used to time each call of givenFunct. */
+    Timer executionTimer;
+
+    /** See associated getters. */
+    LatencyHistogram executionTimes;
+    LatencyHistogram startDelays;
+    LatencyHistogram missedSteps;
+
+    /** How many calls to wait between statistics logs. If 0, statistics
+        won't be logged. */
+    unsigned int callsTillStatsDump;
+
+    /** How many calls we've made since we last logged our statistics. */
+    unsigned int callsSinceStatsDump;
 };
 
 } // namespace AM
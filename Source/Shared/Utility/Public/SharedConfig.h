@@ -53,6 +53,13 @@ public:
     static constexpr unsigned int SCREEN_WIDTH = 1280;
     static constexpr unsigned int SCREEN_HEIGHT = 720;
 
+    /** The width of a client's area of interest in world coordinates. */
+    static constexpr unsigned int AOI_WIDTH
+        = SCREEN_WIDTH + AOI_BUFFER_DISTANCE;
+    /** The height of a client's area of interest in world coordinates. */
+    static constexpr unsigned int AOI_HEIGHT
+        = SCREEN_HEIGHT + AOI_BUFFER_DISTANCE;
+
     // TODO: These are shared between client/editor because
     //       TransformationHelpers uses them. Should they be dynamically
     //       passed in or something?
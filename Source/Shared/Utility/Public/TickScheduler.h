@@ -0,0 +1,87 @@
+#pragma once
+
+#include "LatencyHistogram.h"
+#include "Timer.h"
+#include <deque>
+
+namespace AM
+{
+class PeriodicCaller;
+
+/**
+ * Drives a set of PeriodicCallers, sleeping until the next one is due.
+ *
+ * On Linux, we sleep with clock_nanosleep() until an absolute deadline, so
+ * we wake close to the exact time that the next caller is due. Elsewhere, we
+ * fall back to sleeping in 1ms increments when there's enough time left.
+ *
+ * Tracks how late each caller was started relative to its ideal call time,
+ * and periodically logs the percentiles. Unlike
+ * PeriodicCaller::getStartDelays(), this only covers the first due step of
+ * each update, so it shows how closely we woke up to the deadline without
+ * the caller's catch-up steps mixed in.
+ */
+class TickScheduler
+{
+public:
+    TickScheduler();
+
+    /**
+     * Adds a caller to be driven by this scheduler.
+     * Callers are updated in the order that they were added.
+     *
+     * Note: The caller must outlive this scheduler.
+     */
+    void addCaller(PeriodicCaller& caller);
+
+    /**
+     * Initializes the timers of all callers to the current time, so that
+     * they're relatively synchronized.
+     */
+    void initTimers();
+
+    /**
+     * Sleeps until the next caller is due, then updates all callers.
+     */
+    void update();
+
+    /**
+     * Returns the start latency histogram for the caller at the given index
+     * (in the order that they were added).
+     */
+    const LatencyHistogram& getStartLatencies(std::size_t callerIndex) const;
+
+private:
+    /** A caller, and how late its calls have been started. */
+    struct ScheduledCaller {
+        PeriodicCaller* caller{nullptr};
+        LatencyHistogram startLatencies;
+    };
+
+    /**
+     * Sleeps for the given amount of time.
+     */
+    void sleepFor(double seconds);
+
+    /**
+     * Logs each caller's start latency percentiles and resets them.
+     */
+    void logStatistics();
+
+    /** On platforms without clock_nanosleep(), we sleep for 1ms when
+        possible. We can't trust the scheduler to come back to us after
+        exactly 1ms though, so we need to give it some leeway. */
+    static constexpr double SLEEP_MINIMUM_TIME_S = .003;
+
+    /** How often we log our statistics. */
+    static constexpr double SECONDS_TILL_STATS_DUMP = 5;
+
+    /** The callers that we're driving.
+        Note: A deque, since histograms can't be moved. */
+    std::deque<ScheduledCaller> scheduledCallers;
+
+    /** Used to time when we should log our statistics. */
+    Timer statsTimer;
+};
+
+} // End namespace AM
@@ -6,7 +6,8 @@
 #include <array>
 #include <cstdio>
 #include "Timer.h"
-#include "Ignore.h"
+#include "Peer.h"
+#include <memory>
 
 // const std::string SERVER_IP = "127.0.0.1";
 const std::string SERVER_IP = "45.79.37.63";
@@ -15,32 +16,12 @@ static constexpr unsigned int NUM_BYTES = 16;
 
 using namespace AM;
 
-int main(int argc, char* argv[])
+/**
+ * Runs the test over a raw TCP socket.
+ * @return 0 if successful, else an error code.
+ */
+int runTcpTest(int iterationsToRun, std::vector<float>& resultArray)
 {
-    // SDL2 needs this signature for main, but we don't use the parameters.
-    ignore(argc);
-    ignore(argv);
-
-    int iterationsToRun = 0;
-    if (argc != 2) {
-        std::cout << "Usage: ./LatencyTestClient <number>" << std::endl;
-        return 0;
-    }
-    else {
-        iterationsToRun = std::stoi(argv[1]);
-    }
-
-    if (SDL_Init(0) == -1) {
-        std::cout << "SDLNet_Init: " << SDLNet_GetError() << std::endl;
-        return 1;
-    }
-    if (SDLNet_Init() == -1) {
-        std::cout << "SDLNet_Init: " << SDLNet_GetError() << std::endl;
-        return 2;
-    }
-
-    std::cout << "Connecting to server." << std::endl;
-
     IPaddress ip;
     if (SDLNet_ResolveHost(&ip, SERVER_IP.c_str(), SERVER_PORT)) {
         std::cout << "Could not resolve host." << std::endl;
@@ -54,8 +35,6 @@ int main(int argc, char* argv[])
     }
 
     int iterationCount = 0;
-    std::vector<float> resultArray(iterationsToRun, 0);
-
     std::array<Uint8, NUM_BYTES> messageBuffer = {};
 
     std::cout << "Running tests" << std::endl;
@@ -87,6 +66,84 @@ int main(int argc, char* argv[])
         }
     }
 
+    return 0;
+}
+
+/**
+ * Runs the test over our UDP transport, with the same message framing that
+ * the game uses.
+ * @return 0 if successful, else an error code.
+ */
+int runUdpTest(int iterationsToRun, std::vector<float>& resultArray)
+{
+    std::unique_ptr<Peer> server
+        = Peer::initiate(SERVER_IP, SERVER_PORT, Transport::Udp);
+
+    int iterationCount = 0;
+    std::array<Uint8, (MESSAGE_HEADER_SIZE + NUM_BYTES)> messageBuffer = {};
+    _SDLNet_Write16(NUM_BYTES, &(messageBuffer[MessageHeaderIndex::Size]));
+    std::array<Uint8, NUM_BYTES> receiveBuffer = {};
+
+    std::cout << "Running tests" << std::endl;
+    Timer rttTimer;
+    rttTimer.updateSavedTime();
+    while (iterationCount < iterationsToRun) {
+        // Send
+        if (server->send(messageBuffer.data(), messageBuffer.size())
+            != NetworkResult::Success) {
+            std::cout << "Failed to send message." << std::endl;
+            return 5;
+        }
+
+        // Receive
+        MessageResult result = server->receiveMessageWait(receiveBuffer.data());
+        if (result.networkResult == NetworkResult::Success) {
+            float rtt = rttTimer.getDeltaSeconds(true);
+            resultArray[iterationCount] = rtt;
+            iterationCount++;
+        }
+        else {
+            // Disconnected
+            std::cout << "Detected disconnect." << std::endl;
+            return 7;
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int iterationsToRun = 0;
+    bool useUdp = false;
+    if ((argc < 2) || (argc > 3)
+        || ((argc == 3) && (std::string(argv[2]) != "udp"))) {
+        std::cout << "Usage: ./LatencyTestClient <number> [udp]" << std::endl;
+        return 0;
+    }
+    else {
+        iterationsToRun = std::stoi(argv[1]);
+        useUdp = (argc == 3);
+    }
+
+    if (SDL_Init(0) == -1) {
+        std::cout << "SDLNet_Init: " << SDLNet_GetError() << std::endl;
+        return 1;
+    }
+    if (SDLNet_Init() == -1) {
+        std::cout << "SDLNet_Init: " << SDLNet_GetError() << std::endl;
+        return 2;
+    }
+
+    std::cout << "Connecting to server." << std::endl;
+
+    std::vector<float> resultArray(iterationsToRun, 0);
+    int result = useUdp ? runUdpTest(iterationsToRun, resultArray)
+                        : runTcpTest(iterationsToRun, resultArray);
+    if (result != 0) {
+        return result;
+    }
+
     /* Done getting data. Display it. */
     float max = 0;
     float min = 1000000;
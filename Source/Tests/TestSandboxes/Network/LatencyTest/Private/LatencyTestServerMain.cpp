@@ -4,7 +4,12 @@
 #include <array>
 #include <atomic>
 #include <thread>
-#include "Ignore.h"
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+#include "UdpHost.h"
+#include "UdpPeer.h"
 
 static constexpr int SERVER_PORT = 41499;
 static constexpr unsigned int NUM_BYTES = 16;
@@ -24,21 +29,11 @@ int inputThread(std::atomic<bool>* exitRequested)
     return 0;
 }
 
-int main(int argc, char* argv[])
+/**
+ * Echoes messages over a raw TCP socket until exit is requested.
+ */
+void runTcpServer(std::atomic<bool>* exitRequested)
 {
-    // SDL2 needs this signature for main, but we don't use the parameters.
-    ignore(argc);
-    ignore(argv);
-
-    if (SDL_Init(0) == -1) {
-        std::cout << "SDLNet_Init: " << SDLNet_GetError() << std::endl;
-        return 1;
-    }
-    if (SDLNet_Init() == -1) {
-        std::cout << "SDLNet_Init: " << SDLNet_GetError() << std::endl;
-        return 2;
-    }
-
     /* Set up the listener. */
     IPaddress ip;
     TCPsocket serverSocket = nullptr;
@@ -55,12 +50,8 @@ int main(int argc, char* argv[])
     SDLNet_SocketSet clientSet = SDLNet_AllocSocketSet(1);
     std::array<Uint8, NUM_BYTES> messageBuffer = {};
 
-    // Spin up a thread to check for command line input.
-    std::atomic<bool> exitRequested = false;
-    std::thread inputThreadObj(inputThread, &exitRequested);
-
     std::cout << "Server started." << std::endl;
-    while (!exitRequested) {
+    while (!(*exitRequested)) {
         // If we don't have a connection, try to get one.
         if (clientSocket == nullptr) {
             SDL_Delay(1);
@@ -115,6 +106,89 @@ int main(int argc, char* argv[])
         }
     }
 
+}
+
+/**
+ * Echoes messages over our UDP transport until exit is requested.
+ */
+void runUdpServer(std::atomic<bool>* exitRequested)
+{
+    std::shared_ptr<UdpHost> host = std::make_shared<UdpHost>(SERVER_PORT);
+    std::vector<std::unique_ptr<UdpPeer>> clients;
+    BinaryBufferPtr messageBuffer = nullptr;
+    std::array<Uint8, MESSAGE_HEADER_SIZE> headerBuffer = {};
+
+    std::cout << "Server started." << std::endl;
+    while (!(*exitRequested)) {
+        // Accept any new connections.
+        while (std::unique_ptr<UdpPeer> peer = host->accept()) {
+            std::cout << "Connected new client." << std::endl;
+            clients.push_back(std::move(peer));
+        }
+
+        // Loop back any messages that came in.
+        for (UdpPeer* client : host->receive(1)) {
+            MessageResult result = client->receiveMessage(messageBuffer);
+            while (result.networkResult == NetworkResult::Success) {
+                headerBuffer[MessageHeaderIndex::MessageType]
+                    = static_cast<Uint8>(result.messageType);
+                _SDLNet_Write16(result.messageSize,
+                                &(headerBuffer[MessageHeaderIndex::Size]));
+                std::array<std::span<const Uint8>, 2> buffers{
+                    std::span<const Uint8>{headerBuffer},
+                    std::span<const Uint8>{*messageBuffer}};
+                client->sendNonBlocking(buffers);
+
+                result = client->receiveMessage(messageBuffer);
+            }
+        }
+
+        // Flush acks and resends, and clean up any disconnected clients.
+        for (auto it = clients.begin(); it != clients.end();) {
+            (*it)->flushPendingOutput();
+            if (!((*it)->isConnected())) {
+                std::cout << "Detected disconnect. Cleaning up connection."
+                          << std::endl;
+                it = clients.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    bool useUdp = false;
+    if ((argc > 2) || ((argc == 2) && (std::string(argv[1]) != "udp"))) {
+        std::cout << "Usage: ./LatencyTestServer [udp]" << std::endl;
+        return 0;
+    }
+    else {
+        useUdp = (argc == 2);
+    }
+
+    if (SDL_Init(0) == -1) {
+        std::cout << "SDLNet_Init: " << SDLNet_GetError() << std::endl;
+        return 1;
+    }
+    if (SDLNet_Init() == -1) {
+        std::cout << "SDLNet_Init: " << SDLNet_GetError() << std::endl;
+        return 2;
+    }
+
+    // Spin up a thread to check for command line input.
+    std::atomic<bool> exitRequested = false;
+    std::thread inputThreadObj(inputThread, &exitRequested);
+
+    if (useUdp) {
+        runUdpServer(&exitRequested);
+    }
+    else {
+        runTcpServer(&exitRequested);
+    }
+
     inputThreadObj.join();
 
     return 0;
@@ -25,8 +25,9 @@ static constexpr unsigned int DEFAULT_NUM_CLIENTS = 10;
 void logInvalidInput()
 {
     LOG_ERROR("Invalid input.\n"
-              "Usage: LoadTestClientMain.exe <number of clients>\n"
-              "If no number of clients is given, will default to 10.");
+              "Usage: LoadTestClientMain.exe <number of clients> [tcp|udp]\n"
+              "If no number of clients is given, will default to 10.\n"
+              "If no transport is given, will default to tcp.");
 }
 
 void connectClients(unsigned int numClients,
@@ -44,7 +45,7 @@ void connectClients(unsigned int numClients,
 
 int main(int argc, char** argv)
 try {
-    if (argc > 2) {
+    if (argc > 3) {
         logInvalidInput();
     }
 
@@ -70,10 +71,22 @@ try {
         }
     }
 
+    // Check for an argument with a non-default transport.
+    Transport transport = Transport::Tcp;
+    if (argc > 2) {
+        std::string input{argv[2]};
+        if (input == "udp") {
+            transport = Transport::Udp;
+        }
+        else if (input != "tcp") {
+            logInvalidInput();
+        }
+    }
+
     // Construct the clients.
     std::vector<std::unique_ptr<SimulatedClient>> clients;
     for (unsigned int i = 0; i < numClients; ++i) {
-        clients.push_back(std::make_unique<SimulatedClient>());
+        clients.push_back(std::make_unique<SimulatedClient>(transport));
         clients[i]->setNetstatsLoggingEnabled(false);
     }
 
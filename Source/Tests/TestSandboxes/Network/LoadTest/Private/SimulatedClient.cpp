@@ -5,8 +5,9 @@ namespace AM
 {
 namespace LTC
 {
-SimulatedClient::SimulatedClient()
-: networkCaller(std::bind_front(&Client::Network::tick, &network),
+SimulatedClient::SimulatedClient(Transport transport)
+: network(transport)
+, networkCaller(std::bind_front(&Client::Network::tick, &network),
                 SharedConfig::NETWORK_TICK_TIMESTEP_S, "Network", true)
 , worldSim(network)
 , simCaller(std::bind_front(&WorldSim::tick, &worldSim), SharedConfig::SIM_TICK_TIMESTEP_S, "Sim",
@@ -41,6 +42,7 @@ void SimulatedClient::tick()
 void SimulatedClient::setNetstatsLoggingEnabled(bool inNetstatsLoggingEnabled)
 {
     network.setNetstatsLoggingEnabled(inNetstatsLoggingEnabled);
+    worldSim.setUpdateStatsLoggingEnabled(inNetstatsLoggingEnabled);
 }
 
 } // End namespace LTC
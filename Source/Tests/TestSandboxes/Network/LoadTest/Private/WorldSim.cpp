@@ -5,21 +5,52 @@
 #include "MessageTools.h"
 #include "ConnectionResponse.h"
 #include "ClientInput.h"
+#include "EntityUpdate.h"
+#include "EntityState.h"
+#include "SharedConfig.h"
 #include "Peer.h"
+#include "MessageBufferPool.h"
 #include "Log.h"
 #include <memory>
 #include <algorithm>
+#include <vector>
 
 namespace AM
 {
 namespace LTC
 {
+namespace
+{
+/**
+ * The EntityUpdate format from before compact states were added.
+ * Only used to measure how large the received updates would have been.
+ */
+struct PreviousEntityUpdate {
+    Uint32 tickNum{0};
+    std::vector<EntityState> entityStates;
+};
+
+template<typename S>
+void serialize(S& serializer, PreviousEntityUpdate& entityUpdate)
+{
+    serializer.value4b(entityUpdate.tickNum);
+    serializer.container(entityUpdate.entityStates,
+                         static_cast<std::size_t>(SharedConfig::MAX_ENTITIES));
+}
+
+} // End anonymous namespace
+
+std::atomic<Uint64> WorldSim::receivedUpdateBytes = 0;
+std::atomic<Uint64> WorldSim::uncompressedUpdateBytes = 0;
+
 WorldSim::WorldSim(Client::Network& inNetwork)
 : network(inNetwork)
 , clientEntity(entt::null)
 , currentTick(0)
 , ticksTillInput(0)
 , isMovingRight(false)
+, updateStatsLoggingEnabled(false)
+, ticksSinceUpdateStatsLog(0)
 {
     network.registerCurrentTickPtr(&currentTick);
 }
@@ -66,22 +97,47 @@ void WorldSim::tick()
         ticksTillInput--;
 
         // Receive any waiting player messages.
+        // Note: Updates with npc data are also pushed into the npc queue, so
+        //       we only record player updates that have no npc data.
         std::shared_ptr<const EntityUpdate> entityUpdate
             = network.receivePlayerUpdate(0);
         while (entityUpdate != nullptr) {
+            if ((entityUpdate->entityStates.size() == 1)
+                && entityUpdate->compactEntityStates.empty()
+                && entityUpdate->exitedEntities.empty()) {
+                recordUpdateSize(*entityUpdate);
+            }
             entityUpdate = network.receivePlayerUpdate(0);
         }
 
         // Receive any waiting npc messages.
         Client::NpcReceiveResult receiveResult = network.receiveNpcUpdate();
         while (receiveResult.result == NetworkResult::Success) {
+            if (receiveResult.message.updateType
+                == Client::NpcUpdateType::Update) {
+                recordUpdateSize(*(receiveResult.message.message));
+            }
             receiveResult = network.receiveNpcUpdate();
         }
 
         currentTick++;
+
+        // If it's time to log our update statistics, do so.
+        if (updateStatsLoggingEnabled) {
+            ticksSinceUpdateStatsLog++;
+            if (ticksSinceUpdateStatsLog == TICKS_TILL_STATS_DUMP) {
+                logUpdateStatistics();
+                ticksSinceUpdateStatsLog = 0;
+            }
+        }
     }
 }
 
+void WorldSim::setUpdateStatsLoggingEnabled(bool inUpdateStatsLoggingEnabled)
+{
+    updateStatsLoggingEnabled = inUpdateStatsLoggingEnabled;
+}
+
 void WorldSim::sendNextInput()
 {
     // Construct the next input.
@@ -99,7 +155,7 @@ void WorldSim::sendNextInput()
 
     // Serialize the client inputs message.
     BinaryBufferSharedPtr messageBuffer
-        = std::make_shared<BinaryBuffer>(Peer::MAX_MESSAGE_SIZE);
+        = MessageBufferPool::acquire();
     unsigned int startIndex = CLIENT_HEADER_SIZE + MESSAGE_HEADER_SIZE;
     std::size_t messageSize
         = MessageTools::serialize(*messageBuffer, clientInput, startIndex);
@@ -109,7 +165,50 @@ void WorldSim::sendNextInput()
                                     messageBuffer, CLIENT_HEADER_SIZE);
 
     // Send the message.
-    network.send(messageBuffer);
+    // Note: Like the real client, inputs go on the Unreliable channel.
+    network.send(messageBuffer, Channel::Unreliable);
+}
+
+void WorldSim::recordUpdateSize(const EntityUpdate& entityUpdate)
+{
+    // Re-serialize the update to get its size on the wire.
+    EntityUpdate receivedUpdate{entityUpdate};
+    receivedUpdateBytes
+        += MessageTools::serialize(statsBuffer, receivedUpdate);
+
+    // Build the update in its previous format, where every state was a full
+    // state. Exits weren't sent at all.
+    // Note: An EntityState's wire size doesn't depend on its values, so the
+    //       expanded compact states only need their entity.
+    PreviousEntityUpdate previousUpdate{entityUpdate.tickNum,
+                                        entityUpdate.entityStates};
+    for (const CompactEntityState& compactState :
+         entityUpdate.compactEntityStates) {
+        EntityState& entityState = previousUpdate.entityStates.emplace_back();
+        entityState.entity = compactState.entity;
+    }
+    uncompressedUpdateBytes
+        += MessageTools::serialize(statsBuffer, previousUpdate);
+}
+
+void WorldSim::logUpdateStatistics()
+{
+    // Dump the stats, resetting them.
+    float receivedPerSecond
+        = static_cast<float>(receivedUpdateBytes.exchange(0))
+          / SECONDS_TILL_STATS_DUMP;
+    float uncompressedPerSecond
+        = static_cast<float>(uncompressedUpdateBytes.exchange(0))
+          / SECONDS_TILL_STATS_DUMP;
+
+    float reductionPercent = 0;
+    if (uncompressedPerSecond > 0) {
+        reductionPercent
+            = 100 * (1 - (receivedPerSecond / uncompressedPerSecond));
+    }
+    LOG_INFO("EntityUpdate bytes per second: %.0f, uncompressed: %.0f, "
+             "reduction: %.1f%%",
+             receivedPerSecond, uncompressedPerSecond, reductionPercent);
 }
 
 } // End namespace LTC
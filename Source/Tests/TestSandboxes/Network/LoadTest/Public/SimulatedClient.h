@@ -18,7 +18,10 @@ namespace LTC
 class SimulatedClient
 {
 public:
-    SimulatedClient();
+    /**
+     * @param transport  The transport to connect to the server over.
+     */
+    SimulatedClient(Transport transport);
 
     /**
      * Calls worldSim.connect().
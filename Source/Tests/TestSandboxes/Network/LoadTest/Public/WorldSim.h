@@ -1,6 +1,7 @@
 #pragma once
 
 #include "SharedConfig.h"
+#include "NetworkDefs.h"
 #include "entt/entity/registry.hpp"
 #include <SDL_stdinc.h>
 #include <atomic>
@@ -8,6 +9,7 @@
 namespace AM
 {
 class ClientInput;
+class EntityUpdate;
 
 namespace Client
 {
@@ -38,6 +40,8 @@ public:
      */
     void tick();
 
+    void setUpdateStatsLoggingEnabled(bool inUpdateStatsLoggingEnabled);
+
 private:
     /**
      * Sends the next input message.
@@ -45,6 +49,18 @@ private:
      */
     void sendNextInput();
 
+    /**
+     * Records the size of the given update, along with the size it would
+     * have been in the previous EntityUpdate format, where every entity
+     * state was sent in full.
+     */
+    void recordUpdateSize(const EntityUpdate& entityUpdate);
+
+    /**
+     * Logs the recorded update sizes as bytes per second.
+     */
+    void logUpdateStatistics();
+
     /** How long the game should wait for the server to send a connection
         response. */
     static constexpr unsigned int CONNECTION_RESPONSE_WAIT_MS = 1000;
@@ -71,6 +87,29 @@ private:
     /** Tracks which direction this simulated client is moving.
         Used for constructing the next input message. */
     bool isMovingRight;
+
+    /** The number of seconds we'll wait before logging our update
+        statistics. */
+    static constexpr unsigned int SECONDS_TILL_STATS_DUMP = 5;
+    static constexpr unsigned int TICKS_TILL_STATS_DUMP
+        = SharedConfig::SIM_TICKS_PER_SECOND * SECONDS_TILL_STATS_DUMP;
+
+    /** Whether update statistics logging is enabled or not. */
+    bool updateStatsLoggingEnabled;
+
+    /** The number of ticks since we last logged our update statistics. */
+    unsigned int ticksSinceUpdateStatsLog;
+
+    /** Used to re-serialize received updates for measuring. */
+    BinaryBuffer statsBuffer;
+
+    /** The serialized size of all received updates, across all simulated
+        clients. Static so that one client can log them all. */
+    static std::atomic<Uint64> receivedUpdateBytes;
+
+    /** The size that the received updates would have been in the previous
+        EntityUpdate format. */
+    static std::atomic<Uint64> uncompressedUpdateBytes;
 };
 
 } // End namespace LTC
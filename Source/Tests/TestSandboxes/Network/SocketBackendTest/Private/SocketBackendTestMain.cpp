@@ -0,0 +1,274 @@
+#include "SDL.h"
+#include "SDL_net.h"
+#include "Acceptor.h"
+#include "SocketSet.h"
+#include "TcpPeer.h"
+#include "TcpSendRing.h"
+#include "TcpSocket.h"
+#include "NetworkDefs.h"
+#include "NetworkStats.h"
+#include "Log.h"
+#include <sys/resource.h>
+#include <ctime>
+#include <cstdio>
+#include <array>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Runs a simulated server network tick against a set of loopback clients,
+ * once with each socket backend, and reports the socket syscalls and CPU
+ * time that the server side used per tick.
+ *
+ * Each tick, every client sends a small input message, then the server
+ * receives them all and sends every client an update. Only the server's work
+ * is measured.
+ */
+
+static constexpr Uint16 SERVER_PORT = 41500;
+static constexpr unsigned int DEFAULT_CLIENT_COUNT = 1000;
+static constexpr unsigned int DEFAULT_TICK_COUNT = 300;
+
+/** The payload size of each client's input message. */
+static constexpr unsigned int CLIENT_MESSAGE_SIZE = 16;
+
+/** The payload size of each server update. */
+static constexpr unsigned int SERVER_MESSAGE_SIZE = 256;
+
+/** How long to wait for socket activity before checking again. */
+static constexpr unsigned int SOCKET_WAIT_TIMEOUT_MS = 100;
+
+using namespace AM;
+
+struct BenchResult {
+    /** The receive backend that was actually used. */
+    SocketSet::Backend backend = SocketSet::Backend::SDLNet;
+    /** If true, sends were batched through a TcpSendRing. */
+    bool usedSendRing = false;
+    double syscallsPerTick = 0;
+    double cpuUsPerTick = 0;
+};
+
+/**
+ * Returns the CPU time that the calling thread has used, in microseconds.
+ */
+double getThreadCpuTimeUs()
+{
+    timespec time{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return (time.tv_sec * 1000000.0) + (time.tv_nsec / 1000.0);
+}
+
+/**
+ * Each client needs a socket on both ends, so the default limit is easily
+ * hit. Raises it as far as we're allowed.
+ */
+void raiseFileLimit()
+{
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+const char* getBackendName(SocketSet::Backend backend)
+{
+    switch (backend) {
+        case SocketSet::Backend::SDLNet:
+            return "SDLNet";
+        case SocketSet::Backend::Epoll:
+            return "epoll";
+        case SocketSet::Backend::IoUring:
+            return "io_uring";
+    }
+
+    return "";
+}
+
+/**
+ * Runs the test using the given backend.
+ * @return false if a client disconnected, else true.
+ */
+bool runTest(SocketSet::Backend requestedBackend, unsigned int clientCount,
+             unsigned int tickCount, BenchResult& result)
+{
+    /* Set up the server side. */
+    std::shared_ptr<SocketSet> clientSet
+        = std::make_shared<SocketSet>(clientCount, requestedBackend);
+    Acceptor acceptor(SERVER_PORT, clientSet);
+
+    std::unique_ptr<TcpSendRing> sendRing{nullptr};
+    if (clientSet->getBackend() == SocketSet::Backend::IoUring) {
+        sendRing = std::make_unique<TcpSendRing>(clientCount);
+        if (!(sendRing->isAvailable())) {
+            sendRing = nullptr;
+        }
+    }
+
+    /* Connect the clients. */
+    std::vector<std::unique_ptr<TcpSocket>> clientSockets;
+    std::vector<std::unique_ptr<TcpPeer>> serverPeers;
+    std::unordered_map<const TcpSocket*, TcpPeer*> peerMap;
+    for (unsigned int i = 0; i < clientCount; ++i) {
+        clientSockets.push_back(
+            std::make_unique<TcpSocket>("127.0.0.1", SERVER_PORT));
+
+        std::unique_ptr<TcpPeer> peer{nullptr};
+        while (peer == nullptr) {
+            peer = acceptor.accept();
+        }
+
+        if (sendRing != nullptr) {
+            peer->setSendRing(sendRing.get());
+        }
+        peerMap.emplace(&(peer->getSocket()), peer.get());
+        serverPeers.push_back(std::move(peer));
+    }
+
+    /* Build the messages. */
+    std::array<Uint8, (MESSAGE_HEADER_SIZE + CLIENT_MESSAGE_SIZE)>
+        clientMessage{};
+    clientMessage[MessageHeaderIndex::MessageType]
+        = static_cast<Uint8>(MessageType::ClientInputs);
+    _SDLNet_Write16(CLIENT_MESSAGE_SIZE,
+                    &(clientMessage[MessageHeaderIndex::Size]));
+
+    std::array<Uint8, (MESSAGE_HEADER_SIZE + SERVER_MESSAGE_SIZE)>
+        serverMessage{};
+    serverMessage[MessageHeaderIndex::MessageType]
+        = static_cast<Uint8>(MessageType::EntityUpdate);
+    _SDLNet_Write16(SERVER_MESSAGE_SIZE,
+                    &(serverMessage[MessageHeaderIndex::Size]));
+    std::array<std::span<const Uint8>, 1> serverBuffers{
+        std::span<const Uint8>{serverMessage}};
+
+    /* Run the ticks. */
+    BinaryBufferPtr messageBuffer{nullptr};
+    std::array<Uint8, serverMessage.size()> clientReceiveBuffer{};
+    Uint64 totalSyscalls = 0;
+    double totalCpuUs = 0;
+    NetworkStats::dumpStats();
+    for (unsigned int tick = 0; tick < tickCount; ++tick) {
+        // Each client sends its input.
+        for (std::unique_ptr<TcpSocket>& socket : clientSockets) {
+            socket->send(clientMessage.data(), clientMessage.size());
+        }
+
+        // The server receives every client's input, then sends each client
+        // an update.
+        double startCpuUs = getThreadCpuTimeUs();
+        unsigned int numReceived = 0;
+        while (numReceived < clientCount) {
+            clientSet->checkSockets(SOCKET_WAIT_TIMEOUT_MS);
+            for (const TcpSocket* socket : clientSet->getReadySockets()) {
+                TcpPeer& peer = *(peerMap.at(socket));
+                while (peer.receiveMessage(messageBuffer).networkResult
+                       == NetworkResult::Success) {
+                    numReceived++;
+                }
+
+                if (!(peer.isConnected())) {
+                    LOG_INFO("A client disconnected during the test.");
+                    return false;
+                }
+            }
+        }
+
+        for (std::unique_ptr<TcpPeer>& peer : serverPeers) {
+            peer->sendNonBlocking(serverBuffers);
+        }
+        if (sendRing != nullptr) {
+            sendRing->submit();
+        }
+
+        totalCpuUs += (getThreadCpuTimeUs() - startCpuUs);
+        totalSyscalls += NetworkStats::dumpStats().socketSyscalls;
+
+        // Each client receives its update.
+        for (std::unique_ptr<TcpSocket>& socket : clientSockets) {
+            int bytesReceived = 0;
+            int messageSize = static_cast<int>(clientReceiveBuffer.size());
+            while (bytesReceived < messageSize) {
+                int received
+                    = socket->receive((clientReceiveBuffer.data()
+                                       + bytesReceived),
+                                      (messageSize - bytesReceived));
+                if (received <= 0) {
+                    LOG_INFO("The server disconnected during the test.");
+                    return false;
+                }
+
+                bytesReceived += received;
+            }
+        }
+    }
+
+    result.backend = clientSet->getBackend();
+    result.usedSendRing = (sendRing != nullptr);
+    result.syscallsPerTick = static_cast<double>(totalSyscalls) / tickCount;
+    result.cpuUsPerTick = totalCpuUs / tickCount;
+
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned int clientCount = DEFAULT_CLIENT_COUNT;
+    unsigned int tickCount = DEFAULT_TICK_COUNT;
+    if (argc > 3) {
+        std::printf("Usage: ./SocketBackendTest [clientCount] [tickCount]\n");
+        return 0;
+    }
+    if (argc > 1) {
+        clientCount = std::stoi(argv[1]);
+    }
+    if (argc > 2) {
+        tickCount = std::stoi(argv[2]);
+    }
+
+    if (SDL_Init(0) == -1) {
+        LOG_INFO("SDL_Init: %s", SDLNet_GetError());
+        return 1;
+    }
+    if (SDLNet_Init() == -1) {
+        LOG_INFO("SDLNet_Init: %s", SDLNet_GetError());
+        return 2;
+    }
+
+    raiseFileLimit();
+
+    /* Run the test with each backend. */
+    std::array<SocketSet::Backend, 2> backends{SocketSet::Backend::Epoll,
+                                               SocketSet::Backend::IoUring};
+    std::vector<BenchResult> results;
+    for (SocketSet::Backend backend : backends) {
+        LOG_INFO("Running %u ticks with %u clients, using %s.", tickCount,
+                 clientCount, getBackendName(backend));
+
+        BenchResult result{};
+        if (!runTest(backend, clientCount, tickCount, result)) {
+            return 3;
+        }
+
+        results.push_back(result);
+    }
+
+    /* Print the results. */
+    std::printf("## Server socket cost per tick (%u clients) ##\n",
+                clientCount);
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& result = results[i];
+        std::printf("Requested: %-9s Used: %-9s Send ring: %-4s Syscalls: "
+                    "%9.1f CPU (us): %9.1f\n",
+                    getBackendName(backends[i]),
+                    getBackendName(result.backend),
+                    (result.usedSendRing ? "yes" : "no"),
+                    result.syscallsPerTick, result.cpuUsPerTick);
+    }
+
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <catch2/catch.hpp>
+#include "ByteRingBuffer.h"
+#include <array>
+
+using namespace AM;
+
+TEST_CASE("TestByteRingBuffer")
+{
+    ByteRingBuffer ringBuffer(8);
+    std::array<Uint8, 8> bytes{0, 1, 2, 3, 4, 5, 6, 7};
+    std::array<Uint8, 8> output{};
+
+    SECTION("Bytes are read back in the order they were written.")
+    {
+        ringBuffer.write(bytes.data(), 5);
+        REQUIRE(ringBuffer.size() == 5);
+        REQUIRE(ringBuffer.getFreeSpace() == 3);
+
+        ringBuffer.read(output.data(), 5);
+        REQUIRE(ringBuffer.size() == 0);
+        for (Uint8 i = 0; i < 5; ++i) {
+            REQUIRE(output[i] == i);
+        }
+    }
+
+    SECTION("Writes and reads wrap around the end of the buffer.")
+    {
+        // Move the indices near the end, then write across it.
+        ringBuffer.write(bytes.data(), 6);
+        ringBuffer.discard(6);
+        ringBuffer.write(bytes.data(), 5);
+        REQUIRE(ringBuffer.size() == 5);
+
+        ringBuffer.read(output.data(), 5);
+        for (Uint8 i = 0; i < 5; ++i) {
+            REQUIRE(output[i] == i);
+        }
+    }
+
+    SECTION("Peeks wrap around the end of the buffer, and don't remove.")
+    {
+        ringBuffer.write(bytes.data(), 6);
+        ringBuffer.discard(6);
+        ringBuffer.write(bytes.data(), 8);
+
+        // Start before the end and finish after it.
+        ringBuffer.peek(output.data(), 4, 1);
+        for (Uint8 i = 0; i < 4; ++i) {
+            REQUIRE(output[i] == (i + 1));
+        }
+        REQUIRE(ringBuffer.size() == 8);
+        REQUIRE(ringBuffer.getFreeSpace() == 0);
+    }
+
+    SECTION("Contiguous free space stops at the end of the buffer.")
+    {
+        ringBuffer.write(bytes.data(), 6);
+        ringBuffer.discard(4);
+        REQUIRE(ringBuffer.getFreeSpace() == 6);
+        REQUIRE(ringBuffer.getContiguousFreeSpace() == 2);
+
+        // Fill to the end through the write pointer, then wrap to the start.
+        ringBuffer.getWritePtr()[0] = 6;
+        ringBuffer.getWritePtr()[1] = 7;
+        ringBuffer.commitWrite(2);
+        REQUIRE(ringBuffer.getContiguousFreeSpace() == 4);
+        ringBuffer.getWritePtr()[0] = 8;
+        ringBuffer.commitWrite(1);
+
+        ringBuffer.read(output.data(), 5);
+        for (Uint8 i = 0; i < 5; ++i) {
+            REQUIRE(output[i] == (i + 4));
+        }
+    }
+
+    SECTION("Contiguous free space is limited by unread bytes.")
+    {
+        ringBuffer.write(bytes.data(), 8);
+        ringBuffer.discard(3);
+        ringBuffer.write(bytes.data(), 2);
+        REQUIRE(ringBuffer.getFreeSpace() == 1);
+        REQUIRE(ringBuffer.getContiguousFreeSpace() == 1);
+    }
+}
@@ -0,0 +1,108 @@
+#include <catch2/catch.hpp>
+#include "EntityGrid.h"
+#include "AreaOfInterest.h"
+#include <algorithm>
+#include <vector>
+
+using namespace AM;
+
+namespace
+{
+bool containsEntity(const std::vector<entt::entity>& entities,
+                    entt::entity entity)
+{
+    return (std::find(entities.begin(), entities.end(), entity)
+            != entities.end());
+}
+
+} // End anonymous namespace
+
+TEST_CASE("TestEntityGrid")
+{
+    Server::EntityGrid entityGrid;
+    const float cellSize = Server::EntityGrid::CELL_SIZE;
+
+    // An AoI that covers only the cell at (0, 0).
+    AreaOfInterest originAoI{(cellSize / 2), (cellSize / 2)};
+    originAoI.setCenter({(cellSize / 2), (cellSize / 2), 0});
+
+    const entt::entity entityA = static_cast<entt::entity>(1);
+    const entt::entity entityB = static_cast<entt::entity>(2);
+
+    SECTION("Query finds nearby entities only.")
+    {
+        entityGrid.addEntity(entityA, {10, 10, 0});
+        entityGrid.addEntity(entityB, {(cellSize * 5), (cellSize * 5), 0});
+
+        std::vector<entt::entity> results;
+        entityGrid.queryEntities(originAoI, results);
+        REQUIRE(results.size() == 1);
+        REQUIRE(containsEntity(results, entityA));
+    }
+
+    SECTION("Negative coordinates get their own cells.")
+    {
+        entityGrid.addEntity(entityA, {10, 10, 0});
+        entityGrid.addEntity(entityB, {-10, -10, 0});
+
+        std::vector<entt::entity> results;
+        entityGrid.queryEntities(originAoI, results);
+        REQUIRE(results.size() == 1);
+        REQUIRE(containsEntity(results, entityA));
+
+        Server::GridOccupancyStats stats = entityGrid.getOccupancyStats();
+        REQUIRE(stats.occupiedCells == 2);
+    }
+
+    SECTION("Updates move entities between cells.")
+    {
+        entityGrid.addEntity(entityA, {(cellSize * 5), (cellSize * 5), 0});
+
+        std::vector<entt::entity> results;
+        entityGrid.queryEntities(originAoI, results);
+        REQUIRE(results.empty());
+
+        entityGrid.updateEntity(entityA, {10, 10, 0});
+        entityGrid.queryEntities(originAoI, results);
+        REQUIRE(results.size() == 1);
+        REQUIRE(containsEntity(results, entityA));
+
+        // The old cell should no longer count as occupied.
+        Server::GridOccupancyStats stats = entityGrid.getOccupancyStats();
+        REQUIRE(stats.occupiedCells == 1);
+
+        // Moving back into the emptied cell should work.
+        entityGrid.updateEntity(entityA, {(cellSize * 5), (cellSize * 5), 0});
+        results.clear();
+        entityGrid.queryEntities(originAoI, results);
+        REQUIRE(results.empty());
+        stats = entityGrid.getOccupancyStats();
+        REQUIRE(stats.occupiedCells == 1);
+    }
+
+    SECTION("Removed entities aren't found.")
+    {
+        entityGrid.addEntity(entityA, {10, 10, 0});
+        entityGrid.addEntity(entityB, {20, 20, 0});
+        entityGrid.removeEntity(entityA);
+
+        std::vector<entt::entity> results;
+        entityGrid.queryEntities(originAoI, results);
+        REQUIRE(results.size() == 1);
+        REQUIRE(containsEntity(results, entityB));
+    }
+
+    SECTION("Occupancy stats.")
+    {
+        entityGrid.addEntity(entityA, {10, 10, 0});
+        entityGrid.addEntity(entityB, {20, 20, 0});
+        entityGrid.addEntity(static_cast<entt::entity>(3),
+                             {(cellSize * 2), 10, 0});
+
+        Server::GridOccupancyStats stats = entityGrid.getOccupancyStats();
+        REQUIRE(stats.occupiedCells == 2);
+        REQUIRE(stats.entityCount == 3);
+        REQUIRE(stats.maxCellEntities == 2);
+        REQUIRE(stats.averageCellEntities == Approx(1.5f));
+    }
+}
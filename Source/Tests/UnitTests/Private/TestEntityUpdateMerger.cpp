@@ -0,0 +1,225 @@
+#include <catch2/catch.hpp>
+#include "EntityUpdateMerger.h"
+
+using namespace AM;
+using namespace AM::Server;
+
+namespace
+{
+EntityState makeFullState(Uint32 entityID, float x, float y)
+{
+    EntityState state{};
+    state.entity = static_cast<entt::entity>(entityID);
+    state.position.x = x;
+    state.position.y = y;
+    return state;
+}
+
+CompactEntityState makeCompactState(Uint32 entityID, Uint8 changeMask)
+{
+    CompactEntityState state{};
+    state.entity = static_cast<entt::entity>(entityID);
+    state.changeMask = changeMask;
+    return state;
+}
+
+} // End anonymous namespace
+
+TEST_CASE("TestEntityUpdateMerger")
+{
+    EntityUpdateMerger merger;
+    std::vector<EntityUpdate> merged{};
+
+    SECTION("Each state keeps the tick of its update.")
+    {
+        EntityUpdate first{};
+        first.tickNum = 10;
+        first.entityStates.push_back(makeFullState(1, 0, 0));
+        EntityUpdate second{};
+        second.tickNum = 12;
+        second.entityStates.push_back(makeFullState(2, 0, 0));
+        merger.add(first);
+        merger.add(second);
+        REQUIRE(merger.getUpdateCount() == 2);
+
+        merger.take(merged);
+        REQUIRE(merged.size() == 2);
+        REQUIRE(merged[0].tickNum == 10);
+        REQUIRE(merged[0].entityStates.size() == 1);
+        REQUIRE(merged[1].tickNum == 12);
+        REQUIRE(merged[1].entityStates.size() == 1);
+        REQUIRE(merger.getUpdateCount() == 0);
+    }
+
+    SECTION("Only the newest full state is kept.")
+    {
+        EntityUpdate first{};
+        first.tickNum = 10;
+        first.entityStates.push_back(makeFullState(1, 5, 5));
+        EntityUpdate second{};
+        second.tickNum = 11;
+        second.entityStates.push_back(makeFullState(1, 20, 30));
+        merger.add(first);
+        merger.add(second);
+
+        merger.take(merged);
+        REQUIRE(merged.size() == 1);
+        REQUIRE(merged[0].tickNum == 11);
+        REQUIRE(merged[0].entityStates.size() == 1);
+        REQUIRE(merged[0].entityStates[0].position.x == 20);
+        REQUIRE(merged[0].entityStates[0].position.y == 30);
+    }
+
+    SECTION("Compact states after a full state are kept at their own tick.")
+    {
+        EntityUpdate first{};
+        first.tickNum = 10;
+        first.entityStates.push_back(makeFullState(1, 5, 5));
+
+        EntityUpdate second{};
+        second.tickNum = 11;
+        second.aoiOriginX = 100;
+        second.aoiOriginY = 200;
+        CompactEntityState state
+            = makeCompactState(1, CompactEntityState::InputChanged);
+        state.input.inputStates[Input::XUp] = Input::Pressed;
+        second.compactEntityStates.push_back(state);
+
+        merger.add(first);
+        merger.add(second);
+        merger.take(merged);
+        REQUIRE(merged.size() == 2);
+        REQUIRE(merged[0].tickNum == 10);
+        REQUIRE(merged[0].entityStates.size() == 1);
+        REQUIRE(merged[0].entityStates[0].position.x == 5);
+        REQUIRE(merged[1].tickNum == 11);
+        REQUIRE(merged[1].aoiOriginX == 100);
+        REQUIRE(merged[1].aoiOriginY == 200);
+        REQUIRE(merged[1].compactEntityStates.size() == 1);
+        REQUIRE(merged[1].compactEntityStates[0].input.inputStates[Input::XUp]
+                == Input::Pressed);
+    }
+
+    SECTION("Compact states are dropped once a later one covers them.")
+    {
+        EntityUpdate first{};
+        first.tickNum = 10;
+        first.aoiOriginX = 100;
+        first.aoiOriginY = 100;
+        CompactEntityState firstState
+            = makeCompactState(1, CompactEntityState::PositionXYChanged);
+        firstState.relativeX = 50;
+        first.compactEntityStates.push_back(firstState);
+
+        EntityUpdate second{};
+        second.tickNum = 11;
+        second.aoiOriginX = 120;
+        second.aoiOriginY = 130;
+        CompactEntityState secondState = makeCompactState(
+            1, (CompactEntityState::PositionXYChanged
+                | CompactEntityState::PositionZChanged));
+        secondState.relativeX = 40;
+        second.compactEntityStates.push_back(secondState);
+
+        merger.add(first);
+        merger.add(second);
+        merger.take(merged);
+        REQUIRE(merged.size() == 1);
+        REQUIRE(merged[0].tickNum == 11);
+        REQUIRE(merged[0].aoiOriginX == 120);
+        REQUIRE(merged[0].compactEntityStates.size() == 1);
+        REQUIRE(merged[0].compactEntityStates[0].relativeX == 40);
+    }
+
+    SECTION("Compact states that change other fields aren't rebased.")
+    {
+        EntityUpdate first{};
+        first.tickNum = 10;
+        first.aoiOriginX = 100;
+        first.aoiOriginY = 100;
+        CompactEntityState firstState
+            = makeCompactState(1, CompactEntityState::PositionXYChanged);
+        firstState.relativeX = 50;
+        firstState.relativeY = 60;
+        first.compactEntityStates.push_back(firstState);
+
+        EntityUpdate second{};
+        second.tickNum = 11;
+        second.aoiOriginX = 500;
+        second.aoiOriginY = 500;
+        second.compactEntityStates.push_back(
+            makeCompactState(1, CompactEntityState::InputChanged));
+
+        merger.add(first);
+        merger.add(second);
+        merger.take(merged);
+        REQUIRE(merged.size() == 2);
+        REQUIRE(merged[0].tickNum == 10);
+        REQUIRE(merged[0].aoiOriginX == 100);
+        REQUIRE(merged[0].compactEntityStates[0].relativeX == 50);
+        REQUIRE(merged[0].compactEntityStates[0].relativeY == 60);
+        REQUIRE(merged[1].tickNum == 11);
+        REQUIRE(merged[1].compactEntityStates[0].changeMask
+                == CompactEntityState::InputChanged);
+    }
+
+    SECTION("Input changes are kept until the position is set.")
+    {
+        EntityUpdate first{};
+        first.tickNum = 10;
+        first.compactEntityStates.push_back(
+            makeCompactState(1, CompactEntityState::InputChanged));
+        EntityUpdate second{};
+        second.tickNum = 11;
+        second.compactEntityStates.push_back(
+            makeCompactState(1, CompactEntityState::InputChanged));
+        EntityUpdate third{};
+        third.tickNum = 12;
+        third.compactEntityStates.push_back(makeCompactState(
+            1, (CompactEntityState::InputChanged
+                | CompactEntityState::PositionXYChanged)));
+
+        merger.add(first);
+        merger.add(second);
+        merger.take(merged);
+        REQUIRE(merged.size() == 2);
+
+        merger.add(first);
+        merger.add(second);
+        merger.add(third);
+        merger.take(merged);
+        REQUIRE(merged.size() == 1);
+        REQUIRE(merged[0].tickNum == 12);
+    }
+
+    SECTION("Exits replace earlier states, and are replaced by re-entries.")
+    {
+        EntityUpdate first{};
+        first.tickNum = 10;
+        first.entityStates.push_back(makeFullState(1, 0, 0));
+        first.compactEntityStates.push_back(
+            makeCompactState(2, CompactEntityState::InputChanged));
+
+        EntityUpdate second{};
+        second.tickNum = 11;
+        second.exitedEntities.push_back(static_cast<entt::entity>(1));
+        second.exitedEntities.push_back(static_cast<entt::entity>(2));
+
+        EntityUpdate third{};
+        third.tickNum = 12;
+        third.entityStates.push_back(makeFullState(2, 0, 0));
+
+        merger.add(first);
+        merger.add(second);
+        merger.add(third);
+        merger.take(merged);
+        REQUIRE(merged.size() == 2);
+        REQUIRE(merged[0].tickNum == 11);
+        REQUIRE(merged[0].exitedEntities.size() == 1);
+        REQUIRE(merged[0].exitedEntities[0] == static_cast<entt::entity>(1));
+        REQUIRE(merged[1].tickNum == 12);
+        REQUIRE(merged[1].entityStates.size() == 1);
+        REQUIRE(merged[1].entityStates[0].entity
+                == static_cast<entt::entity>(2));
+    }
+}
@@ -0,0 +1,155 @@
+#include <catch2/catch.hpp>
+#include "EpochSlotArray.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace AM;
+using namespace AM::Server;
+
+namespace
+{
+/** Counts its destructions, and flags use-after-delete. */
+struct TestObject {
+    static constexpr Uint32 ALIVE = 0xA11FE;
+
+    TestObject(std::atomic<int>& inDeleteCount)
+    : deleteCount(inDeleteCount)
+    , state(ALIVE)
+    {
+    }
+
+    ~TestObject()
+    {
+        state = 0;
+        deleteCount++;
+    }
+
+    std::atomic<int>& deleteCount;
+    std::atomic<Uint32> state;
+};
+
+} // End anonymous namespace
+
+TEST_CASE("TestEpochSlotArray")
+{
+    std::atomic<int> deleteCount = 0;
+
+    SECTION("Insert, find, and erase.")
+    {
+        EpochSlotArray<TestObject> array(10);
+        REQUIRE(array.insert(3, std::make_unique<TestObject>(deleteCount)));
+        REQUIRE(array.find(3) != nullptr);
+        REQUIRE(array.find(4) == nullptr);
+        REQUIRE(array.getSize() == 1);
+        REQUIRE(array.getGeneration(3) == 1);
+
+        // Occupied or out of range IDs are rejected.
+        REQUIRE(!array.insert(3, std::make_unique<TestObject>(deleteCount)));
+        REQUIRE(!array.insert(10, std::make_unique<TestObject>(deleteCount)));
+        REQUIRE(array.find(10) == nullptr);
+        REQUIRE(deleteCount == 2);
+
+        array.erase(3);
+        REQUIRE(array.find(3) == nullptr);
+        REQUIRE(array.getSize() == 0);
+        REQUIRE(array.getGeneration(3) == 2);
+
+        // With no readers, the erased object is deleted right away.
+        array.reclaimRetired();
+        REQUIRE(deleteCount == 3);
+        REQUIRE(array.getRetiredCount() == 0);
+    }
+
+    SECTION("Iterate in strides.")
+    {
+        EpochSlotArray<TestObject> array(10);
+        for (std::size_t id : {0, 2, 5, 6, 9}) {
+            array.insert(id, std::make_unique<TestObject>(deleteCount));
+        }
+
+        std::vector<std::size_t> ids;
+        array.forEachInStride(
+            1, 2, [&](std::size_t id, TestObject&) { ids.push_back(id); });
+        REQUIRE(ids == std::vector<std::size_t>{5, 9});
+
+        ids.clear();
+        array.forEach([&](std::size_t id, TestObject&) { ids.push_back(id); });
+        REQUIRE(ids == std::vector<std::size_t>{0, 2, 5, 6, 9});
+    }
+
+    SECTION("Erased objects outlive active readers.")
+    {
+        EpochSlotArray<TestObject> array(10);
+        array.insert(1, std::make_unique<TestObject>(deleteCount));
+
+        std::atomic<bool> readerHasObject = false;
+        std::atomic<bool> releaseReader = false;
+        std::atomic<bool> objectWasAlive = false;
+        std::thread reader([&]() {
+            EpochSlotArray<TestObject>::ReadGuard guard(array);
+            TestObject* object = array.find(1);
+            readerHasObject = true;
+            while (!releaseReader) {
+                std::this_thread::yield();
+            }
+            objectWasAlive = (object->state == TestObject::ALIVE);
+        });
+        while (!readerHasObject) {
+            std::this_thread::yield();
+        }
+
+        // The reader is still using it, so it shouldn't be deleted.
+        array.erase(1);
+        array.reclaimRetired();
+        REQUIRE(deleteCount == 0);
+        REQUIRE(array.getRetiredCount() == 1);
+
+        releaseReader = true;
+        reader.join();
+        REQUIRE(objectWasAlive);
+        array.reclaimRetired();
+        REQUIRE(deleteCount == 1);
+    }
+
+    SECTION("Concurrent readers never see deleted objects.")
+    {
+        static constexpr std::size_t CAPACITY = 16;
+        EpochSlotArray<TestObject> array(CAPACITY);
+
+        std::atomic<bool> exitRequested = false;
+        std::atomic<int> badReads = 0;
+        std::vector<std::thread> readers;
+        for (unsigned int i = 0; i < 3; ++i) {
+            readers.emplace_back([&]() {
+                while (!exitRequested) {
+                    EpochSlotArray<TestObject>::ReadGuard guard(array);
+                    array.forEach([&](std::size_t, TestObject& object) {
+                        if (object.state != TestObject::ALIVE) {
+                            badReads++;
+                        }
+                    });
+                }
+            });
+        }
+
+        // Churn the slots.
+        for (unsigned int i = 0; i < 20000; ++i) {
+            std::size_t id = (i % CAPACITY);
+            array.erase(id);
+            array.insert(id, std::make_unique<TestObject>(deleteCount));
+            array.reclaimRetired();
+        }
+
+        exitRequested = true;
+        for (std::thread& reader : readers) {
+            reader.join();
+        }
+        array.reclaimRetired();
+
+        REQUIRE(badReads == 0);
+        REQUIRE(array.getRetiredCount() == 0);
+        REQUIRE(deleteCount == (20000 - CAPACITY));
+    }
+}
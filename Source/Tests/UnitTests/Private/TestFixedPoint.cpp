@@ -0,0 +1,64 @@
+#include <catch2/catch.hpp>
+#include "FixedPoint.h"
+#include "MovementHelpers.h"
+#include "SharedConfig.h"
+#include "SDL_stdinc.h"
+
+using namespace AM;
+
+namespace
+{
+using Fixed = FixedPoint<Sint64, 16>;
+
+} // End anonymous namespace
+
+TEST_CASE("TestFixedPoint")
+{
+    SECTION("Float conversions round to nearest.")
+    {
+        REQUIRE(Fixed::fromFloat(1.5).getRaw()
+                == (Fixed::ONE + (Fixed::ONE / 2)));
+        REQUIRE(Fixed::fromFloat(-2).getRaw() == (-2 * Fixed::ONE));
+        REQUIRE(Fixed::fromFloat(1.0 / 30).getRaw() == 2185);
+        REQUIRE(Fixed::fromFloat(1.5).toFloat() == 1.5f);
+        REQUIRE(Fixed::fromFloat(-123.25).toFloat() == -123.25f);
+    }
+
+    SECTION("Multiplication rounds to nearest.")
+    {
+        Fixed half = Fixed::fromFloat(0.5);
+        Fixed three = Fixed::fromFloat(3);
+        REQUIRE((half * three) == Fixed::fromFloat(1.5));
+        REQUIRE((-half * three) == Fixed::fromFloat(-1.5));
+
+        // 1 raw unit * 0.5 is exactly half a raw unit, which rounds up.
+        REQUIRE((Fixed::fromRaw(1) * half).getRaw() == 1);
+        REQUIRE((Fixed::fromRaw(-1) * half).getRaw() == 0);
+    }
+
+    SECTION("Movement is exact.")
+    {
+        BasicPosition<Fixed> position{};
+        BasicMovement<Fixed> movement{};
+        Input::StateArr inputStates{};
+        inputStates[Input::XUp] = Input::Pressed;
+        inputStates[Input::YUp] = Input::Pressed;
+
+        Fixed deltaSeconds
+            = Fixed::fromFloat(SharedConfig::SIM_TICK_TIMESTEP_S);
+        for (unsigned int i = 0; i < SharedConfig::SIM_TICKS_PER_SECOND; ++i) {
+            MovementHelpers::moveEntity(position, movement, inputStates,
+                                        deltaSeconds);
+        }
+
+        // Each tick moves by round(VELOCITY * deltaSeconds), in raw units.
+        Sint64 stepRaw = (Fixed::fromFloat(MovementHelpers::VELOCITY)
+                          * deltaSeconds)
+                             .getRaw();
+        REQUIRE(position.x.getRaw()
+                == (stepRaw * SharedConfig::SIM_TICKS_PER_SECOND));
+        REQUIRE(position.y.getRaw()
+                == (-stepRaw * SharedConfig::SIM_TICKS_PER_SECOND));
+        REQUIRE(position.z.getRaw() == 0);
+    }
+}
@@ -0,0 +1,64 @@
+#include <catch2/catch.hpp>
+#include "IDPool.h"
+#include <unordered_set>
+
+using namespace AM;
+using namespace AM::Server;
+
+TEST_CASE("TestIDPool")
+{
+    SECTION("Reserved IDs are unique and have in-range indices.")
+    {
+        IDPool idPool(100);
+        std::unordered_set<NetworkID> IDs;
+        std::unordered_set<unsigned int> indices;
+        for (unsigned int i = 0; i < 100; ++i) {
+            NetworkID ID = idPool.reserveID();
+            REQUIRE(ID != 0);
+            REQUIRE(IDPool::getIndex(ID) < 100);
+            REQUIRE(idPool.isReserved(ID));
+            IDs.insert(ID);
+            indices.insert(IDPool::getIndex(ID));
+        }
+
+        REQUIRE(IDs.size() == 100);
+        REQUIRE(indices.size() == 100);
+    }
+
+    SECTION("Freed indices are reused in order, with a new generation.")
+    {
+        IDPool idPool(3);
+        NetworkID first = idPool.reserveID();
+        NetworkID second = idPool.reserveID();
+        NetworkID third = idPool.reserveID();
+
+        idPool.freeID(second);
+        idPool.freeID(first);
+        REQUIRE(!idPool.isReserved(second));
+        REQUIRE(!idPool.isReserved(first));
+        REQUIRE(idPool.isReserved(third));
+
+        NetworkID reusedSecond = idPool.reserveID();
+        NetworkID reusedFirst = idPool.reserveID();
+        REQUIRE(IDPool::getIndex(reusedSecond) == IDPool::getIndex(second));
+        REQUIRE(IDPool::getIndex(reusedFirst) == IDPool::getIndex(first));
+        REQUIRE(IDPool::getGeneration(reusedSecond)
+                == (IDPool::getGeneration(second) + 1));
+
+        // The old IDs are stale, even though their indices are reserved.
+        REQUIRE(reusedSecond != second);
+        REQUIRE(!idPool.isReserved(second));
+        REQUIRE(idPool.isReserved(reusedSecond));
+    }
+
+    SECTION("Churn keeps IDs unique.")
+    {
+        IDPool idPool(10);
+        std::unordered_set<NetworkID> seenIDs;
+        for (unsigned int i = 0; i < 10000; ++i) {
+            NetworkID ID = idPool.reserveID();
+            REQUIRE(seenIDs.insert(ID).second);
+            idPool.freeID(ID);
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#include <catch2/catch.hpp>
+#include "JobSystem.h"
+#include <atomic>
+#include <vector>
+
+using namespace AM;
+
+TEST_CASE("TestJobSystem")
+{
+    Server::JobSystem jobSystem(3);
+
+    SECTION("Every element is processed once.")
+    {
+        std::vector<std::atomic<int>> visitCounts(1000);
+        for (std::atomic<int>& visitCount : visitCounts) {
+            visitCount = 0;
+        }
+
+        jobSystem.parallelFor(
+            visitCounts.size(), 64,
+            [&](std::size_t beginIndex, std::size_t endIndex) {
+                for (std::size_t i = beginIndex; i < endIndex; ++i) {
+                    visitCounts[i]++;
+                }
+            });
+
+        for (std::atomic<int>& visitCount : visitCounts) {
+            REQUIRE(visitCount == 1);
+        }
+    }
+
+    SECTION("Chunks are split the same way every time.")
+    {
+        // Record each element's chunk, across several runs.
+        std::vector<std::size_t> firstChunkStarts(1000);
+        std::vector<std::size_t> chunkStarts(1000);
+        for (int run = 0; run < 10; ++run) {
+            jobSystem.parallelFor(
+                chunkStarts.size(), 64,
+                [&](std::size_t beginIndex, std::size_t endIndex) {
+                    for (std::size_t i = beginIndex; i < endIndex; ++i) {
+                        chunkStarts[i] = beginIndex;
+                    }
+                });
+
+            if (run == 0) {
+                firstChunkStarts = chunkStarts;
+            }
+            REQUIRE(chunkStarts == firstChunkStarts);
+        }
+
+        REQUIRE(chunkStarts[63] == 0);
+        REQUIRE(chunkStarts[64] == 64);
+        REQUIRE(chunkStarts[999] == 960);
+    }
+
+    SECTION("Ranges smaller than a chunk.")
+    {
+        int callCount = 0;
+        jobSystem.parallelFor(
+            10, 64, [&](std::size_t beginIndex, std::size_t endIndex) {
+                REQUIRE(beginIndex == 0);
+                REQUIRE(endIndex == 10);
+                callCount++;
+            });
+        REQUIRE(callCount == 1);
+
+        jobSystem.parallelFor(0, 64, [&](std::size_t, std::size_t) {
+            callCount++;
+        });
+        REQUIRE(callCount == 1);
+    }
+
+    SECTION("No workers.")
+    {
+        Server::JobSystem serialJobSystem(0);
+
+        std::vector<int> values(100, 0);
+        serialJobSystem.parallelFor(
+            values.size(), 8,
+            [&](std::size_t beginIndex, std::size_t endIndex) {
+                for (std::size_t i = beginIndex; i < endIndex; ++i) {
+                    values[i] = static_cast<int>(i);
+                }
+            });
+
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            REQUIRE(values[i] == static_cast<int>(i));
+        }
+    }
+}
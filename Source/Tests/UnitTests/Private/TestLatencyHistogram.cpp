@@ -0,0 +1,100 @@
+#include <catch2/catch.hpp>
+#include "LatencyHistogram.h"
+#include <thread>
+#include <vector>
+
+using namespace AM;
+
+TEST_CASE("TestLatencyHistogram")
+{
+    LatencyHistogram histogram;
+
+    SECTION("Empty histogram.")
+    {
+        REQUIRE(histogram.getCount() == 0);
+        REQUIRE(histogram.getMax() == 0);
+        REQUIRE(histogram.getPercentile(50) == 0);
+    }
+
+    SECTION("Small values are exact.")
+    {
+        for (Uint64 i = 1; i <= 10; ++i) {
+            histogram.recordValue(i);
+        }
+
+        REQUIRE(histogram.getCount() == 10);
+        REQUIRE(histogram.getPercentile(50) == 5);
+        REQUIRE(histogram.getPercentile(90) == 9);
+        REQUIRE(histogram.getPercentile(100) == 10);
+        REQUIRE(histogram.getMax() == 10);
+    }
+
+    SECTION("Large values are within the bucket precision.")
+    {
+        // 1000 values from 1ms to 1s.
+        for (Uint64 i = 1; i <= 1000; ++i) {
+            histogram.recordValue(i * 1000);
+        }
+
+        Uint64 p50 = histogram.getPercentile(50);
+        REQUIRE(p50 >= 500'000);
+        REQUIRE(p50 <= (500'000 + (500'000 / 16)));
+
+        Uint64 p99 = histogram.getPercentile(99);
+        REQUIRE(p99 >= 990'000);
+        REQUIRE(p99 <= (990'000 + (990'000 / 16)));
+
+        // Percentiles never go above the max.
+        REQUIRE(histogram.getPercentile(100) == 1'000'000);
+    }
+
+    SECTION("Seconds are converted to microseconds.")
+    {
+        histogram.record(0.0025);
+        histogram.record(-1.0);
+
+        REQUIRE(histogram.getCount() == 2);
+        REQUIRE(histogram.getPercentile(50) == 0);
+        REQUIRE(histogram.getMax() == 2500);
+    }
+
+    SECTION("Values past the max are clamped.")
+    {
+        histogram.recordValue(LatencyHistogram::MAX_VALUE_US * 2);
+        REQUIRE(histogram.getMax() == LatencyHistogram::MAX_VALUE_US);
+        REQUIRE(histogram.getPercentile(50) == LatencyHistogram::MAX_VALUE_US);
+    }
+
+    SECTION("Concurrent recording.")
+    {
+        // Record from several threads while querying from this one.
+        std::vector<std::thread> threads;
+        for (Uint64 threadIndex = 0; threadIndex < 4; ++threadIndex) {
+            threads.emplace_back([&histogram, threadIndex]() {
+                for (Uint64 i = 0; i < 10000; ++i) {
+                    histogram.recordValue((threadIndex * 10000) + i);
+                }
+            });
+        }
+        while (histogram.getCount() < 40000) {
+            REQUIRE(histogram.getPercentile(50) <= histogram.getMax());
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        REQUIRE(histogram.getCount() == 40000);
+        REQUIRE(histogram.getMax() == 39999);
+        Uint64 p50 = histogram.getPercentile(50);
+        REQUIRE(p50 >= 19999);
+        REQUIRE(p50 <= (19999 + (19999 / 16)));
+    }
+
+    SECTION("Reset.")
+    {
+        histogram.recordValue(100);
+        histogram.reset();
+        REQUIRE(histogram.getCount() == 0);
+        REQUIRE(histogram.getPercentile(99) == 0);
+    }
+}
@@ -0,0 +1,94 @@
+#include <catch2/catch.hpp>
+#include "LogRingBuffer.h"
+#include <memory>
+#include <thread>
+
+using namespace AM;
+
+namespace
+{
+/** Pushes a record with the given tick, returning false if it was dropped.
+ */
+bool pushRecord(LogRingBuffer& ring, Uint32 tickNum)
+{
+    LogRecord* record = ring.beginPush();
+    if (record == nullptr) {
+        return false;
+    }
+
+    record->tickNum = tickNum;
+    record->textLength = 0;
+    ring.endPush();
+    return true;
+}
+
+} // End anonymous namespace
+
+TEST_CASE("TestLogRingBuffer")
+{
+    // The ring is large, keep it off the stack.
+    std::unique_ptr<LogRingBuffer> ring = std::make_unique<LogRingBuffer>();
+
+    SECTION("Records come out in order.")
+    {
+        REQUIRE(ring->front() == nullptr);
+
+        for (Uint32 i = 0; i < 10; ++i) {
+            REQUIRE(pushRecord(*ring, i));
+        }
+        for (Uint32 i = 0; i < 10; ++i) {
+            const LogRecord* record = ring->front();
+            REQUIRE(record != nullptr);
+            REQUIRE(record->tickNum == i);
+            ring->popFront();
+        }
+
+        REQUIRE(ring->front() == nullptr);
+        REQUIRE(ring->getDropCount() == 0);
+    }
+
+    SECTION("Records are dropped and counted when full.")
+    {
+        for (Uint32 i = 0; i < LogRingBuffer::CAPACITY; ++i) {
+            REQUIRE(pushRecord(*ring, i));
+        }
+        REQUIRE(!pushRecord(*ring, 0));
+        REQUIRE(!pushRecord(*ring, 0));
+        REQUIRE(ring->getDropCount() == 2);
+
+        // Popping makes room again.
+        ring->popFront();
+        REQUIRE(pushRecord(*ring, LogRingBuffer::CAPACITY));
+        REQUIRE(ring->front()->tickNum == 1);
+    }
+
+    SECTION("Concurrent producer and consumer.")
+    {
+        constexpr Uint32 RECORD_COUNT = 100000;
+        std::thread producer([&ring]() {
+            for (Uint32 i = 0; i < RECORD_COUNT; ++i) {
+                while (!pushRecord(*ring, i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        // Every record should come out exactly once, in order.
+        Uint32 expectedTick = 0;
+        bool inOrder = true;
+        while (expectedTick < RECORD_COUNT) {
+            if (const LogRecord* record = ring->front()) {
+                inOrder = (inOrder && (record->tickNum == expectedTick));
+                ring->popFront();
+                expectedTick++;
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+
+        REQUIRE(inOrder);
+        REQUIRE(ring->front() == nullptr);
+    }
+}
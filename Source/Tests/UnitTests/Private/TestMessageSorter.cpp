@@ -7,9 +7,21 @@
 
 using namespace AM;
 
+namespace
+{
+using MessageSorter = Server::MessageSorter<BinaryBufferPtr>;
+using ValidityResult = Server::MessageSorterBase::ValidityResult;
+
+bool isTickValid(MessageSorter& messageSorter, Uint32 tickNum)
+{
+    return (messageSorter.isTickValid(tickNum) == ValidityResult::Valid);
+}
+
+} // End anonymous namespace
+
 TEST_CASE("TestMessageSorter")
 {
-    Server::MessageSorter messageSorter;
+    MessageSorter messageSorter;
 
     REQUIRE(messageSorter.getCurrentTick() == 0);
 
@@ -28,7 +40,7 @@ TEST_CASE("TestMessageSorter")
 
         // Advance the tick.
         messageSorter.endReceive();
-        REQUIRE(!(messageSorter.isTickValid(0)));
+        REQUIRE(!(isTickValid(messageSorter, 0)));
     }
 
     SECTION("Multiple messages for same tick.")
@@ -57,7 +69,7 @@ TEST_CASE("TestMessageSorter")
 
         // Advance the tick.
         messageSorter.endReceive();
-        REQUIRE(!(messageSorter.isTickValid(0)));
+        REQUIRE(!(isTickValid(messageSorter, 0)));
     }
 
     SECTION("Multiple messages over multiple ticks.")
@@ -91,7 +103,7 @@ TEST_CASE("TestMessageSorter")
 
         messageSorter.endReceive();
         REQUIRE(messageSorter.getCurrentTick() == 1);
-        REQUIRE(!(messageSorter.isTickValid(0)));
+        REQUIRE(!(isTickValid(messageSorter, 0)));
 
         // Check that tick 1 is empty.
         queue = &(messageSorter.startReceive(1));
@@ -99,7 +111,7 @@ TEST_CASE("TestMessageSorter")
 
         messageSorter.endReceive();
         REQUIRE(messageSorter.getCurrentTick() == 2);
-        REQUIRE(!(messageSorter.isTickValid(1)));
+        REQUIRE(!(isTickValid(messageSorter, 1)));
 
         // Try to receive ticks 2 and 3.
         for (Uint32 i = 2; i <= 3; ++i) {
@@ -120,34 +132,32 @@ TEST_CASE("TestMessageSorter")
 
             messageSorter.endReceive();
             REQUIRE(messageSorter.getCurrentTick() == (i + 1));
-            REQUIRE(!(messageSorter.isTickValid(i)));
+            REQUIRE(!(isTickValid(messageSorter, i)));
         }
     }
 
     SECTION("Wrap once.")
     {
         // Advance until we wrap.
-        for (unsigned int i = 0; i < Server::MessageSorter::BUFFER_SIZE; ++i) {
+        for (unsigned int i = 0; i < MessageSorter::BUFFER_SIZE; ++i) {
             messageSorter.startReceive(i);
             messageSorter.endReceive();
         }
 
         // Check that we're on the correct tick and everything works.
-        REQUIRE(messageSorter.getCurrentTick()
-                == (Server::MessageSorter::BUFFER_SIZE));
-        REQUIRE(!(
-            messageSorter.isTickValid(Server::MessageSorter::BUFFER_SIZE - 1)));
-        REQUIRE((messageSorter.isTickValid(
-            Server::MessageSorter::BUFFER_SIZE * 2 - 1)));
+        REQUIRE(messageSorter.getCurrentTick() == (MessageSorter::BUFFER_SIZE));
+        REQUIRE(!(isTickValid(messageSorter, MessageSorter::BUFFER_SIZE - 1)));
+        REQUIRE(
+            isTickValid(messageSorter, MessageSorter::BUFFER_SIZE * 2 - 1));
 
         // Push a message.
         messageSorter.push(
-            Server::MessageSorter::BUFFER_SIZE,
+            MessageSorter::BUFFER_SIZE,
             std::make_unique<std::vector<Uint8>>(std::vector<Uint8>{1, 2, 3}));
 
         // Try to receive.
         std::queue<BinaryBufferPtr>& queue
-            = messageSorter.startReceive(Server::MessageSorter::BUFFER_SIZE);
+            = messageSorter.startReceive(MessageSorter::BUFFER_SIZE);
         REQUIRE(!(queue.empty()));
 
         BinaryBufferPtr message = std::move(queue.front());
@@ -155,14 +165,13 @@ TEST_CASE("TestMessageSorter")
 
         // Advance the tick.
         messageSorter.endReceive();
-        REQUIRE(
-            !(messageSorter.isTickValid(Server::MessageSorter::BUFFER_SIZE)));
+        REQUIRE(!(isTickValid(messageSorter, MessageSorter::BUFFER_SIZE)));
     }
 
     SECTION("Wrap a lot.")
     {
         // Advance until we wrap.
-        unsigned int tickNum = Server::MessageSorter::BUFFER_SIZE * 407;
+        unsigned int tickNum = MessageSorter::BUFFER_SIZE * 407;
         for (unsigned int i = 0; i < tickNum; ++i) {
             messageSorter.startReceive(i);
             messageSorter.endReceive();
@@ -170,9 +179,9 @@ TEST_CASE("TestMessageSorter")
 
         // Check that we're on the correct tick and everything works.
         REQUIRE(messageSorter.getCurrentTick() == (tickNum));
-        REQUIRE(!(messageSorter.isTickValid(tickNum - 1)));
-        REQUIRE((messageSorter.isTickValid(
-            tickNum + Server::MessageSorter::BUFFER_SIZE - 1)));
+        REQUIRE(!(isTickValid(messageSorter, tickNum - 1)));
+        REQUIRE(isTickValid(messageSorter,
+                            tickNum + MessageSorter::BUFFER_SIZE - 1));
 
         // Push a message.
         messageSorter.push(tickNum, std::make_unique<std::vector<Uint8>>(
@@ -188,7 +197,7 @@ TEST_CASE("TestMessageSorter")
 
         // Advance the tick.
         messageSorter.endReceive();
-        REQUIRE(!(messageSorter.isTickValid(tickNum)));
+        REQUIRE(!(isTickValid(messageSorter, tickNum)));
     }
 
     SECTION("Pushing from non-zero indices works correctly.")
@@ -218,17 +227,18 @@ TEST_CASE("TestMessageSorter")
 
         // Advance the tick.
         messageSorter.endReceive();
-        REQUIRE(!(messageSorter.isTickValid(7)));
+        REQUIRE(!(isTickValid(messageSorter, 7)));
     }
 
     SECTION("Large positive difference returns invalid.")
     {
         // Create a large diff.
-        Sint64 result = messageSorter.push(
+        MessageSorter::PushResult result = messageSorter.push(
             5000, std::make_unique<BinaryBuffer>(BinaryBuffer{1, 2, 3}));
 
-        REQUIRE(result == 5000);
-        REQUIRE(!(messageSorter.isTickValid(5000)));
+        REQUIRE(result.result == ValidityResult::TooHigh);
+        REQUIRE(result.diff == 5000);
+        REQUIRE(!(isTickValid(messageSorter, 5000)));
     }
 
     SECTION("Large negative difference returns invalid.")
@@ -239,29 +249,31 @@ TEST_CASE("TestMessageSorter")
             messageSorter.endReceive();
         }
 
-        Sint64 result = messageSorter.push(
+        MessageSorter::PushResult result = messageSorter.push(
             100, std::make_unique<BinaryBuffer>(BinaryBuffer{1, 2, 3}));
 
-        REQUIRE(result == -900);
-        REQUIRE(!(messageSorter.isTickValid(100)));
+        REQUIRE(result.result == ValidityResult::TooLow);
+        REQUIRE(result.diff == -900);
+        REQUIRE(!(isTickValid(messageSorter, 100)));
     }
 
     SECTION("Small positive difference returns invalid.")
     {
         // Create a small diff.
-        Sint64 result1 = messageSorter.push(
+        MessageSorter::PushResult result1 = messageSorter.push(
             0, std::make_unique<BinaryBuffer>(BinaryBuffer{1, 2, 3}));
 
-        Sint64 result2 = messageSorter.push(
-            Server::MessageSorter::BUFFER_SIZE - 1,
+        MessageSorter::PushResult result2 = messageSorter.push(
+            MessageSorter::BUFFER_SIZE - 1,
             std::make_unique<BinaryBuffer>(BinaryBuffer{1, 2, 3}));
 
-        REQUIRE(result1 == 0);
-        REQUIRE(result2 == (Server::MessageSorter::BUFFER_SIZE - 1));
+        REQUIRE(result1.result == ValidityResult::Valid);
+        REQUIRE(result1.diff == 0);
+        REQUIRE(result2.result == ValidityResult::Valid);
+        REQUIRE(result2.diff == (MessageSorter::BUFFER_SIZE - 1));
         REQUIRE(
-            messageSorter.isTickValid(Server::MessageSorter::BUFFER_SIZE - 1));
-        REQUIRE(
-            !(messageSorter.isTickValid(Server::MessageSorter::BUFFER_SIZE)));
+            isTickValid(messageSorter, MessageSorter::BUFFER_SIZE - 1));
+        REQUIRE(!(isTickValid(messageSorter, MessageSorter::BUFFER_SIZE)));
     }
 
     SECTION("Small negative difference returns invalid.")
@@ -272,45 +284,50 @@ TEST_CASE("TestMessageSorter")
             messageSorter.endReceive();
         }
 
-        Sint64 result1 = messageSorter.push(
+        MessageSorter::PushResult result1 = messageSorter.push(
             1000, std::make_unique<BinaryBuffer>(BinaryBuffer{1, 2, 3}));
 
-        Sint64 result2 = messageSorter.push(
+        MessageSorter::PushResult result2 = messageSorter.push(
             1000 - 1, std::make_unique<BinaryBuffer>(BinaryBuffer{1, 2, 3}));
 
-        REQUIRE(result1 == 0);
-        REQUIRE(result2 == -1);
-        REQUIRE(messageSorter.isTickValid(1000));
-        REQUIRE(!(messageSorter.isTickValid(1000 - 1)));
+        REQUIRE(result1.result == ValidityResult::Valid);
+        REQUIRE(result1.diff == 0);
+        REQUIRE(result2.result == ValidityResult::TooLow);
+        REQUIRE(result2.diff == -1);
+        REQUIRE(isTickValid(messageSorter, 1000));
+        REQUIRE(!(isTickValid(messageSorter, 1000 - 1)));
     }
 
     SECTION("Wrapping occurs at the expected point.")
     {
-        // Push a message (we're going to leave it as a marker for wrapping.)
-        messageSorter.push(0, std::make_unique<std::vector<Uint8>>(
-                                  std::vector<Uint8>{1, 2, 3}));
+        // Advance to tick 1 so that we can push into the wrapped slot.
+        messageSorter.startReceive(0);
+        messageSorter.endReceive();
+
+        // Push a message into the tick that wraps back to slot 0.
+        messageSorter.push(MessageSorter::BUFFER_SIZE,
+                           std::make_unique<std::vector<Uint8>>(
+                               std::vector<Uint8>{1, 2, 3}));
 
         // Advance until we're on the edge of wrapping.
-        for (unsigned int i = 0; i < (Server::MessageSorter::BUFFER_SIZE - 1);
-             ++i) {
+        for (unsigned int i = 1; i < (MessageSorter::BUFFER_SIZE - 1); ++i) {
             messageSorter.startReceive(i);
             messageSorter.endReceive();
         }
         REQUIRE(messageSorter.getCurrentTick()
-                == (Server::MessageSorter::BUFFER_SIZE - 1));
+                == (MessageSorter::BUFFER_SIZE - 1));
 
         // Try to receive, there should be nothing here.
-        std::queue<BinaryBufferPtr>* queue = &(
-            messageSorter.startReceive(Server::MessageSorter::BUFFER_SIZE - 1));
+        std::queue<BinaryBufferPtr>* queue
+            = &(messageSorter.startReceive(MessageSorter::BUFFER_SIZE - 1));
         REQUIRE(queue->empty());
 
         // Advance over the edge of wrapping.
         messageSorter.endReceive();
 
         // Try to receive, since we should have wrapped back to the original
-        // message.
-        queue
-            = &(messageSorter.startReceive(Server::MessageSorter::BUFFER_SIZE));
+        // slot.
+        queue = &(messageSorter.startReceive(MessageSorter::BUFFER_SIZE));
         REQUIRE(!(queue->empty()));
 
         BinaryBufferPtr message = std::move(queue->front());
@@ -318,4 +335,84 @@ TEST_CASE("TestMessageSorter")
 
         messageSorter.endReceive();
     }
+
+    SECTION("Unprocessed messages are discarded.")
+    {
+        // Push a message and don't process it.
+        messageSorter.push(
+            0, std::make_unique<BinaryBuffer>(BinaryBuffer{1, 2, 3}));
+        messageSorter.startReceive(0);
+        messageSorter.endReceive();
+
+        // Advance to the tick that shares its slot.
+        for (unsigned int i = 1; i < MessageSorter::BUFFER_SIZE; ++i) {
+            messageSorter.startReceive(i);
+            messageSorter.endReceive();
+        }
+
+        // The old message shouldn't be received.
+        std::queue<BinaryBufferPtr>& queue
+            = messageSorter.startReceive(MessageSorter::BUFFER_SIZE);
+        REQUIRE(queue.empty());
+        messageSorter.endReceive();
+    }
+
+    SECTION("Pushing while receiving.")
+    {
+        std::queue<BinaryBufferPtr>& queue = messageSorter.startReceive(0);
+        REQUIRE(queue.empty());
+
+        // Pushes for the tick being received should be rejected.
+        MessageSorter::PushResult result1 = messageSorter.push(
+            0, std::make_unique<BinaryBuffer>(BinaryBuffer{1, 2, 3}));
+        REQUIRE(result1.result == ValidityResult::TooLow);
+        REQUIRE(queue.empty());
+
+        // Pushes for future ticks should go through.
+        MessageSorter::PushResult result2 = messageSorter.push(
+            1, std::make_unique<BinaryBuffer>(BinaryBuffer{4, 5, 6}));
+        REQUIRE(result2.result == ValidityResult::Valid);
+        messageSorter.endReceive();
+
+        std::queue<BinaryBufferPtr>& nextQueue = messageSorter.startReceive(1);
+        REQUIRE(nextQueue.size() == 1);
+        REQUIRE(*(nextQueue.front()) == std::vector<Uint8>({4, 5, 6}));
+        messageSorter.endReceive();
+    }
+
+    SECTION("Pools are reused, and overflow is allocated.")
+    {
+        // Use a pool that's smaller than a tick's messages.
+        MessageSorter smallSorter(2);
+
+        for (Uint32 tick = 0; tick < (MessageSorter::BUFFER_SIZE * 3);
+             ++tick) {
+            // Push more messages than the pool holds.
+            for (Uint8 i = 0; i < 5; ++i) {
+                REQUIRE(smallSorter
+                            .push(tick, std::make_unique<BinaryBuffer>(
+                                            BinaryBuffer{i}))
+                            .result
+                        == ValidityResult::Valid);
+            }
+
+            // A push while the tick is being received should be rejected.
+            std::queue<BinaryBufferPtr>& queue = smallSorter.startReceive(tick);
+            REQUIRE(smallSorter
+                        .push(tick,
+                              std::make_unique<BinaryBuffer>(BinaryBuffer{9}))
+                        .result
+                    == ValidityResult::TooLow);
+
+            // Every message should come out in order.
+            REQUIRE(queue.size() == 5);
+            for (Uint8 i = 0; i < 5; ++i) {
+                REQUIRE(*(queue.front()) == BinaryBuffer{i});
+                queue.pop();
+            }
+            REQUIRE(smallSorter.getStaleMessages().empty());
+
+            smallSorter.endReceive();
+        }
+    }
 }
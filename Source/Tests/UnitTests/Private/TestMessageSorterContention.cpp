@@ -0,0 +1,167 @@
+#include <catch2/catch.hpp>
+#include "MessageSorter.h"
+#include "SDL_stdinc.h"
+#include "Log.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace AM;
+
+namespace
+{
+using MessageSorter = Server::MessageSorter<Uint32>;
+using ValidityResult = Server::MessageSorterBase::ValidityResult;
+using Clock = std::chrono::steady_clock;
+
+/** Per-producer results. Padded so producers don't share a cache line. */
+struct alignas(64) ProducerStats {
+    Uint64 validPushes = 0;
+    Uint64 rejectedPushes = 0;
+    Clock::duration totalPushTime{0};
+    Clock::duration maxPushTime{0};
+};
+
+void produce(MessageSorter& messageSorter, std::atomic<bool>& isRunning,
+             std::atomic<unsigned int>& readyCount, unsigned int producerIndex,
+             ProducerStats& stats)
+{
+    readyCount++;
+
+    Uint32 offset = producerIndex;
+    while (isRunning) {
+        // Push for a tick in the future, like a client that's ahead of us.
+        offset = (offset % (MessageSorter::BUFFER_SIZE - 1)) + 1;
+        Uint32 tickNum = messageSorter.getCurrentTick() + offset;
+
+        Clock::time_point startTime = Clock::now();
+        MessageSorter::PushResult result = messageSorter.push(tickNum, tickNum);
+        Clock::duration pushTime = Clock::now() - startTime;
+
+        if (result.result == ValidityResult::Valid) {
+            stats.validPushes++;
+        }
+        else {
+            stats.rejectedPushes++;
+        }
+        stats.totalPushTime += pushTime;
+        stats.maxPushTime = std::max(stats.maxPushTime, pushTime);
+
+        // Give the other threads a chance, like a receiver waiting on its
+        // sockets would.
+        std::this_thread::yield();
+    }
+}
+
+double toMicroseconds(Clock::duration duration)
+{
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+} // End anonymous namespace
+
+/**
+ * Measures push and receive times while several producers push at the same
+ * time as the consumer receives.
+ *
+ * Hidden by default, run with: UnitTests "[benchmark]"
+ */
+TEST_CASE("TestMessageSorterContention", "[.][benchmark]")
+{
+    static constexpr unsigned int NUM_PRODUCERS = 4;
+    /** How long to run the benchmark for. */
+    static constexpr std::chrono::seconds BENCH_TIME{2};
+    /** How long each tick takes, so producers get a chance to push. */
+    static constexpr std::chrono::microseconds TICK_TIME{50};
+
+    MessageSorter messageSorter;
+    std::atomic<bool> isRunning = true;
+    std::atomic<unsigned int> readyCount = 0;
+    std::vector<ProducerStats> producerStats(NUM_PRODUCERS);
+
+    std::vector<std::thread> producers;
+    for (unsigned int i = 0; i < NUM_PRODUCERS; ++i) {
+        producers.emplace_back(produce, std::ref(messageSorter),
+                               std::ref(isRunning), std::ref(readyCount), i,
+                               std::ref(producerStats[i]));
+    }
+
+    // Wait for the producers to start.
+    while (readyCount < NUM_PRODUCERS) {
+        std::this_thread::yield();
+    }
+
+    // Receive each tick, then spin until the tick is over.
+    Uint64 receivedCount = 0;
+    Uint64 wrongTickCount = 0;
+    Clock::duration totalReceiveTime{0};
+    Clock::duration maxReceiveTime{0};
+    Clock::time_point benchStartTime = Clock::now();
+    Uint32 tickNum = 0;
+    while ((Clock::now() - benchStartTime) < BENCH_TIME) {
+        Clock::time_point startTime = Clock::now();
+
+        std::queue<Uint32>& queue = messageSorter.startReceive(tickNum);
+        while (!(queue.empty())) {
+            if (queue.front() != tickNum) {
+                wrongTickCount++;
+            }
+            queue.pop();
+            receivedCount++;
+        }
+        messageSorter.endReceive();
+
+        Clock::duration receiveTime = Clock::now() - startTime;
+        totalReceiveTime += receiveTime;
+        maxReceiveTime = std::max(maxReceiveTime, receiveTime);
+
+        tickNum++;
+        while ((Clock::now() - startTime) < TICK_TIME) {
+            std::this_thread::yield();
+        }
+    }
+    Clock::duration benchTime = Clock::now() - benchStartTime;
+
+    isRunning = false;
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+
+    // Receive whatever is still buffered.
+    for (Uint32 i = 0; i < MessageSorter::BUFFER_SIZE; ++i) {
+        std::queue<Uint32>& queue = messageSorter.startReceive(tickNum++);
+        receivedCount += queue.size();
+        queue = {};
+        messageSorter.endReceive();
+    }
+
+    // Every message should have been received on its own tick, and every
+    // valid push should have been received or counted as stale.
+    REQUIRE(wrongTickCount == 0);
+    ProducerStats totals{};
+    for (const ProducerStats& stats : producerStats) {
+        totals.validPushes += stats.validPushes;
+        totals.rejectedPushes += stats.rejectedPushes;
+        totals.totalPushTime += stats.totalPushTime;
+        totals.maxPushTime = std::max(totals.maxPushTime, stats.maxPushTime);
+    }
+    REQUIRE(totals.validPushes
+            == (receivedCount + messageSorter.getStaleMessageCount()));
+
+    Uint64 totalPushes = totals.validPushes + totals.rejectedPushes;
+    double benchSeconds = std::chrono::duration<double>(benchTime).count();
+    Uint32 benchTicks = tickNum - MessageSorter::BUFFER_SIZE;
+    LOG_INFO("MessageSorter contention: %u producers, %u ticks, %.3fs",
+             NUM_PRODUCERS, benchTicks, benchSeconds);
+    LOG_INFO("Pushes: %llu (%.0f/s), rejected: %llu, stale: %u", totalPushes,
+             (totalPushes / benchSeconds), totals.rejectedPushes,
+             messageSorter.getStaleMessageCount());
+    LOG_INFO("Push time (us): avg %.3f, max %.3f",
+             (toMicroseconds(totals.totalPushTime) / totalPushes),
+             toMicroseconds(totals.maxPushTime));
+    LOG_INFO("Receive time (us): avg %.3f, max %.3f",
+             (toMicroseconds(totalReceiveTime) / benchTicks),
+             toMicroseconds(maxReceiveTime));
+}
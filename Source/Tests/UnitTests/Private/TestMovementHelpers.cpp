@@ -0,0 +1,76 @@
+#include <catch2/catch.hpp>
+#include "MovementHelpers.h"
+#include "Position.h"
+#include "Movement.h"
+#include "Input.h"
+#include "SharedConfig.h"
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace AM;
+
+TEST_CASE("TestMovementHelpers")
+{
+    SECTION("Batch movement matches per-entity movement exactly.")
+    {
+        // Use a count that isn't a multiple of the SIMD width, so the
+        // remainder path gets tested too.
+        static constexpr std::size_t ENTITY_COUNT = 1003;
+
+        std::mt19937 generator(1234);
+        std::uniform_real_distribution<float> positionDistribution(-100000,
+                                                                   100000);
+        std::uniform_int_distribution<int> inputDistribution(0, 1);
+
+        std::vector<Position> positions(ENTITY_COUNT);
+        std::vector<Movement> movements(ENTITY_COUNT);
+        std::vector<Input> inputs(ENTITY_COUNT);
+        for (std::size_t i = 0; i < ENTITY_COUNT; ++i) {
+            positions[i] = {positionDistribution(generator),
+                            positionDistribution(generator),
+                            positionDistribution(generator)};
+            for (Input::State& inputState : inputs[i].inputStates) {
+                inputState = static_cast<Input::State>(
+                    inputDistribution(generator));
+            }
+        }
+
+        // Make sure every input combination shows up.
+        for (std::size_t i = 0; i < 64; ++i) {
+            for (std::size_t j = 0; j < 6; ++j) {
+                inputs[i].inputStates[j + 1]
+                    = static_cast<Input::State>((i >> j) & 1);
+            }
+        }
+
+        // Move a copy of each entity using the per-entity path.
+        std::vector<Position> expectedPositions{positions};
+        std::vector<Movement> expectedMovements{movements};
+        std::vector<Input> expectedInputs{inputs};
+
+        // Run a few ticks so that positions accumulate.
+        for (int tick = 0; tick < 10; ++tick) {
+            for (std::size_t i = 0; i < ENTITY_COUNT; ++i) {
+                MovementHelpers::moveEntity(expectedPositions[i],
+                                            expectedMovements[i],
+                                            expectedInputs[i].inputStates,
+                                            SharedConfig::SIM_TICK_TIMESTEP_S);
+            }
+
+            MovementHelpers::moveEntities(
+                positions.data(), movements.data(), inputs.data(),
+                ENTITY_COUNT, SharedConfig::SIM_TICK_TIMESTEP_S);
+        }
+
+        // Compare the bits, so that -0 vs 0 and NaNs would be caught.
+        for (std::size_t i = 0; i < ENTITY_COUNT; ++i) {
+            REQUIRE(std::memcmp(&(positions[i]), &(expectedPositions[i]),
+                                sizeof(Position))
+                    == 0);
+            REQUIRE(std::memcmp(&(movements[i]), &(expectedMovements[i]),
+                                sizeof(Movement))
+                    == 0);
+        }
+    }
+}
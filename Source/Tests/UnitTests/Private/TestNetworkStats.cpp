@@ -0,0 +1,97 @@
+#include <catch2/catch.hpp>
+#include "NetworkStats.h"
+#include "ClientStats.h"
+#include <thread>
+#include <vector>
+
+using namespace AM;
+
+TEST_CASE("TestNetworkStats")
+{
+    SECTION("Message type stats are summed across threads.")
+    {
+        // Note: The stats are static, so compare against a baseline.
+        MessageTypeStatsArr baseline = NetworkStats::getMessageTypeStats();
+
+        std::vector<std::thread> threads;
+        for (unsigned int i = 0; i < 4; ++i) {
+            threads.emplace_back([]() {
+                for (unsigned int j = 0; j < 1000; ++j) {
+                    NetworkStats::recordMessageSent(MessageType::EntityUpdate,
+                                                    10);
+                    NetworkStats::recordMessageReceived(
+                        MessageType::ClientInputs, 5);
+                }
+                NetworkStats::recordMessageDropped(MessageType::ClientInputs);
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        MessageTypeStatsArr stats = NetworkStats::getMessageTypeStats();
+        const std::size_t updateIndex
+            = static_cast<std::size_t>(MessageType::EntityUpdate);
+        const std::size_t inputIndex
+            = static_cast<std::size_t>(MessageType::ClientInputs);
+        REQUIRE((stats[updateIndex].messagesSent
+                 - baseline[updateIndex].messagesSent)
+                == 4000);
+        REQUIRE((stats[updateIndex].bytesSent - baseline[updateIndex].bytesSent)
+                == 40000);
+        REQUIRE((stats[inputIndex].messagesReceived
+                 - baseline[inputIndex].messagesReceived)
+                == 4000);
+        REQUIRE((stats[inputIndex].bytesReceived
+                 - baseline[inputIndex].bytesReceived)
+                == 20000);
+        REQUIRE((stats[inputIndex].messagesDropped
+                 - baseline[inputIndex].messagesDropped)
+                == 4);
+    }
+
+    SECTION("Client stats snapshot.")
+    {
+        Server::ClientStats clientStats;
+        clientStats.recordSend(3, 100, 0);
+        clientStats.recordSend(2, 50, 20);
+        clientStats.recordTickAdjustment();
+        clientStats.recordReceive(12);
+        clientStats.recordDrop();
+        clientStats.recordBackpressure();
+        clientStats.recordSupersededUpdates(4);
+
+        Server::ClientStatsSnapshot snapshot = clientStats.getSnapshot(7);
+        REQUIRE(snapshot.netID == 7);
+        REQUIRE(snapshot.messagesSent == 5);
+        REQUIRE(snapshot.bytesSent == 150);
+        REQUIRE(snapshot.sendQueueDepth == 2);
+        REQUIRE(snapshot.maxSendQueueDepth == 3);
+        REQUIRE(snapshot.backpressuredSends == 1);
+        REQUIRE(snapshot.updatesSuperseded == 4);
+        REQUIRE(snapshot.pendingOutputBytes == 20);
+        REQUIRE(snapshot.sendStalls == 1);
+        REQUIRE(snapshot.tickAdjustments == 1);
+        REQUIRE(snapshot.messagesReceived == 1);
+        REQUIRE(snapshot.bytesReceived == 12);
+        REQUIRE(snapshot.messagesDropped == 1);
+    }
+
+    SECTION("Client drops can be recorded from multiple threads.")
+    {
+        Server::ClientStats clientStats;
+        std::vector<std::thread> threads;
+        for (unsigned int i = 0; i < 2; ++i) {
+            threads.emplace_back([&clientStats]() {
+                for (unsigned int j = 0; j < 10000; ++j) {
+                    clientStats.recordDrop();
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        REQUIRE(clientStats.getSnapshot(0).messagesDropped == 20000);
+    }
+}
@@ -0,0 +1,94 @@
+#include <catch2/catch.hpp>
+#include "ReplicationHelpers.h"
+#include "ClientSimData.h"
+#include "CompactEntityState.h"
+
+using namespace AM;
+using namespace AM::Server;
+
+namespace
+{
+VisibleEntity makeKnownEntity(float x, float y)
+{
+    VisibleEntity visibleEntity{};
+    visibleEntity.entity = static_cast<entt::entity>(1);
+    visibleEntity.position.x = x;
+    visibleEntity.position.y = y;
+    visibleEntity.isKnownByClient = true;
+    return visibleEntity;
+}
+
+} // End anonymous namespace
+
+TEST_CASE("TestReplicationHelpers")
+{
+    static constexpr Config::ReplicationMode INPUT_ONLY
+        = Config::ReplicationMode::InputOnly;
+    Position aoiOrigin{};
+
+    // The client last received the entity standing still. Since then, its
+    // input changed and it started moving.
+    VisibleEntity baseline = makeKnownEntity(10, 10);
+    VisibleEntity current = makeKnownEntity(15, 10);
+    current.inputStates[Input::XUp] = Input::Pressed;
+    current.velocityCode = 1;
+
+    SECTION("An input change that's sent on time only sends the input.")
+    {
+        CompactEntityState state{};
+        ReplicationHelpers::buildCompactState(INPUT_ONLY, aoiOrigin, baseline,
+                                              current, state);
+        REQUIRE(state.changeMask == CompactEntityState::InputChanged);
+    }
+
+    SECTION("A deferred input change sends the velocity and position.")
+    {
+        ReplicationHelpers::deferChanges(INPUT_ONLY, baseline, current);
+        REQUIRE(baseline.needsKeyframe);
+
+        CompactEntityState state{};
+        ReplicationHelpers::buildCompactState(INPUT_ONLY, aoiOrigin, baseline,
+                                              current, state);
+        REQUIRE(state.changeMask == CompactEntityState::AllChanged);
+        REQUIRE(state.input.inputStates[Input::XUp] == Input::Pressed);
+        REQUIRE(state.velocityCode == 1);
+        REQUIRE(state.relativeX == 15);
+        REQUIRE(state.relativeY == 10);
+    }
+
+    SECTION("Deferring other changes doesn't need a keyframe.")
+    {
+        current.inputStates = baseline.inputStates;
+        ReplicationHelpers::deferChanges(INPUT_ONLY, baseline, current);
+        REQUIRE(!(baseline.needsKeyframe));
+    }
+
+    SECTION("FullState replication sends what changed, deferred or not.")
+    {
+        ReplicationHelpers::deferChanges(Config::ReplicationMode::FullState,
+                                         baseline, current);
+        REQUIRE(!(baseline.needsKeyframe));
+
+        CompactEntityState state{};
+        ReplicationHelpers::buildCompactState(
+            Config::ReplicationMode::FullState, aoiOrigin, baseline, current,
+            state);
+        REQUIRE(state.changeMask
+                == (CompactEntityState::InputChanged
+                    | CompactEntityState::VelocityChanged
+                    | CompactEntityState::PositionXYChanged));
+    }
+
+    SECTION("Positions outside of the AoI are clamped to its edges.")
+    {
+        current.position.x = -1;
+        current.position.y = (SharedConfig::AOI_HEIGHT + 1.0f);
+
+        CompactEntityState state{};
+        ReplicationHelpers::buildCompactState(
+            Config::ReplicationMode::FullState, aoiOrigin, baseline, current,
+            state);
+        REQUIRE(state.relativeX == 0);
+        REQUIRE(state.relativeY == SharedConfig::AOI_HEIGHT);
+    }
+}
@@ -0,0 +1,112 @@
+#include <catch2/catch.hpp>
+#include "SocketSet.h"
+#include "TcpSocket.h"
+#include <SDL2/SDL_net.h>
+#include <SDL_stdinc.h>
+#include <memory>
+#include <vector>
+
+using namespace AM;
+
+namespace
+{
+/** The port that the test connections are made over. */
+constexpr Uint16 TEST_PORT = 41498;
+
+/** The number of connections to receive over. */
+constexpr int SOCKET_COUNT = 48;
+
+/** The number of bytes to send over each connection. Across all of the
+    connections, this is more than the io_uring backend's provided buffers
+    can hold at once. */
+constexpr int BYTES_PER_SOCKET = (24 * 1024);
+
+/** The value of the byte at the given index of a socket's data. */
+Uint8 getExpectedByte(int socketIndex, int byteIndex)
+{
+    return static_cast<Uint8>((socketIndex + byteIndex) % 251);
+}
+
+} // End anonymous namespace
+
+TEST_CASE("TestSocketSet")
+{
+    REQUIRE(SDLNet_Init() != -1);
+
+    SocketSet::Backend requestedBackend{GENERATE(SocketSet::Backend::SDLNet,
+                                                 SocketSet::Backend::Epoll,
+                                                 SocketSet::Backend::IoUring)};
+    SocketSet set(SOCKET_COUNT, requestedBackend);
+
+    // Connect each sender to a receiving socket in the set.
+    TcpSocket listener(TEST_PORT);
+    std::vector<std::unique_ptr<TcpSocket>> senders;
+    std::vector<std::unique_ptr<TcpSocket>> receivers;
+    for (int i = 0; i < SOCKET_COUNT; ++i) {
+        senders.push_back(std::make_unique<TcpSocket>("127.0.0.1", TEST_PORT));
+
+        std::unique_ptr<TcpSocket> acceptedSocket{};
+        while (acceptedSocket == nullptr) {
+            acceptedSocket = listener.accept();
+        }
+        set.addSocket(*acceptedSocket);
+        receivers.push_back(std::move(acceptedSocket));
+    }
+
+    SECTION("All sent data is received, even past the buffers' capacity.")
+    {
+        // Send everything before anything is read.
+        std::vector<Uint8> data(BYTES_PER_SOCKET);
+        for (int i = 0; i < SOCKET_COUNT; ++i) {
+            for (int j = 0; j < BYTES_PER_SOCKET; ++j) {
+                data[j] = getExpectedByte(i, j);
+            }
+            senders[i]->send(data.data(), BYTES_PER_SOCKET);
+        }
+
+        // Read until everything arrives, checking that it's in order.
+        std::vector<int> receivedCounts(SOCKET_COUNT, 0);
+        int totalReceived = 0;
+        Uint8 receiveBuffer[1000];
+        for (int check = 0; check < 500; ++check) {
+            set.checkSockets(10);
+            for (int i = 0; i < SOCKET_COUNT; ++i) {
+                int received = set.receiveAvailable(
+                    *(receivers[i]), receiveBuffer, sizeof(receiveBuffer));
+                REQUIRE(received >= 0);
+                for (int j = 0; j < received; ++j) {
+                    REQUIRE(receiveBuffer[j]
+                            == getExpectedByte(i, receivedCounts[i] + j));
+                }
+                receivedCounts[i] += received;
+                totalReceived += received;
+            }
+
+            if (totalReceived == (SOCKET_COUNT * BYTES_PER_SOCKET)) {
+                break;
+            }
+        }
+
+        for (int count : receivedCounts) {
+            REQUIRE(count == BYTES_PER_SOCKET);
+        }
+    }
+
+    SECTION("A closed connection is reported.")
+    {
+        senders[0] = nullptr;
+
+        int received = 0;
+        for (int check = 0; (check < 100) && (received == 0); ++check) {
+            set.checkSockets(10);
+            Uint8 receiveBuffer[8];
+            received = set.receiveAvailable(*(receivers[0]), receiveBuffer,
+                                            sizeof(receiveBuffer));
+        }
+        REQUIRE(received == -1);
+    }
+
+    for (std::unique_ptr<TcpSocket>& receiver : receivers) {
+        set.remSocket(*receiver);
+    }
+}
@@ -0,0 +1,138 @@
+#include <catch2/catch.hpp>
+#include "TcpPeer.h"
+#include "TcpSocket.h"
+#include "SocketSet.h"
+#include <SDL2/SDL_net.h>
+#include <SDL_stdinc.h>
+#include <vector>
+
+using namespace AM;
+
+namespace
+{
+/** The port that the test connection is made over. */
+constexpr Uint16 TEST_PORT = 41499;
+
+/** Builds a {header, payload} frame, preceded by the given prefix bytes. */
+std::vector<Uint8> makeFrame(MessageType type, Uint16 payloadSize,
+                             Uint8 prefixSize = 0)
+{
+    std::vector<Uint8> frame(prefixSize + MESSAGE_HEADER_SIZE + payloadSize);
+    for (Uint8 i = 0; i < prefixSize; ++i) {
+        frame[i] = (0xF0 + i);
+    }
+
+    Uint8* header = &(frame[prefixSize]);
+    header[MessageHeaderIndex::MessageType] = static_cast<Uint8>(type);
+    _SDLNet_Write16(payloadSize, &(header[MessageHeaderIndex::Size]));
+    for (Uint16 i = 0; i < payloadSize; ++i) {
+        header[MessageHeaderIndex::MessageStart + i] = static_cast<Uint8>(i);
+    }
+
+    return frame;
+}
+
+/** Waits for the sent bytes to arrive, then tries to receive a message. */
+MessageResult receive(TcpPeer& peer, SocketSet& set,
+                      BinaryBufferPtr& messageBuffer,
+                      Uint8* prefixBuffer = nullptr,
+                      unsigned int prefixSize = 0)
+{
+    set.checkSockets(100);
+    return peer.receiveMessage(messageBuffer, prefixBuffer, prefixSize);
+}
+
+} // End anonymous namespace
+
+TEST_CASE("TestTcpPeer")
+{
+    REQUIRE(SDLNet_Init() != -1);
+
+    // Connect a raw sending socket to a receiving peer.
+    TcpSocket listener(TEST_PORT);
+    TcpSocket sender("127.0.0.1", TEST_PORT);
+    std::unique_ptr<TcpSocket> acceptedSocket{};
+    while (acceptedSocket == nullptr) {
+        acceptedSocket = listener.accept();
+    }
+    auto set{std::make_shared<SocketSet>(1)};
+    TcpPeer peer(std::move(acceptedSocket), set);
+
+    BinaryBufferPtr messageBuffer{};
+
+    SECTION("A whole frame is received as one message.")
+    {
+        std::vector<Uint8> frame{makeFrame(MessageType::Heartbeat, 10)};
+        sender.send(frame.data(), static_cast<int>(frame.size()));
+
+        MessageResult result{receive(peer, *set, messageBuffer)};
+        REQUIRE(result.networkResult == NetworkResult::Success);
+        REQUIRE(result.messageType == MessageType::Heartbeat);
+        REQUIRE(result.messageSize == 10);
+        for (Uint8 i = 0; i < 10; ++i) {
+            REQUIRE((*messageBuffer)[i] == i);
+        }
+    }
+
+    SECTION("A header split across reads is held until it completes.")
+    {
+        std::vector<Uint8> frame{makeFrame(MessageType::ClientInputs, 4)};
+        sender.send(frame.data(), 1);
+        REQUIRE(receive(peer, *set, messageBuffer).networkResult
+                == NetworkResult::NoWaitingData);
+
+        sender.send(&(frame[1]), static_cast<int>(frame.size() - 1));
+        MessageResult result{receive(peer, *set, messageBuffer)};
+        REQUIRE(result.networkResult == NetworkResult::Success);
+        REQUIRE(result.messageType == MessageType::ClientInputs);
+        REQUIRE(result.messageSize == 4);
+    }
+
+    SECTION("A body split across reads is held until it completes.")
+    {
+        std::vector<Uint8> frame{makeFrame(MessageType::EntityUpdate, 100, 2)};
+        std::size_t splitIndex = (frame.size() / 2);
+        sender.send(frame.data(), static_cast<int>(splitIndex));
+        Uint8 prefix[2]{};
+        REQUIRE(receive(peer, *set, messageBuffer, prefix, 2).networkResult
+                == NetworkResult::NoWaitingData);
+
+        sender.send(&(frame[splitIndex]),
+                    static_cast<int>(frame.size() - splitIndex));
+        MessageResult result{receive(peer, *set, messageBuffer, prefix, 2)};
+        REQUIRE(result.networkResult == NetworkResult::Success);
+        REQUIRE(result.messageSize == 100);
+        REQUIRE(prefix[0] == 0xF0);
+        REQUIRE(prefix[1] == 0xF1);
+        for (Uint8 i = 0; i < 100; ++i) {
+            REQUIRE((*messageBuffer)[i] == i);
+        }
+    }
+
+    SECTION("Back-to-back frames are received one at a time.")
+    {
+        std::vector<Uint8> frames{makeFrame(MessageType::Heartbeat, 3)};
+        std::vector<Uint8> second{makeFrame(MessageType::ClientInputs, 5)};
+        frames.insert(frames.end(), second.begin(), second.end());
+        sender.send(frames.data(), static_cast<int>(frames.size()));
+
+        MessageResult result{receive(peer, *set, messageBuffer)};
+        REQUIRE(result.messageType == MessageType::Heartbeat);
+        result = peer.receiveMessage(messageBuffer, nullptr, 0);
+        REQUIRE(result.networkResult == NetworkResult::Success);
+        REQUIRE(result.messageType == MessageType::ClientInputs);
+        REQUIRE(result.messageSize == 5);
+    }
+
+    SECTION("An oversized size header disconnects the peer.")
+    {
+        std::vector<Uint8> frame{makeFrame(MessageType::Heartbeat, 0)};
+        _SDLNet_Write16((Peer::MAX_MESSAGE_SIZE + 1),
+                        &(frame[MessageHeaderIndex::Size]));
+        sender.send(frame.data(), static_cast<int>(frame.size()));
+
+        REQUIRE(receive(peer, *set, messageBuffer).networkResult
+                == NetworkResult::Disconnected);
+        REQUIRE(!(peer.isConnected()));
+    }
+}
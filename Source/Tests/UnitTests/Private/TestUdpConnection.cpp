@@ -0,0 +1,310 @@
+#include <catch2/catch.hpp>
+#include "UdpConnection.h"
+#include <vector>
+
+using namespace AM;
+
+namespace
+{
+BinaryBuffer makePayload(Uint8 value)
+{
+    return BinaryBuffer(4, value);
+}
+
+/** Hands each of the given datagrams to the given connection. */
+void deliver(const std::vector<BinaryBuffer>& datagrams,
+             UdpConnection& receiver, double currentTimeS)
+{
+    for (const BinaryBuffer& datagram : datagrams) {
+        REQUIRE(receiver.processDatagram(datagram, currentTimeS));
+    }
+}
+
+/** Pops all of the delivered reliable payloads from the given connection. */
+std::vector<BinaryBuffer> popAllReliable(UdpConnection& connection)
+{
+    std::vector<BinaryBuffer> payloads;
+    BinaryBuffer payload;
+    while (connection.popReliable(payload)) {
+        payloads.push_back(payload);
+    }
+    return payloads;
+}
+
+} // End anonymous namespace
+
+TEST_CASE("TestUdpConnection")
+{
+    UdpConnection sender;
+    UdpConnection receiver;
+    std::vector<BinaryBuffer> datagrams;
+
+    SECTION("Reliable payloads are delivered in order.")
+    {
+        for (Uint8 i = 0; i < 3; ++i) {
+            REQUIRE(sender.queue(Channel::Reliable, makePayload(i)));
+        }
+        sender.writeDatagrams(0, datagrams);
+        REQUIRE(datagrams.size() == 3);
+        deliver(datagrams, receiver, 0);
+
+        std::vector<BinaryBuffer> payloads = popAllReliable(receiver);
+        REQUIRE(payloads.size() == 3);
+        for (Uint8 i = 0; i < 3; ++i) {
+            REQUIRE(payloads[i] == makePayload(i));
+        }
+    }
+
+    SECTION("Out of order reliable payloads are held until the gap fills.")
+    {
+        for (Uint8 i = 0; i < 3; ++i) {
+            REQUIRE(sender.queue(Channel::Reliable, makePayload(i)));
+        }
+        sender.writeDatagrams(0, datagrams);
+
+        REQUIRE(receiver.processDatagram(datagrams[2], 0));
+        REQUIRE(receiver.processDatagram(datagrams[1], 0));
+        REQUIRE(receiver.peekReliableSize() == 0);
+
+        REQUIRE(receiver.processDatagram(datagrams[0], 0));
+        std::vector<BinaryBuffer> payloads = popAllReliable(receiver);
+        REQUIRE(payloads.size() == 3);
+        for (Uint8 i = 0; i < 3; ++i) {
+            REQUIRE(payloads[i] == makePayload(i));
+        }
+    }
+
+    SECTION("Duplicate reliable payloads are only delivered once.")
+    {
+        REQUIRE(sender.queue(Channel::Reliable, makePayload(7)));
+        sender.writeDatagrams(0, datagrams);
+        deliver(datagrams, receiver, 0);
+        deliver(datagrams, receiver, 0);
+
+        REQUIRE(popAllReliable(receiver).size() == 1);
+    }
+
+    SECTION("Dropped reliable payloads are resent once their ack is late.")
+    {
+        REQUIRE(sender.queue(Channel::Reliable, makePayload(1)));
+        sender.writeDatagrams(0, datagrams);
+        REQUIRE(datagrams.size() == 1);
+
+        // Drop it. Nothing should be resent until the interval has passed.
+        datagrams.clear();
+        sender.writeDatagrams(0.01, datagrams);
+        REQUIRE(datagrams.empty());
+
+        double resendTimeS = (UdpConnection::MIN_RESEND_INTERVAL_S * 2);
+        sender.writeDatagrams(resendTimeS, datagrams);
+        REQUIRE(datagrams.size() == 1);
+        REQUIRE(sender.getResendCount() == 1);
+
+        deliver(datagrams, receiver, resendTimeS);
+        REQUIRE(popAllReliable(receiver).size() == 1);
+    }
+
+    SECTION("Acked reliable payloads are released and not resent.")
+    {
+        REQUIRE(sender.queue(Channel::Reliable, makePayload(1)));
+        sender.writeDatagrams(0, datagrams);
+        REQUIRE(sender.getUnackedReliableBytes() == 4);
+        deliver(datagrams, receiver, 0);
+
+        // The receiver owes an ack, so it should send one on its own.
+        datagrams.clear();
+        receiver.writeDatagrams(0.05, datagrams);
+        REQUIRE(datagrams.size() == 1);
+        deliver(datagrams, sender, 0.05);
+        REQUIRE(sender.getUnackedReliableBytes() == 0);
+
+        // Once the ack has gone out, it isn't owed anymore.
+        datagrams.clear();
+        receiver.writeDatagrams(0.06, datagrams);
+        REQUIRE(datagrams.empty());
+
+        datagrams.clear();
+        sender.writeDatagrams(1, datagrams);
+        REQUIRE(datagrams.empty());
+        REQUIRE(sender.getResendCount() == 0);
+    }
+
+    SECTION("Acks survive the loss of the datagram that first carried them.")
+    {
+        // Three reliable payloads, each acked by its own datagram.
+        std::vector<BinaryBuffer> acks;
+        for (Uint8 i = 0; i < 3; ++i) {
+            datagrams.clear();
+            REQUIRE(sender.queue(Channel::Reliable, makePayload(i)));
+            sender.writeDatagrams(0, datagrams);
+            deliver(datagrams, receiver, 0);
+            receiver.writeDatagrams(0, acks);
+        }
+        REQUIRE(acks.size() == 3);
+
+        // Only the last ack arrives, but its bitfield covers the others.
+        REQUIRE(sender.processDatagram(acks[2], 0));
+        REQUIRE(sender.getUnackedReliableBytes() == 0);
+    }
+
+    SECTION("Stale unreliable payloads are dropped.")
+    {
+        sender.queue(Channel::Unreliable, makePayload(1));
+        sender.queue(Channel::Unreliable, makePayload(2));
+        sender.writeDatagrams(0, datagrams);
+        REQUIRE(datagrams.size() == 2);
+
+        // Deliver the newer one first. The older one should be dropped.
+        REQUIRE(receiver.processDatagram(datagrams[1], 0));
+        REQUIRE(receiver.processDatagram(datagrams[0], 0));
+
+        BinaryBuffer payload;
+        REQUIRE(receiver.popUnreliable(payload));
+        REQUIRE(payload == makePayload(2));
+        REQUIRE(!(receiver.popUnreliable(payload)));
+    }
+
+    SECTION("Unreliable payloads are never resent.")
+    {
+        sender.queue(Channel::Unreliable, makePayload(1));
+        sender.writeDatagrams(0, datagrams);
+        REQUIRE(datagrams.size() == 1);
+
+        datagrams.clear();
+        sender.writeDatagrams(1, datagrams);
+        REQUIRE(datagrams.empty());
+    }
+
+    SECTION("Resends are paced, oldest first.")
+    {
+        std::size_t payloadCount = (UdpConnection::MAX_RESENDS_PER_WRITE + 2);
+        for (std::size_t i = 0; i < payloadCount; ++i) {
+            REQUIRE(sender.queue(Channel::Reliable,
+                                 makePayload(static_cast<Uint8>(i))));
+        }
+        sender.writeDatagrams(0, datagrams);
+        REQUIRE(datagrams.size() == payloadCount);
+
+        // Drop them all. Only a limited number should be resent at once.
+        datagrams.clear();
+        double resendTimeS = (UdpConnection::MIN_RESEND_INTERVAL_S * 2);
+        sender.writeDatagrams(resendTimeS, datagrams);
+        REQUIRE(datagrams.size() == UdpConnection::MAX_RESENDS_PER_WRITE);
+        std::vector<BinaryBuffer> firstResends{datagrams};
+
+        // The rest should go out in the next write.
+        datagrams.clear();
+        sender.writeDatagrams(resendTimeS, datagrams);
+        REQUIRE(datagrams.size() == 2);
+        REQUIRE(sender.getResendCount() == payloadCount);
+
+        // They should still be delivered in order.
+        deliver(datagrams, receiver, resendTimeS);
+        deliver(firstResends, receiver, resendTimeS);
+        std::vector<BinaryBuffer> payloads = popAllReliable(receiver);
+        REQUIRE(payloads.size() == payloadCount);
+        for (std::size_t i = 0; i < payloadCount; ++i) {
+            REQUIRE(payloads[i] == makePayload(static_cast<Uint8>(i)));
+        }
+    }
+
+    SECTION("Notified payloads are reported delivered once acked.")
+    {
+        BinaryBuffer payload{makePayload(1)};
+        sender.queueNotified(payload, 5);
+        sender.writeDatagrams(0, datagrams);
+        deliver(datagrams, receiver, 0);
+
+        // No notice until the ack arrives.
+        DeliveryNotice notice{};
+        REQUIRE(!(sender.popNotice(notice)));
+
+        datagrams.clear();
+        receiver.writeDatagrams(0.01, datagrams);
+        deliver(datagrams, sender, 0.01);
+        REQUIRE(sender.popNotice(notice));
+        REQUIRE(notice.notifyToken == 5);
+        REQUIRE(notice.wasDelivered);
+        REQUIRE(!(sender.popNotice(notice)));
+    }
+
+    SECTION("Notified payloads are reported lost after a timeout, in order.")
+    {
+        BinaryBuffer first{makePayload(1)};
+        BinaryBuffer second{makePayload(2)};
+        sender.queueNotified(first, 1);
+        sender.queueNotified(second, 2);
+        sender.writeDatagrams(0, datagrams);
+        REQUIRE(datagrams.size() == 2);
+
+        // Only the second arrives, and its ack gets back.
+        REQUIRE(receiver.processDatagram(datagrams[1], 0));
+        datagrams.clear();
+        receiver.writeDatagrams(0.01, datagrams);
+        deliver(datagrams, sender, 0.01);
+
+        // The second's notice must wait for the first to time out.
+        DeliveryNotice notice{};
+        REQUIRE(!(sender.popNotice(notice)));
+
+        datagrams.clear();
+        sender.writeDatagrams(1, datagrams);
+        REQUIRE(sender.popNotice(notice));
+        REQUIRE(notice.notifyToken == 1);
+        REQUIRE(!(notice.wasDelivered));
+        REQUIRE(sender.popNotice(notice));
+        REQUIRE(notice.notifyToken == 2);
+        REQUIRE(notice.wasDelivered);
+    }
+
+    SECTION("Stale unreliable payloads aren't acked.")
+    {
+        BinaryBuffer first{makePayload(1)};
+        BinaryBuffer second{makePayload(2)};
+        sender.queueNotified(first, 1);
+        sender.queueNotified(second, 2);
+        sender.writeDatagrams(0, datagrams);
+
+        // The first arrives after the second, so it's dropped.
+        REQUIRE(receiver.processDatagram(datagrams[1], 0));
+        REQUIRE(receiver.processDatagram(datagrams[0], 0));
+        datagrams.clear();
+        receiver.writeDatagrams(0.01, datagrams);
+        deliver(datagrams, sender, 0.01);
+
+        // Since it was never delivered, the sender should hear that it
+        // was lost.
+        datagrams.clear();
+        sender.writeDatagrams(1, datagrams);
+        DeliveryNotice notice{};
+        REQUIRE(sender.popNotice(notice));
+        REQUIRE(notice.notifyToken == 1);
+        REQUIRE(!(notice.wasDelivered));
+        REQUIRE(sender.popNotice(notice));
+        REQUIRE(notice.wasDelivered);
+    }
+
+    SECTION("Queueing fails once the reliable window is full.")
+    {
+        for (std::size_t i = 0; i < UdpConnection::RELIABLE_WINDOW_SIZE;
+             ++i) {
+            REQUIRE(sender.queue(Channel::Reliable, makePayload(0)));
+        }
+        REQUIRE(!(sender.queue(Channel::Reliable, makePayload(0))));
+
+        // Unreliable payloads aren't limited by the window.
+        REQUIRE(sender.queue(Channel::Unreliable, makePayload(0)));
+    }
+
+    SECTION("Connect datagrams are recognized, and foreign ones rejected.")
+    {
+        sender.writeConnect(0, datagrams);
+        REQUIRE(UdpConnection::isConnect(datagrams[0]));
+        REQUIRE(receiver.processDatagram(datagrams[0], 0));
+        REQUIRE(receiver.hasReceived());
+
+        BinaryBuffer foreign(UdpConnection::HEADER_SIZE, 0);
+        REQUIRE(!(UdpConnection::isConnect(foreign)));
+        REQUIRE(!(receiver.processDatagram(foreign, 0)));
+    }
+}